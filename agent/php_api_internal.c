@@ -15,6 +15,7 @@
 #include "nr_segment_tree.h"
 #include "util_logging.h"
 #include "util_memory.h"
+#include "util_set.h"
 #include "util_system.h"
 
 /* Test scaffolding. */
@@ -25,6 +25,7 @@
 #include "util_metrics.h"
 #include "util_number_converter.h"
 #include "util_strings.h"
+#include "util_suffix_matcher.h"
 #include "util_url.h"
 #include "util_url.h"
 #include "util_metrics.h"
@@ -494,6 +495,38 @@ static const nr_vuln_mgmt_table_t vuln_mgmt_packages[] = {
 static const size_t num_packages
     = sizeof(vuln_mgmt_packages) / sizeof(nr_vuln_mgmt_table_t);
 
+#define AUTOLOAD_MAGIC_FILE "vendor/autoload.php"
+#define AUTOLOAD_MAGIC_FILE_LEN (sizeof(AUTOLOAD_MAGIC_FILE) - 1)
+
+/*
+ * The key files of all of the tables above, and the autoload file, are
+ * matched with a single suffix matcher built at MINIT, so that every loaded
+ * file is examined once rather than once per table entry.
+ *
+ * A match's value combines the kind of table with the index of the entry in
+ * it. Values are reported in ascending order, so matches are handled in the
+ * order of the kinds below, and in table order within each kind.
+ */
+typedef enum _nr_file_match_kind_t {
+  NR_FILE_MATCH_FRAMEWORK = 0,
+  NR_FILE_MATCH_LIBRARY,
+  NR_FILE_MATCH_AUTOLOAD,
+  NR_FILE_MATCH_LOGGING_FRAMEWORK,
+  NR_FILE_MATCH_PACKAGE,
+} nr_file_match_kind_t;
+
+#define NR_FILE_MATCH_VALUE(kind, index) (((int)(kind) << 16) | (int)(index))
+#define NR_FILE_MATCH_KIND(value) ((nr_file_match_kind_t)((value) >> 16))
+#define NR_FILE_MATCH_INDEX(value) ((size_t)((value)&0xffff))
+
+/*
+ * The most matches handled for a single file. Key files are distinct enough
+ * that a file matches at most one entry of each kind.
+ */
+#define NR_FILE_MATCHES_MAX 8
+
+static nr_suffix_matcher_t* nr_php_file_matcher = NULL;
+
 /*
  * This const char[] provides enough white space to indent functions to
  * (sizeof (nr_php_indentation_spaces) / NR_EXECUTE_INDENTATION_WIDTH) deep.
@@ -620,9 +653,9 @@ static void nr_php_show_exec_return(NR_EXECUTE_PROTO TSRMLS_DC) {
 
 static nrframework_t nr_try_detect_framework(
     const nr_framework_table_t frameworks[],
-    size_t num_frameworks,
-    const char* filename,
-    const size_t filename_len TSRMLS_DC);
+    const int* matches,
+    size_t num_matches,
+    const char* filename TSRMLS_DC);
 static nrframework_t nr_try_force_framework(
     const nr_framework_table_t frameworks[],
     size_t num_frameworks,
@@ -682,8 +715,9 @@ void nr_framework_create_metric(TSRMLS_D) {
  */
 static void nr_execute_handle_framework(const nr_framework_table_t frameworks[],
                                         size_t num_frameworks,
-                                        const char* filename,
-                                        const size_t filename_len TSRMLS_DC) {
+                                        const int* matches,
+                                        size_t num_matches,
+                                        const char* filename TSRMLS_DC) {
   if (NR_FW_UNSET != NRPRG_SHARED(current_framework)) {
     return;
   }
@@ -692,7 +726,7 @@ static void nr_execute_handle_framework(const nr_framework_table_t frameworks[],
     nrframework_t detected_framework = NR_FW_UNSET;
 
     detected_framework = nr_try_detect_framework(
-        frameworks, num_frameworks, filename, filename_len TSRMLS_CC);
+        frameworks, matches, num_matches, filename TSRMLS_CC);
     if (NR_FW_UNSET != detected_framework) {
       NRPRG_SHARED(current_framework) = detected_framework;
     }
@@ -710,50 +744,50 @@ static void nr_execute_handle_framework(const nr_framework_table_t frameworks[],
   }
 }
 
-#define STR_AND_LEN(v) v, v##_len
-
 /*
- * Attempt to detect a framework.
+ * Attempt to detect a framework from the matches for a file.
  * Call the appropriate enable function if we find the framework.
  * Return the framework found, or NR_FW_UNSET otherwise.
  */
 static nrframework_t nr_try_detect_framework(
     const nr_framework_table_t frameworks[],
-    size_t num_frameworks,
-    const char* filename,
-    const size_t filename_len TSRMLS_DC) {
+    const int* matches,
+    size_t num_matches,
+    const char* filename TSRMLS_DC) {
   nrframework_t detected = NR_FW_UNSET;
-  size_t i;
+  size_t m;
 
-  for (i = 0; i < num_frameworks; i++) {
-    if (nr_striendswith(STR_AND_LEN(filename),
-                        STR_AND_LEN(frameworks[i].file_to_check))) {
-      /*
-       * If we have a special check function and it tells us to ignore
-       * the file name because some other condition wasn't met, continue
-       * the loop.
-       */
-      if (frameworks[i].special) {
-        nr_framework_classification_t special
-            = frameworks[i].special(filename TSRMLS_CC);
+  for (m = 0; m < num_matches; m++) {
+    size_t i = NR_FILE_MATCH_INDEX(matches[m]);
 
-        if (FRAMEWORK_IS_NORMAL == special) {
-          continue;
-        }
-      }
+    if (NR_FILE_MATCH_FRAMEWORK != NR_FILE_MATCH_KIND(matches[m])) {
+      break;
+    }
 
-      nr_framework_log("detected framework", frameworks[i].framework_name);
-      nrl_verbosedebug(
-          NRL_FRAMEWORK, "framework '%s' detected with %s, which ends with %s",
-          frameworks[i].framework_name, filename, frameworks[i].file_to_check);
+    /*
+     * If we have a special check function and it tells us to ignore
+     * the file name because some other condition wasn't met, continue
+     * the loop.
+     */
+    if (frameworks[i].special) {
+      nr_framework_classification_t special
+          = frameworks[i].special(filename TSRMLS_CC);
 
-      frameworks[i].enable(TSRMLS_C);
-      detected = frameworks[i].detected;
-      goto end;
+      if (FRAMEWORK_IS_NORMAL == special) {
+        continue;
+      }
     }
+
+    nr_framework_log("detected framework", frameworks[i].framework_name);
+    nrl_verbosedebug(
+        NRL_FRAMEWORK, "framework '%s' detected with %s, which ends with %s",
+        frameworks[i].framework_name, filename, frameworks[i].file_to_check);
+
+    frameworks[i].enable(TSRMLS_C);
+    detected = frameworks[i].detected;
+    break;
   }
 
-end:
   return detected;
 }
 
@@ -792,31 +826,18 @@ static nrframework_t nr_try_force_framework(
   return NR_FW_UNSET;
 }
 
-static void nr_execute_handle_library(const char* filename,
-                                      const size_t filename_len TSRMLS_DC) {
-  size_t i;
-
-  for (i = 0; i < num_libraries; i++) {
-    if (nr_striendswith(STR_AND_LEN(filename),
-                        STR_AND_LEN(libraries[i].file_to_check))) {
-      nrl_debug(NRL_INSTRUMENT, "detected library=%s",
-                libraries[i].library_name);
+static void nr_execute_handle_library(size_t i TSRMLS_DC) {
+  nrl_debug(NRL_INSTRUMENT, "detected library=%s", libraries[i].library_name);
 
-      nr_fw_support_add_library_supportability_metric(
-          NRPRG(txn), libraries[i].library_name);
+  nr_fw_support_add_library_supportability_metric(NRPRG(txn),
+                                                  libraries[i].library_name);
 
-      if (NULL != libraries[i].enable) {
-        libraries[i].enable(TSRMLS_C);
-      }
-    }
+  if (NULL != libraries[i].enable) {
+    libraries[i].enable(TSRMLS_C);
   }
 }
 
-static void nr_execute_handle_autoload(const char* filename,
-                                       const size_t filename_len) {
-#define AUTOLOAD_MAGIC_FILE "vendor/autoload.php"
-#define AUTOLOAD_MAGIC_FILE_LEN (sizeof(AUTOLOAD_MAGIC_FILE) - 1)
-
+static void nr_execute_handle_autoload(const char* filename) {
   if (!NRINI(vulnerability_management_package_detection_enabled)) {
     // do nothing when vulnerability management package detection is disabled
     return;
@@ -848,12 +869,6 @@ static void nr_execute_handle_autoload(const char* filename,
   }
   // clang-format on
 
-  if (!nr_striendswith(STR_AND_LEN(filename), AUTOLOAD_MAGIC_FILE,
-                       AUTOLOAD_MAGIC_FILE_LEN)) {
-    // not an autoload file
-    return;
-  }
-
   nrl_debug(NRL_FRAMEWORK, "detected autoload with %s, which ends with %s",
             filename, AUTOLOAD_MAGIC_FILE);
   NRPRG(txn)->composer_info.autoload_detected = true;
@@ -862,46 +877,109 @@ static void nr_execute_handle_autoload(const char* filename,
   nr_composer_handle_autoload(filename);
 }
 
-static void nr_execute_handle_logging_framework(const char* filename,
-                                                const size_t filename_len
-                                                    TSRMLS_DC) {
+static void nr_execute_handle_logging_framework(size_t i TSRMLS_DC) {
   bool is_enabled = false;
-  size_t i;
 
-  for (i = 0; i < num_logging_frameworks; i++) {
-    if (nr_striendswith(STR_AND_LEN(filename),
-                        STR_AND_LEN(logging_frameworks[i].file_to_check))) {
-      nrl_debug(NRL_INSTRUMENT, "detected library=%s",
-                logging_frameworks[i].library_name);
+  nrl_debug(NRL_INSTRUMENT, "detected library=%s",
+            logging_frameworks[i].library_name);
 
-      nr_fw_support_add_library_supportability_metric(
-          NRPRG(txn), logging_frameworks[i].library_name);
+  nr_fw_support_add_library_supportability_metric(
+      NRPRG(txn), logging_frameworks[i].library_name);
 
-      if (NRINI(logging_enabled) && NULL != logging_frameworks[i].enable) {
-        is_enabled = true;
-        logging_frameworks[i].enable(TSRMLS_C);
-      }
-      nr_fw_support_add_logging_supportability_metric(
-          NRPRG(txn), logging_frameworks[i].library_name, is_enabled);
-    }
+  if (NRINI(logging_enabled) && NULL != logging_frameworks[i].enable) {
+    is_enabled = true;
+    logging_frameworks[i].enable(TSRMLS_C);
+  }
+  nr_fw_support_add_logging_supportability_metric(
+      NRPRG(txn), logging_frameworks[i].library_name, is_enabled);
+}
+
+static void nr_execute_handle_package(size_t i) {
+  if (NULL != vuln_mgmt_packages[i].enable) {
+    vuln_mgmt_packages[i].enable();
   }
 }
 
-static void nr_execute_handle_package(const char* filename,
-                                      const size_t filename_len) {
-  size_t i = 0;
+void nr_php_execute_minit(void) {
+  size_t i;
+
+  nr_php_file_matcher = nr_suffix_matcher_create();
 
+  for (i = 0; i < (size_t)num_all_frameworks; i++) {
+    nr_suffix_matcher_add(
+        nr_php_file_matcher, all_frameworks[i].file_to_check,
+        all_frameworks[i].file_to_check_len,
+        NR_FILE_MATCH_VALUE(NR_FILE_MATCH_FRAMEWORK, i));
+  }
+  for (i = 0; i < num_libraries; i++) {
+    nr_suffix_matcher_add(nr_php_file_matcher, libraries[i].file_to_check,
+                          libraries[i].file_to_check_len,
+                          NR_FILE_MATCH_VALUE(NR_FILE_MATCH_LIBRARY, i));
+  }
+  nr_suffix_matcher_add(nr_php_file_matcher, AUTOLOAD_MAGIC_FILE,
+                        AUTOLOAD_MAGIC_FILE_LEN,
+                        NR_FILE_MATCH_VALUE(NR_FILE_MATCH_AUTOLOAD, 0));
+  for (i = 0; i < num_logging_frameworks; i++) {
+    nr_suffix_matcher_add(
+        nr_php_file_matcher, logging_frameworks[i].file_to_check,
+        logging_frameworks[i].file_to_check_len,
+        NR_FILE_MATCH_VALUE(NR_FILE_MATCH_LOGGING_FRAMEWORK, i));
+  }
   for (i = 0; i < num_packages; i++) {
-    if (nr_striendswith(STR_AND_LEN(filename),
-                        STR_AND_LEN(vuln_mgmt_packages[i].file_to_check))) {
-      if (NULL != vuln_mgmt_packages[i].enable) {
-        vuln_mgmt_packages[i].enable();
-      }
-    }
+    nr_suffix_matcher_add(nr_php_file_matcher,
+                          vuln_mgmt_packages[i].file_to_check,
+                          vuln_mgmt_packages[i].file_to_check_len,
+                          NR_FILE_MATCH_VALUE(NR_FILE_MATCH_PACKAGE, i));
   }
 }
 
-#undef STR_AND_LEN
+void nr_php_execute_mshutdown(void) {
+  nr_suffix_matcher_destroy(&nr_php_file_matcher);
+}
+
+/*
+ * Purpose : Enable the frameworks, libraries and packages matched by a file.
+ *
+ * Params  : 1. Full name of a PHP file.
+ *           2. The file's matches, as returned by the file matcher.
+ *           3. The number of matches.
+ */
+static void nr_php_user_instrumentation_from_matches(const char* filename,
+                                                     const int* matches,
+                                                     size_t num_matches
+                                                         TSRMLS_DC) {
+  size_t i;
+
+  /*
+   * A forced framework is enabled on the first file loaded, so framework
+   * handling cannot be skipped when nothing matched.
+   */
+  nr_execute_handle_framework(all_frameworks, num_all_frameworks, matches,
+                              num_matches, filename TSRMLS_CC);
+
+  for (i = 0; i < num_matches; i++) {
+    size_t index = NR_FILE_MATCH_INDEX(matches[i]);
+
+    switch (NR_FILE_MATCH_KIND(matches[i])) {
+      case NR_FILE_MATCH_FRAMEWORK:
+        break;
+      case NR_FILE_MATCH_LIBRARY:
+        nr_execute_handle_library(index TSRMLS_CC);
+        break;
+      case NR_FILE_MATCH_AUTOLOAD:
+        nr_execute_handle_autoload(filename);
+        break;
+      case NR_FILE_MATCH_LOGGING_FRAMEWORK:
+        nr_execute_handle_logging_framework(index TSRMLS_CC);
+        break;
+      case NR_FILE_MATCH_PACKAGE:
+        if (NRINI(vulnerability_management_package_detection_enabled)) {
+          nr_execute_handle_package(index);
+        }
+        break;
+    }
+  }
+}
 
 /*
  * Purpose : Detect library and framework usage from a PHP file.
@@ -914,6 +992,9 @@ static void nr_execute_handle_package(const char* filename,
 static void nr_php_user_instrumentation_from_file(const char* filename,
                                                   const size_t filename_len
                                                       TSRMLS_DC) {
+  int matches[NR_FILE_MATCHES_MAX];
+  size_t num_matches;
+
   /* short circuit if filename_len is 0; a single place short circuit */
   if (0 == filename_len) {
     nrl_verbosedebug(NRL_AGENT,
@@ -921,15 +1002,120 @@ static void nr_php_user_instrumentation_from_file(const char* filename,
                      filename);
     return;
   }
-  nr_execute_handle_framework(all_frameworks, num_all_frameworks, filename,
-                              filename_len TSRMLS_CC);
-  nr_execute_handle_library(filename, filename_len TSRMLS_CC);
-  nr_execute_handle_autoload(filename, filename_len);
-  nr_execute_handle_logging_framework(filename, filename_len TSRMLS_CC);
-  if (NRINI(vulnerability_management_package_detection_enabled)) {
-    nr_execute_handle_package(filename, filename_len);
+
+  num_matches = nr_suffix_matcher_match(nr_php_file_matcher, filename,
+                                        filename_len, matches,
+                                        NR_FILE_MATCHES_MAX);
+
+  nr_php_user_instrumentation_from_matches(filename, matches,
+                                           num_matches TSRMLS_CC);
+}
+
+#if ZEND_MODULE_API_NO >= ZEND_7_3_X_API_NO
+/*
+ * The matches of every file the executor loads are cached per worker, keyed
+ * by the address of the file name, so that a file loaded again costs a
+ * single hash lookup rather than a walk of the file matcher. Only the
+ * matches are cached: the handlers still run for every load, as what they
+ * enable is per request.
+ *
+ * Only permanent interned file names are cached, which in practice means
+ * those held in opcache's shared memory. Request interned strings are freed
+ * at the end of each request, and their addresses reused. A permanent name
+ * can also be freed and its address reused by an opcache restart, so the
+ * length and hash of the name are kept to validate a hit.
+ */
+typedef struct _nr_php_file_cache_entry_t {
+  zend_ulong hash;
+  size_t len;
+  size_t num_matches;
+  int matches[];
+} nr_php_file_cache_entry_t;
+
+/*
+ * The most file names cached. Repeated opcache restarts leave stale entries
+ * behind, so the cache is emptied once it reaches this size.
+ */
+#define NR_PHP_FILE_CACHE_MAX 16384
+
+/*
+ * Applications load a few thousand files, so the cache starts with enough
+ * buckets to keep their chains short.
+ */
+#define NR_PHP_FILE_CACHE_BUCKETS 4096
+
+static void nr_php_file_cache_entry_destroy(void* entry) {
+  nr_free(entry);
+}
+
+/*
+ * Purpose : Detect library and framework usage from the file of an op array,
+ *           using the file cache where the file name allows it.
+ *
+ * Params  : 1. The op array of the file being executed.
+ */
+static void nr_php_user_instrumentation_from_op_array(
+    const zend_op_array* op_array TSRMLS_DC) {
+  zend_string* filename = op_array->filename;
+  nr_php_file_cache_entry_t* entry;
+  int matches[NR_FILE_MATCHES_MAX];
+  size_t num_matches;
+  uint64_t key;
+
+  if (NULL == filename || 0 == ZSTR_LEN(filename)
+      || !ZSTR_IS_INTERNED(filename)
+      || !(GC_FLAGS(filename) & IS_STR_PERMANENT)) {
+    nr_php_user_instrumentation_from_file(
+        nr_php_op_array_file_name(op_array),
+        nr_php_op_array_file_name_len(op_array) TSRMLS_CC);
+    return;
   }
+
+  key = (uint64_t)(uintptr_t)filename;
+  entry = (nr_php_file_cache_entry_t*)nr_hashmap_index_get(
+      NRPRG_SHARED(file_cache), key);
+
+  if (entry && entry->len == ZSTR_LEN(filename)
+      && entry->hash == zend_string_hash_val(filename)) {
+    NRTXNGLOBAL(file_cache_hits) += 1;
+    nr_php_user_instrumentation_from_matches(
+        ZSTR_VAL(filename), entry->matches, entry->num_matches TSRMLS_CC);
+    return;
+  }
+
+  NRTXNGLOBAL(file_cache_misses) += 1;
+
+  num_matches
+      = nr_suffix_matcher_match(nr_php_file_matcher, ZSTR_VAL(filename),
+                                ZSTR_LEN(filename), matches,
+                                NR_FILE_MATCHES_MAX);
+
+  if (NULL == NRPRG_SHARED(file_cache)
+      || nr_hashmap_count(NRPRG_SHARED(file_cache)) >= NR_PHP_FILE_CACHE_MAX) {
+    nr_hashmap_destroy(&NRPRG_SHARED(file_cache));
+    NRPRG_SHARED(file_cache) = nr_hashmap_create_buckets(
+        NR_PHP_FILE_CACHE_BUCKETS, nr_php_file_cache_entry_destroy);
+  }
+
+  entry = nr_malloc(sizeof(nr_php_file_cache_entry_t)
+                    + num_matches * sizeof(int));
+  entry->hash = zend_string_hash_val(filename);
+  entry->len = ZSTR_LEN(filename);
+  entry->num_matches = num_matches;
+  nr_memcpy(entry->matches, matches, num_matches * sizeof(int));
+  nr_hashmap_index_update(NRPRG_SHARED(file_cache), key, entry);
+
+  nr_php_user_instrumentation_from_matches(ZSTR_VAL(filename), matches,
+                                           num_matches TSRMLS_CC);
+}
+#else
+static void nr_php_user_instrumentation_from_op_array(
+    const zend_op_array* op_array TSRMLS_DC) {
+  nr_php_user_instrumentation_from_file(
+      nr_php_op_array_file_name(op_array),
+      nr_php_op_array_file_name_len(op_array) TSRMLS_CC);
 }
+#endif /* PHP >= 7.3 */
 
 /*
  * The maximum length of a custom metric.
@@ -939,7 +1125,6 @@ static void nr_php_user_instrumentation_from_file(const char* filename,
 void nr_php_execute_file(const zend_op_array* op_array,
                          NR_EXECUTE_PROTO TSRMLS_DC) {
   const char* filename = nr_php_op_array_file_name(op_array);
-  size_t filename_len = nr_php_op_array_file_name_len(op_array);
 
   NR_UNUSED_FUNC_RETURN_VALUE;
 
@@ -950,7 +1135,7 @@ void nr_php_execute_file(const zend_op_array* op_array,
   /*
    * Check for, and handle, frameworks and libraries.
    */
-  nr_php_user_instrumentation_from_file(filename, filename_len TSRMLS_CC);
+  nr_php_user_instrumentation_from_op_array(op_array TSRMLS_CC);
 
   nr_txn_match_file(NRPRG(txn), filename);
 
@@ -1817,6 +2002,17 @@ static void nr_php_instrument_func_begin(NR_EXECUTE_PROTO) {
   }
   wraprec = nr_php_get_wraprec(execute_data->func);
 
+  if (NULL == wraprec) {
+    /*
+     * Most uninstrumented calls are short and their segments are discarded,
+     * so only record a pending frame. It is turned into a segment if the call
+     * gets a child or attributes, or runs long enough to be kept. This is the
+     * OAPI counterpart of stacked segments.
+     */
+    nr_txn_pending_frame_push(NRPRG(txn), execute_data);
+    return;
+  }
+
   segment = nr_segment_start(NRPRG(txn), NULL, NULL);
 
   if (nrunlikely(NULL == segment)) {
@@ -1824,10 +2020,6 @@ static void nr_php_instrument_func_begin(NR_EXECUTE_PROTO) {
     return;
   }
 
-  if (NULL == wraprec) {
-    return;
-  }
-
   /* Store information that the segment is exception handler segment directly in
    * the segment, because exception handler can call restore_exception_handler,
    * and that will reset is_exception_handler flag in the wraprec */
@@ -1874,6 +2066,42 @@ static void nr_php_instrument_func_begin(NR_EXECUTE_PROTO) {
   }
 }
 
+/*
+ * Purpose : End a call that never needed a segment while it ran, starting one
+ *           for it only if it ran long enough to be kept.
+ *
+ * Params  : 1. The start time of the call's pending frame.
+ */
+static void nr_php_instrument_pending_frame_end(nrtime_t start_time,
+                                                NR_EXECUTE_PROTO) {
+  nr_segment_t* segment = NULL;
+  nr_php_execute_metadata_t metadata = {0};
+  nrtime_t stop_time = 0;
+  NR_UNUSED_FUNC_RETURN_VALUE;
+
+  if (!NRINI(tt_detail) || !(NR_OP_ARRAY->function_name)) {
+    return;
+  }
+
+  stop_time = nr_txn_now_rel(NRPRG(txn));
+  if (nr_time_duration(start_time, stop_time)
+      < NR_PHP_PROCESS_GLOBALS(expensive_min)) {
+    return;
+  }
+
+  segment = nr_segment_start(NRPRG(txn), NULL, NULL);
+  if (nrunlikely(NULL == segment)) {
+    nrl_verbosedebug(NRL_AGENT, "Error starting segment.");
+    return;
+  }
+  segment->start_time = start_time;
+  segment->stop_time = stop_time;
+
+  nr_php_execute_metadata_init(&metadata, NR_OP_ARRAY);
+  nr_php_execute_segment_end(segment, &metadata, false);
+  nr_php_execute_metadata_release(&metadata);
+}
+
 static void nr_php_instrument_func_end(NR_EXECUTE_PROTO) {
   int zcaught = 0;
   nr_segment_t* segment = NULL;
@@ -1881,10 +2109,23 @@ static void nr_php_instrument_func_end(NR_EXECUTE_PROTO) {
   bool create_metric = false;
   nr_php_execute_metadata_t metadata = {0};
   nrtime_t txn_start_time = 0;
+  nrtime_t start_time = 0;
 
   if (NULL == NRPRG(txn)) {
     return;
   }
+
+  /*
+   * A call that still has a pending frame had no children or attributes. An
+   * uncaught exception is recorded on the call's segment, so that case takes
+   * the regular path below, which materializes the frame.
+   */
+  if (NULL != nr_php_get_return_value(NR_EXECUTE_ORIG_ARGS)
+      && nr_txn_pending_frame_pop(NRPRG(txn), execute_data, &start_time)) {
+    nr_php_instrument_pending_frame_end(start_time, NR_EXECUTE_ORIG_ARGS);
+    return;
+  }
+
   txn_start_time = nr_txn_start_time(NRPRG(txn));
 
   /*
@@ -30,6 +30,17 @@
 extern void nr_php_execute_file(const zend_op_array* op_array,
                                 NR_EXECUTE_PROTO TSRMLS_DC);
 
+/*
+ * Purpose : Build the matcher for the key files of frameworks, libraries and
+ *           packages that nr_php_execute_file() checks loaded files against.
+ */
+extern void nr_php_execute_minit(void);
+
+/*
+ * Purpose : Destroy the matcher built by nr_php_execute_minit().
+ */
+extern void nr_php_execute_mshutdown(void);
+
 /*
  * Purpose: Log information about the execute data in a given execution
  * context - either 'execute' (zend_execute) or 'observe' (fcall_init).
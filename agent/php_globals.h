@@ -58,6 +58,10 @@ typedef struct _nrphpglobals_t {
   int done_instrumentation;  /* Set to true if we have installed instrumentation
                                 handlers */
   nrtime_t expensive_min;    /* newrelic.special.expensive_node_min */
+  size_t segment_page_cache_limit; /* newrelic.special.segment_page_cache_limit
+                                    */
+  size_t sql_cache_limit;    /* newrelic.special.sql_cache_limit */
+  size_t string_intern_limit; /* newrelic.special.string_intern_limit */
   char* upgrade_license_key; /* License key from special file created during 2.9
                                 upgrades */
   nrobj_t* appenv;           /* Application environment */
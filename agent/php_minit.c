@@ -32,6 +32,9 @@
 #include "util_logging.h"
 #include "util_memory.h"
 #include "util_signals.h"
+#include "util_slab.h"
+#include "util_sql_cache.h"
+#include "util_string_intern.h"
 #include "util_strings.h"
 #include "util_syscalls.h"
 #include "util_threads.h"
@@ -124,6 +127,11 @@ PHP_GSHUTDOWN_FUNCTION(newrelic) {
    * cope with an uninitialised extensions structure.
    */
   nr_php_extension_instrument_destroy(&newrelic_globals->shared.extensions);
+
+  /*
+   * The file cache is likewise allocated by the first file loaded.
+   */
+  nr_hashmap_destroy(&newrelic_globals->shared.file_cache);
 }
 
 #if defined(__GNUC__)
@@ -662,6 +670,23 @@ PHP_MINIT_FUNCTION(newrelic) {
   nr_php_check_logging_config(TSRMLS_C);
   nr_php_check_high_security_log_forwarding(TSRMLS_C);
 
+  /*
+   * Keep segment slab pages warm between requests in long lived processes.
+   */
+  nr_slab_page_cache_set_limit(
+      NR_PHP_PROCESS_GLOBALS(segment_page_cache_limit));
+
+  /*
+   * Reuse the results of obfuscating and parsing repeated SQL statements.
+   */
+  nr_sql_cache_set_limit(NR_PHP_PROCESS_GLOBALS(sql_cache_limit));
+
+  /*
+   * Share metric and segment names between transactions instead of copying
+   * them into each transaction's string pools.
+   */
+  nr_string_intern_set_limit(NR_PHP_PROCESS_GLOBALS(string_intern_limit));
+
   /*
    * Save the original PHP hooks and then apply our own hooks. The agent is
    * almost fully operational now. The last remaining initialization that
@@ -727,6 +752,7 @@ PHP_MINIT_FUNCTION(newrelic) {
   nr_guzzle4_minit(TSRMLS_C);
   nr_guzzle6_minit(TSRMLS_C);
   nr_wordpress_minit();
+  nr_php_execute_minit();
   nr_php_set_opcode_handlers();
 
   nrl_debug(NRL_INIT, "MINIT processing done");
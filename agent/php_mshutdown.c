@@ -15,6 +15,9 @@
 #include "php_vm.h"
 #include "nr_agent.h"
 #include "util_logging.h"
+#include "util_slab.h"
+#include "util_sql_cache.h"
+#include "util_string_intern.h"
 #include "fw_wordpress.h"
 #include "lib_aws_sdk_php.h"
 
@@ -42,6 +45,7 @@ PHP_MSHUTDOWN_FUNCTION(newrelic) {
   nrl_debug(NRL_INIT, "MSHUTDOWN processing started");
 
   nr_wordpress_mshutdown();
+  nr_php_execute_mshutdown();
 
 #if ZEND_MODULE_API_NO >= ZEND_8_1_X_API_NO /* PHP 8.1+ */
   nr_aws_sdk_mshutdown();
@@ -60,6 +64,14 @@ PHP_MSHUTDOWN_FUNCTION(newrelic) {
   nr_php_destroy_user_wrap_records();
   nr_php_global_destroy();
   nr_applist_destroy(&nr_agent_applist);
+  nr_slab_page_cache_set_limit(0);
+  nr_sql_cache_set_limit(0);
+
+  /*
+   * This must come last: every string pool that might reference an interned
+   * string has been destroyed by now.
+   */
+  nr_string_intern_set_limit(0);
 
   return SUCCESS;
 }
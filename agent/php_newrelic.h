@@ -316,6 +316,10 @@ typedef struct _ini_t {
       tt_max_segments_web;  // newrelic.transaction_tracer.max_segments_web
   nriniuint_t
       tt_max_segments_cli;   // newrelic.transaction_tracer.max_segments_cli
+  nrinibool_t
+      tt_release_completed_segments;  // newrelic.transaction_tracer.release_completed_segments
+  nrinibool_t
+      tt_observe_instrumented_only;  // newrelic.transaction_tracer.observe_instrumented_only
   nrinibool_t tt_slowsql;    // newrelic.transaction_tracer.slow_sql
   nrinitime_t tt_threshold;  // newrelic.transaction_tracer.threshold
   nrinitime_t ep_threshold;  // newrelic.transaction_tracer.explain_threshold
@@ -427,6 +431,7 @@ typedef struct _shared_globals_t {
   int wtfiles_where;   // Where was newrelic.webtransaction.name.files set?
   int ttcustom_where;  // Where was newrelic.transaction_tracer.custom set?
   nr_php_extensions_t* extensions;  // Instrumented extensions
+  nr_hashmap_t* file_cache;         // Cached matches of loaded files
 
   /*
    * Save a valid pointer to the sapi_headers_struct for the current response.
@@ -457,6 +462,12 @@ typedef struct _shared_globals_t {
   nrphpcufafn_t
       cufa_callback;  // The current call_user_func_array callback, if any
 
+#if ZEND_MODULE_API_NO >= ZEND_8_0_X_API_NO \
+    && !defined OVERWRITE_ZEND_EXECUTE_DATA
+  bool observer_skipped_functions;  // True once a user function has been
+                                    // left unobserved in this request
+#endif
+
 #if ZEND_MODULE_API_NO < ZEND_7_4_X_API_NO
   /*
    * pid and user_function_wrappers are used to store user function wrappers.
@@ -545,6 +556,8 @@ typedef struct _ctx_globals_t {
  */
 typedef struct _txn_globals_t {
   int execute_count;  // How many times nr_php_execute_enabled was called
+  int file_cache_hits;    // Loaded files found in the file cache
+  int file_cache_misses;  // Loaded files missing from the file cache
   int generating_explain_plan;  // Are we currently working on an explain plan?
   nr_hashmap_t* guzzle_objs;    // Guzzle request object storage: requests that
                                 // are currently in progress are stored here
@@ -1113,6 +1113,110 @@ static PHP_INI_MH(nr_special_expensive_node_min_mh) {
   return SUCCESS;
 }
 
+/*
+ * The default high-water mark for the segment page cache. This is enough to
+ * keep the pages for a transaction of a few thousand segments warm.
+ */
+#define NR_PHP_SEGMENT_PAGE_CACHE_LIMIT_DEFAULT (1024 * 1024)
+
+static PHP_INI_MH(nr_special_segment_page_cache_limit_mh) {
+  long val;
+
+  (void)entry;
+  (void)mh_arg1;
+  (void)mh_arg2;
+  (void)mh_arg3;
+  (void)stage;
+  NR_UNUSED_TSRMLS;
+
+  NR_PHP_PROCESS_GLOBALS(segment_page_cache_limit)
+      = NR_PHP_SEGMENT_PAGE_CACHE_LIMIT_DEFAULT;
+
+  if (0 != NEW_VALUE_LEN) {
+    val = strtol(NEW_VALUE, 0, 10);
+    if (val < 0) {
+      nrl_warning(NRL_INIT,
+                  "The value \"%s\" is not valid for the "
+                  "newrelic.special.segment_page_cache_limit setting, using "
+                  "default value instead.",
+                  NEW_VALUE);
+      return SUCCESS;
+    }
+    NR_PHP_PROCESS_GLOBALS(segment_page_cache_limit) = (size_t)val;
+  }
+
+  return SUCCESS;
+}
+
+/*
+ * The default number of statements held in the SQL cache. Applications
+ * rarely issue more distinct statements than this.
+ */
+#define NR_PHP_SQL_CACHE_LIMIT_DEFAULT 1000
+
+static PHP_INI_MH(nr_special_sql_cache_limit_mh) {
+  long val;
+
+  (void)entry;
+  (void)mh_arg1;
+  (void)mh_arg2;
+  (void)mh_arg3;
+  (void)stage;
+  NR_UNUSED_TSRMLS;
+
+  NR_PHP_PROCESS_GLOBALS(sql_cache_limit) = NR_PHP_SQL_CACHE_LIMIT_DEFAULT;
+
+  if (0 != NEW_VALUE_LEN) {
+    val = strtol(NEW_VALUE, 0, 10);
+    if (val < 0) {
+      nrl_warning(NRL_INIT,
+                  "The value \"%s\" is not valid for the "
+                  "newrelic.special.sql_cache_limit setting, using "
+                  "default value instead.",
+                  NEW_VALUE);
+      return SUCCESS;
+    }
+    NR_PHP_PROCESS_GLOBALS(sql_cache_limit) = (size_t)val;
+  }
+
+  return SUCCESS;
+}
+
+/*
+ * The default number of interned strings. This comfortably covers the metric
+ * and segment names of a typical application.
+ */
+#define NR_PHP_STRING_INTERN_LIMIT_DEFAULT 10000
+
+static PHP_INI_MH(nr_special_string_intern_limit_mh) {
+  long val;
+
+  (void)entry;
+  (void)mh_arg1;
+  (void)mh_arg2;
+  (void)mh_arg3;
+  (void)stage;
+  NR_UNUSED_TSRMLS;
+
+  NR_PHP_PROCESS_GLOBALS(string_intern_limit)
+      = NR_PHP_STRING_INTERN_LIMIT_DEFAULT;
+
+  if (0 != NEW_VALUE_LEN) {
+    val = strtol(NEW_VALUE, 0, 10);
+    if (val < 0) {
+      nrl_warning(NRL_INIT,
+                  "The value \"%s\" is not valid for the "
+                  "newrelic.special.string_intern_limit setting, using "
+                  "default value instead.",
+                  NEW_VALUE);
+      return SUCCESS;
+    }
+    NR_PHP_PROCESS_GLOBALS(string_intern_limit) = (size_t)val;
+  }
+
+  return SUCCESS;
+}
+
 static PHP_INI_MH(nr_special_enable_extension_instrumentation_mh) {
   int val = 0;
 
@@ -2277,6 +2381,21 @@ PHP_INI_ENTRY_EX("newrelic.special.expensive_node_min",
                  NR_PHP_SYSTEM,
                  nr_special_expensive_node_min_mh,
                  0)
+PHP_INI_ENTRY_EX("newrelic.special.segment_page_cache_limit",
+                 "",
+                 NR_PHP_SYSTEM,
+                 nr_special_segment_page_cache_limit_mh,
+                 0)
+PHP_INI_ENTRY_EX("newrelic.special.sql_cache_limit",
+                 "",
+                 NR_PHP_SYSTEM,
+                 nr_special_sql_cache_limit_mh,
+                 0)
+PHP_INI_ENTRY_EX("newrelic.special.string_intern_limit",
+                 "",
+                 NR_PHP_SYSTEM,
+                 nr_special_string_intern_limit_mh,
+                 0)
 PHP_INI_ENTRY_EX("newrelic.special.enable_extension_instrumentation",
                  "",
                  NR_PHP_SYSTEM,
@@ -2552,6 +2671,22 @@ STD_PHP_INI_ENTRY_EX("newrelic.transaction_tracer.max_segments_web",
                      zend_newrelic_globals,
                      newrelic_globals,
                      0)
+STD_PHP_INI_ENTRY_EX("newrelic.transaction_tracer.release_completed_segments",
+                     "0",
+                     NR_PHP_REQUEST,
+                     nr_boolean_mh,
+                     ini.tt_release_completed_segments,
+                     zend_newrelic_globals,
+                     newrelic_globals,
+                     0)
+STD_PHP_INI_ENTRY_EX("newrelic.transaction_tracer.observe_instrumented_only",
+                     "1",
+                     NR_PHP_REQUEST,
+                     nr_boolean_mh,
+                     ini.tt_observe_instrumented_only,
+                     zend_newrelic_globals,
+                     newrelic_globals,
+                     0)
 STD_PHP_INI_ENTRY_EX("newrelic.transaction_tracer.slow_sql",
                      "1",
                      NR_PHP_REQUEST,
@@ -69,6 +69,43 @@
  */
 
 #if ZEND_MODULE_API_NO >= ZEND_8_0_X_API_NO /* PHP8+ */
+/*
+ * Determine whether user functions without a wraprec can be left unobserved.
+ *
+ * When newrelic.transaction_tracer.detail is 0, the begin and end handlers of
+ * a function without a wraprec only start a segment and then discard it, so
+ * the function can be registered without handlers and run at full speed.
+ * Handlers are still needed for every function while anything else relies on
+ * seeing each call: a call_user_func_array() callback installed by framework
+ * instrumentation, the nesting level limit, or the execute debug output.
+ *
+ * The Observer API asks for a function's handlers only on its first call in a
+ * request, and this is decided then, so a wraprec that is added after that
+ * call, for example by newrelic_add_custom_tracer() or by instrumentation of a
+ * framework that is detected later, only takes effect in later requests.
+ * nr_php_wraprec_lookup_set() logs when that happens.
+ */
+static bool nr_php_observer_is_selective(void) {
+  if (!NRINI(tt_observe_instrumented_only) || NRINI(tt_detail)) {
+    return false;
+  }
+
+  if (NULL != NRPRG_SHARED(cufa_callback)) {
+    return false;
+  }
+
+  if (0 < ((int)NRINI(max_nesting_level))) {
+    return false;
+  }
+
+  if (NR_PHP_PROCESS_GLOBALS(special_flags).show_executes
+      || NR_PHP_PROCESS_GLOBALS(special_flags).show_execute_returns) {
+    return false;
+  }
+
+  return true;
+}
+
 /*
  * Register the begin and end function handlers with the Observer API.
  */
@@ -124,6 +161,18 @@ static zend_observer_fcall_handlers nr_php_fcall_register_handlers(
         = wr;
   }
 
+  if (NULL == nr_php_get_wraprec(execute_data->func)
+      && nr_php_observer_is_selective()) {
+    /*
+     * Count the function as executed, as the begin handler would have: the
+     * transaction relies on a non-zero execute count to know that PHP code
+     * ran at all.
+     */
+    NRTXNGLOBAL(execute_count) += 1;
+    NRPRG_SHARED(observer_skipped_functions) = true;
+    return handlers;
+  }
+
   handlers.begin = nr_php_observer_fcall_begin;
   handlers.end = nr_php_observer_fcall_end;
   return handlers;
@@ -48,6 +48,10 @@ PHP_RINIT_FUNCTION(newrelic) {
   (void)module_number;
 
   NRPRG_SHARED(current_framework) = NR_FW_UNSET;
+#if ZEND_MODULE_API_NO >= ZEND_8_0_X_API_NO \
+    && !defined OVERWRITE_ZEND_EXECUTE_DATA
+  NRPRG_SHARED(observer_skipped_functions) = false;
+#endif
   NRPRG_CTX(php_cur_stack_depth) = 0;
   NRPRG_CTX(deprecated_capture_request_parameters) = NRINI(capture_params);
   NRPRG_SHARED(sapi_headers) = NULL;
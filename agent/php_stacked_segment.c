@@ -44,7 +44,8 @@ void nr_php_stacked_segment_deinit(nr_segment_t* stacked TSRMLS_DC) {
   if (NULL == NRPRG(txn) || (NULL == stacked)) {
     return;
   }
-  nr_segment_children_reparent(&stacked->children, stacked->parent);
+  nr_segment_children_reparent(&stacked->children, stacked->parent,
+                               &NRTXN(segment_children_pool));
 
   nr_free(stacked->id);
 
@@ -167,7 +167,10 @@
 
 /*
  * Observer API paradigm: OAPI cannot make use of stacked segments and
- * therefore uses the txn segment stack API.
+ * therefore uses the txn segment stack API. Uninstrumented calls get the
+ * same benefit from the transaction's pending frames instead: only a start
+ * time is recorded per call, and a segment is started once it is needed. See
+ * nr_txn_pending_frame_push().
  */
 // clang-format on
 
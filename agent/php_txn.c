@@ -940,6 +940,7 @@ nr_status_t nr_php_txn_begin(const char* appnames,
   opts.span_events_max_samples_stored = NRINI(span_events_max_samples_stored);
   opts.max_segments
       = is_cli ? NRINI(tt_max_segments_cli) : NRINI(tt_max_segments_web);
+  opts.release_completed_segments = NRINI(tt_release_completed_segments);
   opts.span_queue_batch_size = NRINI(agent_span_queue_size);
   opts.span_queue_batch_timeout = NRINI(agent_span_queue_timeout);
   opts.dt_sampler_parent_sampled = NRPRG_SHARED(dt_sampler_parent_sampled);
@@ -1313,6 +1314,16 @@ nr_status_t nr_php_txn_end(int ignoretxn, int in_post_deactivate TSRMLS_DC) {
                   "Supportability/execute/allocated_segment_count",
                   nr_txn_allocated_segment_count(txn));
 
+    nrm_force_add(txn->unscoped_metrics,
+                  "Supportability/execute/file_cache/hits",
+                  NRTXNGLOBAL(file_cache_hits));
+    nrm_force_add(txn->unscoped_metrics,
+                  "Supportability/execute/file_cache/misses",
+                  NRTXNGLOBAL(file_cache_misses));
+    nrm_force_add(txn->unscoped_metrics,
+                  "Supportability/execute/file_cache/size",
+                  nr_hashmap_count(NRPRG_SHARED(file_cache)));
+
     /* Agent and PHP version metrics*/
     nr_php_txn_create_agent_php_version_metrics(txn);
 
@@ -143,6 +143,30 @@ static inline void nr_php_wraprec_lookup_set(nruserfn_t* wr,
     wr->is_disabled = 1;
     return;
   }
+
+#if !defined OVERWRITE_ZEND_EXECUTE_DATA
+  /*
+   * A function that was called before it had a wraprec may have been left
+   * unobserved (see nr_php_observer_is_selective()), and the Observer API
+   * does not ask for its handlers again until the next request.
+   */
+  if (NRPRG_SHARED(observer_skipped_functions)
+      && (NULL != RUN_TIME_CACHE(&zf->op_array))
+      && (NULL
+          == ZEND_OP_ARRAY_EXTENSION(
+              &zf->op_array,
+              NR_PHP_PROCESS_GLOBALS(op_array_extension_handle)))
+      && nrl_should_print(NRL_VERBOSEDEBUG, NRL_INSTRUMENT)) {
+    char* name = nr_php_function_debug_name(zf);
+
+    nrl_verbosedebug(NRL_INSTRUMENT,
+                     "%s - %s was instrumented after its first call and may "
+                     "not be observed until the next request",
+                     __func__, NRSAFESTR(name));
+    nr_free(name);
+  }
+#endif
+
   // for situation when wraprec is added after first execution of the function
   // store the wraprec in the op_array extension for the duration of the request
   // for later lookup The op_array extension slot for function may not be
@@ -208,6 +208,11 @@ static inline bool zstr_equal(zend_string* zs1, zend_string* zs2) {
     return false;
   }
 
+  /* Names are usually the same interned string: no need to compare them */
+  if (zs1 == zs2) {
+    return true;
+  }
+
   if (ZSTR_LEN(zs1) != ZSTR_LEN(zs2)) {
     return false;
   }
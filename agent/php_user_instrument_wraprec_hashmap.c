@@ -8,383 +8,194 @@
 #include "util_logging.h"
 #include "util_memory.h"
 #include "util_strings.h"
+#include "util_vector.h"
 
-// -----------------------------------------------------------------------------
-// func hash map
-
-typedef struct {
-  bool is_method;
-  const char* name;
-  int name_len;
-  zend_ulong name_hash;
-} nr_func_hashmap_key_t;
-
-typedef struct _nr_func_bucket {
-  struct _nr_func_bucket* prev;
-  struct _nr_func_bucket* next;
-  nr_func_hashmap_key_t* key;
-  nruserfn_t* wraprec;
-} nr_func_bucket_t;
+/*
+ * The wraprecs of user functions are kept in a single flat, open-addressed
+ * table keyed by scope and function name, with linear probing. Each slot
+ * holds the hash and name lengths of its key, so that a probe only looks at
+ * the wraprec of a slot when they all match.
+ *
+ * The table is looked up once per op array per request, with the names of
+ * the op array. When those names are permanent interned strings, as they are
+ * with opcache, a slot remembers them once they have matched its key, and
+ * later lookups with the same strings match on their addresses alone: the
+ * names of the wraprec are only compared when the addresses differ. A
+ * permanent interned string may be freed and its address reused by an
+ * opcache restart, which is why an address match still requires the hash and
+ * lengths to match.
+ *
+ * Lookups take no lock. Slots are only ever added, and their wraprec is
+ * published last with a release store, which lookups load with acquire
+ * semantics before reading the rest of the slot. When an add outgrows the
+ * slots, they are copied into a larger array that is published the same
+ * way, and the old array is kept until the table is destroyed, so that a
+ * concurrent lookup still probing it reads valid memory. The remembered
+ * names are written by lookups, so they are only accessed atomically; each
+ * of them matched the key of its slot when it was stored, so a lookup may
+ * pair one remembered by one thread with one remembered by another.
+ */
 
-typedef struct _nr_func_hashmap {
-  size_t log2_num_buckets;
-  nr_func_bucket_t** buckets;
+typedef struct _nr_wraprec_slot_t {
+  zend_ulong hash;              /* Combined hash of the scope and name */
+  uint32_t name_len;            /* Length of the function name */
+  uint32_t scope_len;           /* Length of the scope name, 0 if none */
+  const zend_string* name_ptr;  /* Interned function name known to match */
+  const zend_string* scope_ptr; /* Interned scope name known to match */
+  nruserfn_t* wraprec;          /* NULL if the slot is empty */
+} nr_wraprec_slot_t;
+
+typedef struct _nr_wraprec_slots_t {
+  size_t mask; /* The number of slots, which is a power of 2, less 1 */
+  nr_wraprec_slot_t slot[];
+} nr_wraprec_slots_t;
+
+typedef struct _nr_wraprec_table_t {
+  nr_wraprec_slots_t* slots;
   size_t elements;
-} nr_func_hashmap_t;
-
-static nr_func_hashmap_t* nr_func_hashmap_create_internal(size_t log2_num_buckets) {
-  nr_func_hashmap_t* hashmap = NULL;
-
-  if (0 == log2_num_buckets) {
-    /*
-     * Encode the default value in one place: namely, here.
-     */
-    log2_num_buckets = 8;
-  } else if (log2_num_buckets > 24) {
-    /*
-     * Basic sanity check: it's extremely unlikely that we'll ever need a
-     * hashmap for the user function wraprecs that has more than 2^24 buckets.
-     */
-    log2_num_buckets = 24;
-  }
+  nr_vector_t* retired; /* Outgrown slot arrays, freed with the table */
+} nr_wraprec_table_t;
 
-  hashmap
-      = (nr_func_hashmap_t*)nr_malloc(sizeof(nr_func_hashmap_t));
-  hashmap->log2_num_buckets = log2_num_buckets;
-  hashmap->buckets = (nr_func_bucket_t**)nr_calloc(
-      (1 << log2_num_buckets), sizeof(nr_func_bucket_t*));
-  hashmap->elements = 0;
+/*
+ * The agent's own instrumentation adds a few hundred wraprecs, so the table
+ * starts with room for those and grows by doubling. It is kept at most half
+ * full, which keeps probe sequences short.
+ */
+#define NR_WRAPREC_TABLE_INITIAL_SLOTS 1024
 
-  return hashmap;
-}
+static nr_wraprec_table_t* wraprec_table = NULL;
 
-static size_t nr_func_hashmap_hash_key(size_t log2_num_buckets, nr_func_hashmap_key_t* key) {
-  return (key->name_hash & ((1 << log2_num_buckets) - 1));
+static inline zend_ulong nr_wraprec_table_hash(zend_ulong name_hash,
+                                               zend_ulong scope_hash) {
+  return name_hash ^ (scope_hash * 0x9e3779b97f4a7c15ULL);
 }
 
-static bool nr_func_hashmap_key_equals(nr_func_hashmap_key_t* a, nr_func_hashmap_key_t* b) {
-  return (a->name_hash == b->name_hash) && (a->name_len == b->name_len)
-         && (0 == nr_strncmp(a->name, b->name, a->name_len));
-}
+static nr_wraprec_slots_t* nr_wraprec_slots_create(size_t num_slots) {
+  nr_wraprec_slots_t* slots = (nr_wraprec_slots_t*)nr_zalloc(
+      sizeof(nr_wraprec_slots_t) + num_slots * sizeof(nr_wraprec_slot_t));
 
-static bool nr_func_hashmap_fetch_internal(nr_func_hashmap_t* hashmap, size_t hash, nr_func_hashmap_key_t* key, nr_func_bucket_t** bucket_ptr) {
-  for (nr_func_bucket_t* bucket = hashmap->buckets[hash]; bucket; bucket = bucket->next) {
-    if (nr_func_hashmap_key_equals(bucket->key, key)) {
-      if (bucket_ptr) {
-        *bucket_ptr = bucket;
-      }
-      return true;
-    }
-  }
-  return false;
-}
+  slots->mask = num_slots - 1;
 
-static nruserfn_t* nr_func_hashmap_add_internal(nr_func_hashmap_t* hashmap,
-                             size_t hash_key,
-                             nr_func_hashmap_key_t* key) {
-  nr_func_bucket_t* bucket = (nr_func_bucket_t*)nr_malloc(sizeof(nr_func_bucket_t));
-
-  bucket->prev = NULL;
-  bucket->next = hashmap->buckets[hash_key];
-  bucket->key = (nr_func_hashmap_key_t*)nr_malloc(sizeof(nr_func_hashmap_key_t));
-  bucket->key->is_method = key->is_method;
-  bucket->key->name = nr_strndup(key->name, key->name_len);
-  bucket->key->name_len = key->name_len;
-  bucket->key->name_hash = key->name_hash;
-  bucket->wraprec = nr_php_user_wraprec_create();
-
-  if (hashmap->buckets[hash_key]) {
-    hashmap->buckets[hash_key]->prev = bucket;
-  }
-
-  hashmap->buckets[hash_key] = bucket;
-  ++hashmap->elements;
-
-  return bucket->wraprec;
+  return slots;
 }
 
-static nruserfn_t* nr_func_hashmap_lookup_internal(nr_func_hashmap_t* hashmap, nr_func_hashmap_key_t* key) {
-  size_t hash;
-  nr_func_bucket_t* bucket = NULL;
-
-  if (nrunlikely((NULL == hashmap) || (NULL == key))) {
-    return NULL;
-  }
-
-  hash = nr_func_hashmap_hash_key(hashmap->log2_num_buckets, key);
-  if (nr_func_hashmap_fetch_internal(hashmap, hash, key, &bucket)) {
-    return bucket->wraprec;
-  }
-
-  return NULL;
+static void nr_wraprec_slots_retired_dtor(void* slots,
+                                          void* userdata NRUNUSED) {
+  nr_free(slots);
 }
 
-static nruserfn_t* nr_func_hashmap_update_internal(nr_func_hashmap_t* hashmap, nr_func_hashmap_key_t* key, bool* created) {
-  size_t hash;
-  nr_func_bucket_t* bucket = NULL;
-  nruserfn_t* wraprec = NULL;
+static nr_wraprec_table_t* nr_wraprec_table_create(size_t num_slots) {
+  nr_wraprec_table_t* table
+      = (nr_wraprec_table_t*)nr_zalloc(sizeof(nr_wraprec_table_t));
 
-  if (nrunlikely((NULL == hashmap) || (NULL == key))) {
-    return NULL;
-  }
-
-  hash = nr_func_hashmap_hash_key(hashmap->log2_num_buckets, key);
-  if (nr_func_hashmap_fetch_internal(hashmap, hash, key, &bucket)) {
-    if (created) {
-      *created = false;
-    }
-    return bucket->wraprec;
-  }
+  table->slots = nr_wraprec_slots_create(num_slots);
+  table->retired = nr_vector_create(0, nr_wraprec_slots_retired_dtor, NULL);
 
-  if (created) {
-    *created = true;
-  }
-  return nr_func_hashmap_add_internal(hashmap, hash, key);
-}
-
-static void nr_func_hashmap_destroy_bucket_internal(nr_func_bucket_t** bucket_ptr) {
-  nr_func_bucket_t* bucket = *bucket_ptr;
-  if (NULL != bucket->key) {
-    nr_free(bucket->key->name);
-  }
-  nr_free(bucket->key);
-  nr_php_user_wraprec_destroy(&bucket->wraprec);
-  nr_realfree((void**)bucket_ptr);
+  return table;
 }
 
-static void nr_func_hashmap_destroy_internal(nr_func_hashmap_t** hashmap_ptr) {
-  size_t count;
-  nr_func_hashmap_t* hashmap = NULL;
+static void nr_wraprec_table_destroy(nr_wraprec_table_t** table_ptr) {
+  nr_wraprec_table_t* table;
   size_t i;
 
-  if ((NULL == hashmap_ptr) || (NULL == *hashmap_ptr)) {
+  if ((NULL == table_ptr) || (NULL == *table_ptr)) {
     return;
   }
-  hashmap = *hashmap_ptr;
-
-  count = (size_t)(1 << hashmap->log2_num_buckets);
-  for (i = 0; i < count; i++) {
-    nr_func_bucket_t* bucket = hashmap->buckets[i];
-
-    while (bucket) {
-      nr_func_bucket_t* next = bucket->next;
-
-      nr_func_hashmap_destroy_bucket_internal(&bucket);
-
-      bucket = next;
-    }
-  }
-
-  nr_free(hashmap->buckets);
-  nr_realfree((void**)hashmap_ptr);
-}
-
-// -----------------------------------------------------------------------------
-// scope hash map
-
-typedef struct {
-  const char* name;
-  int name_len;
-  zend_ulong name_hash;
-} nr_scope_hashmap_key_t;
-
-typedef struct _nr_scope_bucket {
-  struct _nr_scope_bucket* prev;
-  struct _nr_scope_bucket* next;
-  nr_scope_hashmap_key_t* key;
-  nr_func_hashmap_t* scoped_funcs_ht;
-} nr_scope_bucket_t;
-
-typedef struct _nr_scope_hashmap {
-  size_t log2_num_buckets;
-  nr_scope_bucket_t** buckets;
-  size_t elements;
-} nr_scope_hashmap_t;
-
-static nr_scope_hashmap_t* nr_scope_hashmap_create_internal(size_t log2_num_buckets) {
-  nr_scope_hashmap_t* hashmap = NULL;
-
-  if (0 == log2_num_buckets) {
-    /*
-     * Encode the default value in one place: namely, here.
-     */
-    log2_num_buckets = 8;
-  } else if (log2_num_buckets > 24) {
-    /*
-     * Basic sanity check: it's extremely unlikely that we'll ever need a
-     * hashmap for the user function wraprecs that has more than 2^24 buckets.
-     */
-    log2_num_buckets = 24;
-  }
-
-  hashmap
-      = (nr_scope_hashmap_t*)nr_malloc(sizeof(nr_scope_hashmap_t));
-  hashmap->log2_num_buckets = log2_num_buckets;
-  hashmap->buckets = (nr_scope_bucket_t**)nr_calloc(
-      (1 << log2_num_buckets), sizeof(nr_scope_bucket_t*));
-  hashmap->elements = 0;
-
-  return hashmap;
-}
-
-static size_t nr_scope_hashmap_hash_key(size_t log2_num_buckets, nr_scope_hashmap_key_t* key) {
-  return (key->name_hash & ((1 << log2_num_buckets) - 1));
-}
-
-static bool nr_scope_hashmap_key_equals(nr_scope_hashmap_key_t* a, nr_scope_hashmap_key_t* b) {
-  return (a->name_hash == b->name_hash) && (a->name_len == b->name_len)
-         && (0 == nr_strncmp(a->name, b->name, a->name_len));
-}
-
-static bool nr_scope_hashmap_fetch_internal(nr_scope_hashmap_t* hashmap, size_t hash, nr_scope_hashmap_key_t* key, nr_scope_bucket_t** bucket_ptr) {
+  table = *table_ptr;
 
-  for (nr_scope_bucket_t* bucket = hashmap->buckets[hash]; bucket; bucket = bucket->next) {
-    if (nr_scope_hashmap_key_equals(bucket->key, key)) {
-      if (bucket_ptr) {
-        *bucket_ptr = bucket;
-      }
-      return true;
+  for (i = 0; i <= table->slots->mask; i++) {
+    if (table->slots->slot[i].wraprec) {
+      nr_php_user_wraprec_destroy(&table->slots->slot[i].wraprec);
     }
   }
-  return false;
-}
-
-static nr_func_hashmap_t* nr_scope_hashmap_add_internal(nr_scope_hashmap_t* hashmap,
-                             size_t hash_key,
-                             nr_scope_hashmap_key_t* key) {
-  nr_scope_bucket_t* bucket = (nr_scope_bucket_t*)nr_malloc(sizeof(nr_scope_bucket_t));
-  bucket->prev = NULL;
-  bucket->next = hashmap->buckets[hash_key];
-  bucket->key = (nr_scope_hashmap_key_t*)nr_malloc(sizeof(nr_scope_hashmap_key_t));
-  bucket->key->name = nr_strndup(key->name, key->name_len);
-  bucket->key->name_len = key->name_len;
-  bucket->key->name_hash = key->name_hash;
-  bucket->scoped_funcs_ht = nr_func_hashmap_create_internal(0);
-
-  if (hashmap->buckets[hash_key]) {
-    hashmap->buckets[hash_key]->prev = bucket;
-  }
-
-  hashmap->buckets[hash_key] = bucket;
-  ++hashmap->elements;
+  nr_free(table->slots);
+  nr_vector_destroy(&table->retired);
 
-  return bucket->scoped_funcs_ht;
+  nr_realfree((void**)table_ptr);
 }
 
-static nr_func_hashmap_t* nr_scope_hashmap_lookup_internal(nr_scope_hashmap_t* hashmap, nr_scope_hashmap_key_t* key) {
-  size_t hash;
-  nr_scope_bucket_t* bucket = NULL;
+static bool nr_wraprec_slot_matches(const nr_wraprec_slot_t* slot,
+                                    zend_ulong hash,
+                                    const char* name,
+                                    size_t name_len,
+                                    const char* scope,
+                                    size_t scope_len) {
+  const nruserfn_t* wraprec = __atomic_load_n(&slot->wraprec, __ATOMIC_ACQUIRE);
 
-  if (nrunlikely((NULL == hashmap) || (NULL == key))) {
-    return NULL;
+  if ((slot->hash != hash) || (slot->name_len != name_len)
+      || (slot->scope_len != scope_len)) {
+    return false;
   }
 
-  hash = nr_scope_hashmap_hash_key(hashmap->log2_num_buckets, key);
-  if (nr_scope_hashmap_fetch_internal(hashmap, hash, key, &bucket)) {
-    return bucket->scoped_funcs_ht;
+  if (NULL == scope) {
+    if (wraprec->is_method) {
+      return false;
+    }
+  } else if (!wraprec->is_method
+             || 0 != nr_strncmp(wraprec->classname, scope, scope_len)) {
+    return false;
   }
 
-  return NULL;
+  return 0 == nr_strncmp(wraprec->funcname, name, name_len);
 }
 
-static nr_func_hashmap_t* nr_scope_hashmap_update_internal(nr_scope_hashmap_t* hashmap, nr_scope_hashmap_key_t* key) {
-  size_t hash;
-  nr_scope_bucket_t* bucket = NULL;
-
-  if (nrunlikely((NULL == hashmap) || (NULL == key))) {
-    return NULL;
-  }
-
-  hash = nr_scope_hashmap_hash_key(hashmap->log2_num_buckets, key);
-  if (nr_scope_hashmap_fetch_internal(hashmap, hash, key, &bucket)) {
-    return bucket->scoped_funcs_ht;
-  }
+/*
+ * Purpose : Find the slot holding a key, or the empty slot where it belongs.
+ */
+static nr_wraprec_slot_t* nr_wraprec_slots_find(nr_wraprec_slots_t* slots,
+                                                zend_ulong hash,
+                                                const char* name,
+                                                size_t name_len,
+                                                const char* scope,
+                                                size_t scope_len) {
+  size_t i;
 
-  return nr_scope_hashmap_add_internal(hashmap, hash, key);
-}
+  for (i = (size_t)hash & slots->mask;; i = (i + 1) & slots->mask) {
+    nr_wraprec_slot_t* slot = &slots->slot[i];
 
-static void nr_scope_hashmap_destroy_bucket_internal(nr_scope_bucket_t** bucket_ptr) {
-  nr_scope_bucket_t* bucket = *bucket_ptr;
-  if (NULL != bucket->key) {
-    nr_free(bucket->key->name);
+    if ((NULL == slot->wraprec)
+        || nr_wraprec_slot_matches(slot, hash, name, name_len, scope,
+                                   scope_len)) {
+      return slot;
+    }
   }
-  nr_free(bucket->key);
-  nr_func_hashmap_destroy_internal(&bucket->scoped_funcs_ht);
-  nr_realfree((void**)bucket_ptr);
 }
 
-static void nr_scope_hashmap_destroy_internal(nr_scope_hashmap_t** hashmap_ptr) {
-  size_t count;
-  nr_scope_hashmap_t* hashmap = NULL;
+static void nr_wraprec_table_grow(nr_wraprec_table_t* table) {
+  nr_wraprec_slots_t* old_slots = table->slots;
+  nr_wraprec_slots_t* slots;
   size_t i;
 
-  if ((NULL == hashmap_ptr) || (NULL == *hashmap_ptr)) {
-    return;
-  }
-  hashmap = *hashmap_ptr;
+  slots = nr_wraprec_slots_create((old_slots->mask + 1) * 2);
 
-  count = (size_t)(1 << hashmap->log2_num_buckets);
-  for (i = 0; i < count; i++) {
-    nr_scope_bucket_t* bucket = hashmap->buckets[i];
+  /*
+   * The remembered names are not copied, as concurrent lookups may still be
+   * writing them.
+   */
+  for (i = 0; i <= old_slots->mask; i++) {
+    const nr_wraprec_slot_t* old_slot = &old_slots->slot[i];
+    size_t j;
 
-    while (bucket) {
-      nr_scope_bucket_t* next = bucket->next;
-
-      nr_scope_hashmap_destroy_bucket_internal(&bucket);
-
-      bucket = next;
+    if (NULL == old_slot->wraprec) {
+      continue;
     }
-  }
-
-  nr_free(hashmap->buckets);
-  nr_realfree((void**)hashmap_ptr);
-}
-
-nr_func_hashmap_t* global_funcs_ht = NULL;
-nr_scope_hashmap_t* scope_ht = NULL;
-
-/* This function expects full_name and full_name_len to be validated with
- * nr_php_user_instrument_is_name_valid() before being passed in.
- * Specifically, it requires that:
- * - full_name_len be greater than 0
- * - full_name must not be NULL and must not end with `:` (colon) . */
-
-static void nr_php_user_instrument_wraprec_hashmap_name2keys(
-  nr_func_hashmap_key_t* func,
-  nr_scope_hashmap_key_t* scope,
-  const char* full_name,
-  int full_name_len) {
-
-  func->name = full_name;
-  func->name_len = full_name_len;
-  func->name_hash = 0;
-  scope->name = NULL;
-  scope->name_len = 0;
-  scope->name_hash = 0;
 
-  /* If scope::method, then break into two strings */
-  for (int i = 0; i < full_name_len; i++) {
-    if ((':' == full_name[i]) && (':' == full_name[i + 1])) {
-      func->is_method = true;
-      scope->name = full_name;
-      scope->name_len = i;
-      func->name = full_name + i + 2;
-      func->name_len = full_name_len - i - 2;
+    for (j = (size_t)old_slot->hash & slots->mask; slots->slot[j].wraprec;
+         j = (j + 1) & slots->mask) {
     }
+    slots->slot[j].hash = old_slot->hash;
+    slots->slot[j].name_len = old_slot->name_len;
+    slots->slot[j].scope_len = old_slot->scope_len;
+    slots->slot[j].wraprec = old_slot->wraprec;
   }
 
-  if (func->is_method) {
-    scope->name_hash = zend_hash_func(scope->name, scope->name_len);
-  }
-  func->name_hash = zend_hash_func(func->name, func->name_len);
+  __atomic_store_n(&table->slots, slots, __ATOMIC_RELEASE);
+  nr_vector_push_back(table->retired, old_slots);
 }
 
 void nr_php_user_instrument_wraprec_hashmap_init(void) {
-  if (NULL == scope_ht) {
-    scope_ht = nr_scope_hashmap_create_internal(0);
-  }
-  if (NULL == global_funcs_ht) {
-    global_funcs_ht = nr_func_hashmap_create_internal(0);
+  if (NULL == wraprec_table) {
+    wraprec_table = nr_wraprec_table_create(NR_WRAPREC_TABLE_INITIAL_SLOTS);
   }
 }
 
@@ -394,96 +205,134 @@ void nr_php_user_instrument_wraprec_hashmap_init(void) {
  * - namestrlen be greater than 0
  * - namestr must not be NULL and must not end with `:` (colon) . */
 
-nruserfn_t* nr_php_user_instrument_wraprec_hashmap_add(const char* namestr, size_t namestrlen) {
-  nr_scope_hashmap_key_t scope_key = {0};
-  nr_func_hashmap_key_t func_key = {0};
-  nr_func_hashmap_t* funcs_ht = NULL;
-  bool is_new_wraprec = false;
-  nruserfn_t* wraprec = NULL;
-
+nruserfn_t* nr_php_user_instrument_wraprec_hashmap_add(const char* namestr,
+                                                       size_t namestrlen) {
+  const char* name = namestr;
+  size_t name_len = namestrlen;
+  const char* scope = NULL;
+  size_t scope_len = 0;
+  zend_ulong hash;
+  nr_wraprec_slot_t* slot;
+  nruserfn_t* wraprec;
+  size_t i;
 
-  if (NULL == scope_ht || NULL == global_funcs_ht) {
+  if (NULL == wraprec_table) {
     return NULL;
   }
 
-  nr_php_user_instrument_wraprec_hashmap_name2keys(&func_key, &scope_key, namestr, namestrlen);
-
-  if (func_key.is_method) {
-    funcs_ht = nr_scope_hashmap_update_internal(scope_ht, &scope_key);
-  } else {
-    funcs_ht = global_funcs_ht;
+  /* If scope::method, then break into two strings */
+  for (i = 0; i + 1 < namestrlen; i++) {
+    if ((':' == namestr[i]) && (':' == namestr[i + 1])) {
+      scope = namestr;
+      scope_len = i;
+      name = namestr + i + 2;
+      name_len = namestrlen - i - 2;
+    }
   }
 
-  if (NULL == funcs_ht) {
-    return NULL;
+  hash = nr_wraprec_table_hash(zend_hash_func(name, name_len),
+                               scope ? zend_hash_func(scope, scope_len) : 0);
+
+  slot = nr_wraprec_slots_find(wraprec_table->slots, hash, name, name_len,
+                               scope, scope_len);
+  if (slot->wraprec) {
+    nrl_verbosedebug(NRL_INSTRUMENT, "reusing custom wrapper for '%s'",
+                     namestr);
+    return slot->wraprec;
   }
 
-  wraprec = nr_func_hashmap_update_internal(funcs_ht, &func_key, &is_new_wraprec);
+  if ((wraprec_table->elements + 1) * 2 > wraprec_table->slots->mask + 1) {
+    nr_wraprec_table_grow(wraprec_table);
+    slot = nr_wraprec_slots_find(wraprec_table->slots, hash, name, name_len,
+                                 scope, scope_len);
+  }
 
-  if (NULL == wraprec) {
-    return NULL;
+  wraprec = nr_php_user_wraprec_create();
+  wraprec->funcname = nr_strndup(name, name_len);
+  wraprec->funcnamelen = name_len;
+  wraprec->funcnameLC = nr_string_to_lowercase(wraprec->funcname);
+  if (scope) {
+    wraprec->classname = nr_strndup(scope, scope_len);
+    wraprec->classnamelen = scope_len;
+    wraprec->classnameLC = nr_string_to_lowercase(wraprec->classname);
+    wraprec->is_method = 1;
   }
 
-  if (is_new_wraprec) {
-    wraprec->funcname = nr_strndup(func_key.name, func_key.name_len);
-    wraprec->funcnamelen = func_key.name_len;
-    wraprec->funcnameLC = nr_string_to_lowercase(wraprec->funcname);
-    if (func_key.is_method) {
-      wraprec->classname = nr_strndup(scope_key.name, scope_key.name_len);
-      wraprec->classnamelen = scope_key.name_len;
-      wraprec->classnameLC = nr_string_to_lowercase(wraprec->classname);
-      wraprec->is_method = 1;
-    }
+  wraprec->supportability_metric = nr_txn_create_fn_supportability_metric(
+      wraprec->funcname, wraprec->classname);
 
-    wraprec->supportability_metric = nr_txn_create_fn_supportability_metric(
-        wraprec->funcname, wraprec->classname);
-    nrl_verbosedebug(NRL_INSTRUMENT, "adding custom wrapper for '%s'", namestr);
-  } else {
-    nrl_verbosedebug(NRL_INSTRUMENT, "reusing custom wrapper for '%s'", namestr);
-  }
+  slot->hash = hash;
+  slot->name_len = (uint32_t)name_len;
+  slot->scope_len = (uint32_t)scope_len;
+  slot->name_ptr = NULL;
+  slot->scope_ptr = NULL;
+  __atomic_store_n(&slot->wraprec, wraprec, __ATOMIC_RELEASE);
+  wraprec_table->elements += 1;
+
+  nrl_verbosedebug(NRL_INSTRUMENT, "adding custom wrapper for '%s'", namestr);
 
   return wraprec;
 }
 
-nruserfn_t* nr_php_user_instrument_wraprec_hashmap_get(zend_string *func_name, zend_string *scope_name) {
-  nr_scope_hashmap_key_t scope_key = {0};
-  nr_func_hashmap_key_t func_key = {0};
-  nr_func_hashmap_t* funcs_ht = NULL;
+/*
+ * Purpose : Determine whether a name can be remembered by a slot: it must
+ *           outlive the request, which a missing scope trivially does.
+ */
+static inline bool nr_wraprec_name_is_permanent(const zend_string* str) {
+  return (NULL == str)
+         || (ZSTR_IS_INTERNED(str) && (GC_FLAGS(str) & IS_STR_PERMANENT));
+}
+
+nruserfn_t* nr_php_user_instrument_wraprec_hashmap_get(
+    zend_string* func_name,
+    zend_string* scope_name) {
+  nr_wraprec_slots_t* slots;
+  zend_ulong hash;
+  size_t name_len;
+  size_t scope_len;
+  size_t i;
+  nruserfn_t* wraprec;
 
-  if (NULL == scope_ht || NULL == global_funcs_ht) {
+  if (NULL == wraprec_table) {
     return NULL;
   }
   if (NULL == func_name) {
     return NULL;
   }
 
-  if (NULL != scope_name) {
-    func_key.is_method = true;
-    scope_key.name = ZSTR_VAL(scope_name);
-    scope_key.name_len = ZSTR_LEN(scope_name);
-    scope_key.name_hash = ZSTR_HASH(scope_name);
-    funcs_ht = nr_scope_hashmap_lookup_internal(scope_ht, &scope_key);
-  } else {
-    funcs_ht = global_funcs_ht;
-  }
+  hash = nr_wraprec_table_hash(ZSTR_HASH(func_name),
+                               scope_name ? ZSTR_HASH(scope_name) : 0);
+  name_len = ZSTR_LEN(func_name);
+  scope_len = scope_name ? ZSTR_LEN(scope_name) : 0;
 
-  if (NULL == funcs_ht) {
-    return NULL;
-  }
+  slots = __atomic_load_n(&wraprec_table->slots, __ATOMIC_ACQUIRE);
+  for (i = (size_t)hash & slots->mask;
+       (wraprec = __atomic_load_n(&slots->slot[i].wraprec, __ATOMIC_ACQUIRE));
+       i = (i + 1) & slots->mask) {
+    nr_wraprec_slot_t* slot = &slots->slot[i];
+
+    if ((__atomic_load_n(&slot->name_ptr, __ATOMIC_RELAXED) == func_name)
+        && (__atomic_load_n(&slot->scope_ptr, __ATOMIC_RELAXED) == scope_name)
+        && (slot->hash == hash) && (slot->name_len == name_len)
+        && (slot->scope_len == scope_len)) {
+      return wraprec;
+    }
 
-  func_key.name = ZSTR_VAL(func_name);
-  func_key.name_len = ZSTR_LEN(func_name);
-  func_key.name_hash = ZSTR_HASH(func_name);
+    if (nr_wraprec_slot_matches(slot, hash, ZSTR_VAL(func_name), name_len,
+                                scope_name ? ZSTR_VAL(scope_name) : NULL,
+                                scope_len)) {
+      if (nr_wraprec_name_is_permanent(func_name)
+          && nr_wraprec_name_is_permanent(scope_name)) {
+        __atomic_store_n(&slot->name_ptr, func_name, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->scope_ptr, scope_name, __ATOMIC_RELAXED);
+      }
+      return wraprec;
+    }
+  }
 
-  return nr_func_hashmap_lookup_internal(funcs_ht, &func_key);
+  return NULL;
 }
 
 void nr_php_user_instrument_wraprec_hashmap_destroy(void) {
-  if (NULL != scope_ht) {
-    nr_scope_hashmap_destroy_internal(&scope_ht);
-  }
-  if (NULL != global_funcs_ht) {
-    nr_func_hashmap_destroy_internal(&global_funcs_ht);
-  }
-  return;
+  nr_wraprec_table_destroy(&wraprec_table);
 }
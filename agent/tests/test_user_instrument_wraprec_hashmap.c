@@ -69,6 +69,47 @@ static void test_wraprecs_hashmap() {
   zend_string_free(method_name);
 }
 
+static void test_wraprecs_hashmap_many() {
+  nruserfn_t* wraprecs[2000];
+  zend_string *func_name, *scope_name;
+  char name[64];
+  int i;
+
+  nr_php_user_instrument_wraprec_hashmap_destroy();
+  nr_php_user_instrument_wraprec_hashmap_init();
+
+  // Add enough wraprecs for the table to grow past its initial size
+  for (i = 0; i < 2000; i++) {
+    snprintf(name, sizeof(name), "Class%d::method%d", i % 50, i);
+    wraprecs[i] = nr_php_user_instrument_wraprec_hashmap_add(name, nr_strlen(name));
+    tlib_pass_if_not_null("adding many methods", wraprecs[i]);
+  }
+
+  for (i = 0; i < 2000; i++) {
+    snprintf(name, sizeof(name), "Class%d::method%d", i % 50, i);
+    tlib_pass_if_ptr_equal("adding existing method", wraprecs[i],
+                           nr_php_user_instrument_wraprec_hashmap_add(name, nr_strlen(name)));
+
+    snprintf(name, sizeof(name), "method%d", i);
+    func_name = zend_string_init(name, nr_strlen(name), 0);
+    snprintf(name, sizeof(name), "Class%d", i % 50);
+    scope_name = zend_string_init(name, nr_strlen(name), 0);
+
+    // Look up twice, as a second lookup may take a different path
+    tlib_pass_if_ptr_equal("getting many methods", wraprecs[i],
+                           nr_php_user_instrument_wraprec_hashmap_get(func_name, scope_name));
+    tlib_pass_if_ptr_equal("getting many methods again", wraprecs[i],
+                           nr_php_user_instrument_wraprec_hashmap_get(func_name, scope_name));
+    tlib_pass_if_null("getting method without scope",
+                      nr_php_user_instrument_wraprec_hashmap_get(func_name, NULL));
+
+    zend_string_free(func_name);
+    zend_string_free(scope_name);
+  }
+
+  nr_php_user_instrument_wraprec_hashmap_destroy();
+}
+
 // clang-format on
 
 void test_main(void* p NRUNUSED) {
@@ -76,6 +117,7 @@ void test_main(void* p NRUNUSED) {
   tlib_php_engine_create("" PTSRMLS_CC);
 
   test_wraprecs_hashmap();
+  test_wraprecs_hashmap_many();
 
   tlib_php_engine_destroy(TSRMLS_C);
 }
@@ -9,6 +9,7 @@
 
 #include "nr_errors.h"
 #include "nr_errors_private.h"
+#include "util_json_writer.h"
 #include "util_memory.h"
 #include "util_object.h"
 #include "util_strings.h"
@@ -97,40 +98,38 @@ void nr_error_destroy(nr_error_t** error_ptr) {
   nr_realfree((void**)error_ptr);
 }
 
-static nrobj_t* nr_error_params_to_object(const char* stacktrace_json,
-                                          const nrobj_t* agent_attributes,
-                                          const nrobj_t* user_attributes,
-                                          const nrobj_t* intrinsics,
-                                          const char* request_uri) {
-  nrobj_t* hash;
-  char* json;
+static void nr_error_params_to_buffer(nrbuf_t* buf,
+                                      const char* stacktrace_json,
+                                      const nrobj_t* agent_attributes,
+                                      const nrobj_t* user_attributes,
+                                      const nrobj_t* intrinsics,
+                                      const char* request_uri) {
+  nr_json_write_begin_object(buf);
 
-  hash = nro_new_hash();
-  nro_set_hash_jstring(hash, "stack_trace", stacktrace_json);
+  nr_json_write_key(buf, "stack_trace");
+  nr_json_write_raw(buf, stacktrace_json);
 
   if (agent_attributes) {
-    json = nro_to_json(agent_attributes);
-    nro_set_hash_jstring(hash, "agentAttributes", json);
-    nr_free(json);
+    nr_json_write_key(buf, "agentAttributes");
+    nr_json_write_object(buf, agent_attributes);
   }
 
   if (user_attributes) {
-    json = nro_to_json(user_attributes);
-    nro_set_hash_jstring(hash, "userAttributes", json);
-    nr_free(json);
+    nr_json_write_key(buf, "userAttributes");
+    nr_json_write_object(buf, user_attributes);
   }
 
   if (intrinsics) {
-    json = nro_to_json(intrinsics);
-    nro_set_hash_jstring(hash, "intrinsics", json);
-    nr_free(json);
+    nr_json_write_key(buf, "intrinsics");
+    nr_json_write_object(buf, intrinsics);
   }
 
   if (request_uri) {
-    nro_set_hash_string(hash, "request_uri", request_uri);
+    nr_json_write_key(buf, "request_uri");
+    nr_json_write_string(buf, request_uri);
   }
 
-  return hash;
+  nr_json_write_end_object(buf);
 }
 
 char* nr_error_to_daemon_json(const nr_error_t* error,
@@ -140,8 +139,7 @@ char* nr_error_to_daemon_json(const nr_error_t* error,
                               const nrobj_t* user_attributes,
                               const nrobj_t* intrinsics,
                               const char* request_uri) {
-  nrobj_t* outer;
-  nrobj_t* params;
+  nrbuf_t* buf;
   char* json;
 
   if (NULL == error) {
@@ -154,25 +152,26 @@ char* nr_error_to_daemon_json(const nr_error_t* error,
    * priority (so that the daemon can keep the highest priority errors).
    */
 
-  params = nr_error_params_to_object(error->stacktrace_json, agent_attributes,
-                                     user_attributes, intrinsics, request_uri);
+  buf = nr_buffer_create(4096, 4096);
 
-  outer = nro_new_array();
-  nro_set_array_long(outer, 1, error->when / NR_TIME_DIVISOR_MS);
-  nro_set_array_string(outer, 2, txn_name);
-  nro_set_array_string(outer, 3, error->message);
-  nro_set_array_string(outer, 4, error->klass);
-  nro_set_array(outer, 5, params);
+  nr_json_write_begin_array(buf);
+  nr_json_write_int(buf, (int64_t)(error->when / NR_TIME_DIVISOR_MS));
+  nr_json_write_string(buf, txn_name);
+  nr_json_write_string(buf, error->message);
+  nr_json_write_string(buf, error->klass);
+  nr_error_params_to_buffer(buf, error->stacktrace_json, agent_attributes,
+                            user_attributes, intrinsics, request_uri);
 
   /* only include transaction guid if it is defined */
   if (!nr_strempty(txn_guid)) {
-    nro_set_array_string(outer, 6, txn_guid);
+    nr_json_write_string(buf, txn_guid);
   }
 
-  nro_delete(params);
+  nr_json_write_end_array(buf);
+  nr_buffer_add(buf, NR_PSTR("\0"));
 
-  json = nro_to_json(outer);
-  nro_delete(outer);
+  json = nr_strdup((const char*)nr_buffer_cptr(buf));
+  nr_buffer_destroy(&buf);
 
   return json;
 }
\ No newline at end of file
@@ -73,6 +73,7 @@ nr_exclusive_time_t* nr_exclusive_time_create(size_t child_segments,
                  + sizeof(nr_exclusive_time_transition_t) * child_segments * 2);
   et->start_time = start_time;
   et->stop_time = stop_time;
+  et->children_sorted = true;
   et->transitions.capacity = child_segments * 2;
   et->transitions.used = 0;
 
@@ -106,6 +107,19 @@ bool nr_exclusive_time_add_child(nr_exclusive_time_t* parent_et,
     return false;
   }
 
+  /*
+   * Children are usually added in start order. Keep track of whether that is
+   * still the case, so that the transitions only have to be sorted if it
+   * isn't.
+   */
+  if (parent_et->transitions.used
+      && start_time
+             < parent_et->transitions
+                   .transitions[parent_et->transitions.used - 2]
+                   .time) {
+    parent_et->children_sorted = false;
+  }
+
   /*
    * Basic theory of operation: we need to add a transition for both the start
    * and stop of this segment to the transitions array.
@@ -163,6 +177,70 @@ int nr_exclusive_time_transition_compare(
   return 0;
 }
 
+/*
+ * Purpose : Calculate exclusive time when the children were added in start
+ *           order.
+ *
+ * Params  : 1. A pointer to the exclusive time structure.
+ *
+ * Returns : The amount of exclusive time.
+ *
+ * Notes   : As the transitions are pairs of start and stop times in start
+ *           order, the periods covered by children can be merged in a single
+ *           pass, without sorting the transitions first.
+ */
+static nrtime_t nr_exclusive_time_calculate_sorted(
+    const nr_exclusive_time_t* et) {
+  nrtime_t exclusive_time = nr_time_duration(et->start_time, et->stop_time);
+  nrtime_t covered_start = 0;
+  nrtime_t covered_stop = 0;
+  bool covered = false;
+  size_t i;
+
+  for (i = 0; i + 1 < et->transitions.used; i += 2) {
+    nrtime_t start = et->transitions.transitions[i].time;
+    nrtime_t stop = et->transitions.transitions[i + 1].time;
+
+    /*
+     * Clamp the child to the parent segment, which is possible in an async
+     * world, and skip it if nothing is left.
+     */
+    if (start < et->start_time) {
+      start = et->start_time;
+    }
+    if (stop > et->stop_time) {
+      stop = et->stop_time;
+    }
+    if (start >= stop) {
+      continue;
+    }
+
+    /*
+     * Extend the current covered period if the child overlaps it; otherwise
+     * the current period is over and is removed from the exclusive time.
+     */
+    if (covered && start <= covered_stop) {
+      if (stop > covered_stop) {
+        covered_stop = stop;
+      }
+      continue;
+    }
+
+    if (covered) {
+      exclusive_time -= covered_stop - covered_start;
+    }
+    covered_start = start;
+    covered_stop = stop;
+    covered = true;
+  }
+
+  if (covered) {
+    exclusive_time -= covered_stop - covered_start;
+  }
+
+  return exclusive_time;
+}
+
 nrtime_t nr_exclusive_time_calculate(nr_exclusive_time_t* et) {
   unsigned int active_children = 0;
   nrtime_t exclusive_time;
@@ -181,6 +259,10 @@ nrtime_t nr_exclusive_time_calculate(nr_exclusive_time_t* et) {
     return nr_time_duration(et->start_time, et->stop_time);
   }
 
+  if (et->children_sorted) {
+    return nr_exclusive_time_calculate_sorted(et);
+  }
+
   /*
    * Essentially, what we want to do in this function is walk the list of
    * transitions in time order. So, firstly, let's put it in time order.
@@ -24,6 +24,8 @@ typedef struct _nr_exclusive_time_transition_t {
 struct _nr_exclusive_time_t {
   nrtime_t start_time;
   nrtime_t stop_time;
+  bool children_sorted; /* Whether the children were added in start order, in
+                           which case the transitions don't need sorting */
   struct {
     size_t capacity;
     size_t used;
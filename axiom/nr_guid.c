@@ -21,3 +21,83 @@ char* nr_guid_create(nr_random_t* rnd) {
 
   return guid;
 }
+
+/*
+ * The two hex digits of each byte value, so that an id can be encoded a byte
+ * at a time.
+ */
+static const char hex_pairs[513]
+    = "000102030405060708090a0b0c0d0e0f"
+      "101112131415161718191a1b1c1d1e1f"
+      "202122232425262728292a2b2c2d2e2f"
+      "303132333435363738393a3b3c3d3e3f"
+      "404142434445464748494a4b4c4d4e4f"
+      "505152535455565758595a5b5c5d5e5f"
+      "606162636465666768696a6b6c6d6e6f"
+      "707172737475767778797a7b7c7d7e7f"
+      "808182838485868788898a8b8c8d8e8f"
+      "909192939495969798999a9b9c9d9e9f"
+      "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+      "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+      "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+      "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+      "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+      "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static void nr_guid_generator_seed(nr_guid_generator_t* gen,
+                                   nr_random_t* rnd) {
+  uint64_t seed;
+
+  /* nr_random_range() provides 31 bits at a time. */
+  seed = (uint64_t)nr_random_range(rnd, NR_RANDOM_MAX_EXCLUSIVE_LIMIT);
+  seed = (seed << 31)
+         | (uint64_t)nr_random_range(rnd, NR_RANDOM_MAX_EXCLUSIVE_LIMIT);
+  seed = (seed << 31)
+         ^ (uint64_t)nr_random_range(rnd, NR_RANDOM_MAX_EXCLUSIVE_LIMIT);
+
+  gen->state = seed;
+  gen->seeded = true;
+}
+
+static inline uint64_t nr_guid_generator_next(nr_guid_generator_t* gen) {
+  uint64_t z;
+
+  gen->state += 0x9e3779b97f4a7c15ULL;
+  z = gen->state;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+char* nr_guid_generator_create(nr_guid_generator_t* gen, nr_random_t* rnd) {
+  char* guid;
+  uint64_t value;
+  int i;
+
+  if (NULL == gen) {
+    return NULL;
+  }
+
+  if (!gen->seeded) {
+    if (nrunlikely(NULL == rnd)) {
+      /* Match nr_guid_create(), which has no entropy to draw on either. */
+      return nr_guid_create(NULL);
+    }
+    nr_guid_generator_seed(gen, rnd);
+  }
+
+  do {
+    value = nr_guid_generator_next(gen);
+  } while (0 == value);
+
+  guid = nr_malloc(NR_GUID_SIZE + 1);
+  for (i = 0; i < NR_GUID_SIZE / 2; i++) {
+    const char* pair = &hex_pairs[((value >> (56 - 8 * i)) & 0xff) * 2];
+
+    guid[2 * i] = pair[0];
+    guid[2 * i + 1] = pair[1];
+  }
+  guid[NR_GUID_SIZE] = '\0';
+
+  return guid;
+}
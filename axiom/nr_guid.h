@@ -6,6 +6,9 @@
 #ifndef NR_GUID_HDR
 #define NR_GUID_HDR
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "util_random.h"
 
 /*
@@ -25,4 +28,36 @@
  */
 extern char* nr_guid_create(nr_random_t* rnd);
 
+/*
+ * A generator for a stream of GUIDs, such as the span ids of a transaction.
+ *
+ * The generator is a SplitMix64 stream that is seeded once from an
+ * nr_random_t, so creating an id costs one 64 bit mix instead of a call to
+ * nr_random_range() per hex digit. As SplitMix64 is a bijection of a 64 bit
+ * counter, a generator never repeats an id within 2^64 ids, and it never
+ * creates the all zero id, which W3C trace context treats as invalid.
+ *
+ * A zero initialised generator is valid: it is seeded on first use. Until it
+ * has been seeded, a NULL random number generator yields the same all zero
+ * id as nr_guid_create().
+ */
+typedef struct _nr_guid_generator_t {
+  uint64_t state;
+  bool seeded;
+} nr_guid_generator_t;
+
+/*
+ * Purpose : Create a new GUID from a generator.
+ *
+ * Params  : 1. The generator.
+ *           2. The random number generator to seed the generator from, if it
+ *              has not been seeded yet.
+ *
+ * Returns : A newly allocated, null terminated string of NR_GUID_SIZE hex
+ *           digits, which is owned by the caller, or NULL if the generator is
+ *           NULL.
+ */
+extern char* nr_guid_generator_create(nr_guid_generator_t* gen,
+                                      nr_random_t* rnd);
+
 #endif /* NR_GUID_HDR */
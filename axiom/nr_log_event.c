@@ -8,6 +8,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "util_json_writer.h"
 #include "util_memory.h"
 #include "nr_attributes.h"
 #include "util_strings.h"
@@ -46,20 +47,15 @@ void nr_log_event_destroy(nr_log_event_t** ptr) {
  * Params  :
  *           1. Pointer to buffer (nrbuf_t*)
  *           2. Name of the field (JSON key)
- *           3. Value of the field (JSON value)
- *           4. Boolean indicating if this is the first field
- *           5. Boolean indicating if this field is required
- *           6. Boolean indicating if this field should be quoted
- *              (use false if including a JSON string, for example)
+ *           3. Value of the field (JSON string value)
+ *           4. Boolean indicating if this field is required
  *
  * Returns : True is data was added to buf.
  */
 static bool add_log_field_to_buf(nrbuf_t* buf,
                                  const char* field_name,
                                  const char* field_value,
-                                 const bool first,
-                                 const bool required,
-                                 const bool quoted) {
+                                 const bool required) {
   const char* final_value = field_value;
 
   if (NULL == buf || nr_strempty(field_name)) {
@@ -74,18 +70,8 @@ static bool add_log_field_to_buf(nrbuf_t* buf,
     }
   }
 
-  if (!first) {
-    nr_buffer_add(buf, NR_PSTR(","));
-  }
-  nr_buffer_add(buf, NR_PSTR("\""));
-  nr_buffer_add(buf, field_name, nr_strlen(field_name));
-  nr_buffer_add(buf, NR_PSTR("\""));
-  nr_buffer_add(buf, NR_PSTR(":"));
-  if (quoted) {
-    nr_buffer_add_escape_json(buf, final_value);
-  } else {
-    nr_buffer_add(buf, final_value, nr_strlen(final_value));
-  }
+  nr_json_write_key(buf, field_name);
+  nr_json_write_string(buf, final_value);
 
   return true;
 }
@@ -109,30 +95,28 @@ char* nr_log_event_to_json(const nr_log_event_t* event) {
 }
 
 bool nr_log_event_to_json_buffer(const nr_log_event_t* event, nrbuf_t* buf) {
-  char* json = NULL;
   nrobj_t* log_attributes = NULL;
 
   if (NULL == event || NULL == buf) {
     return false;
   }
 
-  // We'll build the JSON manually
+  // We'll stream the JSON straight into the buffer. The buffer may already
+  // hold other data, so the object is opened without a separator.
   nr_buffer_add(buf, NR_PSTR("{"));
 
   // only add non-empty fields
-  add_log_field_to_buf(buf, "message", event->message, true, true, true);
-  add_log_field_to_buf(buf, "level", event->log_level, false, true, true);
-  add_log_field_to_buf(buf, "trace.id", event->trace_id, false, false, true);
-  add_log_field_to_buf(buf, "span.id", event->span_id, false, false, true);
-  add_log_field_to_buf(buf, "entity.guid", event->entity_guid, false, false,
-                       true);
-  add_log_field_to_buf(buf, "entity.name", event->entity_name, false, false,
-                       true);
-  add_log_field_to_buf(buf, "hostname", event->hostname, false, false, true);
+  add_log_field_to_buf(buf, "message", event->message, true);
+  add_log_field_to_buf(buf, "level", event->log_level, true);
+  add_log_field_to_buf(buf, "trace.id", event->trace_id, false);
+  add_log_field_to_buf(buf, "span.id", event->span_id, false);
+  add_log_field_to_buf(buf, "entity.guid", event->entity_guid, false);
+  add_log_field_to_buf(buf, "entity.name", event->entity_name, false);
+  add_log_field_to_buf(buf, "hostname", event->hostname, false);
 
   // timestamp always present
-  nr_buffer_add(buf, NR_PSTR(",\"timestamp\":"));
-  nr_buffer_write_uint64_t_as_text(buf, event->timestamp);
+  nr_json_write_key(buf, "timestamp");
+  nr_json_write_uint(buf, event->timestamp);
 
   // add attributes if present
   if (NULL != event->context_attributes) {
@@ -140,15 +124,14 @@ bool nr_log_event_to_json_buffer(const nr_log_event_t* event, nrbuf_t* buf) {
         event->context_attributes, NR_ATTRIBUTE_DESTINATION_LOG);
 
     if (0 < nro_getsize(log_attributes)) {
-      json = nro_to_json(log_attributes);
-      add_log_field_to_buf(buf, "attributes", json, false, false, false);
-      nr_free(json);
+      nr_json_write_key(buf, "attributes");
+      nr_json_write_object(buf, log_attributes);
     }
 
     nro_delete(log_attributes);
   }
 
-  nr_buffer_add(buf, NR_PSTR("}"));
+  nr_json_write_end_object(buf);
 
   return true;
 }
@@ -14,6 +14,7 @@
 #include "util_logging.h"
 #include "util_memory.h"
 #include "util_slab.h"
+#include "util_stack.h"
 #include "util_string_pool.h"
 #include "util_strings.h"
 #include "util_time.h"
@@ -30,6 +31,28 @@ struct _nr_span_event_and_counter_t {
 
 typedef struct _nr_span_event_and_counter_t nr_span_event_and_counter_t;
 
+/*
+ * Purpose : Add the metrics of a segment to the transaction metric tables.
+ *
+ * Params  : 1. The segment.
+ *           2. The duration of the metrics.
+ *           3. The exclusive time of the metrics.
+ */
+static void nr_segment_add_metrics_to_txn(const nr_segment_t* segment,
+                                          nrtime_t duration,
+                                          nrtime_t exclusive_time) {
+  size_t metric_count = nr_vector_size(segment->metrics);
+
+  for (size_t i = 0; i < metric_count; i++) {
+    nr_segment_metric_t* sm
+        = (nr_segment_metric_t*)nr_vector_get(segment->metrics, i);
+
+    nrm_add_ex(sm->scoped ? segment->txn->scoped_metrics
+                          : segment->txn->unscoped_metrics,
+               sm->name, duration, exclusive_time);
+  }
+}
+
 /*
  * Purpose: Merges metrics from a discarded segment into transaction
  *          metrics.
@@ -51,7 +74,6 @@ static void nr_segment_discard_merge_metrics(nr_segment_t* segment) {
   nrtime_t duration;
   nrtime_t exclusive_time;
   nr_segment_t* parent;
-  size_t metric_count;
   size_t num_children;
   static nrtxn_t* warning_printed_for;
 
@@ -64,7 +86,6 @@ static void nr_segment_discard_merge_metrics(nr_segment_t* segment) {
     return;
   }
 
-  metric_count = nr_vector_size(segment->metrics);
   duration = nr_time_duration(segment->start_time, segment->stop_time);
 
   /*
@@ -76,14 +97,7 @@ static void nr_segment_discard_merge_metrics(nr_segment_t* segment) {
    * large.
    */
   if (segment->txn->options.max_segments > 1) {
-    for (size_t i = 0; i < metric_count; i++) {
-      nr_segment_metric_t* sm
-          = (nr_segment_metric_t*)nr_vector_get(segment->metrics, i);
-
-      nrm_add_ex(sm->scoped ? segment->txn->scoped_metrics
-                            : segment->txn->unscoped_metrics,
-                 sm->name, duration, 0);
-    }
+    nr_segment_add_metrics_to_txn(segment, duration, 0);
 
     if (warning_printed_for != segment->txn) {
       nrl_warning(
@@ -134,6 +148,7 @@ static void nr_segment_discard_merge_metrics(nr_segment_t* segment) {
   } else {
     exclusive_time = nr_exclusive_time_calculate(segment->exclusive_time);
   }
+  exclusive_time = nr_segment_subtract_released_time(segment, exclusive_time);
 
   /*
    * If we're in the same execution context, this segment has to be
@@ -153,14 +168,7 @@ static void nr_segment_discard_merge_metrics(nr_segment_t* segment) {
    * Finally, metrics of this segment with the proper exclusive time and
    * duration are added to the transaction.
    */
-  for (size_t i = 0; i < metric_count; i++) {
-    nr_segment_metric_t* sm
-        = (nr_segment_metric_t*)nr_vector_get(segment->metrics, i);
-
-    nrm_add_ex(sm->scoped ? segment->txn->scoped_metrics
-                          : segment->txn->unscoped_metrics,
-               sm->name, duration, exclusive_time);
-  }
+  nr_segment_add_metrics_to_txn(segment, duration, exclusive_time);
 }
 
 nr_segment_t* nr_segment_start(nrtxn_t* txn,
@@ -217,7 +225,8 @@ bool nr_segment_init(nr_segment_t* segment,
    * segment a sibling of its parent's (possibly) already-existing children. */
   if (parent) {
     segment->parent = parent;
-    nr_segment_children_add(&parent->children, segment);
+    nr_segment_children_add_pooled(&parent->children, segment,
+                                   &txn->segment_children_pool);
   } /* Otherwise, the parent of this new segment is the current segment on the
        transaction */
   else {
@@ -236,7 +245,8 @@ bool nr_segment_init(nr_segment_t* segment,
     segment->parent = current_segment;
 
     if (NULL != current_segment) {
-      nr_segment_children_add(&current_segment->children, segment);
+      nr_segment_children_add_pooled(&current_segment->children, segment,
+                                     &txn->segment_children_pool);
     }
     nr_txn_set_current_segment(txn, segment);
   }
@@ -750,7 +760,9 @@ bool nr_segment_set_parent(nr_segment_t* segment, nr_segment_t* parent) {
     nr_segment_children_remove(&segment->parent->children, segment);
   }
 
-  nr_segment_children_add(&parent->children, segment);
+  nr_segment_children_add_pooled(
+      &parent->children, segment,
+      segment->txn ? &segment->txn->segment_children_pool : NULL);
   segment->parent = parent;
 
   return true;
@@ -769,6 +781,53 @@ bool nr_segment_set_timing(nr_segment_t* segment,
   return true;
 }
 
+/*
+ * Purpose : Record the metrics of a segment when it ends while a segment limit
+ *           applies.
+ *
+ * Params  : 1. The ended segment.
+ *
+ * Notes   : Segments in the segment heap may be discarded at any time, taking
+ *           their timing with them, so the exclusive time of their parents
+ *           cannot be calculated from the tree once the transaction ends.
+ *           Instead, each segment adds its duration to the child time of its
+ *           parent when it ends, and records its metrics straight away.
+ *           Children on the same context run one after another, so their
+ *           durations don't overlap.
+ *
+ *           This also means that segments in the segment heap don't keep
+ *           their metrics.
+ *
+ *           Without a segment limit, metrics are still recorded when the
+ *           transaction is finalised, or when the segment is released. Until
+ *           then, an ended segment keeps its metrics on the segment, where
+ *           the agent and its instrumentation may still read them, and its
+ *           exclusive time is calculated from the final tree: children can
+ *           still end after it, be re-parented to it, or overlap each other
+ *           when their timing is set explicitly.
+ */
+static void nr_segment_end_record_metrics(nr_segment_t* segment) {
+  nrtime_t duration;
+  nrtime_t exclusive_time;
+
+  if (NULL == segment->parent
+      || segment->start_time > segment->stop_time) {
+    return;
+  }
+
+  duration = nr_time_duration(segment->start_time, segment->stop_time);
+
+  if (segment->parent->async_context == segment->async_context) {
+    segment->parent->child_time += duration;
+  }
+
+  exclusive_time
+      = (duration > segment->child_time) ? duration - segment->child_time : 0;
+
+  nr_segment_add_metrics_to_txn(segment, duration, exclusive_time);
+  nr_vector_destroy(&segment->metrics);
+}
+
 bool nr_segment_end(nr_segment_t** segment_ptr) {
   nrtxn_t* txn = NULL;
   nr_segment_t* segment;
@@ -790,11 +849,24 @@ bool nr_segment_end(nr_segment_t** segment_ptr) {
         = nr_time_duration(nr_txn_start_time(txn), nr_get_time());
   }
 
+  segment->state |= NR_SEGMENT_ENDED;
   txn->segment_count += 1;
   nr_txn_retire_current_segment(txn, segment);
 
+  /*
+   * Without a segment limit, metrics are recorded when the transaction is
+   * finalised instead; see nr_segment_end_record_metrics().
+   */
+  if (txn->segment_heap) {
+    nr_segment_end_record_metrics(segment);
+  }
+
   nr_minmax_heap_insert(txn->segment_heap, segment);
 
+  if (txn->options.release_completed_segments) {
+    nr_segment_release_completed(segment);
+  }
+
   (*segment_ptr) = NULL;
 
   return true;
@@ -838,6 +910,23 @@ static nr_segment_iter_return_t nr_segment_destroy_children_callback(
       .post_callback = nr_segment_destroy_children_post_callback});
 }
 
+/*
+ * A segment whose children are being iterated, along with the index of the
+ * next child to visit and the post-traversal callback to invoke once all of
+ * its children have been visited.
+ */
+typedef struct _nr_segment_iter_frame_t {
+  nr_segment_t* segment;
+  size_t next_child;
+  nr_segment_iter_return_t cb_return;
+} nr_segment_iter_frame_t;
+
+/*
+ * The number of frames kept on the C stack. Deeper trees move the frames to
+ * the heap.
+ */
+#define NR_SEGMENT_ITER_FRAMES 64
+
 /*
  * Purpose : Iterate over the segments in a tree of segments.
  *
@@ -847,7 +936,13 @@ static nr_segment_iter_return_t nr_segment_destroy_children_callback(
  *           4. The iterator function to be invoked for each segment
  *           5. Optional userdata for the iterator.
  *
- * Notes   : This iterator is hardened against infinite regress. Even
+ * Notes   : The tree is traversed with an explicit stack of frames rather
+ *           than by recursion, so that deep trees cannot exhaust the C stack.
+ *           Segments are visited in the same pre-order, and post-traversal
+ *           callbacks are invoked in the same post-order, as a recursive
+ *           traversal would.
+ *
+ *           This iterator is hardened against infinite regress. Even
  *           when there are ill-formed cycles in the tree, the
  *           iteration will terminate because it colors the segments
  *           as it traverses them.
@@ -857,32 +952,66 @@ static void nr_segment_iterate_helper(nr_segment_t* root,
                                       nr_segment_color_t set_color,
                                       nr_segment_iter_t callback,
                                       void* userdata) {
-  if (NULL == root) {
-    return;
-  } else {
+  nr_segment_iter_frame_t initial_frames[NR_SEGMENT_ITER_FRAMES];
+  nr_segment_iter_frame_t* frames = initial_frames;
+  size_t capacity = NR_SEGMENT_ITER_FRAMES;
+  size_t depth = 0;
+  nr_segment_t* next = root;
+
+  for (;;) {
     // Color the segments as the tree is traversed to prevent infinite regress.
-    if (reset_color == root->color) {
-      nr_segment_iter_return_t cb_return;
-      size_t i;
-      size_t n_children = nr_segment_children_size(&root->children);
+    if (NULL != next && reset_color == next->color) {
+      nr_segment_iter_frame_t* frame;
+
+      if (nrunlikely(depth == capacity)) {
+        capacity *= 2;
+        if (frames == initial_frames) {
+          frames = (nr_segment_iter_frame_t*)nr_malloc(
+              capacity * sizeof(nr_segment_iter_frame_t));
+          nr_memcpy(frames, initial_frames, sizeof(initial_frames));
+        } else {
+          frames = (nr_segment_iter_frame_t*)nr_realloc(
+              frames, capacity * sizeof(nr_segment_iter_frame_t));
+        }
+      }
 
-      root->color = set_color;
+      next->color = set_color;
 
       // Invoke the pre-traversal callback.
-      cb_return = (callback)(root, userdata);
+      frame = &frames[depth++];
+      frame->segment = next;
+      frame->next_child = 0;
+      frame->cb_return = (callback)(next, userdata);
+    }
+
+    if (0 == depth) {
+      break;
+    }
 
-      // Iterate the children.
-      for (i = 0; i < n_children; i++) {
-        nr_segment_iterate_helper(nr_segment_children_get(&root->children, i),
-                                  reset_color, set_color, callback, userdata);
+    // Iterate the children of the innermost segment.
+    {
+      nr_segment_iter_frame_t* frame = &frames[depth - 1];
+
+      if (frame->next_child
+          < nr_segment_children_size(&frame->segment->children)) {
+        next = nr_segment_children_get(&frame->segment->children,
+                                       frame->next_child++);
+        continue;
       }
 
       // If a post-traversal callback was registered, invoke it.
-      if (cb_return.post_callback) {
-        (cb_return.post_callback)(root, cb_return.userdata);
+      depth--;
+      next = NULL;
+      if (frame->cb_return.post_callback) {
+        (frame->cb_return.post_callback)(frame->segment,
+                                         frame->cb_return.userdata);
       }
     }
   }
+
+  if (frames != initial_frames) {
+    nr_free(frames);
+  }
 }
 
 void nr_segment_iterate(nr_segment_t* root,
@@ -940,10 +1069,14 @@ bool nr_segment_discard(nr_segment_t** segment_ptr) {
   nr_txn_retire_current_segment(segment->txn, segment);
 
   /*
-   * Merge metrics into the transaction's metric tables.
+   * Merge metrics into the transaction's metric tables. Otherwise, the time of
+   * any released children is passed up to the parent, as the segment no
+   * longer stands in for it.
    */
   if (nr_vector_size(segment->metrics)) {
     nr_segment_discard_merge_metrics(segment);
+  } else if (segment->parent->async_context == segment->async_context) {
+    segment->parent->released_time += segment->released_time;
   }
 
   /* Unhook the segment from its parent. */
@@ -951,8 +1084,20 @@ bool nr_segment_discard(nr_segment_t** segment_ptr) {
     return false;
   }
 
+  /*
+   * A segment discarded before it ends never adds its duration to the child
+   * time of its parent, so the time of its ended children has to be passed
+   * up instead: they have recorded their own metrics, and are about to
+   * become children of the parent.
+   */
+  if (!(segment->state & NR_SEGMENT_ENDED)
+      && segment->parent->async_context == segment->async_context) {
+    segment->parent->child_time += segment->child_time;
+  }
+
   /* Reparent all children. */
-  nr_segment_children_reparent(&segment->children, segment->parent);
+  nr_segment_children_reparent(&segment->children, segment->parent,
+                               txn ? &txn->segment_children_pool : NULL);
 
   nr_segment_children_deinit(&segment->children);
 
@@ -964,6 +1109,280 @@ bool nr_segment_discard(nr_segment_t** segment_ptr) {
   return true;
 }
 
+/*
+ * The state of a pass over a subtree that is being released.
+ */
+typedef struct _nr_segment_release_metadata_t {
+  nr_segment_t* top;   /* The segment whose subtree is being released */
+  bool create_spans;   /* Whether span events are created */
+  size_t span_budget;  /* The number of span events that may be created */
+  size_t released;     /* The number of segments released by this pass */
+  nrtime_t total_time; /* The total time of the released segments */
+} nr_segment_release_metadata_t;
+
+static void nr_segment_release_span_event_dtor(void* element,
+                                               void* userdata NRUNUSED) {
+  nr_span_event_destroy((nr_span_event_t**)&element);
+}
+
+/*
+ * Purpose : Check whether every segment within a subtree has ended, has a
+ *           valid duration and is on the main context.
+ *
+ * Params  : 1. The segment at the top of the subtree.
+ *
+ * Returns : True if the subtree can be released.
+ */
+static bool nr_segment_release_is_complete(nr_segment_t* segment) {
+  size_t num_children = nr_segment_children_size(&segment->children);
+  nr_stack_t stack;
+  bool complete = true;
+  size_t i;
+
+  if (!(segment->state & NR_SEGMENT_ENDED)
+      || segment->start_time > segment->stop_time || segment->async_context) {
+    return false;
+  }
+
+  /*
+   * Usually every child has already been released and removed from the tree,
+   * so there is nothing to walk.
+   */
+  if (0 == num_children) {
+    return true;
+  }
+
+  nr_stack_init(&stack, 32);
+  for (i = 0; i < num_children; i++) {
+    nr_stack_push(&stack, nr_segment_children_get(&segment->children, i));
+  }
+
+  while (complete && !nr_stack_is_empty(&stack)) {
+    nr_segment_t* current = (nr_segment_t*)nr_stack_pop(&stack);
+
+    if (!(current->state & NR_SEGMENT_ENDED)
+        || current->start_time > current->stop_time
+        || current->async_context) {
+      complete = false;
+    }
+
+    num_children = nr_segment_children_size(&current->children);
+    for (i = 0; i < num_children; i++) {
+      nr_stack_push(&stack, nr_segment_children_get(&current->children, i));
+    }
+  }
+
+  nr_stack_destroy_fields(&stack);
+
+  return complete;
+}
+
+/*
+ * Purpose : Create the span event for a segment that is being released, and
+ *           keep it in the transaction.
+ */
+static void nr_segment_release_create_span_event(
+    nr_segment_t* segment,
+    nr_segment_release_metadata_t* metadata) {
+  nrtxn_t* txn = segment->txn;
+  nr_span_event_t* event;
+
+  /*
+   * nr_segment_ensure_id() only creates ids while the transaction is sampled,
+   * which it may not be yet.
+   */
+  if (NULL == segment->id) {
+    segment->id = nr_guid_generator_create(&txn->span_ids, txn->rnd);
+  }
+  if (NULL == segment->parent->id) {
+    segment->parent->id = nr_guid_generator_create(&txn->span_ids, txn->rnd);
+  }
+
+  event = nr_segment_to_span_event(segment);
+  if (NULL == event) {
+    return;
+  }
+
+  if (NULL == txn->released_span_events) {
+    txn->released_span_events = nr_vector_create(
+        64, nr_segment_release_span_event_dtor, NULL);
+  }
+
+  nr_vector_push_back(txn->released_span_events, event);
+  segment->parent->state |= NR_SEGMENT_CHILD_SPAN_RELEASED;
+
+  if (metadata->span_budget) {
+    metadata->span_budget -= 1;
+  }
+}
+
+/*
+ * Purpose : Free a released segment.
+ */
+static void nr_segment_release_free(nr_segment_t* segment) {
+  nrtxn_t* txn = segment->txn;
+
+  nr_segment_destroy_fields(segment);
+  nr_segment_children_deinit(&segment->children);
+  nr_slab_release(txn->segment_slab, segment);
+}
+
+/*
+ * Purpose : The callback registered by nr_segment_release_iterator_callback()
+ *           to release a segment once its children have been visited.
+ *
+ * Notes   : The children of the segment are freed here, rather than in their
+ *           own post-traversal callbacks, as the iterator still walks the
+ *           children array of the segment after each child is visited. The
+ *           top segment is freed by nr_segment_release_completed() once the
+ *           iteration is done.
+ */
+static void nr_segment_release_post_iterator_callback(
+    nr_segment_t* segment,
+    nr_segment_release_metadata_t* metadata) {
+  size_t num_children = nr_segment_children_size(&segment->children);
+  nrtime_t exclusive_time;
+  size_t i;
+
+  for (i = 0; i < num_children; i++) {
+    nr_segment_release_free(nr_segment_children_get(&segment->children, i));
+  }
+
+  exclusive_time = nr_segment_subtract_released_time(
+      segment, nr_exclusive_time_calculate(segment->exclusive_time));
+
+  metadata->total_time += exclusive_time;
+  metadata->released += 1;
+
+  nr_segment_add_metrics_to_txn(
+      segment, nr_time_duration(segment->start_time, segment->stop_time),
+      exclusive_time);
+
+  /*
+   * Once the span event budget is spent, span events are still created for
+   * segments with a child that has one, so that no span event is left
+   * without its parent.
+   */
+  if (metadata->create_spans
+      && (metadata->span_budget
+          || (segment->state & NR_SEGMENT_CHILD_SPAN_RELEASED))) {
+    nr_segment_release_create_span_event(segment, metadata);
+  }
+}
+
+/*
+ * Purpose : The callback to iterate over a subtree that is being released.
+ */
+static nr_segment_iter_return_t nr_segment_release_iterator_callback(
+    nr_segment_t* segment,
+    nr_segment_release_metadata_t* metadata) {
+  nr_exclusive_time_ensure(&segment->exclusive_time,
+                           nr_segment_children_size(&segment->children),
+                           segment->start_time, segment->stop_time);
+
+  /*
+   * The top segment is folded into the released time of its parent once the
+   * subtree is released.
+   */
+  if (segment != metadata->top
+      && segment->parent->async_context == segment->async_context) {
+    nr_exclusive_time_add_child(segment->parent->exclusive_time,
+                                segment->start_time, segment->stop_time);
+  }
+
+  // clang-format off
+  return ((nr_segment_iter_return_t){
+    .post_callback
+      = (nr_segment_post_iter_t)nr_segment_release_post_iterator_callback,
+    .userdata = metadata,
+  });
+  // clang-format on
+}
+
+/*
+ * Purpose : Determine whether span events are created for released segments.
+ *
+ * Note    : Unlike nr_txn_should_create_span_events(), this does not depend on
+ *           the transaction being sampled: that may still change before the
+ *           transaction is finalised, for example by accepting an inbound
+ *           payload. The span events of an unsampled transaction are dropped
+ *           when it is finalised.
+ */
+static bool nr_segment_release_should_create_spans(const nrtxn_t* txn) {
+  return txn->options.distributed_tracing_enabled
+         && txn->options.span_events_enabled && NULL == txn->span_queue;
+}
+
+bool nr_segment_release_completed(nr_segment_t* segment) {
+  nr_segment_release_metadata_t metadata;
+  nr_segment_t* parent;
+  nrtxn_t* txn;
+  size_t span_limit;
+  size_t span_count;
+
+  if (nrunlikely(NULL == segment || NULL == segment->txn
+                 || NULL == segment->parent)) {
+    return false;
+  }
+
+  txn = segment->txn;
+  parent = segment->parent;
+
+  /*
+   * Segments in the segment heap may be discarded at any time, so they cannot
+   * be released as well. Asynchronous segments are never released, as the
+   * main context blocking calculation needs every one of them.
+   */
+  if (txn->segment_heap || !nr_segment_release_is_complete(segment)) {
+    return false;
+  }
+
+  /*
+   * One span event is left for the root segment, which is created when the
+   * transaction is finalised.
+   */
+  span_limit = nr_txn_get_span_events_limit(txn);
+  span_count = nr_vector_size(txn->released_span_events);
+
+  metadata = (nr_segment_release_metadata_t){
+      .top = segment,
+      .create_spans = nr_segment_release_should_create_spans(txn),
+      .span_budget = (span_limit > span_count + 1)
+                         ? span_limit - span_count - 1
+                         : 0,
+      .released = 0,
+      .total_time = 0,
+  };
+
+  /*
+   * Iterating toggles the color of the subtree, which is all freed.
+   */
+  nr_segment_iterate(
+      segment, (nr_segment_iter_t)nr_segment_release_iterator_callback,
+      &metadata);
+
+  /*
+   * Fold the segment into its parent: its duration counts towards the
+   * released time of the parent, which is subtracted from the exclusive time
+   * of the parent. Children on the same context run one after another, so
+   * this doesn't overlap with the remaining children of the parent.
+   */
+  if (parent->async_context == segment->async_context) {
+    parent->released_time
+        += nr_time_duration(segment->start_time, segment->stop_time);
+  }
+
+  nr_segment_children_remove(&parent->children, segment);
+  nr_segment_release_free(segment);
+
+  txn->segment_count -= (metadata.released < txn->segment_count)
+                            ? metadata.released
+                            : txn->segment_count;
+  txn->released_total_time += metadata.total_time;
+
+  return true;
+}
+
 /*
  * Safety check for comparator functions
  *
@@ -1031,31 +1450,25 @@ static void nr_segment_stoh_post_iterator_callback(
     nr_segment_t* segment,
     nr_segment_tree_to_heap_metadata_t* metadata) {
   nrtime_t exclusive_time;
-  size_t i;
-  size_t metric_count;
 
   if (nrunlikely(NULL == segment || NULL == metadata)) {
     return;
   }
 
+  // Every descendant has been numbered by now.
+  segment->tree_end = metadata->next_pos - 1;
+
   // Calculate the exclusive time.
-  exclusive_time = nr_exclusive_time_calculate(segment->exclusive_time);
+  exclusive_time = nr_segment_subtract_released_time(
+      segment, nr_exclusive_time_calculate(segment->exclusive_time));
 
   // Update the transaction total time.
   metadata->total_time += exclusive_time;
 
   // Merge any segment metrics with the transaction metric tables.
-  metric_count = nr_vector_size(segment->metrics);
-  for (i = 0; i < metric_count; i++) {
-    nr_segment_metric_t* sm
-        = (nr_segment_metric_t*)nr_vector_get(segment->metrics, i);
-
-    nrm_add_ex(sm->scoped ? segment->txn->scoped_metrics
-                          : segment->txn->unscoped_metrics,
-               sm->name,
-               nr_time_duration(segment->start_time, segment->stop_time),
-               exclusive_time);
-  }
+  nr_segment_add_metrics_to_txn(
+      segment, nr_time_duration(segment->start_time, segment->stop_time),
+      exclusive_time);
 
   /*
    * Don't discard the exclusive time structure for the root segment, as
@@ -1089,6 +1502,19 @@ static nr_segment_iter_return_t nr_segment_stoh_iterator_callback(
     return NR_SEGMENT_NO_POST_ITERATION_CALLBACK;
   }
 
+  /* Number the segment, so that selected segments can be put back into tree
+   * order without iterating over the tree again. */
+  segment->tree_pos = metadata->next_pos++;
+
+  if (metadata->segments) {
+    nr_vector_push_back(metadata->segments, segment);
+  }
+
+  if (nrunlikely(segment->start_time > segment->stop_time)
+      && (NULL == metadata->invalid_segment)) {
+    metadata->invalid_segment = segment;
+  }
+
   /* Set up the exclusive time so that children can adjust it as necessary. */
   nr_exclusive_time_ensure(&segment->exclusive_time,
                            nr_segment_children_size(&segment->children),
@@ -1148,47 +1574,47 @@ void nr_segment_tree_to_heap(nr_segment_t* root,
                      metadata);
 }
 
-/*
- * Purpose : Place an nr_segment_t pointer in a heap into a nr_set_t,
- *             or "heap to set".
- *
- * Params  : 1. The segment pointer in the heap.
- *           2. A void* pointer to be recast as the pointer to the set.
- *
- * Note    : This is the callback function supplied to nr_minmax_heap_iterate
- *           used for iterating over a heap of segments and placing each
- *           segment into a set.
- */
-static bool nr_segment_htos_iterator_callback(void* value, void* userdata) {
+static bool nr_segment_htov_iterator_callback(void* value, void* userdata) {
   if (nrlikely(value && userdata)) {
-    nr_set_t* set = (nr_set_t*)userdata;
-    nr_set_insert(set, value);
+    nr_vector_push_back((nr_vector_t*)userdata, value);
   }
 
   return true;
 }
 
-void nr_segment_heap_to_set(nr_minmax_heap_t* heap, nr_set_t* set) {
-  if (NULL == heap || NULL == set) {
+static int nr_segment_tree_pos_comparator(const void* a,
+                                          const void* b,
+                                          void* userdata NRUNUSED) {
+  uint32_t pos_a = ((const nr_segment_t*)a)->tree_pos;
+  uint32_t pos_b = ((const nr_segment_t*)b)->tree_pos;
+
+  if (pos_a < pos_b) {
+    return -1;
+  } else if (pos_a > pos_b) {
+    return 1;
+  }
+  return 0;
+}
+
+void nr_segment_heap_to_vector(nr_minmax_heap_t* heap, nr_vector_t* vector) {
+  if (NULL == heap || NULL == vector) {
     return;
   }
 
-  /* Convert the heap to a set */
   nr_minmax_heap_iterate(
-      heap, (nr_minmax_heap_iter_t)nr_segment_htos_iterator_callback,
-      (void*)set);
-
-  return;
+      heap, (nr_minmax_heap_iter_t)nr_segment_htov_iterator_callback,
+      (void*)vector);
+  nr_vector_sort(vector, nr_segment_tree_pos_comparator, NULL);
 }
 
-char* nr_segment_ensure_id(nr_segment_t* segment, const nrtxn_t* txn) {
+char* nr_segment_ensure_id(nr_segment_t* segment, nrtxn_t* txn) {
   if (nrunlikely(NULL == segment || NULL == txn)) {
     return NULL;
   }
 
   // Create a segment id if it doesn't exist.
   if ((NULL == segment->id) && (nr_txn_should_create_span_events(txn))) {
-    segment->id = nr_guid_create(txn->rnd);
+    segment->id = nr_guid_generator_create(&txn->span_ids, txn->rnd);
   }
 
   return segment->id;
@@ -43,14 +43,25 @@ typedef enum _nr_segment_type_t {
  * span events, and the other for traces. It keeps a running total of the
  * transaction's total time, which is the sum of all exclusive time.
  *
+ * The iteration also numbers the segments in pre-order: each segment's
+ * tree_pos is set to its position, and its tree_end to the largest position
+ * within its subtree (see nr_segment_t below). The selected segments can then
+ * be emitted in tree order, nested correctly, without iterating over the tree
+ * again. If no sampling is required, every segment can be collected into a
+ * vector instead of a heap.
+ *
  * This struct is used to pass in the two heaps, along with the field to track
  * the total time.
  */
 typedef struct {
   nr_minmax_heap_t* span_heap;
   nr_minmax_heap_t* trace_heap;
+  nr_vector_t* segments; /* If set, receives every segment in pre-order */
   nrtime_t total_time;
   nr_exclusive_time_t* main_context;
+  uint32_t next_pos;             /* The next pre-order position */
+  nr_segment_t* invalid_segment; /* The first segment found that stopped
+                                    before it started, if any */
 } nr_segment_tree_to_heap_metadata_t;
 
 /*
@@ -92,6 +103,19 @@ typedef enum _nr_segment_color_t {
 #define NR_SEGMENT_PRIORITY_LOG (1 << 14)
 #define NR_SEGMENT_PRIORITY_ATTR (1 << 13)
 
+/*
+ * Segment state flags
+ *
+ * These go into the state bitfield in the nr_segment_t struct.
+ *
+ * NR_SEGMENT_ENDED is set by nr_segment_end. NR_SEGMENT_CHILD_SPAN_RELEASED
+ * marks a segment with a child that was released by
+ * nr_segment_release_completed along with a span event, so that a span event
+ * is also created for the segment when it is released.
+ */
+#define NR_SEGMENT_ENDED (1 << 0)
+#define NR_SEGMENT_CHILD_SPAN_RELEASED (1 << 1)
+
 typedef struct _nr_segment_datastore_t {
   char* component; /* The name of the database vendor or driver */
   char* sql;
@@ -203,6 +227,11 @@ typedef struct _nr_segment_t {
   nr_segment_children_t children;
   size_t child_ix; /* index of this segment in its parent->children vector */
   nr_segment_color_t color;
+  uint32_t tree_pos; /* Pre-order position of this segment in the tree. This,
+                        and tree_end, are only set while the tree is being
+                        finalised. */
+  uint32_t tree_end; /* Largest tree_pos within this segment's subtree */
+  uint8_t state;     /* NR_SEGMENT_* state flags */
 
   /* Generic segment fields. */
 
@@ -233,6 +262,14 @@ typedef struct _nr_segment_t {
                                        This is only calculated after the
                                        transaction has ended; before then, this
                                        will be NULL. */
+  nrtime_t child_time; /* The total duration of the ended children on the
+                          same context. This is only kept while a segment
+                          limit applies, to calculate the exclusive time of
+                          the segment when it ends. */
+  nrtime_t released_time; /* The total duration of the released children on
+                             the same context, which are no longer in the
+                             tree. This is subtracted from the exclusive time
+                             of the segment. */
   nr_attributes_t* attributes;         /* User attributes */
   nr_attributes_t*
       attributes_txn_event; /* Transaction event custom user attributes */
@@ -624,13 +661,15 @@ extern void nr_segment_tree_to_heap(
     nr_segment_tree_to_heap_metadata_t* metadata);
 
 /*
- * Purpose : Given a heap of segments, create a set containing the highest
- *           priority segments.
+ * Purpose : Given a heap of segments that were numbered by
+ *           nr_segment_tree_to_heap(), fill a vector with the segments in
+ *           tree order.
  *
  * Params  : 1. The heap.
- *           2. The set to populate.
+ *           2. The vector to populate.
  */
-extern void nr_segment_heap_to_set(nr_minmax_heap_t* heap, nr_set_t* set);
+extern void nr_segment_heap_to_vector(nr_minmax_heap_t* heap,
+                                      nr_vector_t* vector);
 
 /*
  * Purpose : Free a tree of segments.
@@ -661,18 +700,47 @@ extern void nr_segment_destroy_tree(nr_segment_t* root);
  */
 extern bool nr_segment_discard(nr_segment_t** segment);
 
+/*
+ * Purpose : Release the subtree of an ended segment, if every segment within
+ *           it has ended.
+ *
+ * Params  : 1. The segment.
+ *
+ * Returns : True if the subtree was released.
+ *
+ * Notes   : This is called by nr_segment_end() when the
+ *           release_completed_segments transaction option is enabled.
+ *
+ *           The metrics and exclusive time of the released segments are
+ *           merged into the transaction, and span events are created for them
+ *           and kept in the transaction until it is finalised. The segment and
+ *           its descendants are then freed and removed from the tree: the
+ *           duration of the segment is added to the released time of its
+ *           parent, which keeps the exclusive time of the parent correct.
+ *           The segment must not be used once it has ended.
+ *
+ *           Nothing is released while a segment limit applies, as the segment
+ *           heap keeps the ended segments.
+ *
+ *           Released segments are not part of the transaction trace.
+ */
+extern bool nr_segment_release_completed(nr_segment_t* segment);
+
 /*
  * Purpose : Ensure the segment has an ID.
  *
  *           This function is guaranteed to return an ID if span events will be
  *           created for the given transaction, otherwise it can return NULL.
  *
+ *           IDs are created lazily from the transaction's span id
+ *           generator, so segments that never need one cost nothing.
+ *
  * Params  : 1. A pointer to a segment.
  *           2. The transaction.
  *
  * Returns : The ID of the segment or NULL.
  */
-extern char* nr_segment_ensure_id(nr_segment_t* segment, const nrtxn_t* txn);
+extern char* nr_segment_ensure_id(nr_segment_t* segment, nrtxn_t* txn);
 
 /*
  * Purpose : Set a segment priority flag
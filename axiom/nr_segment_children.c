@@ -8,6 +8,109 @@
 #include "nr_segment.h"
 #include "nr_segment_children.h"
 
+/*
+ * Return the size class of the pool that holds arrays of the given capacity,
+ * or -1 if arrays of that capacity are allocated from the heap.
+ */
+static int nr_segment_children_pool_class(size_t capacity) {
+  size_t class_capacity = NR_SEGMENT_CHILDREN_PACKED_LIMIT * 2;
+  int i;
+
+  for (i = 0; i < NR_SEGMENT_CHILDREN_POOL_CLASSES; i++) {
+    if (capacity == class_capacity) {
+      return i;
+    }
+    class_capacity *= 2;
+  }
+
+  return -1;
+}
+
+nr_segment_t** nr_segment_children_pool_alloc(nr_segment_children_pool_t* pool,
+                                              size_t capacity) {
+  int size_class = nr_segment_children_pool_class(capacity);
+
+  if (NULL == pool || size_class < 0) {
+    return (nr_segment_t**)nr_malloc(capacity * sizeof(nr_segment_t*));
+  }
+
+  if (NULL == pool->slabs[size_class]) {
+    pool->slabs[size_class]
+        = nr_slab_create(capacity * sizeof(nr_segment_t*), 0);
+  }
+
+  return (nr_segment_t**)nr_slab_next(pool->slabs[size_class]);
+}
+
+void nr_segment_children_pool_free(nr_segment_children_pool_t* pool,
+                                   nr_segment_t** elements,
+                                   size_t capacity) {
+  int size_class = nr_segment_children_pool_class(capacity);
+
+  if (NULL == pool || size_class < 0) {
+    nr_free(elements);
+    return;
+  }
+
+  nr_slab_release(pool->slabs[size_class], elements);
+}
+
+void nr_segment_children_pool_destroy_fields(
+    nr_segment_children_pool_t* pool) {
+  int i;
+
+  if (NULL == pool) {
+    return;
+  }
+
+  for (i = 0; i < NR_SEGMENT_CHILDREN_POOL_CLASSES; i++) {
+    nr_slab_destroy(&pool->slabs[i]);
+  }
+}
+
+void nr_segment_children_ensure_spilled(nr_segment_children_t* children,
+                                        size_t capacity) {
+  nr_segment_spilled_children_t* spilled = &children->spilled;
+  size_t new_capacity = spilled->capacity;
+  nr_segment_t** elements;
+
+  if (capacity <= spilled->capacity) {
+    return;
+  }
+
+  /*
+   * A zeroed children structure is spilled with no array at all, so start
+   * from the first size class.
+   */
+  if (0 == new_capacity) {
+    new_capacity = NR_SEGMENT_CHILDREN_PACKED_LIMIT * 2;
+  }
+  while (new_capacity < capacity) {
+    new_capacity *= 2;
+  }
+
+  /*
+   * Arrays beyond the largest size class are only ever on the heap, so they
+   * can simply be reallocated.
+   */
+  if (NULL == spilled->pool
+      || nr_segment_children_pool_class(spilled->capacity) < 0) {
+    spilled->elements = (nr_segment_t**)nr_realloc(
+        spilled->elements, new_capacity * sizeof(nr_segment_t*));
+    spilled->capacity = new_capacity;
+    return;
+  }
+
+  elements = nr_segment_children_pool_alloc(spilled->pool, new_capacity);
+  nr_memcpy(elements, spilled->elements,
+            spilled->count * sizeof(nr_segment_t*));
+  nr_segment_children_pool_free(spilled->pool, spilled->elements,
+                                spilled->capacity);
+
+  spilled->elements = elements;
+  spilled->capacity = new_capacity;
+}
+
 nr_segment_t* nr_segment_children_get_prev(nr_segment_children_t* children,
                                            nr_segment_t* child) {
   nr_segment_t* prev;
@@ -71,7 +174,8 @@ nr_segment_t* nr_segment_children_get_next(nr_segment_children_t* children,
 }
 
 bool nr_segment_children_reparent(nr_segment_children_t* children,
-                                  nr_segment_t* new_parent) {
+                                  nr_segment_t* new_parent,
+                                  nr_segment_children_pool_t* pool) {
   size_t i;
   size_t parent_size;
   size_t req_parent_size;
@@ -98,13 +202,13 @@ bool nr_segment_children_reparent(nr_segment_children_t* children,
   }
 
   if (req_parent_size > NR_SEGMENT_CHILDREN_PACKED_LIMIT) {
-    nr_segment_children_migrate_to_vector(&new_parent->children);
+    nr_segment_children_migrate_to_spilled(&new_parent->children, pool);
   }
 
   if (children->is_packed) {
     source = &children->packed.elements[0];
   } else {
-    source = &children->vector.elements[0];
+    source = &children->spilled.elements[0];
   }
 
   if (new_parent->children.is_packed) {
@@ -112,10 +216,10 @@ bool nr_segment_children_reparent(nr_segment_children_t* children,
               size * sizeof(nr_segment_t*));
     new_parent->children.packed.count = req_parent_size;
   } else {
-    nr_vector_ensure(&new_parent->children.vector, req_parent_size);
-    nr_memcpy(&new_parent->children.vector.elements[parent_size], source,
+    nr_segment_children_ensure_spilled(&new_parent->children, req_parent_size);
+    nr_memcpy(&new_parent->children.spilled.elements[parent_size], source,
               size * sizeof(nr_segment_t*));
-    new_parent->children.vector.used = req_parent_size;
+    new_parent->children.spilled.count = req_parent_size;
   }
 
   nr_segment_children_deinit(children);
@@ -17,8 +17,15 @@
 
 #define NR_SEGMENT_CHILDREN_PACKED_LIMIT 8
 
+/*
+ * The number of size classes of spilled children arrays that are allocated
+ * from a pool. The classes hold twice NR_SEGMENT_CHILDREN_PACKED_LIMIT
+ * children, then four times, and so on; larger arrays come from the heap.
+ */
+#define NR_SEGMENT_CHILDREN_POOL_CLASSES 5
+
 #include "util_memory.h"
-#include "util_vector.h"
+#include "util_slab.h"
 
 /*
  * Forward declaration of nr_segment_t, and some getters/setters,
@@ -28,6 +35,18 @@ typedef struct _nr_segment_t nr_segment_t;
 extern ssize_t nr_segment_get_child_ix(const nr_segment_t*);
 extern void nr_segment_set_child_ix(nr_segment_t*, size_t);
 
+/*
+ * A pool of spilled children arrays, with one slab allocator per size class.
+ * Each transaction owns a pool, so that the children arrays of its segments
+ * are carved out of a few pages instead of being allocated from the heap one
+ * at a time, and arrays released by one segment are reused by the next.
+ *
+ * A zero initialised pool is valid: slabs are created as they are needed.
+ */
+typedef struct _nr_segment_children_pool_t {
+  nr_slab_t* slabs[NR_SEGMENT_CHILDREN_POOL_CLASSES];
+} nr_segment_children_pool_t;
+
 /*
  * The data structure for packed children, holding an array of children and the
  * number of elements in the array.
@@ -37,14 +56,26 @@ typedef struct {
   nr_segment_t* elements[NR_SEGMENT_CHILDREN_PACKED_LIMIT];
 } nr_segment_packed_children_t;
 
+/*
+ * The data structure for children that have outgrown the packed array. The
+ * elements array is allocated from the pool if it fits a size class and a
+ * pool was provided, and from the heap otherwise.
+ */
+typedef struct {
+  size_t count;
+  size_t capacity;
+  nr_segment_t** elements;
+  nr_segment_children_pool_t* pool;
+} nr_segment_spilled_children_t;
+
 /*
  * The children structure. If `is_packed` is true the union is used as packed,
- * otherwise it is used as vector.
+ * otherwise it is used as spilled.
  */
 typedef struct {
   bool is_packed;
   union {
-    nr_vector_t vector;
+    nr_segment_spilled_children_t spilled;
     nr_segment_packed_children_t packed;
   };
 } nr_segment_children_t;
@@ -76,7 +107,9 @@ static inline void nr_segment_children_deinit(nr_segment_children_t* children) {
   }
 
   if (!children->is_packed) {
-    nr_vector_deinit(&children->vector);
+    nr_segment_children_pool_free(children->spilled.pool,
+                                  children->spilled.elements,
+                                  children->spilled.capacity);
   }
   nr_segment_children_init(children);
 }
@@ -95,7 +128,7 @@ static inline size_t nr_segment_children_size(
   }
 
   return children->is_packed ? children->packed.count
-                             : nr_vector_size(&children->vector);
+                             : children->spilled.count;
 }
 
 /*
@@ -114,22 +147,26 @@ static inline nr_segment_t* nr_segment_children_get(
     return NULL;
   }
 
-  // This breaks the encapsulation of nr_vector_t, but avoids the checks that
-  // we've already done above.
   return children->is_packed ? children->packed.elements[i]
-                             : children->vector.elements[i];
+                             : children->spilled.elements[i];
 }
 
 /*
- * Purpose : Add a child to a segment's children.
+ * Purpose : Add a child to a segment's children, allocating any spilled array
+ *           from a pool.
  *
  * Params  : 1. A pointer to a segment's nr_segment_children_t structure.
  *           2. A pointer to the segment to add.
+ *           3. The pool to allocate the array from if the children outgrow
+ *              the packed array, or NULL to use the heap. Once spilled, the
+ *              children keep using the pool they spilled into.
  *
  * Returns : True if successful, false otherwise.
  */
-static inline bool nr_segment_children_add(nr_segment_children_t* children,
-                                           nr_segment_t* child) {
+static inline bool nr_segment_children_add_pooled(
+    nr_segment_children_t* children,
+    nr_segment_t* child,
+    nr_segment_children_pool_t* pool) {
   if (nrunlikely(NULL == children || NULL == child)) {
     return false;
   }
@@ -138,21 +175,32 @@ static inline bool nr_segment_children_add(nr_segment_children_t* children,
     size_t new_count = children->packed.count + 1;
 
     if (new_count > NR_SEGMENT_CHILDREN_PACKED_LIMIT) {
-      // We're about to overflow the packed array; migrate to a vector.
-      nr_segment_children_migrate_to_vector(children);
-      nr_segment_set_child_ix(child, nr_vector_size(&children->vector));
-      nr_segment_children_add_vector(children, child);
-    } else {
-      children->packed.elements[children->packed.count] = child;
-      children->packed.count = new_count;
-      nr_segment_set_child_ix(child, new_count - 1);
+      // We're about to overflow the packed array; migrate to a spilled array.
+      nr_segment_children_migrate_to_spilled(children, pool);
+      return nr_segment_children_add_spilled(children, child);
     }
-  } else {
-    nr_segment_set_child_ix(child, nr_vector_size(&children->vector));
-    nr_segment_children_add_vector(children, child);
+
+    children->packed.elements[children->packed.count] = child;
+    children->packed.count = new_count;
+    nr_segment_set_child_ix(child, new_count - 1);
+
+    return true;
   }
 
-  return true;
+  return nr_segment_children_add_spilled(children, child);
+}
+
+/*
+ * Purpose : Add a child to a segment's children.
+ *
+ * Params  : 1. A pointer to a segment's nr_segment_children_t structure.
+ *           2. A pointer to the segment to add.
+ *
+ * Returns : True if successful, false otherwise.
+ */
+static inline bool nr_segment_children_add(nr_segment_children_t* children,
+                                           nr_segment_t* child) {
+  return nr_segment_children_add_pooled(children, child, NULL);
 }
 
 /*
@@ -165,44 +213,34 @@ static inline bool nr_segment_children_add(nr_segment_children_t* children,
  */
 static inline bool nr_segment_children_remove(nr_segment_children_t* children,
                                               const nr_segment_t* child) {
+  nr_segment_t** elements;
+  nr_segment_t* temp;
+  size_t ix;
+  size_t end;
+
   if (nrunlikely(NULL == children || NULL == child
                  || 0 == nr_segment_children_size(children))) {
     return false;
   }
 
-  if (children->is_packed) {
-    size_t ix = (size_t)nr_segment_get_child_ix(child); // safe to cast, child != NULL asserted earlier
-    const size_t end = children->packed.count - 1;
-    nr_segment_t* temp;
+  ix = (size_t)nr_segment_get_child_ix(child); // safe to cast, child != NULL asserted earlier
+  end = nr_segment_children_size(children) - 1;
+  if (ix > end) {
+    return false;
+  }
 
-    if (ix > end) {
-      return false;
-    }
+  elements = children->is_packed ? children->packed.elements
+                                 : children->spilled.elements;
 
-    // Swap'n'Pop
-    temp = children->packed.elements[end];
-    nr_segment_set_child_ix(temp, ix);
-    children->packed.elements[ix] = temp;
-    children->packed.count -= 1;
+  // Swap'n'Pop
+  temp = elements[end];
+  nr_segment_set_child_ix(temp, ix);
+  elements[ix] = temp;
 
+  if (children->is_packed) {
+    children->packed.count = end;
   } else {
-    size_t index = (size_t)nr_segment_get_child_ix(child); // safe to cast, child != NULL asserted earlier
-    nr_segment_t* temp;
-    if (index >= nr_vector_size(&children->vector)) {
-        return false;
-    }
-
-    if (!nr_vector_get_element(&children->vector, nr_vector_size(&children->vector)-1, (void**)&temp)) {
-      return false;
-    }
-    nr_segment_set_child_ix(temp, index);
-
-    if (!nr_vector_replace(&children->vector, index, temp)) {
-      return false;
-    }
-    if (!nr_vector_pop_back(&children->vector, (void**)&temp)) {
-      return false;
-    }
+    children->spilled.count = end;
   }
 
   return true;
@@ -213,10 +251,24 @@ static inline bool nr_segment_children_remove(nr_segment_children_t* children,
  *
  * Params  : 1. A pointer to a segment's nr_segment_children_t structure.
  *           2. The new parent segment.
+ *           3. The pool to allocate the new parent's array from if its
+ *              children outgrow the packed array, or NULL to use the heap.
  *
  * Returns : True on success; false otherwise.
  */
 extern bool nr_segment_children_reparent(nr_segment_children_t* children,
-                                         nr_segment_t* new_parent);
+                                         nr_segment_t* new_parent,
+                                         nr_segment_children_pool_t* pool);
+
+/*
+ * Purpose : Destroy the slabs of a children pool.
+ *
+ * Params  : 1. A pointer to the pool.
+ *
+ * Warning : Every children structure that spilled into the pool must have
+ *           been deinitialised first.
+ */
+extern void nr_segment_children_pool_destroy_fields(
+    nr_segment_children_pool_t* pool);
 
 #endif /* NR_SEGMENT_CHILDREN_HDR */
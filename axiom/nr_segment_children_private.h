@@ -10,7 +10,45 @@
 #define NR_SEGMENT_CHILDREN_PRIVATE_HDR
 
 /*
- * Purpose : Add an element to the children vector.
+ * Purpose : Allocate a spilled children array.
+ *
+ * Params  : 1. The pool to allocate from, or NULL to use the heap.
+ *           2. The capacity of the array, in elements. Arrays whose capacity
+ *              matches a size class of the pool are allocated from the pool.
+ *
+ * Returns : A newly allocated array.
+ */
+extern nr_segment_t** nr_segment_children_pool_alloc(
+    nr_segment_children_pool_t* pool,
+    size_t capacity);
+
+/*
+ * Purpose : Free a spilled children array.
+ *
+ * Params  : 1. The pool the array was allocated from, or NULL if it was
+ *              allocated from the heap.
+ *           2. The array to free.
+ *           3. The capacity the array was allocated with.
+ */
+extern void nr_segment_children_pool_free(nr_segment_children_pool_t* pool,
+                                          nr_segment_t** elements,
+                                          size_t capacity);
+
+/*
+ * Purpose : Grow a spilled children array to hold at least the given number
+ *           of elements.
+ *
+ * Params  : 1. A pointer to a segment's nr_segment_children_t structure.
+ *           2. The required capacity.
+ *
+ * Warning : This function does not check if the children pointer is valid, or
+ *           if a spilled array is in use.
+ */
+extern void nr_segment_children_ensure_spilled(nr_segment_children_t* children,
+                                               size_t capacity);
+
+/*
+ * Purpose : Add an element to the spilled children array.
  *
  * Params  : 1. A pointer to a segment's nr_segment_children_t structure.
  *           2. A pointer to the segment to add.
@@ -18,48 +56,51 @@
  * Returns : True if successful, false otherwise.
  *
  * Warning : This function does not check if the children pointer is valid, or
- *           if a vector is in use.
+ *           if a spilled array is in use.
  */
-static inline bool nr_segment_children_add_vector(
+static inline bool nr_segment_children_add_spilled(
     nr_segment_children_t* children,
     nr_segment_t* child) {
-  // If we're ever going to add a defensive check to guard against the vector
-  // capacity growing to the point where the high bit is set, this would be
-  // where we'd do it.
-  return nr_vector_push_back(&children->vector, child);
+  nr_segment_spilled_children_t* spilled = &children->spilled;
+
+  if (nrunlikely(spilled->count == spilled->capacity)) {
+    nr_segment_children_ensure_spilled(children, spilled->count + 1);
+  }
+
+  nr_segment_set_child_ix(child, spilled->count);
+  spilled->elements[spilled->count] = child;
+  spilled->count += 1;
+
+  return true;
 }
 
 /*
- * Purpose : Migrate a segment children structure to use a vector as its
- *           backing store, unconditionally.
+ * Purpose : Migrate a segment children structure to use a spilled array as
+ *           its backing store, unconditionally.
  *
  * Params  : 1. A pointer to a segment's nr_segment_children_t structure.
+ *           2. The pool to allocate the array from, or NULL to use the heap.
  */
-static inline void nr_segment_children_migrate_to_vector(
-    nr_segment_children_t* children) {
+static inline void nr_segment_children_migrate_to_spilled(
+    nr_segment_children_t* children,
+    nr_segment_children_pool_t* pool) {
   if (nrlikely(children->is_packed)) {
-    if (nrlikely(children->packed.count > 0)) {
-      // Using nr_alloca() because we should never have enough elements in the
-      // packed variant to cause stack overflow issues.
-      const size_t count = children->packed.count;
-      nr_segment_t** packed
-          = (nr_segment_t**)nr_alloca(sizeof(nr_segment_t*) * count);
+    const size_t count = children->packed.count;
+    const size_t capacity = NR_SEGMENT_CHILDREN_PACKED_LIMIT * 2;
+    nr_segment_t** elements = nr_segment_children_pool_alloc(pool, capacity);
 
-      // Temporarily copy the elements out to the stack array above.
-      nr_memcpy(packed, &children->packed.elements[0],
-                sizeof(nr_segment_t*) * count);
+    // The packed elements share storage with the spilled fields, so copy them
+    // out before the spilled fields are written.
+    nr_memcpy(elements, &children->packed.elements[0],
+              sizeof(nr_segment_t*) * count);
 
-      // Set up the vector.
-      children->is_packed = false;
-      nr_vector_init(&children->vector, count * 2, NULL, NULL);
-      children->vector.used = count;
-      nr_memcpy(&children->vector.elements[0], packed,
-                sizeof(nr_segment_t*) * count);
-    } else {
-      children->is_packed = false;
-      nr_vector_init(&children->vector, NR_SEGMENT_CHILDREN_PACKED_LIMIT, NULL,
-                     NULL);
-    }
+    children->is_packed = false;
+    children->spilled = (nr_segment_spilled_children_t){
+        .count = count,
+        .capacity = capacity,
+        .elements = elements,
+        .pool = pool,
+    };
   }
 }
 
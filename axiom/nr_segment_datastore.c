@@ -10,8 +10,32 @@
 #include "nr_txn.h"
 #include "util_strings.h"
 #include "util_sql.h"
+#include "util_sql_cache.h"
 #include "util_logging.h"
 
+/*
+ * Purpose : Record whether a lookup in the SQL cache was a hit or a miss.
+ */
+static void nr_segment_datastore_sql_cache_metric(
+    const nrtxn_t* txn,
+    nr_sql_cache_status_t status) {
+  switch (status) {
+    case NR_SQL_CACHE_HIT:
+      nrm_force_add(txn->unscoped_metrics, "Supportability/PHP/SQLCache/Hit",
+                    0);
+      break;
+
+    case NR_SQL_CACHE_MISS:
+      nrm_force_add(txn->unscoped_metrics, "Supportability/PHP/SQLCache/Miss",
+                    0);
+      break;
+
+    case NR_SQL_CACHE_BYPASSED:
+    default:
+      break;
+  }
+}
+
 static char* create_metrics(nr_segment_t* segment,
                             nrtime_t duration,
                             const char* product,
@@ -102,6 +126,7 @@ bool nr_segment_datastore_end(nr_segment_t** segment_ptr,
   char* input_query_query = NULL;
   nr_segment_datastore_t datastore = {0};
   nr_segment_t* segment = NULL;
+  nr_sql_cache_status_t cache_status;
   bool rv = false;
 
   if (NULL == segment_ptr) {
@@ -249,7 +274,9 @@ bool nr_segment_datastore_end(nr_segment_t** segment_ptr,
         break;
 
       case NR_SQL_OBFUSCATED:
-        datastore.sql_obfuscated = nr_sql_obfuscate(params->sql.sql);
+        datastore.sql_obfuscated
+            = nr_sql_cache_obfuscate(params->sql.sql, &cache_status);
+        nr_segment_datastore_sql_cache_metric(txn, cache_status);
 
         /*
          * If it's set, we have to replace input_query with the obfuscated
@@ -257,7 +284,9 @@ bool nr_segment_datastore_end(nr_segment_t** segment_ptr,
          */
         if (params->sql.input_query) {
           input_query_allocated.query = input_query_query
-              = nr_sql_obfuscate(params->sql.input_query->query);
+              = nr_sql_cache_obfuscate(params->sql.input_query->query,
+                                       &cache_status);
+          nr_segment_datastore_sql_cache_metric(txn, cache_status);
           input_query_allocated.name = params->sql.input_query->name;
           input_query = &input_query_allocated;
         }
@@ -341,6 +370,7 @@ char* nr_segment_sql_get_operation_and_table(
     const char* sql,
     nr_modify_table_name_fn_t modify_table_name_fn) {
   char* table = NULL;
+  nr_sql_cache_status_t cache_status;
 
   if (operation_ptr) {
     *operation_ptr = NULL;
@@ -352,8 +382,10 @@ char* nr_segment_sql_get_operation_and_table(
     return NULL;
   }
 
-  nr_sql_get_operation_and_table(sql, operation_ptr, &table,
-                                 txn->special_flags.show_sql_parsing);
+  nr_sql_cache_get_operation_and_table(sql, operation_ptr, &table,
+                                       txn->special_flags.show_sql_parsing,
+                                       &cache_status);
+  nr_segment_datastore_sql_cache_metric(txn, cache_status);
   if (NULL == table) {
     return NULL;
   }
@@ -104,3 +104,14 @@ void nr_segment_error_destroy_fields(nr_segment_error_t* segment_error) {
   nr_free(segment_error->error_class);
   nr_free(segment_error);
 }
+
+nrtime_t nr_segment_subtract_released_time(const nr_segment_t* segment,
+                                           nrtime_t exclusive_time) {
+  if (nrunlikely(NULL == segment)) {
+    return exclusive_time;
+  }
+
+  return (exclusive_time > segment->released_time)
+             ? exclusive_time - segment->released_time
+             : 0;
+}
@@ -54,4 +54,17 @@ void nr_segment_metric_destroy_fields(nr_segment_metric_t* sm);
  */
 void nr_segment_error_destroy_fields(nr_segment_error_t* segment_error);
 
+/*
+ * Purpose : Subtract the time of the released children of a segment from its
+ *           exclusive time.
+ *
+ * Params  : 1. The segment.
+ *           2. The exclusive time of the segment, as calculated from the
+ *              children that are still in the tree.
+ *
+ * Returns : The exclusive time of the segment.
+ */
+nrtime_t nr_segment_subtract_released_time(const nr_segment_t* segment,
+                                           nrtime_t exclusive_time);
+
 #endif
@@ -12,6 +12,7 @@
 #include "nr_segment_traces.h"
 #include "nr_segment_tree.h"
 #include "nr_txn.h"
+#include "util_json_writer.h"
 #include "util_logging.h"
 #include "util_minmax_heap.h"
 #include "util_strings.h"
@@ -25,11 +26,8 @@ static void nr_vector_span_event_dtor(void* element, void* userdata NRUNUSED) {
 /*
  * Purpose: Add a key-value pair to a hash in the buffer.
  *
- * If the key-value pair is not the first pair in the hash, it is
- * prepended with a comma.
- *
- * If raw_json is true, the value is added as escaped JSON. Otherwise
- * the value is added to the JSON output as is.
+ * If raw_json is true, the value is added to the JSON output as is.
+ * Otherwise the value is added as an escaped JSON string.
  */
 static void add_hash_key_value_to_buffer(nrbuf_t* buf,
                                          const char* key,
@@ -39,17 +37,11 @@ static void add_hash_key_value_to_buffer(nrbuf_t* buf,
     return;
   }
 
-  if ('{' != nr_buffer_peek_end(buf)) {
-    nr_buffer_add(buf, NR_PSTR(","));
-  }
-
-  nr_buffer_add(buf, NR_PSTR("\""));
-  nr_buffer_add(buf, key, nr_strlen(key));
-  nr_buffer_add(buf, NR_PSTR("\":"));
+  nr_json_write_key(buf, key);
   if (raw_json) {
-    nr_buffer_add(buf, value, nr_strlen(value));
+    nr_json_write_raw(buf, value);
   } else {
-    nr_buffer_add_escape_json(buf, value);
+    nr_json_write_string(buf, value);
   }
 }
 
@@ -60,14 +52,8 @@ static void add_hash_key_value_to_buffer_int(nrbuf_t* buf,
     return;
   }
 
-  if ('{' != nr_buffer_peek_end(buf)) {
-    nr_buffer_add(buf, NR_PSTR(","));
-  }
-
-  nr_buffer_add(buf, NR_PSTR("\""));
-  nr_buffer_add(buf, key, nr_strlen(key));
-  nr_buffer_add(buf, NR_PSTR("\":"));
-  nr_buffer_write_uint64_t_as_text(buf, *value);
+  nr_json_write_key(buf, key);
+  nr_json_write_uint(buf, *value);
 }
 
 /*
@@ -95,36 +81,6 @@ static void add_async_attribute_to_buffer(nrbuf_t* buf,
   add_hash_key_value_to_buffer(buf, "async_context", context_idx_str, false);
 }
 
-/*
- * Purpose: Add a hash to a hash in the buffer.
- *
- * The hash is added without the leading and trailing '{' and '}'
- * characters.
- *
- * If the hash in the buffer already contains key-value pairs, a comma
- * is added before adding further values.
- */
-static void add_attribute_hash_to_buffer(nrbuf_t* buf, nrobj_t* attributes) {
-  if (NULL != attributes) {
-    char* json = nro_to_json(attributes);
-    int json_len = nr_strlen(json);
-
-    /*
-     * An empty hash will be a two character string: "{}". If it's longer than
-     * that, then there's data, which we should add to the buffer without the
-     * surrounding braces.
-     */
-    if (json_len > 2) {
-      if ('{' != nr_buffer_peek_end(buf)) {
-        nr_buffer_add(buf, ",", 1);
-      }
-      nr_buffer_add(buf, json + 1, nr_strlen(json) - 2);
-    }
-
-    nr_free(json);
-  }
-}
-
 /*
  * Purpose: Add typed attributes from a segment to a hash in the buffer.
  */
@@ -187,93 +143,23 @@ static void add_typed_attributes_to_buffer(nrbuf_t* buf,
   }
 }
 
-static inline bool nr_segment_is_sampled(const nr_segment_t* segment,
-                                         nr_set_t* set) {
-  if (nrunlikely(NULL == segment)) {
-    return false;
-  }
-
-  if (NULL == set) {
-    return true;
-  }
-  return nr_set_contains(set, (const void*)segment);
-}
-
-static void nr_segment_traces_stot_iterator_post_callback(
-    nr_segment_t* segment,
-    nr_segment_userdata_t* userdata) {
-  nr_segment_t* current_trace_segment;
-
-  if (nrunlikely(NULL == segment || NULL == userdata)) {
-    nrl_warning(
-        NRL_SEGMENT,
-        "Invalid inputs to the segment iterator: segment=%p; userdata=%p",
-        segment, userdata);
-    userdata->success = false;
-    return;
-  }
-
-  current_trace_segment = nr_vector_get(userdata->trace.current_path, 0);
-
-  /*
-   * The segment is sampled for the the trace output. It has to be popped off
-   * the current trace ancestor path and brackets have to be added to the
-   * trace output.
-   */
-  if (NULL != userdata->trace.buf && segment == current_trace_segment) {
-    nr_buffer_add(userdata->trace.buf, "]", 1);
-    nr_buffer_add(userdata->trace.buf, "]", 1);
-
-    nr_vector_remove(userdata->trace.current_path, 0,
-                     (void**)&current_trace_segment);
-  }
-
-  /*
-   * If the segment is sampled for the span output, then we need to remove it
-   * from the stack of parent IDs.
-   */
-  if (nr_segment_is_sampled(segment, userdata->spans.sample)) {
-    nr_stack_pop(&userdata->spans.parent_ids);
-  }
-}
-
 static void nr_segment_iteration_pass_trace(nr_segment_t* segment,
                                             nr_segment_userdata_t* userdata,
                                             const char* segment_name) {
   nr_segment_userdata_trace_t* tracedata = &(userdata->trace);
-  bool trace_is_sampled = (NULL != tracedata->sample);
-  bool segment_is_sampled = nr_set_contains(tracedata->sample, (void*)segment);
   nrpool_t* segment_names = userdata->segment_names;
   nrbuf_t* buf = userdata->trace.buf;
   int idx;
-  nr_segment_t* parent = NULL;
+  char idx_str[24];
   nrobj_t* user_attributes = NULL;
   nrobj_t* agent_attributes = NULL;
 
   uint64_t start_ms;
   uint64_t stop_ms;
 
-  if (trace_is_sampled && !segment_is_sampled) {
-    return;
-  }
-
-  /* Get nearest sampled ancestor segment. This will serve as parent. */
-  parent = (nr_segment_t*)nr_vector_get(tracedata->current_path, 0);
-
   /* Update the current ancestor path of segments added to the trace
    * output. */
-  nr_vector_push_front(tracedata->current_path, (void*)segment);
-
-  /* Examine the sampled_ancestors.  If the closest sampled ancestor of this
-   * segment appears in the set, this means the current segment has a previous
-   * sibling. and so the JSON needs a comma. */
-  if (nr_set_contains(tracedata->sampled_ancestors_with_child, parent)) {
-    nr_buffer_add(buf, ",", 1);
-  }
-
-  if (NULL != parent) {
-    nr_set_insert(tracedata->sampled_ancestors_with_child, (void*)parent);
-  }
+  nr_stack_push(&tracedata->current_path, (void*)segment);
 
   /* Get the name index.
    * The internal string tables index at 1, and we wish to index by 0 here. */
@@ -291,21 +177,18 @@ static void nr_segment_iteration_pass_trace(nr_segment_t* segment,
     stop_ms = start_ms;
   }
 
-  nr_buffer_add(buf, "[", 1);
-  nr_buffer_write_uint64_t_as_text(buf, start_ms);
-  nr_buffer_add(buf, ",", 1);
-  nr_buffer_write_uint64_t_as_text(buf, stop_ms);
-  nr_buffer_add(buf, ",", 1);
-  nr_buffer_add(buf, "\"", 1);
-  nr_buffer_add(buf, "`", 1);
-  nr_buffer_write_uint64_t_as_text(buf, (uint64_t)idx);
-  nr_buffer_add(buf, "\"", 1);
-  nr_buffer_add(buf, ",", 1);
+  /* The JSON writer adds the comma needed if this segment has a previous
+   * sibling. */
+  nr_json_write_begin_array(buf);
+  nr_json_write_uint(buf, start_ms);
+  nr_json_write_uint(buf, stop_ms);
+  snprintf(idx_str, sizeof(idx_str), "\"`%d\"", idx);
+  nr_json_write_raw(buf, idx_str);
 
   /*
    * Segment parameters.
    */
-  nr_buffer_add(buf, "{", 1);
+  nr_json_write_begin_object(buf);
 
   add_typed_attributes_to_buffer(buf, segment);
 
@@ -316,22 +199,21 @@ static void nr_segment_iteration_pass_trace(nr_segment_t* segment,
   if (segment->attributes) {
     user_attributes = nr_attributes_user_to_obj(
         segment->attributes, NR_ATTRIBUTE_DESTINATION_TXN_TRACE);
-    add_attribute_hash_to_buffer(buf, user_attributes);
+    nr_json_write_object_members(buf, user_attributes);
     nro_delete(user_attributes);
     /*
      *  Add segment attributes to transaction trace.
      */
     agent_attributes = nr_attributes_agent_to_obj(
         segment->attributes, NR_ATTRIBUTE_DESTINATION_TXN_TRACE);
-    add_attribute_hash_to_buffer(buf, agent_attributes);
+    nr_json_write_object_members(buf, agent_attributes);
     nro_delete(agent_attributes);
   }
 
-  nr_buffer_add(buf, "}", 1);
+  nr_json_write_end_object(buf);
 
   /* And now for all its children. */
-  nr_buffer_add(buf, ",", 1);
-  nr_buffer_add(buf, "[", 1);
+  nr_json_write_begin_array(buf);
 }
 
 static void nr_segment_iteration_pass_span(nr_segment_t* segment,
@@ -340,10 +222,6 @@ static void nr_segment_iteration_pass_span(nr_segment_t* segment,
   nr_segment_userdata_spans_t* spandata = &userdata->spans;
   nr_span_event_t* span;
 
-  if (!nr_segment_is_sampled(segment, spandata->sample)) {
-    return;
-  }
-
   span = nr_segment_to_span_event(segment);
   if (span) {
     nr_span_event_set_name(span, segment_name);
@@ -370,232 +248,253 @@ static void nr_segment_iteration_pass_span(nr_segment_t* segment,
   }
 
   // We have to add the GUID to the span path regardless of whether the span
-  // event conversion above succeeded or failed, since the post-callback will
+  // event conversion above succeeded or failed, since closing the span will
   // pop it from the stack.
   nr_stack_push(&spandata->parent_ids, (void*)segment->id);
 }
 
-nr_segment_iter_return_t nr_segment_traces_stot_iterator_callback(
-    nr_segment_t* segment,
-    void* data) {
-  nr_segment_userdata_t* userdata = (nr_segment_userdata_t*)data;
-  const nrtxn_t* txn = userdata->txn;
-  const char* segment_name;
+static const char* nr_segment_traces_get_name(const nrtxn_t* txn,
+                                              const nr_segment_t* segment) {
+  const char* segment_name = nr_string_get(txn->trace_strings, segment->name);
 
-  segment_name = nr_string_get(txn->trace_strings, segment->name);
   if (NULL == segment_name) {
     segment_name = "<unknown>";
   }
 
-  /*
-   * For VERY fast segments, the start time can equal the stop time.
-   * Such segments are skipped, as zero duration segments don't make
-   * sense.
-   */
-  if (segment->start_time == segment->stop_time) {
-    return NR_SEGMENT_NO_POST_ITERATION_CALLBACK;
-  }
-
-  /*
-   * Sanity check, the segment should have started before it stopped.
-   */
-  if (segment->start_time > segment->stop_time) {
-    nrl_warning(NRL_SEGMENT,
-                "Invalid segment '%s': start time (" NR_TIME_FMT
-                ") after stop time (" NR_TIME_FMT ")",
-                segment_name, segment->start_time, segment->stop_time);
-    userdata->success = false;
-    return NR_SEGMENT_NO_POST_ITERATION_CALLBACK;
-  }
+  return segment_name;
+}
 
-  /*
-   * Spans are only created if the span event output vector is given.
-   */
-  if (NULL != userdata->spans.events) {
-    nr_segment_iteration_pass_span(segment, userdata, segment_name);
-  }
+/*
+ * Purpose : Create the span event output vector for a transaction.
+ */
+static nr_vector_t* nr_segment_traces_create_span_events(const nrtxn_t* txn) {
+  size_t app_span_event_limit = (size_t)txn->app_limits.span_events;
+  size_t vector_size = (txn->segment_count > app_span_event_limit)
+                           ? app_span_event_limit
+                           : txn->segment_count;
 
-  /*
-   * Traces are only created if the trace output buffer is given.
-   */
-  if (NULL != userdata->trace.buf) {
-    nr_segment_iteration_pass_trace(segment, userdata, segment_name);
-  }
+  return nr_vector_create(vector_size, nr_vector_span_event_dtor, NULL);
+}
 
+/*
+ * Purpose : Add the start of the trace JSON, up to the children of the
+ *           ROOT node, to the buffer.
+ */
+static void nr_segment_traces_begin_json(nrbuf_t* buf, nrtime_t duration) {
   /*
-   * Register a post-callback to close brackets and to adapt parent stacks.
+   * Here we create a JSON string which will be eventually be compressed,
+   * encoded, and embedded into the final trace JSON structure for the
+   * New Relic backend.
    */
-  return ((nr_segment_iter_return_t){
-      .post_callback
-      = (nr_segment_post_iter_t)nr_segment_traces_stot_iterator_post_callback,
-      .userdata = userdata});
+  nr_buffer_add(buf, "[", 1);
+  nr_buffer_add(buf, "[", 1);
+  nr_buffer_add(buf, "0.0", 1); /* Unused timestamp. */
+  nr_buffer_add(buf, ",", 1);
+  nr_buffer_add(buf, "{}", 2); /* Unused:  Formerly request-parameters. */
+  nr_buffer_add(buf, ",", 1);
+  nr_buffer_add(buf, "{}", 2); /* Unused:  Formerly custom-parameters. */
+  nr_buffer_add(buf, ",", 1);
+  nr_buffer_add(buf, "[", 1);
+  nr_buffer_add(buf, "0", 1);
+  nr_buffer_add(buf, ",", 1);
+  nr_buffer_write_uint64_t_as_text(buf, duration / NR_TIME_DIVISOR_MS);
+  nr_buffer_add(buf, ",", 1);
+  nr_buffer_add(buf, "\"ROOT\"", 6);
+  nr_buffer_add(buf, ",", 1);
+  nr_buffer_add(buf, "{}", 2);
+  nr_buffer_add(buf, ",", 1);
+  nr_buffer_add(buf, "[", 1);
 }
 
-bool nr_segment_traces_json_print_segments(nrbuf_t* buf,
-                                           nr_vector_t* span_events,
-                                           nr_set_t* trace_set,
-                                           nr_set_t* span_set,
-                                           const nrtxn_t* txn,
-                                           nr_segment_t* root,
-                                           nrpool_t* segment_names) {
-  nr_segment_userdata_t* userdata;
-
-  if (NULL == buf && NULL == span_events) {
-    /* The trace output buffer and the span output vector are not given.
-     * In that case, there's no work to do.
-     */
-    return false;
+/*
+ * Purpose : Complete the trace JSON and place the results in the output
+ *           struct.
+ */
+static void nr_segment_traces_end_json(nrbuf_t* buf,
+                                       nr_vector_t* span_events,
+                                       nrpool_t* segment_names,
+                                       const nrobj_t* agent_attributes,
+                                       const nrobj_t* user_attributes,
+                                       const nrobj_t* intrinsics,
+                                       nrtxnfinal_t* out) {
+  nr_buffer_add(buf, "]", 1);
+  nr_buffer_add(buf, "]", 1);
+  nr_buffer_add(buf, ",", 1);
+  nr_json_write_begin_object(buf);
+  if (agent_attributes) {
+    nr_json_write_key(buf, "agentAttributes");
+    nr_json_write_object(buf, agent_attributes);
   }
+  if (user_attributes) {
+    nr_json_write_key(buf, "userAttributes");
+    nr_json_write_object(buf, user_attributes);
+  }
+  if (intrinsics) {
+    nr_json_write_key(buf, "intrinsics");
+    nr_json_write_object(buf, intrinsics);
+  }
+  nr_json_write_end_object(buf);
+  nr_buffer_add(buf, "]", 1);
+  nr_buffer_add(buf, ",", 1);
+  if (buf) {
+    char* js = nr_string_pool_to_json(segment_names);
 
-  if ((NULL == txn) || (NULL == segment_names) || (NULL == root)) {
-    return false;
+    nr_buffer_add(buf, js, nr_strlen(js));
+    nr_free(js);
+  }
+  nr_buffer_add(buf, "]", 1);
+  nr_buffer_add(buf, "\0", 1);
+  if (buf) {
+    out->trace_json = nr_strdup((const char*)nr_buffer_cptr(buf));
+  } else {
+    out->trace_json = NULL;
   }
+  out->span_events = span_events;
+}
 
-  /* Construct the userdata to be supplied to the callback */
-  userdata = &(nr_segment_userdata_t){
-         .txn = txn,
-         .segment_names = segment_names,
-         .success = true,
-         .trace = {
-           .buf = buf,
-           .sample = trace_set,
-           .current_path = nr_vector_create(12, NULL, NULL),
-           .sampled_ancestors_with_child = nr_set_create(),
-         },
-         .spans = {
-           .events = span_events,
-           .sample = span_set,
-         },
-  };
-  nr_stack_init(&userdata->spans.parent_ids, 12);
+/*
+ * Purpose : Close the trace nodes of segments that are not ancestors of the
+ *           next segment to be added to the trace.
+ *
+ * Params  : 1. The userdata for the trace.
+ *           2. The next segment, or NULL to close every open node.
+ */
+static void nr_segment_traces_close_trace_nodes(nr_segment_userdata_t* userdata,
+                                                const nr_segment_t* next) {
+  nr_segment_t* open;
 
-  nr_segment_iterate(
-      root, (nr_segment_iter_t)nr_segment_traces_stot_iterator_callback,
-      userdata);
+  while (NULL != (open = nr_stack_get_top(&userdata->trace.current_path))) {
+    if (next && next->tree_pos <= open->tree_end) {
+      return;
+    }
+
+    nr_json_write_end_array(userdata->trace.buf);
+    nr_json_write_end_array(userdata->trace.buf);
+    nr_stack_pop(&userdata->trace.current_path);
+  }
+}
 
-  nr_set_destroy(&(userdata->trace.sampled_ancestors_with_child));
-  nr_vector_destroy(&(userdata->trace.current_path));
-  nr_stack_destroy_fields(&userdata->spans.parent_ids);
+/*
+ * Purpose : Close the spans of segments that are not ancestors of the next
+ *           segment to be turned into a span event.
+ *
+ * Params  : 1. The userdata for the span events.
+ *           2. The stack of segments with open spans.
+ *           3. The next segment, or NULL to close every open span.
+ */
+static void nr_segment_traces_close_spans(nr_segment_userdata_t* userdata,
+                                          nr_stack_t* open_segments,
+                                          const nr_segment_t* next) {
+  const nr_segment_t* open;
+
+  while (NULL != (open = nr_stack_get_top(open_segments))) {
+    if (next && next->tree_pos <= open->tree_end) {
+      return;
+    }
 
-  return userdata->success;
+    nr_stack_pop(open_segments);
+    nr_stack_pop(&userdata->spans.parent_ids);
+  }
 }
 
-void nr_segment_traces_create_data(
+void nr_segment_traces_create_data_from_selection(
     const nrtxn_t* txn,
     nrtime_t duration,
-    nr_segment_tree_sampling_metadata_t* metadata,
+    nr_vector_t* trace_segments,
+    nr_vector_t* span_segments,
     const nrobj_t* agent_attributes,
     const nrobj_t* user_attributes,
     const nrobj_t* intrinsics,
-    bool create_trace,
-    bool create_spans) {
+    nrtxnfinal_t* out) {
   nrbuf_t* buf = NULL;
-  bool print_success;
   nr_vector_t* span_events = NULL;
   nrpool_t* segment_names;
+  nr_segment_userdata_t userdata;
+  nr_stack_t open_segments;
+  size_t num_segments;
+  size_t i;
 
   if ((NULL == txn) || (0 == txn->segment_count) || (0 == duration)
-      || NULL == metadata || NULL == metadata->out
-      || (NULL != metadata->trace_set
-          && NR_MAX_SEGMENTS < nr_set_size(metadata->trace_set))) {
+      || (NULL == out)
+      || (NULL == trace_segments && NULL == span_segments)
+      || (NR_MAX_SEGMENTS < nr_vector_size(trace_segments))) {
     return;
   }
 
-  if (create_trace) {
+  if (trace_segments) {
     buf = nr_buffer_create(4096 * 8, 4096 * 4);
   }
 
-  if (create_spans) {
-    size_t app_span_event_limit = (size_t)txn->app_limits.span_events;
-    size_t vector_size = (txn->segment_count > app_span_event_limit)
-                             ? app_span_event_limit
-                             : txn->segment_count;
-    span_events
-        = nr_vector_create(vector_size, nr_vector_span_event_dtor, NULL);
-  }
-
   segment_names = nr_string_pool_create();
 
+  userdata = (nr_segment_userdata_t){
+      .txn = txn,
+      .segment_names = segment_names,
+      .trace = {
+          .buf = buf,
+      },
+      .spans = {
+          .events = NULL,
+      },
+  };
+  nr_stack_init(&userdata.trace.current_path, 12);
+  nr_stack_init(&userdata.spans.parent_ids, 12);
+
   /*
-   * Here we create a JSON string which will be eventually be compressed,
-   * encoded, and embedded into the final trace JSON structure for the
-   * New Relic backend.
+   * The selected segments are in tree order, so the span events are created
+   * in the same order as a traversal of the tree would create them. The
+   * nearest selected ancestor of each segment is the topmost open segment
+   * whose subtree contains it.
    */
-  nr_buffer_add(buf, "[", 1);
-  nr_buffer_add(buf, "[", 1);
-  nr_buffer_add(buf, "0.0", 1); /* Unused timestamp. */
-  nr_buffer_add(buf, ",", 1);
-  nr_buffer_add(buf, "{}", 2); /* Unused:  Formerly request-parameters. */
-  nr_buffer_add(buf, ",", 1);
-  nr_buffer_add(buf, "{}", 2); /* Unused:  Formerly custom-parameters. */
-  nr_buffer_add(buf, ",", 1);
-  nr_buffer_add(buf, "[", 1);
-  nr_buffer_add(buf, "0", 1);
-  nr_buffer_add(buf, ",", 1);
-  nr_buffer_write_uint64_t_as_text(buf, duration / NR_TIME_DIVISOR_MS);
-  nr_buffer_add(buf, ",", 1);
-  nr_buffer_add(buf, "\"ROOT\"", 6);
-  nr_buffer_add(buf, ",", 1);
-  nr_buffer_add(buf, "{}", 2);
-  nr_buffer_add(buf, ",", 1);
-  nr_buffer_add(buf, "[", 1);
+  if (span_segments) {
+    span_events = nr_segment_traces_create_span_events(txn);
+    userdata.spans.events = span_events;
+    nr_stack_init(&open_segments, 12);
+
+    num_segments = nr_vector_size(span_segments);
+    for (i = 0; i < num_segments; i++) {
+      nr_segment_t* segment = nr_vector_get(span_segments, i);
+
+      /* Zero duration segments are skipped, as they don't make sense. */
+      if (segment->start_time == segment->stop_time) {
+        continue;
+      }
 
-  print_success = nr_segment_traces_json_print_segments(
-      buf, span_events, metadata->trace_set, metadata->span_set, txn,
-      txn->segment_root, segment_names);
+      nr_segment_traces_close_spans(&userdata, &open_segments, segment);
+      nr_segment_iteration_pass_span(
+          segment, &userdata, nr_segment_traces_get_name(txn, segment));
+      nr_stack_push(&open_segments, segment);
+    }
 
-  if (!print_success) {
-    nrl_warning(NRL_SEGMENT,
-                "Segment iteration failed; no trace or span events will be "
-                "generated for this transaction");
-    nr_string_pool_destroy(&segment_names);
-    nr_buffer_destroy(&buf);
-    return;
+    nr_stack_destroy_fields(&open_segments);
   }
 
-  nr_buffer_add(buf, "]", 1);
-  nr_buffer_add(buf, "]", 1);
-  nr_buffer_add(buf, ",", 1);
-  {
-    nrobj_t* hash = nro_new_hash();
+  nr_segment_traces_begin_json(buf, duration);
 
-    if (agent_attributes) {
-      nro_set_hash(hash, "agentAttributes", agent_attributes);
-    }
-    if (user_attributes) {
-      nro_set_hash(hash, "userAttributes", user_attributes);
-    }
-    if (intrinsics) {
-      nro_set_hash(hash, "intrinsics", intrinsics);
-    }
+  if (trace_segments) {
+    num_segments = nr_vector_size(trace_segments);
+    for (i = 0; i < num_segments; i++) {
+      nr_segment_t* segment = nr_vector_get(trace_segments, i);
 
-    nr_buffer_add(buf, "{", 1);
-    add_attribute_hash_to_buffer(buf, hash);
-    nr_buffer_add(buf, "}", 1);
+      if (segment->start_time == segment->stop_time) {
+        continue;
+      }
 
-    nro_delete(hash);
-  }
-  nr_buffer_add(buf, "]", 1);
-  nr_buffer_add(buf, ",", 1);
-  {
-    char* js = nr_string_pool_to_json(segment_names);
+      nr_segment_traces_close_trace_nodes(&userdata, segment);
+      nr_segment_iteration_pass_trace(
+          segment, &userdata, nr_segment_traces_get_name(txn, segment));
+    }
 
-    nr_buffer_add(buf, js, nr_strlen(js));
-    nr_free(js);
+    nr_segment_traces_close_trace_nodes(&userdata, NULL);
   }
-  nr_buffer_add(buf, "]", 1);
-  nr_buffer_add(buf, "\0", 1);
-  if (create_trace) {
-    metadata->out->trace_json = nr_strdup((const char*)nr_buffer_cptr(buf));
-  } else {
-    metadata->out->trace_json = NULL;
-  }
-  metadata->out->span_events = span_events;
 
+  nr_segment_traces_end_json(buf, span_events, segment_names, agent_attributes,
+                             user_attributes, intrinsics, out);
+
+  nr_stack_destroy_fields(&userdata.trace.current_path);
+  nr_stack_destroy_fields(&userdata.spans.parent_ids);
   nr_string_pool_destroy(&segment_names);
   nr_buffer_destroy(&buf);
-
-  return;
 }
 
 /*
@@ -5,6 +5,34 @@
 
 #include "nr_segment_traces.h"
 #include "nr_segment_tree.h"
+#include "nr_span_event.h"
+#include "util_logging.h"
+#include "util_memory.h"
+
+/*
+ * Purpose : Update the span events of released segments with the trace
+ *           fields of the transaction, which may have changed since they were
+ *           created, for example by accepting an inbound payload.
+ */
+static void nr_segment_tree_update_released_span_events(nrtxn_t* txn) {
+  char* trace_id = nr_txn_get_current_trace_id(txn);
+  const char* guid = nr_txn_get_guid(txn);
+  double priority = nr_distributed_trace_get_priority(txn->distributed_trace);
+  bool sampled = nr_distributed_trace_is_sampled(txn->distributed_trace);
+  size_t i;
+
+  for (i = 0; i < nr_vector_size(txn->released_span_events); i++) {
+    nr_span_event_t* event
+        = (nr_span_event_t*)nr_vector_get(txn->released_span_events, i);
+
+    nr_span_event_set_trace_id(event, trace_id);
+    nr_span_event_set_transaction_id(event, guid);
+    nr_span_event_set_priority(event, priority);
+    nr_span_event_set_sampled(event, sampled);
+  }
+
+  nr_free(trace_id);
+}
 
 nrtxnfinal_t nr_segment_tree_finalise(nrtxn_t* txn,
                                       const size_t trace_limit,
@@ -25,10 +53,15 @@ nrtxnfinal_t nr_segment_tree_finalise(nrtxn_t* txn,
   nr_segment_tree_to_heap_metadata_t first_pass_metadata = {
       .trace_heap = NULL,
       .span_heap = NULL,
+      .segments = NULL,
       .total_time = 0,
       .main_context = NULL,
+      .next_pos = 0,
+      .invalid_segment = NULL,
   };
   nrtime_t duration;
+  size_t released_spans;
+  size_t remaining_span_limit = span_limit;
 
   if (NULL == txn || NULL == txn->segment_root) {
     return result;
@@ -36,23 +69,45 @@ nrtxnfinal_t nr_segment_tree_finalise(nrtxn_t* txn,
 
   duration = nr_txn_duration(txn);
 
+  /*
+   * Span events that were created for released segments count towards the
+   * limit. The root segment always gets a span event.
+   */
+  released_spans = nr_vector_size(txn->released_span_events);
+  if (released_spans && remaining_span_limit) {
+    remaining_span_limit = (remaining_span_limit > released_spans)
+                               ? remaining_span_limit - released_spans
+                               : 1;
+  }
+
   should_save_trace
       = (trace_limit > 0) && nr_txn_should_save_trace(txn, duration);
   should_sample_trace = txn->segment_count > trace_limit;
 
-  should_save_spans = (span_limit > 0) && nr_txn_should_create_span_events(txn)
+  should_save_spans = (remaining_span_limit > 0)
+                      && nr_txn_should_create_span_events(txn)
                       && NULL == txn->span_queue;
-  should_sample_spans = txn->segment_count > span_limit;
+  should_sample_spans = txn->segment_count > remaining_span_limit;
 
   if (should_save_spans && should_sample_spans) {
     first_pass_metadata.span_heap = nr_segment_heap_create(
-        span_limit, nr_segment_wrapped_span_priority_comparator);
+        remaining_span_limit, nr_segment_wrapped_span_priority_comparator);
   }
   if (should_save_trace && should_sample_trace) {
     first_pass_metadata.trace_heap = nr_segment_heap_create(
         trace_limit, nr_segment_wrapped_duration_comparator);
   }
 
+  /*
+   * If the trace or the span events will include every segment, then the
+   * first pass collects the segments in tree order.
+   */
+  if ((should_save_trace && !should_sample_trace)
+      || (should_save_spans && !should_sample_spans)) {
+    first_pass_metadata.segments
+        = nr_vector_create(txn->segment_count, NULL, NULL);
+  }
+
   /*
    * We'll use an exclusive time structure to calculate how long the main
    * context was blocked, if that was requested for this transaction.
@@ -63,7 +118,7 @@ nrtxnfinal_t nr_segment_tree_finalise(nrtxn_t* txn,
   }
 
   /*
-   * Do the first pass over the tree: we need to generate the heaps tracking the
+   * Do the only pass over the tree: we need to generate the heaps tracking the
    * segments that will be used in any transaction trace or span event
    * reservoir and calculate the total time for the transaction.
    */
@@ -72,7 +127,8 @@ nrtxnfinal_t nr_segment_tree_finalise(nrtxn_t* txn,
   /*
    * We always need to set the total time.
    */
-  result.total_time = first_pass_metadata.total_time;
+  result.total_time
+      = first_pass_metadata.total_time + txn->released_total_time;
 
   /*
    * If the discount main context blocking option was set, then we need to
@@ -104,29 +160,39 @@ nrtxnfinal_t nr_segment_tree_finalise(nrtxn_t* txn,
   }
 
   /*
-   * Now we do a second pass if needed. If we don't need to generate a trace or
-   * span events, then there's no need.
+   * Now we generate the trace and span events if needed. Rather than iterating
+   * over the tree again, only the selected segments are visited, in tree
+   * order.
    */
   if (should_save_trace || should_save_spans) {
     nrobj_t* agent_attributes;
     nrobj_t* user_attributes;
-    nr_segment_tree_sampling_metadata_t metadata = {
-        .trace_set = NULL,
-        .span_set = NULL,
-        .out = &result,
-    };
-
-    if (should_sample_trace) {
-      /* Prepare for the second pass of the tree; convert the heap to a set. */
-      metadata.trace_set = nr_set_create();
-      nr_segment_heap_to_set(first_pass_metadata.trace_heap,
-                             metadata.trace_set);
+    nr_vector_t* trace_segments = NULL;
+    nr_vector_t* span_segments = NULL;
+    nr_vector_t* sampled_trace_segments = NULL;
+    nr_vector_t* sampled_span_segments = NULL;
+
+    if (should_save_trace) {
+      if (should_sample_trace) {
+        sampled_trace_segments = nr_vector_create(trace_limit, NULL, NULL);
+        nr_segment_heap_to_vector(first_pass_metadata.trace_heap,
+                                  sampled_trace_segments);
+        trace_segments = sampled_trace_segments;
+      } else {
+        trace_segments = first_pass_metadata.segments;
+      }
     }
 
-    if (should_sample_spans) {
-      /* Prepare for the second pass of the tree; convert the heap to a set. */
-      metadata.span_set = nr_set_create();
-      nr_segment_heap_to_set(first_pass_metadata.span_heap, metadata.span_set);
+    if (should_save_spans) {
+      if (should_sample_spans) {
+        sampled_span_segments
+            = nr_vector_create(remaining_span_limit, NULL, NULL);
+        nr_segment_heap_to_vector(first_pass_metadata.span_heap,
+                                  sampled_span_segments);
+        span_segments = sampled_span_segments;
+      } else {
+        span_segments = first_pass_metadata.segments;
+      }
     }
 
     agent_attributes = nr_attributes_agent_to_obj(
@@ -134,45 +200,50 @@ nrtxnfinal_t nr_segment_tree_finalise(nrtxn_t* txn,
     user_attributes = nr_attributes_user_to_obj(
         txn->attributes, NR_ATTRIBUTE_DESTINATION_TXN_TRACE);
 
-    nr_segment_traces_create_data(txn, duration, &metadata, agent_attributes,
-                                  user_attributes, txn->intrinsics,
-                                  should_save_trace, should_save_spans);
-    result.trace_json = metadata.out->trace_json;
-    result.span_events = metadata.out->span_events;
+    /*
+     * A segment that stopped before it started invalidates the whole tree.
+     */
+    if (first_pass_metadata.invalid_segment) {
+      const nr_segment_t* invalid = first_pass_metadata.invalid_segment;
+      const char* name = nr_string_get(txn->trace_strings, invalid->name);
+
+      nrl_warning(NRL_SEGMENT,
+                  "Invalid segment '%s': start time (" NR_TIME_FMT
+                  ") after stop time (" NR_TIME_FMT ")",
+                  name ? name : "<unknown>", invalid->start_time,
+                  invalid->stop_time);
+      nrl_warning(NRL_SEGMENT,
+                  "Segment iteration failed; no trace or span events will be "
+                  "generated for this transaction");
+    } else {
+      nr_segment_traces_create_data_from_selection(
+          txn, duration, trace_segments, span_segments, agent_attributes,
+          user_attributes, txn->intrinsics, &result);
+    }
+
+    /*
+     * The span events of released segments are only sent along with the
+     * span events of the rest of the tree.
+     */
+    if (result.span_events) {
+      void* event;
+
+      nr_segment_tree_update_released_span_events(txn);
+      while (nr_vector_pop_back(txn->released_span_events, &event)) {
+        nr_vector_push_back(result.span_events, event);
+      }
+    }
 
     nro_delete(agent_attributes);
     nro_delete(user_attributes);
 
-    nr_set_destroy(&metadata.trace_set);
-    nr_set_destroy(&metadata.span_set);
-    nr_minmax_heap_destroy(&first_pass_metadata.trace_heap);
-    nr_minmax_heap_destroy(&first_pass_metadata.span_heap);
+    nr_vector_destroy(&sampled_trace_segments);
+    nr_vector_destroy(&sampled_span_segments);
   }
 
-  return result;
-}
-
-nr_segment_t* nr_segment_tree_get_nearest_sampled_ancestor(
-    nr_set_t* sampled_set,
-    const nr_segment_t* segment) {
-  if (NULL == segment || NULL == sampled_set || NULL == segment->txn) {
-    return NULL;
-  } else {
-    nr_segment_t* root = segment->txn->segment_root;
-    nr_segment_t* current = segment->parent;
-
-    while (NULL != current) {
-      if (nr_set_contains(sampled_set, current)) {
-        return current;
-      }
-      // If a cycle was created in the tree it will be lost unless root is given
-      // a parent. This clause will prevent infinite looping.
-      if (current == root) {
-        return NULL;
-      }
-      current = current->parent;
-    }
-  }
+  nr_vector_destroy(&first_pass_metadata.segments);
+  nr_minmax_heap_destroy(&first_pass_metadata.trace_heap);
+  nr_minmax_heap_destroy(&first_pass_metadata.span_heap);
 
-  return NULL;
+  return result;
 }
@@ -14,19 +14,6 @@
 #include "nr_segment_traces.h"
 #include "nr_txn.h"
 
-#include "util_set.h"
-
-/*
- * To assemble the transaction trace and the array of span events, the axiom
- * library must iterate over the tree of segments. This struct contains the
- * input metadata and result storage for that operation.
- */
-typedef struct {
-  nr_set_t* trace_set;
-  nr_set_t* span_set;
-  nrtxnfinal_t* out;
-} nr_segment_tree_sampling_metadata_t;
-
 /*
  * Purpose : Traverse all the segments in the tree.  If a transaction trace is
  *           merited, assemble the transaction trace JSON for the highest
@@ -51,20 +38,4 @@ extern nrtxnfinal_t nr_segment_tree_finalise(
     void (*total_time_cb)(nrtxn_t* txn, nrtime_t total_time, void* userdata),
     void* callback_userdata);
 
-/*
- * Purpose : Return a pointer to the closest sampled ancestor of the
- *           provided segment.
- *
- * Params  : 1. The set of sampled segment.
- *           2. The starting place, the segment who's ancestors we want to
- *              learn about.
- *
- * Return  : The nearest ancestor of the passed in segment or NULL if none
- *           found.  The ancestor must be sampled, meaning that it is
- *           contained in the provided set.
- */
-extern nr_segment_t* nr_segment_tree_get_nearest_sampled_ancestor(
-    nr_set_t* sampled_set,
-    const nr_segment_t* segment);
-
 #endif
@@ -12,6 +12,7 @@
 #include "util_logging.h"
 #include "util_object.h"
 #include "util_sql.h"
+#include "util_sql_cache.h"
 #include "util_strings.h"
 #include "util_system.h"
 #include "util_time.h"
@@ -36,17 +37,7 @@ struct _nr_slowsqls_t {
 };
 
 static uint32_t nr_sql_id(const char* sql) {
-  uint32_t sql_id;
-  char* obfuscated;
-
-  obfuscated = nr_sql_obfuscate(sql);
-  if (0 == obfuscated) {
-    return 0;
-  }
-  sql_id = nr_sql_normalized_id(obfuscated);
-  nr_free(obfuscated);
-
-  return sql_id;
+  return nr_sql_cache_normalized_id(sql, NULL);
 }
 
 uint32_t nr_slowsql_id(const nr_slowsql_t* slow) {
@@ -156,67 +156,127 @@ bool nr_span_encoding_encode_attribute_value_v1(
   return true;
 }
 
+static void nr_span_encoding_encode_field_value_v1(
+    const nr_span_event_field_t* field,
+    Com__Newrelic__Trace__V1__AttributeValue* value) {
+  com__newrelic__trace__v1__attribute_value__init(value);
+
+  switch (field->type) {
+    case NR_SPAN_EVENT_FIELD_STRING:
+      value->value_case
+          = COM__NEWRELIC__TRACE__V1__ATTRIBUTE_VALUE__VALUE_STRING_VALUE;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+      value->string_value = (char*)field->u.sval;
+#pragma GCC diagnostic pop
+      break;
+
+    case NR_SPAN_EVENT_FIELD_BOOLEAN:
+      value->value_case
+          = COM__NEWRELIC__TRACE__V1__ATTRIBUTE_VALUE__VALUE_BOOL_VALUE;
+      value->bool_value = field->u.bval;
+      break;
+
+    case NR_SPAN_EVENT_FIELD_DOUBLE:
+      value->value_case
+          = COM__NEWRELIC__TRACE__V1__ATTRIBUTE_VALUE__VALUE_DOUBLE_VALUE;
+      value->double_value = field->u.dval;
+      break;
+
+    case NR_SPAN_EVENT_FIELD_ULONG:
+      value->value_case
+          = COM__NEWRELIC__TRACE__V1__ATTRIBUTE_VALUE__VALUE_INT_VALUE;
+      value->int_value = (int64_t)field->u.ulval;
+      break;
+  }
+}
+
 // This next bit is hideous, but it gets us type safety across the disjoint
 // entry types.
 //
 // To recap: the protoc-c compiler has kindly generated us three *Entry types to
 // represent attribute maps. These types are all identical. However, because C
 // doesn't support structural typing, we can't just write one implementation of
-// a function to encode an nrobj_t hash to an array of entries.
+// a function to encode the typed span event fields and an nrobj_t hash to an
+// array of entries.
 //
 // (Well, we _can_, but that involves a bunch of scary assumptions that can
 // never change about the generated code and a lot of void * pointers, and I'm
 // trying to kick my void * habit.)
 //
 // So we'll define this GENERATE_SERIALISE_FUNC() macro that templates our
-// functions to take an nrobj_t and fill in an Entry array for use in later
-// encoding endeavours. If you use Fira Code, you get to see the *** ligature
-// because there is an honest-to-God triple pointer in here. (Technically, it's
-// an output parameter for a double pointer array, but I'm not sure that makes
-// it better.)
+// functions to take an array of typed fields and an optional nrobj_t hash of
+// further attributes, and fill in an Entry array for use in later encoding
+// endeavours. Hash members with the same key as a typed field are skipped, as
+// the typed field takes precedence. If you use Fira Code, you get to see the
+// *** ligature because there is an honest-to-God triple pointer in here.
+// (Technically, it's an output parameter for a double pointer array, but I'm
+// not sure that makes it better.)
 
 // Where we're going, we don't need cast qualifier warnings.
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-qual"
 #define GENERATE_SERIALISE_FUNC(NAME, TYPE, INIT_FUNC)                       \
-  static bool NAME(const nrobj_t* obj, TYPE*** out_ptr, size_t* out_len,     \
+  static bool NAME(const nr_span_event_field_t* fields, size_t n_fields,     \
+                   const nrobj_t* obj, TYPE*** out_ptr, size_t* out_len,     \
                    nr_span_encoding_context_t* ctx) {                        \
-    int len = nro_getsize(obj);                                              \
+    int obj_len = obj ? nro_getsize(obj) : 0;                                \
+    size_t len = n_fields + (obj_len > 0 ? (size_t)obj_len : 0);             \
+    size_t n = 0;                                                            \
+    size_t i;                                                                \
                                                                              \
-    *out_len = (size_t)len;                                                  \
+    *out_len = 0;                                                            \
                                                                              \
-    if (len > 0) {                                                           \
-      int i;                                                                 \
+    if (0 == len) {                                                          \
+      *out_ptr = NULL;                                                       \
+      return true;                                                           \
+    }                                                                        \
                                                                              \
-      *out_ptr = nr_calloc(len, sizeof(TYPE*));                              \
-      nr_vector_push_back(&ctx->proto_arrays, *out_ptr);                     \
+    *out_ptr = nr_calloc(len, sizeof(TYPE*));                                \
+    nr_vector_push_back(&ctx->proto_arrays, *out_ptr);                       \
                                                                              \
-      for (i = 0; i < len; i++) {                                            \
-        Com__Newrelic__Trace__V1__AttributeValue* av                         \
-            = nr_slab_next(ctx->attribute_value_slab);                       \
-        TYPE* entry = nr_slab_next(ctx->entry_slab);                         \
-        const char* key = NULL;                                              \
-        const nrobj_t* value;                                                \
+    for (i = 0; i < n_fields; i++) {                                         \
+      Com__Newrelic__Trace__V1__AttributeValue* av                           \
+          = nr_slab_next(ctx->attribute_value_slab);                         \
+      TYPE* entry = nr_slab_next(ctx->entry_slab);                           \
                                                                              \
-        /* Hashes use 1-based indexing, like arrays. */                      \
-        value = nro_get_hash_value_by_index(obj, i + 1, NULL, &key);         \
-        if (NULL == value) {                                                 \
-          /* Yikes. We really shouldn't get here. Something is spectacularly \
-           * wrong, so let's just bail out. */                               \
-          return false;                                                      \
-        }                                                                    \
+      nr_span_encoding_encode_field_value_v1(&fields[i], av);                \
                                                                              \
-        nr_span_encoding_encode_attribute_value_v1(value, av);               \
+      INIT_FUNC(entry);                                                      \
+      entry->key = (char*)fields[i].key;                                     \
+      entry->value = av;                                                     \
+      (*out_ptr)[n++] = entry;                                               \
+    }                                                                        \
+                                                                             \
+    for (i = 0; i < (size_t)obj_len; i++) {                                  \
+      Com__Newrelic__Trace__V1__AttributeValue* av;                          \
+      TYPE* entry;                                                           \
+      const char* key = NULL;                                                \
+      const nrobj_t* value;                                                  \
                                                                              \
-        INIT_FUNC(entry);                                                    \
-        entry->key = (char*)key;                                             \
-        entry->value = av;                                                   \
-        (*out_ptr)[i] = entry;                                               \
+      /* Hashes use 1-based indexing, like arrays. */                        \
+      value = nro_get_hash_value_by_index(obj, (int)i + 1, NULL, &key);      \
+      if (NULL == value) {                                                   \
+        /* Yikes. We really shouldn't get here. Something is spectacularly   \
+         * wrong, so let's just bail out. */                                 \
+        return false;                                                        \
       }                                                                      \
-    } else {                                                                 \
-      *out_ptr = NULL;                                                       \
+                                                                             \
+      if (nr_span_event_fields_have_key(fields, n_fields, key)) {            \
+        continue;                                                            \
+      }                                                                      \
+                                                                             \
+      av = nr_slab_next(ctx->attribute_value_slab);                          \
+      entry = nr_slab_next(ctx->entry_slab);                                 \
+      nr_span_encoding_encode_attribute_value_v1(value, av);                 \
+                                                                             \
+      INIT_FUNC(entry);                                                      \
+      entry->key = (char*)key;                                               \
+      entry->value = av;                                                     \
+      (*out_ptr)[n++] = entry;                                               \
     }                                                                        \
                                                                              \
+    *out_len = n;                                                            \
     return true;                                                             \
   }
 
@@ -241,6 +301,11 @@ GENERATE_SERIALISE_FUNC(
 bool nr_span_encoding_encode_span_v1(const nr_span_event_t* event,
                                      Com__Newrelic__Trace__V1__Span* span,
                                      nr_span_encoding_context_t* ctx) {
+  nr_span_event_field_t intrinsics[NR_SPAN_EVENT_INTRINSICS_MAX];
+  nr_span_event_field_t agent[NR_SPAN_EVENT_AGENT_FIELDS_MAX];
+  size_t n_intrinsics;
+  size_t n_agent;
+
   if (nrunlikely(NULL == event || NULL == span || NULL == ctx)) {
     return false;
   }
@@ -248,15 +313,18 @@ bool nr_span_encoding_encode_span_v1(const nr_span_event_t* event,
   com__newrelic__trace__v1__span__init(span);
   span->trace_id = event->trace_id;
 
+  n_intrinsics = nr_span_event_intrinsics(event, intrinsics);
   if (!nr_span_encoding_intrinsics_to_infinite_v1(
-          event->intrinsics, &span->intrinsics, &span->n_intrinsics, ctx)) {
+          intrinsics, n_intrinsics, NULL, &span->intrinsics,
+          &span->n_intrinsics, ctx)) {
     nrl_warning(NRL_AGENT,
                 "error encoding span event intrinsics; dropping span event");
     return false;
   }
 
+  n_agent = nr_span_event_agent_fields(event, agent);
   if (!nr_span_encoding_agent_attributes_to_infinite_v1(
-          event->agent_attributes, &span->agent_attributes,
+          agent, n_agent, event->agent_attributes, &span->agent_attributes,
           &span->n_agent_attributes, ctx)) {
     nrl_warning(
         NRL_AGENT,
@@ -265,7 +333,7 @@ bool nr_span_encoding_encode_span_v1(const nr_span_event_t* event,
   }
 
   if (!nr_span_encoding_user_attributes_to_infinite_v1(
-          event->user_attributes, &span->user_attributes,
+          NULL, 0, event->user_attributes, &span->user_attributes,
           &span->n_user_attributes, ctx)) {
     nrl_warning(
         NRL_AGENT,
@@ -7,21 +7,18 @@
 
 #include "nr_span_event.h"
 #include "nr_span_event_private.h"
+#include "util_json_writer.h"
 #include "util_memory.h"
+#include "util_strings.h"
 #include "util_time.h"
 
 nr_span_event_t* nr_span_event_create() {
   nr_span_event_t* se;
 
-  se = (nr_span_event_t*)nr_malloc(sizeof(nr_span_event_t));
+  se = (nr_span_event_t*)nr_zalloc(sizeof(nr_span_event_t));
 
-  se->trace_id = NULL;
-  se->intrinsics = nro_new_hash();
-  se->agent_attributes = nro_new_hash();
-  se->user_attributes = nro_new_hash();
-
-  nro_set_hash_string(se->intrinsics, "category", "generic");
-  nro_set_hash_string(se->intrinsics, "type", "Span");
+  se->category = NR_SPAN_GENERIC;
+  se->spankind = NR_SPANKIND_NO_SPANKIND;
 
   return se;
 }
@@ -35,13 +32,249 @@ void nr_span_event_destroy(nr_span_event_t** ptr) {
 
   event = *ptr;
   nr_free(event->trace_id);
-  nro_delete(event->intrinsics);
+  nr_free(event->guid);
+  nr_free(event->parent_id);
+  nr_free(event->transaction_id);
+  nr_free(event->name);
+  nr_free(event->transaction_name);
+  nr_free(event->tracing_vendors);
+  nr_free(event->trusted_parent_id);
+  nr_free(event->component);
+  nr_free(event->parent_type);
+  nr_free(event->parent_app);
+  nr_free(event->parent_account);
+  nr_free(event->parent_transport_type);
+  nr_free(event->error_message);
+  nr_free(event->error_class);
+  nr_free(event->db_system);
+  nr_free(event->db_statement);
+  nr_free(event->db_instance);
+  nr_free(event->peer_address);
+  nr_free(event->peer_hostname);
+  nr_free(event->http_url);
+  nr_free(event->http_method);
+  nr_free(event->message_destination_name);
+  nr_free(event->messaging_system);
+  nr_free(event->server_address);
+  nr_free(event->messaging_destination_routing_key);
+  nr_free(event->messaging_destination_publish_name);
   nro_delete(event->agent_attributes);
   nro_delete(event->user_attributes);
 
   nr_realfree((void**)ptr);
 }
 
+static const char* nr_span_event_category_name(nr_span_category_t category) {
+  switch (category) {
+    case NR_SPAN_DATASTORE:
+      return "datastore";
+    case NR_SPAN_HTTP:
+      return "http";
+    case NR_SPAN_MESSAGE:
+      return "message";
+    case NR_SPAN_GENERIC:
+    default:
+      return "generic";
+  }
+}
+
+static const char* nr_span_event_spankind_name(nr_span_spankind_t spankind) {
+  switch (spankind) {
+    case NR_SPANKIND_PRODUCER:
+      return "producer";
+    case NR_SPANKIND_CLIENT:
+      return "client";
+    case NR_SPANKIND_CONSUMER:
+      return "consumer";
+    case NR_SPANKIND_NO_SPANKIND:
+    default:
+      return NULL;
+  }
+}
+
+/*
+ * Helpers to append a field to an array of fields if it is set. Each returns
+ * the new number of fields.
+ */
+static inline size_t nr_span_event_add_string_field(
+    nr_span_event_field_t* fields,
+    size_t n,
+    const char* key,
+    const char* value) {
+  if (NULL == value) {
+    return n;
+  }
+
+  fields[n].key = key;
+  fields[n].type = NR_SPAN_EVENT_FIELD_STRING;
+  fields[n].u.sval = value;
+  return n + 1;
+}
+
+static inline size_t nr_span_event_add_bool_field(nr_span_event_field_t* fields,
+                                                  size_t n,
+                                                  bool present,
+                                                  const char* key,
+                                                  bool value) {
+  if (!present) {
+    return n;
+  }
+
+  fields[n].key = key;
+  fields[n].type = NR_SPAN_EVENT_FIELD_BOOLEAN;
+  fields[n].u.bval = value;
+  return n + 1;
+}
+
+static inline size_t nr_span_event_add_double_field(
+    nr_span_event_field_t* fields,
+    size_t n,
+    bool present,
+    const char* key,
+    double value) {
+  if (!present) {
+    return n;
+  }
+
+  fields[n].key = key;
+  fields[n].type = NR_SPAN_EVENT_FIELD_DOUBLE;
+  fields[n].u.dval = value;
+  return n + 1;
+}
+
+static inline size_t nr_span_event_add_ulong_field(
+    nr_span_event_field_t* fields,
+    size_t n,
+    bool present,
+    const char* key,
+    uint64_t value) {
+  if (!present) {
+    return n;
+  }
+
+  fields[n].key = key;
+  fields[n].type = NR_SPAN_EVENT_FIELD_ULONG;
+  fields[n].u.ulval = value;
+  return n + 1;
+}
+
+size_t nr_span_event_intrinsics(const nr_span_event_t* event,
+                                nr_span_event_field_t* fields) {
+  size_t n = 0;
+
+  if (NULL == event || NULL == fields) {
+    return 0;
+  }
+
+  n = nr_span_event_add_string_field(
+      fields, n, "category", nr_span_event_category_name(event->category));
+  n = nr_span_event_add_string_field(fields, n, "type", "Span");
+  n = nr_span_event_add_string_field(fields, n, "guid", event->guid);
+  n = nr_span_event_add_string_field(fields, n, "traceId", event->trace_id);
+  n = nr_span_event_add_string_field(fields, n, "transactionId",
+                                     event->transaction_id);
+  n = nr_span_event_add_string_field(fields, n, "name", event->name);
+  n = nr_span_event_add_ulong_field(
+      fields, n, event->flags & NR_SPAN_EVENT_HAS_TIMESTAMP, "timestamp",
+      event->timestamp);
+  n = nr_span_event_add_double_field(
+      fields, n, event->flags & NR_SPAN_EVENT_HAS_DURATION, "duration",
+      event->duration);
+  n = nr_span_event_add_double_field(
+      fields, n, event->flags & NR_SPAN_EVENT_HAS_PRIORITY, "priority",
+      event->priority);
+  n = nr_span_event_add_bool_field(fields, n,
+                                   event->flags & NR_SPAN_EVENT_HAS_SAMPLED,
+                                   "sampled", event->sampled);
+  n = nr_span_event_add_bool_field(fields, n,
+                                   event->flags & NR_SPAN_EVENT_HAS_ENTRY_POINT,
+                                   "nr.entryPoint", true);
+  n = nr_span_event_add_string_field(fields, n, "tracingVendors",
+                                     event->tracing_vendors);
+  n = nr_span_event_add_string_field(fields, n, "trustedParentId",
+                                     event->trusted_parent_id);
+  n = nr_span_event_add_string_field(fields, n, "parentId", event->parent_id);
+  n = nr_span_event_add_string_field(fields, n, "transaction.name",
+                                     event->transaction_name);
+  n = nr_span_event_add_string_field(
+      fields, n, "span.kind", nr_span_event_spankind_name(event->spankind));
+  n = nr_span_event_add_string_field(fields, n, "component", event->component);
+
+  return n;
+}
+
+size_t nr_span_event_agent_fields(const nr_span_event_t* event,
+                                  nr_span_event_field_t* fields) {
+  size_t n = 0;
+
+  if (NULL == event || NULL == fields) {
+    return 0;
+  }
+
+  n = nr_span_event_add_string_field(fields, n, "parent.type",
+                                     event->parent_type);
+  n = nr_span_event_add_string_field(fields, n, "parent.app",
+                                     event->parent_app);
+  n = nr_span_event_add_string_field(fields, n, "parent.account",
+                                     event->parent_account);
+  n = nr_span_event_add_string_field(fields, n, "parent.transportType",
+                                     event->parent_transport_type);
+  n = nr_span_event_add_double_field(
+      fields, n, event->flags & NR_SPAN_EVENT_HAS_PARENT_TRANSPORT_DURATION,
+      "parent.transportDuration", event->parent_transport_duration);
+  n = nr_span_event_add_string_field(fields, n, "error.message",
+                                     event->error_message);
+  n = nr_span_event_add_string_field(fields, n, "error.class",
+                                     event->error_class);
+  n = nr_span_event_add_string_field(fields, n, "db.system", event->db_system);
+  n = nr_span_event_add_string_field(fields, n, "peer.hostname",
+                                     event->peer_hostname);
+  n = nr_span_event_add_string_field(fields, n, "peer.address",
+                                     event->peer_address);
+  n = nr_span_event_add_string_field(fields, n, "db.instance",
+                                     event->db_instance);
+  n = nr_span_event_add_string_field(fields, n, "db.statement",
+                                     event->db_statement);
+  n = nr_span_event_add_string_field(fields, n, "http.method",
+                                     event->http_method);
+  n = nr_span_event_add_string_field(fields, n, "http.url", event->http_url);
+  n = nr_span_event_add_ulong_field(
+      fields, n, event->flags & NR_SPAN_EVENT_HAS_HTTP_STATUS,
+      "http.statusCode", event->http_status);
+  n = nr_span_event_add_string_field(fields, n,
+                                     NR_ATTR_MESSAGING_DESTINATION_NAME,
+                                     event->message_destination_name);
+  n = nr_span_event_add_string_field(fields, n, NR_ATTR_MESSAGING_SYSTEM,
+                                     event->messaging_system);
+  n = nr_span_event_add_string_field(fields, n, NR_ATTR_SERVER_ADDRESS,
+                                     event->server_address);
+  n = nr_span_event_add_string_field(fields, n,
+                                     NR_ATTR_MESSAGING_DESTINATION_ROUTING_KEY,
+                                     event->messaging_destination_routing_key);
+  n = nr_span_event_add_string_field(
+      fields, n, NR_ATTR_MESSAGING_DESTINATION_PUBLISH_NAME,
+      event->messaging_destination_publish_name);
+  n = nr_span_event_add_ulong_field(
+      fields, n, event->flags & NR_SPAN_EVENT_HAS_SERVER_PORT,
+      NR_ATTR_SERVER_PORT, event->server_port);
+
+  return n;
+}
+
+bool nr_span_event_fields_have_key(const nr_span_event_field_t* fields,
+                                   size_t count,
+                                   const char* key) {
+  size_t i;
+
+  for (i = 0; i < count; i++) {
+    if (0 == nr_strcmp(fields[i].key, key)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 char* nr_span_event_to_json(const nr_span_event_t* event) {
   nrbuf_t* buf = nr_buffer_create(0, 0);
   char* json = NULL;
@@ -58,31 +291,95 @@ end:
   return json;
 }
 
+static void nr_span_event_fields_to_json_buffer(
+    const nr_span_event_field_t* fields,
+    size_t count,
+    nrbuf_t* buf) {
+  size_t i;
+
+  for (i = 0; i < count; i++) {
+    nr_json_write_key(buf, fields[i].key);
+
+    switch (fields[i].type) {
+      case NR_SPAN_EVENT_FIELD_STRING:
+        nr_json_write_string(buf, fields[i].u.sval);
+        break;
+      case NR_SPAN_EVENT_FIELD_BOOLEAN:
+        nr_json_write_bool(buf, fields[i].u.bval);
+        break;
+      case NR_SPAN_EVENT_FIELD_DOUBLE:
+        nr_json_write_double(buf, fields[i].u.dval);
+        break;
+      case NR_SPAN_EVENT_FIELD_ULONG:
+        nr_json_write_uint(buf, fields[i].u.ulval);
+        break;
+    }
+  }
+}
+
+typedef struct _nr_span_event_json_extras_t {
+  nrbuf_t* buf;
+  const nr_span_event_field_t* fields;
+  size_t count;
+} nr_span_event_json_extras_t;
+
+static nr_status_t nr_span_event_extra_to_json_buffer(const char* key,
+                                                      const nrobj_t* val,
+                                                      void* ptr) {
+  nr_span_event_json_extras_t* extras = (nr_span_event_json_extras_t*)ptr;
+
+  if (!nr_span_event_fields_have_key(extras->fields, extras->count, key)) {
+    nr_json_write_key(extras->buf, key);
+    nro_to_json_buffer(val, extras->buf);
+  }
+
+  return NR_SUCCESS;
+}
+
 bool nr_span_event_to_json_buffer(const nr_span_event_t* event, nrbuf_t* buf) {
+  nr_span_event_field_t intrinsics[NR_SPAN_EVENT_INTRINSICS_MAX];
+  nr_span_event_field_t agent[NR_SPAN_EVENT_AGENT_FIELDS_MAX];
+  nr_span_event_json_extras_t extras;
+  size_t count;
+
   if (NULL == event || NULL == buf) {
     return false;
   }
 
-  // We'll build the JSON manually to avoid copying the hashes into a new
-  // nrobj_t array, which is expensive and pointless given it's a fixed length
-  // array.
-  nr_buffer_add(buf, NR_PSTR("["));
-  nro_to_json_buffer(event->intrinsics, buf);
-  nr_buffer_add(buf, NR_PSTR(","));
-  nro_to_json_buffer(event->user_attributes, buf);
-  nr_buffer_add(buf, NR_PSTR(","));
-  nro_to_json_buffer(event->agent_attributes, buf);
-  nr_buffer_add(buf, NR_PSTR("]"));
+  // We'll build the JSON manually from the typed fields, which avoids
+  // building generic objects just to serialise them.
+  nr_buffer_add(buf, NR_PSTR("[{"));
+  count = nr_span_event_intrinsics(event, intrinsics);
+  nr_span_event_fields_to_json_buffer(intrinsics, count, buf);
+  nr_buffer_add(buf, NR_PSTR("},{"));
+  nr_json_write_object_members(buf, event->user_attributes);
+  nr_buffer_add(buf, NR_PSTR("},{"));
+  count = nr_span_event_agent_fields(event, agent);
+  nr_span_event_fields_to_json_buffer(agent, count, buf);
+  extras.buf = buf;
+  extras.fields = agent;
+  extras.count = count;
+  nro_iteratehash(event->agent_attributes, nr_span_event_extra_to_json_buffer,
+                  &extras);
+  nr_buffer_add(buf, NR_PSTR("}]"));
 
   return true;
 }
 
+/*
+ * Purpose : Replace the value of a string field.
+ */
+static inline void nr_span_event_set_string(char** field, const char* value) {
+  nr_free(*field);
+  *field = nr_strdup(value);
+}
+
 void nr_span_event_set_guid(nr_span_event_t* event, const char* guid) {
   if (NULL == event || NULL == guid) {
     return;
   }
 
-  nro_set_hash_string(event->intrinsics, "guid", guid);
+  nr_span_event_set_string(&event->guid, guid);
 }
 
 void nr_span_event_set_parent_id(nr_span_event_t* event,
@@ -91,7 +388,7 @@ void nr_span_event_set_parent_id(nr_span_event_t* event,
     return;
   }
 
-  nro_set_hash_string(event->intrinsics, "parentId", parent_id);
+  nr_span_event_set_string(&event->parent_id, parent_id);
 }
 
 void nr_span_event_set_trace_id(nr_span_event_t* event, const char* trace_id) {
@@ -101,7 +398,6 @@ void nr_span_event_set_trace_id(nr_span_event_t* event, const char* trace_id) {
 
   nr_free(event->trace_id);
   if (trace_id) {
-    nro_set_hash_string(event->intrinsics, "traceId", trace_id);
     event->trace_id = nr_strdup(trace_id);
   }
 }
@@ -112,7 +408,7 @@ void nr_span_event_set_transaction_id(nr_span_event_t* event,
     return;
   }
 
-  nro_set_hash_string(event->intrinsics, "transactionId", transaction_id);
+  nr_span_event_set_string(&event->transaction_id, transaction_id);
 }
 
 void nr_span_event_set_name(nr_span_event_t* event, const char* name) {
@@ -120,7 +416,7 @@ void nr_span_event_set_name(nr_span_event_t* event, const char* name) {
     return;
   }
 
-  nro_set_hash_string(event->intrinsics, "name", name);
+  nr_span_event_set_string(&event->name, name);
 }
 
 void nr_span_event_set_transaction_name(nr_span_event_t* event,
@@ -129,7 +425,7 @@ void nr_span_event_set_transaction_name(nr_span_event_t* event,
     return;
   }
 
-  nro_set_hash_string(event->intrinsics, "transaction.name", transaction_name);
+  nr_span_event_set_string(&event->transaction_name, transaction_name);
 }
 
 void nr_span_event_set_category(nr_span_event_t* event,
@@ -140,22 +436,22 @@ void nr_span_event_set_category(nr_span_event_t* event,
 
   switch (category) {
     case NR_SPAN_DATASTORE:
-      nro_set_hash_string(event->intrinsics, "category", "datastore");
+      event->category = NR_SPAN_DATASTORE;
       nr_span_event_set_spankind(event, NR_SPANKIND_CLIENT);
       break;
 
     case NR_SPAN_GENERIC:
-      nro_set_hash_string(event->intrinsics, "category", "generic");
+      event->category = NR_SPAN_GENERIC;
       nr_span_event_set_spankind(event, NR_SPANKIND_NO_SPANKIND);
       break;
 
     case NR_SPAN_HTTP:
-      nro_set_hash_string(event->intrinsics, "category", "http");
+      event->category = NR_SPAN_HTTP;
       nr_span_event_set_spankind(event, NR_SPANKIND_CLIENT);
       break;
 
     case NR_SPAN_MESSAGE:
-      nro_set_hash_string(event->intrinsics, "category", "message");
+      event->category = NR_SPAN_MESSAGE;
       /* give it a default value in case we exit before spankind is set*/
       nr_span_event_set_spankind(event, NR_SPANKIND_NO_SPANKIND);
       break;
@@ -170,19 +466,13 @@ void nr_span_event_set_spankind(nr_span_event_t* event,
 
   switch (spankind) {
     case NR_SPANKIND_PRODUCER:
-      nro_set_hash_string(event->intrinsics, "span.kind", "producer");
-      break;
     case NR_SPANKIND_CLIENT:
-      nro_set_hash_string(event->intrinsics, "span.kind", "client");
-      break;
     case NR_SPANKIND_CONSUMER:
-      nro_set_hash_string(event->intrinsics, "span.kind", "consumer");
+      event->spankind = spankind;
       break;
     case NR_SPANKIND_NO_SPANKIND:
     default:
-      if (nro_get_hash_value(event->intrinsics, "span.kind", NULL)) {
-        nro_set_hash_none(event->intrinsics, "span.kind");
-      }
+      event->spankind = NR_SPANKIND_NO_SPANKIND;
       break;
   }
 }
@@ -192,7 +482,8 @@ void nr_span_event_set_timestamp(nr_span_event_t* event, nrtime_t time) {
     return;
   }
 
-  nro_set_hash_ulong(event->intrinsics, "timestamp", time / NR_TIME_DIVISOR_MS);
+  event->timestamp = time / NR_TIME_DIVISOR_MS;
+  event->flags |= NR_SPAN_EVENT_HAS_TIMESTAMP;
 }
 
 void nr_span_event_set_duration(nr_span_event_t* event, nrtime_t duration) {
@@ -200,8 +491,8 @@ void nr_span_event_set_duration(nr_span_event_t* event, nrtime_t duration) {
     return;
   }
 
-  nro_set_hash_double(event->intrinsics, "duration",
-                      duration / NR_TIME_DIVISOR_D);
+  event->duration = duration / NR_TIME_DIVISOR_D;
+  event->flags |= NR_SPAN_EVENT_HAS_DURATION;
 }
 
 void nr_span_event_set_priority(nr_span_event_t* event, double priority) {
@@ -209,7 +500,8 @@ void nr_span_event_set_priority(nr_span_event_t* event, double priority) {
     return;
   }
 
-  nro_set_hash_double(event->intrinsics, "priority", priority);
+  event->priority = priority;
+  event->flags |= NR_SPAN_EVENT_HAS_PRIORITY;
 }
 
 void nr_span_event_set_sampled(nr_span_event_t* event, bool sampled) {
@@ -217,7 +509,8 @@ void nr_span_event_set_sampled(nr_span_event_t* event, bool sampled) {
     return;
   }
 
-  nro_set_hash_boolean(event->intrinsics, "sampled", sampled);
+  event->sampled = sampled;
+  event->flags |= NR_SPAN_EVENT_HAS_SAMPLED;
 }
 
 void nr_span_event_set_entry_point(nr_span_event_t* event, bool entry_point) {
@@ -226,7 +519,7 @@ void nr_span_event_set_entry_point(nr_span_event_t* event, bool entry_point) {
   }
 
   if (entry_point) {
-    nro_set_hash_boolean(event->intrinsics, "nr.entryPoint", entry_point);
+    event->flags |= NR_SPAN_EVENT_HAS_ENTRY_POINT;
   }
 }
 
@@ -236,7 +529,7 @@ void nr_span_event_set_tracing_vendors(nr_span_event_t* event,
     return;
   }
 
-  nro_set_hash_string(event->intrinsics, "tracingVendors", tracing_vendors);
+  nr_span_event_set_string(&event->tracing_vendors, tracing_vendors);
 }
 
 void nr_span_event_set_trusted_parent_id(nr_span_event_t* event,
@@ -245,7 +538,7 @@ void nr_span_event_set_trusted_parent_id(nr_span_event_t* event,
     return;
   }
 
-  nro_set_hash_string(event->intrinsics, "trustedParentId", trusted_parent_id);
+  nr_span_event_set_string(&event->trusted_parent_id, trusted_parent_id);
 }
 
 void nr_span_event_set_error_message(nr_span_event_t* event,
@@ -254,7 +547,7 @@ void nr_span_event_set_error_message(nr_span_event_t* event,
     return;
   }
 
-  nro_set_hash_string(event->agent_attributes, "error.message", error_message);
+  nr_span_event_set_string(&event->error_message, error_message);
 }
 
 void nr_span_event_set_error_class(nr_span_event_t* event,
@@ -263,7 +556,7 @@ void nr_span_event_set_error_class(nr_span_event_t* event,
     return;
   }
 
-  nro_set_hash_string(event->agent_attributes, "error.class", error_class);
+  nr_span_event_set_string(&event->error_class, error_class);
 }
 
 void nr_span_event_set_parent_attribute(
@@ -276,17 +569,16 @@ void nr_span_event_set_parent_attribute(
 
   switch (member) {
     case NR_SPAN_PARENT_TYPE:
-      nro_set_hash_string(event->agent_attributes, "parent.type", value);
+      nr_span_event_set_string(&event->parent_type, value);
       break;
     case NR_SPAN_PARENT_APP:
-      nro_set_hash_string(event->agent_attributes, "parent.app", value);
+      nr_span_event_set_string(&event->parent_app, value);
       break;
     case NR_SPAN_PARENT_ACCOUNT:
-      nro_set_hash_string(event->agent_attributes, "parent.account", value);
+      nr_span_event_set_string(&event->parent_account, value);
       break;
     case NR_SPAN_PARENT_TRANSPORT_TYPE:
-      nro_set_hash_string(event->agent_attributes, "parent.transportType",
-                          value);
+      nr_span_event_set_string(&event->parent_transport_type, value);
       break;
   }
 }
@@ -297,8 +589,8 @@ void nr_span_event_set_parent_transport_duration(nr_span_event_t* event,
     return;
   }
 
-  nro_set_hash_double(event->agent_attributes, "parent.transportDuration",
-                      transport_duration / NR_TIME_DIVISOR);
+  event->parent_transport_duration = transport_duration / NR_TIME_DIVISOR;
+  event->flags |= NR_SPAN_EVENT_HAS_PARENT_TRANSPORT_DURATION;
 }
 
 void nr_span_event_set_datastore(nr_span_event_t* event,
@@ -310,22 +602,22 @@ void nr_span_event_set_datastore(nr_span_event_t* event,
 
   switch (member) {
     case NR_SPAN_DATASTORE_COMPONENT:
-      nro_set_hash_string(event->intrinsics, "component", new_value);
+      nr_span_event_set_string(&event->component, new_value);
       break;
     case NR_SPAN_DATASTORE_DB_SYSTEM:
-      nro_set_hash_string(event->agent_attributes, "db.system", new_value);
+      nr_span_event_set_string(&event->db_system, new_value);
       break;
     case NR_SPAN_DATASTORE_DB_STATEMENT:
-      nro_set_hash_string(event->agent_attributes, "db.statement", new_value);
+      nr_span_event_set_string(&event->db_statement, new_value);
       break;
     case NR_SPAN_DATASTORE_DB_INSTANCE:
-      nro_set_hash_string(event->agent_attributes, "db.instance", new_value);
+      nr_span_event_set_string(&event->db_instance, new_value);
       break;
     case NR_SPAN_DATASTORE_PEER_ADDRESS:
-      nro_set_hash_string(event->agent_attributes, "peer.address", new_value);
+      nr_span_event_set_string(&event->peer_address, new_value);
       break;
     case NR_SPAN_DATASTORE_PEER_HOSTNAME:
-      nro_set_hash_string(event->agent_attributes, "peer.hostname", new_value);
+      nr_span_event_set_string(&event->peer_hostname, new_value);
       break;
   }
   return;
@@ -340,13 +632,13 @@ void nr_span_event_set_external(nr_span_event_t* event,
 
   switch (member) {
     case NR_SPAN_EXTERNAL_URL:
-      nro_set_hash_string(event->agent_attributes, "http.url", new_value);
+      nr_span_event_set_string(&event->http_url, new_value);
       break;
     case NR_SPAN_EXTERNAL_METHOD:
-      nro_set_hash_string(event->agent_attributes, "http.method", new_value);
+      nr_span_event_set_string(&event->http_method, new_value);
       break;
     case NR_SPAN_EXTERNAL_COMPONENT:
-      nro_set_hash_string(event->intrinsics, "component", new_value);
+      nr_span_event_set_string(&event->component, new_value);
       break;
   }
 }
@@ -357,7 +649,8 @@ void nr_span_event_set_external_status(nr_span_event_t* event,
     return;
   }
 
-  nro_set_hash_ulong(event->agent_attributes, "http.statusCode", status);
+  event->http_status = status;
+  event->flags |= NR_SPAN_EVENT_HAS_HTTP_STATUS;
 }
 
 void nr_span_event_set_message(nr_span_event_t* event,
@@ -369,25 +662,21 @@ void nr_span_event_set_message(nr_span_event_t* event,
 
   switch (member) {
     case NR_SPAN_MESSAGE_DESTINATION_NAME:
-      nro_set_hash_string(event->agent_attributes,
-                          NR_ATTR_MESSAGING_DESTINATION_NAME, new_value);
+      nr_span_event_set_string(&event->message_destination_name, new_value);
       break;
     case NR_SPAN_MESSAGE_MESSAGING_SYSTEM:
-      nro_set_hash_string(event->agent_attributes, NR_ATTR_MESSAGING_SYSTEM,
-                          new_value);
+      nr_span_event_set_string(&event->messaging_system, new_value);
       break;
     case NR_SPAN_MESSAGE_SERVER_ADDRESS:
-      nro_set_hash_string(event->agent_attributes, NR_ATTR_SERVER_ADDRESS,
-                          new_value);
+      nr_span_event_set_string(&event->server_address, new_value);
       break;
     case NR_SPAN_MESSAGE_MESSAGING_DESTINATION_ROUTING_KEY:
-      nro_set_hash_string(event->agent_attributes,
-                          NR_ATTR_MESSAGING_DESTINATION_ROUTING_KEY, new_value);
+      nr_span_event_set_string(&event->messaging_destination_routing_key,
+                               new_value);
       break;
     case NR_SPAN_MESSAGE_MESSAGING_DESTINATION_PUBLISH_NAME:
-      nro_set_hash_string(event->agent_attributes,
-                          NR_ATTR_MESSAGING_DESTINATION_PUBLISH_NAME,
-                          new_value);
+      nr_span_event_set_string(&event->messaging_destination_publish_name,
+                               new_value);
       break;
     case NR_SPAN_MESSAGE_SERVER_PORT:
       break;
@@ -403,8 +692,8 @@ void nr_span_event_set_message_ulong(nr_span_event_t* event,
 
   switch (member) {
     case NR_SPAN_MESSAGE_SERVER_PORT:
-      nro_set_hash_ulong(event->agent_attributes, NR_ATTR_SERVER_PORT,
-                         new_value);
+      event->server_port = new_value;
+      event->flags |= NR_SPAN_EVENT_HAS_SERVER_PORT;
       break;
     case NR_SPAN_MESSAGE_DESTINATION_NAME:
       break;
@@ -423,78 +712,105 @@ void nr_span_event_set_message_ulong(nr_span_event_t* event,
  * Getters.
  *
  * We only use these for unit tests.
- *
- * These are generated using macros, which is ugly and horrible, but saves a
- * bunch of boilerplate.
  */
-#define SPAN_EVENT_GETTER(name, type, obj, getter, field, default_value) \
-  type name(const nr_span_event_t* event) {                              \
-    nr_status_t err = NR_FAILURE;                                        \
-    type rv = default_value;                                             \
-                                                                         \
-    if (NULL == event) {                                                 \
-      return rv;                                                         \
-    }                                                                    \
-                                                                         \
-    rv = getter(event->obj, field, &err);                                \
-    if (NR_SUCCESS != err) {                                             \
-      return default_value;                                              \
-    }                                                                    \
-    return rv;                                                           \
-  }
-
-#define SPAN_EVENT_GETTER_BOOL(name, obj, field) \
-  SPAN_EVENT_GETTER(name, bool, obj, nro_get_hash_boolean, field, false)
-
-#define SPAN_EVENT_GETTER_DOUBLE(name, obj, field) \
-  SPAN_EVENT_GETTER(name, double, obj, nro_get_hash_double, field, 0.0)
-
-#define SPAN_EVENT_GETTER_STRING(name, obj, field) \
-  SPAN_EVENT_GETTER(name, const char*, obj, nro_get_hash_string, field, NULL)
-
-#define SPAN_EVENT_GETTER_TIME(name, obj, field) \
-  SPAN_EVENT_GETTER(name, nrtime_t, obj, nro_get_hash_ulong, field, 0)
-
-#define SPAN_EVENT_GETTER_UINT(name, obj, field) \
-  SPAN_EVENT_GETTER(name, uint64_t, obj, nro_get_hash_ulong, field, 0)
-
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_guid, intrinsics, "guid")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_parent_id, intrinsics, "parentId")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_trace_id, intrinsics, "traceId")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_transaction_id,
-                         intrinsics,
-                         "transactionId")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_name, intrinsics, "name")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_transaction_name,
-                         intrinsics,
-                         "transaction.name")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_category, intrinsics, "category")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_spankind, intrinsics, "span.kind")
-SPAN_EVENT_GETTER_TIME(nr_span_event_get_timestamp, intrinsics, "timestamp")
-SPAN_EVENT_GETTER_DOUBLE(nr_span_event_get_duration, intrinsics, "duration")
-SPAN_EVENT_GETTER_DOUBLE(nr_span_event_get_priority, intrinsics, "priority")
-SPAN_EVENT_GETTER_BOOL(nr_span_event_is_sampled, intrinsics, "sampled")
-SPAN_EVENT_GETTER_BOOL(nr_span_event_is_entry_point,
-                       intrinsics,
-                       "nr.entryPoint")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_tracing_vendors,
-                         intrinsics,
-                         "tracingVendors")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_trusted_parent_id,
-                         intrinsics,
-                         "trustedParentId")
-SPAN_EVENT_GETTER_DOUBLE(nr_span_event_get_parent_transport_duration,
-                         agent_attributes,
-                         "parent.transportDuration")
-SPAN_EVENT_GETTER_UINT(nr_span_event_get_external_status,
-                       agent_attributes,
-                       "http.statusCode")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_error_message,
-                         agent_attributes,
-                         "error.message")
-SPAN_EVENT_GETTER_STRING(nr_span_event_get_error_class,
-                         agent_attributes,
-                         "error.class")
+const char* nr_span_event_get_guid(const nr_span_event_t* event) {
+  return event ? event->guid : NULL;
+}
+
+const char* nr_span_event_get_parent_id(const nr_span_event_t* event) {
+  return event ? event->parent_id : NULL;
+}
+
+const char* nr_span_event_get_trace_id(const nr_span_event_t* event) {
+  return event ? event->trace_id : NULL;
+}
+
+const char* nr_span_event_get_transaction_id(const nr_span_event_t* event) {
+  return event ? event->transaction_id : NULL;
+}
+
+const char* nr_span_event_get_name(const nr_span_event_t* event) {
+  return event ? event->name : NULL;
+}
+
+const char* nr_span_event_get_transaction_name(const nr_span_event_t* event) {
+  return event ? event->transaction_name : NULL;
+}
+
+const char* nr_span_event_get_category(const nr_span_event_t* event) {
+  return event ? nr_span_event_category_name(event->category) : NULL;
+}
+
+const char* nr_span_event_get_spankind(const nr_span_event_t* event) {
+  return event ? nr_span_event_spankind_name(event->spankind) : NULL;
+}
+
+nrtime_t nr_span_event_get_timestamp(const nr_span_event_t* event) {
+  if (NULL == event || !(event->flags & NR_SPAN_EVENT_HAS_TIMESTAMP)) {
+    return 0;
+  }
+  return event->timestamp;
+}
+
+double nr_span_event_get_duration(const nr_span_event_t* event) {
+  if (NULL == event || !(event->flags & NR_SPAN_EVENT_HAS_DURATION)) {
+    return 0.0;
+  }
+  return event->duration;
+}
+
+double nr_span_event_get_priority(const nr_span_event_t* event) {
+  if (NULL == event || !(event->flags & NR_SPAN_EVENT_HAS_PRIORITY)) {
+    return 0.0;
+  }
+  return event->priority;
+}
+
+bool nr_span_event_is_sampled(const nr_span_event_t* event) {
+  if (NULL == event || !(event->flags & NR_SPAN_EVENT_HAS_SAMPLED)) {
+    return false;
+  }
+  return event->sampled;
+}
+
+bool nr_span_event_is_entry_point(const nr_span_event_t* event) {
+  if (NULL == event) {
+    return false;
+  }
+  return (event->flags & NR_SPAN_EVENT_HAS_ENTRY_POINT) ? true : false;
+}
+
+const char* nr_span_event_get_tracing_vendors(const nr_span_event_t* event) {
+  return event ? event->tracing_vendors : NULL;
+}
+
+const char* nr_span_event_get_trusted_parent_id(const nr_span_event_t* event) {
+  return event ? event->trusted_parent_id : NULL;
+}
+
+double nr_span_event_get_parent_transport_duration(
+    const nr_span_event_t* event) {
+  if (NULL == event
+      || !(event->flags & NR_SPAN_EVENT_HAS_PARENT_TRANSPORT_DURATION)) {
+    return 0.0;
+  }
+  return event->parent_transport_duration;
+}
+
+uint64_t nr_span_event_get_external_status(const nr_span_event_t* event) {
+  if (NULL == event || !(event->flags & NR_SPAN_EVENT_HAS_HTTP_STATUS)) {
+    return 0;
+  }
+  return event->http_status;
+}
+
+const char* nr_span_event_get_error_message(const nr_span_event_t* event) {
+  return event ? event->error_message : NULL;
+}
+
+const char* nr_span_event_get_error_class(const nr_span_event_t* event) {
+  return event ? event->error_class : NULL;
+}
 
 const char* nr_span_event_get_parent_attribute(
     const nr_span_event_t* event,
@@ -505,15 +821,13 @@ const char* nr_span_event_get_parent_attribute(
 
   switch (member) {
     case NR_SPAN_PARENT_TYPE:
-      return nro_get_hash_string(event->agent_attributes, "parent.type", NULL);
+      return event->parent_type;
     case NR_SPAN_PARENT_APP:
-      return nro_get_hash_string(event->agent_attributes, "parent.app", NULL);
+      return event->parent_app;
     case NR_SPAN_PARENT_ACCOUNT:
-      return nro_get_hash_string(event->agent_attributes, "parent.account",
-                                 NULL);
+      return event->parent_account;
     case NR_SPAN_PARENT_TRANSPORT_TYPE:
-      return nro_get_hash_string(event->agent_attributes,
-                                 "parent.transportType", NULL);
+      return event->parent_transport_type;
   }
   return NULL;
 }
@@ -527,18 +841,17 @@ const char* nr_span_event_get_datastore(
 
   switch (member) {
     case NR_SPAN_DATASTORE_COMPONENT:
-      return nro_get_hash_string(event->intrinsics, "component", NULL);
+      return event->component;
     case NR_SPAN_DATASTORE_DB_SYSTEM:
-      return nro_get_hash_string(event->agent_attributes, "db.system", NULL);
+      return event->db_system;
     case NR_SPAN_DATASTORE_DB_STATEMENT:
-      return nro_get_hash_string(event->agent_attributes, "db.statement", NULL);
+      return event->db_statement;
     case NR_SPAN_DATASTORE_DB_INSTANCE:
-      return nro_get_hash_string(event->agent_attributes, "db.instance", NULL);
+      return event->db_instance;
     case NR_SPAN_DATASTORE_PEER_ADDRESS:
-      return nro_get_hash_string(event->agent_attributes, "peer.address", NULL);
+      return event->peer_address;
     case NR_SPAN_DATASTORE_PEER_HOSTNAME:
-      return nro_get_hash_string(event->agent_attributes, "peer.hostname",
-                                 NULL);
+      return event->peer_hostname;
   }
   return NULL;
 }
@@ -551,11 +864,11 @@ const char* nr_span_event_get_external(const nr_span_event_t* event,
 
   switch (member) {
     case NR_SPAN_EXTERNAL_URL:
-      return nro_get_hash_string(event->agent_attributes, "http.url", NULL);
+      return event->http_url;
     case NR_SPAN_EXTERNAL_METHOD:
-      return nro_get_hash_string(event->agent_attributes, "http.method", NULL);
+      return event->http_method;
     case NR_SPAN_EXTERNAL_COMPONENT:
-      return nro_get_hash_string(event->intrinsics, "component", NULL);
+      return event->component;
   }
   return NULL;
 }
@@ -568,22 +881,15 @@ const char* nr_span_event_get_message(const nr_span_event_t* event,
 
   switch (member) {
     case NR_SPAN_MESSAGE_DESTINATION_NAME:
-      return nro_get_hash_string(event->agent_attributes,
-                                 NR_ATTR_MESSAGING_DESTINATION_NAME, NULL);
+      return event->message_destination_name;
     case NR_SPAN_MESSAGE_MESSAGING_SYSTEM:
-      return nro_get_hash_string(event->agent_attributes,
-                                 NR_ATTR_MESSAGING_SYSTEM, NULL);
+      return event->messaging_system;
     case NR_SPAN_MESSAGE_SERVER_ADDRESS:
-      return nro_get_hash_string(event->agent_attributes,
-                                 NR_ATTR_SERVER_ADDRESS, NULL);
+      return event->server_address;
     case NR_SPAN_MESSAGE_MESSAGING_DESTINATION_ROUTING_KEY:
-      return nro_get_hash_string(event->agent_attributes,
-                                 NR_ATTR_MESSAGING_DESTINATION_ROUTING_KEY,
-                                 NULL);
+      return event->messaging_destination_routing_key;
     case NR_SPAN_MESSAGE_MESSAGING_DESTINATION_PUBLISH_NAME:
-      return nro_get_hash_string(event->agent_attributes,
-                                 NR_ATTR_MESSAGING_DESTINATION_PUBLISH_NAME,
-                                 NULL);
+      return event->messaging_destination_publish_name;
     case NR_SPAN_MESSAGE_SERVER_PORT:
       break;
   }
@@ -599,8 +905,7 @@ uint64_t nr_span_event_get_message_ulong(
 
   switch (member) {
     case NR_SPAN_MESSAGE_SERVER_PORT:
-      return nro_get_hash_ulong(event->agent_attributes, NR_ATTR_SERVER_PORT,
-                                NULL);
+      return event->server_port;
     case NR_SPAN_MESSAGE_DESTINATION_NAME:
       break;
     case NR_SPAN_MESSAGE_MESSAGING_SYSTEM:
@@ -622,6 +927,9 @@ void nr_span_event_set_attribute_user(nr_span_event_t* event,
     return;
   }
 
+  if (NULL == event->user_attributes) {
+    event->user_attributes = nro_new_hash();
+  }
   nro_set_hash(event->user_attributes, name, value);
 }
 
@@ -632,5 +940,8 @@ void nr_span_event_set_attribute_agent(nr_span_event_t* event,
     return;
   }
 
+  if (NULL == event->agent_attributes) {
+    event->agent_attributes = nro_new_hash();
+  }
   nro_set_hash(event->agent_attributes, name, value);
 }
@@ -9,13 +9,129 @@
 #include "nr_span_event.h"
 #include "util_object.h"
 
+/*
+ * Flags indicating which of the non-string fields of a span event have been
+ * set. String fields are unset when they are NULL.
+ */
+#define NR_SPAN_EVENT_HAS_TIMESTAMP (1 << 0)
+#define NR_SPAN_EVENT_HAS_DURATION (1 << 1)
+#define NR_SPAN_EVENT_HAS_PRIORITY (1 << 2)
+#define NR_SPAN_EVENT_HAS_SAMPLED (1 << 3)
+#define NR_SPAN_EVENT_HAS_ENTRY_POINT (1 << 4)
+#define NR_SPAN_EVENT_HAS_PARENT_TRANSPORT_DURATION (1 << 5)
+#define NR_SPAN_EVENT_HAS_HTTP_STATUS (1 << 6)
+#define NR_SPAN_EVENT_HAS_SERVER_PORT (1 << 7)
+
+/*
+ * A span event.
+ *
+ * The intrinsics and agent attributes that the agent knows about are kept in
+ * typed fields, so that setting them doesn't need a hash lookup and encoding
+ * them doesn't need a type switch on a generic object. Only the user
+ * attributes and any other agent attributes are kept in generic hashes, which
+ * are created when the first such attribute is added.
+ */
 struct _nr_span_event_t {
+  /* Intrinsics. */
   char* trace_id;
-  nrobj_t* intrinsics;
+  char* guid;
+  char* parent_id;
+  char* transaction_id;
+  char* name;
+  char* transaction_name;
+  char* tracing_vendors;
+  char* trusted_parent_id;
+  char* component;
+  nr_span_category_t category;
+  nr_span_spankind_t spankind; /* NR_SPANKIND_NO_SPANKIND when unset */
+  uint32_t flags;              /* NR_SPAN_EVENT_HAS_* flags */
+  bool sampled;
+  uint64_t timestamp; /* In milliseconds */
+  double duration;    /* In seconds */
+  double priority;
+
+  /* Agent attributes. */
+  char* parent_type;
+  char* parent_app;
+  char* parent_account;
+  char* parent_transport_type;
+  double parent_transport_duration;
+  char* error_message;
+  char* error_class;
+  char* db_system;
+  char* db_statement;
+  char* db_instance;
+  char* peer_address;
+  char* peer_hostname;
+  char* http_url;
+  char* http_method;
+  uint64_t http_status;
+  char* message_destination_name;
+  char* messaging_system;
+  char* server_address;
+  char* messaging_destination_routing_key;
+  char* messaging_destination_publish_name;
+  uint64_t server_port;
+
+  /* Attributes without a typed field; NULL until one is added. */
   nrobj_t* agent_attributes;
   nrobj_t* user_attributes;
 };
 
+/*
+ * A single typed span event field, as produced by nr_span_event_intrinsics()
+ * and nr_span_event_agent_fields() for the encoders.
+ */
+typedef enum _nr_span_event_field_type_t {
+  NR_SPAN_EVENT_FIELD_STRING,
+  NR_SPAN_EVENT_FIELD_BOOLEAN,
+  NR_SPAN_EVENT_FIELD_DOUBLE,
+  NR_SPAN_EVENT_FIELD_ULONG,
+} nr_span_event_field_type_t;
+
+typedef struct _nr_span_event_field_t {
+  const char* key;
+  nr_span_event_field_type_t type;
+  union {
+    const char* sval;
+    bool bval;
+    double dval;
+    uint64_t ulval;
+  } u;
+} nr_span_event_field_t;
+
+#define NR_SPAN_EVENT_INTRINSICS_MAX 17
+#define NR_SPAN_EVENT_AGENT_FIELDS_MAX 21
+
+/*
+ * Purpose : Get the intrinsics, or the typed agent attributes, that are set
+ *           on a span event.
+ *
+ * Params  : 1. The span event.
+ *           2. An array to fill with the fields, which must have room for
+ *              NR_SPAN_EVENT_INTRINSICS_MAX or NR_SPAN_EVENT_AGENT_FIELDS_MAX
+ *              fields respectively. String values point into the span event.
+ *
+ * Returns : The number of fields written.
+ */
+extern size_t nr_span_event_intrinsics(const nr_span_event_t* event,
+                                       nr_span_event_field_t* fields);
+extern size_t nr_span_event_agent_fields(const nr_span_event_t* event,
+                                         nr_span_event_field_t* fields);
+
+/*
+ * Purpose : Check if a key is used by one of the given fields.
+ *
+ *           Typed agent attributes take precedence over agent attributes in
+ *           the generic hash with the same key, so the encoders use this to
+ *           skip the latter.
+ *
+ * Returns : true if one of the fields has the key, false otherwise.
+ */
+extern bool nr_span_event_fields_have_key(const nr_span_event_field_t* fields,
+                                          size_t count,
+                                          const char* key);
+
 /*
  * Getters, used only for unit tests.
  */
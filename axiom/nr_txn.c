@@ -239,6 +239,8 @@ bool nr_txn_cmp_options(nrtxnopt_t* o1, nrtxnopt_t* o2) {
     return false;
   if ((bool)o1->max_segments != (bool)o2->max_segments)
     return false;
+  if (o1->release_completed_segments != o2->release_completed_segments)
+    return false;
   if (o1->span_queue_batch_size != o2->span_queue_batch_size)
     return false;
   if (o1->span_queue_batch_timeout != o2->span_queue_batch_timeout)
@@ -482,11 +484,13 @@ nrtxn_t* nr_txn_begin(nrapp_t* app,
   nt->agent_run_id = nr_strdup(app->agent_run_id);
   nt->rnd = app->rnd;
   nt->segment_slab = segment_slab;
+  nt->arena = nr_arena_create(0);
 
   /*
-   * Allocate the transaction-global string pools.
+   * Allocate the transaction-global string pools. Strings are never removed
+   * from these, so their contents can live in the transaction's arena.
    */
-  nt->trace_strings = nr_string_pool_create();
+  nt->trace_strings = nr_string_pool_create_with_arena(nt->arena);
 
   nr_memcpy(&nt->options, opts, sizeof(nrtxnopt_t));
 
@@ -534,9 +538,11 @@ nrtxn_t* nr_txn_begin(nrapp_t* app,
 
 #define NR_TXN_MAX_SLOWSQLS 10
   nt->slowsqls = nr_slowsqls_create(NR_TXN_MAX_SLOWSQLS);
-  nt->datastore_products = nr_string_pool_create();
-  nt->unscoped_metrics = nrm_table_create(NR_METRIC_DEFAULT_LIMIT);
-  nt->scoped_metrics = nrm_table_create(NR_METRIC_DEFAULT_LIMIT);
+  nt->datastore_products = nr_string_pool_create_with_arena(nt->arena);
+  nt->unscoped_metrics
+      = nrm_table_create_with_arena(NR_METRIC_DEFAULT_LIMIT, nt->arena);
+  nt->scoped_metrics
+      = nrm_table_create_with_arena(NR_METRIC_DEFAULT_LIMIT, nt->arena);
   nt->attribute_config = nr_attribute_config_copy(attribute_config);
   nt->attributes = nr_attributes_create(attribute_config);
   nt->intrinsics = nro_new_hash();
@@ -607,7 +613,7 @@ nrtxn_t* nr_txn_begin(nrapp_t* app,
 
   nt->license = nr_strdup(app->info.license);
 
-  nt->app_connect_reply = nro_copy(app->connect_reply);
+  nt->app_connect_reply = nro_ref(app->connect_reply);
   nt->app_limits = app->limits;
   nt->primary_app_name = nr_strdup(app->entity_name);
 
@@ -1062,8 +1068,9 @@ void nr_txn_create_duration_metrics(nrtxn_t* txn,
     return;
   }
 
-  root_exclusive
-      = nr_exclusive_time_calculate(txn->segment_root->exclusive_time);
+  root_exclusive = nr_segment_subtract_released_time(
+      txn->segment_root,
+      nr_exclusive_time_calculate(txn->segment_root->exclusive_time));
 
   if (txn->status.background) {
     rollup_metric = "OtherTransaction/all";
@@ -1253,13 +1260,16 @@ void nr_txn_destroy_fields(nrtxn_t* txn) {
   nr_error_destroy(&txn->error);
   nr_distributed_trace_destroy(&txn->distributed_trace);
   nr_segment_destroy_tree(txn->segment_root);
+  nr_segment_children_pool_destroy_fields(&txn->segment_children_pool);
   nr_hashmap_destroy(&txn->parent_stacks);
   nr_php_packages_destroy(&txn->php_packages);
   nr_php_packages_destroy(&txn->php_package_major_version_metrics_suggestions);
   nr_stack_destroy_fields(&txn->default_parent_stack);
+  nr_free(txn->pending_frames);
   nr_slab_destroy(&txn->segment_slab);
   nr_minmax_heap_set_destructor(txn->segment_heap, NULL, NULL);
   nr_minmax_heap_destroy(&txn->segment_heap);
+  nr_vector_destroy(&txn->released_span_events);
   nr_span_queue_destroy(&txn->span_queue);
 
   nrm_table_destroy(&txn->unscoped_metrics);
@@ -1287,6 +1297,11 @@ void nr_txn_destroy_fields(nrtxn_t* txn) {
   nr_synthetics_destroy(&txn->synthetics);
 
   nr_txn_final_destroy_fields(&txn->final_data);
+
+  /*
+   * This must be last, as any of the above may reference arena memory.
+   */
+  nr_arena_destroy(&txn->arena);
 }
 
 void nr_txn_final_destroy_fields(nrtxnfinal_t* tf) {
@@ -1461,12 +1476,7 @@ void nr_txn_end(nrtxn_t* txn) {
    * Finalise the segment tree.
    */
   txn->final_data = nr_segment_tree_finalise(
-      txn, NR_MAX_SEGMENTS,
-      ((0 < txn->options.span_events_max_samples_stored)
-       && (NR_MAX_SPAN_EVENTS_MAX_SAMPLES_STORED
-           >= txn->options.span_events_max_samples_stored))
-          ? txn->options.span_events_max_samples_stored
-          : NR_DEFAULT_SPAN_EVENTS_MAX_SAMPLES_STORED,
+      txn, NR_MAX_SEGMENTS, nr_txn_get_span_events_limit(txn),
       nr_txn_handle_total_time, NULL);
 }
 
@@ -2750,6 +2760,20 @@ bool nr_txn_should_create_span_events(const nrtxn_t* txn) {
          && txn->options.span_events_enabled;
 }
 
+size_t nr_txn_get_span_events_limit(const nrtxn_t* txn) {
+  if (nrunlikely(NULL == txn)) {
+    return NR_DEFAULT_SPAN_EVENTS_MAX_SAMPLES_STORED;
+  }
+
+  if ((0 < txn->options.span_events_max_samples_stored)
+      && (NR_MAX_SPAN_EVENTS_MAX_SAMPLES_STORED
+          >= txn->options.span_events_max_samples_stored)) {
+    return txn->options.span_events_max_samples_stored;
+  }
+
+  return NR_DEFAULT_SPAN_EVENTS_MAX_SAMPLES_STORED;
+}
+
 char* nr_txn_create_w3c_traceparent_header(nrtxn_t* txn,
                                            nr_segment_t* segment) {
   char* span_id = NULL;
@@ -2774,7 +2798,7 @@ char* nr_txn_create_w3c_traceparent_header(nrtxn_t* txn,
 
   // If spans are off we must send a random guid.
   if (NULL == span_id) {
-    span_id = nr_guid_create(txn->rnd);
+    span_id = nr_guid_generator_create(&txn->span_ids, txn->rnd);
     header = nr_distributed_trace_create_w3c_traceparent_header(
         trace_id, span_id,
         nr_distributed_trace_is_sampled(txn->distributed_trace));
@@ -2795,7 +2819,7 @@ end:
   return header;
 }
 
-char* nr_txn_create_w3c_tracestate_header(const nrtxn_t* txn,
+char* nr_txn_create_w3c_tracestate_header(nrtxn_t* txn,
                                           nr_segment_t* segment) {
   char* span_id = NULL;
   char* txn_id = NULL;
@@ -3185,11 +3209,51 @@ void nr_txn_finalize_parent_stacks(nrtxn_t* txn) {
     return;
   }
 
+  nr_txn_materialize_pending_frames(txn);
   nr_hashmap_apply(txn->parent_stacks, nr_txn_end_segments_in_stack_wrapper,
                    txn);
   nr_txn_end_segments_in_stack(&txn->default_parent_stack, txn);
 }
 
+void nr_txn_pending_frame_grow(nrtxn_t* txn) {
+  size_t capacity;
+
+  if (nrunlikely(NULL == txn)) {
+    return;
+  }
+
+  capacity = txn->pending_frames_capacity ? txn->pending_frames_capacity * 2
+                                          : NR_STACK_DEFAULT_CAPACITY;
+  txn->pending_frames = (nr_txn_pending_frame_t*)nr_realloc(
+      txn->pending_frames, capacity * sizeof(nr_txn_pending_frame_t));
+  txn->pending_frames_capacity = capacity;
+}
+
+void nr_txn_materialize_pending_frames(nrtxn_t* txn) {
+  size_t i;
+  size_t used;
+
+  if (nrunlikely(NULL == txn) || 0 == txn->pending_frames_used) {
+    return;
+  }
+
+  /*
+   * Empty the pending frames first: nr_segment_start() asks for the current
+   * segment, which would otherwise materialize them again.
+   */
+  used = txn->pending_frames_used;
+  txn->pending_frames_used = 0;
+
+  for (i = 0; i < used; i++) {
+    nr_segment_t* segment = nr_segment_start(txn, NULL, NULL);
+
+    if (nrunlikely(NULL == segment)) {
+      return;
+    }
+    segment->start_time = txn->pending_frames[i].start_time;
+  }
+}
+
 nr_segment_t* nr_txn_get_current_segment(nrtxn_t* txn,
                                          const char* async_context) {
   if (nrunlikely(NULL == txn)) {
@@ -3206,6 +3270,10 @@ nr_segment_t* nr_txn_get_current_segment(nrtxn_t* txn,
         nr_hashmap_index_get(txn->parent_stacks, (uint64_t)async_context_idx));
   }
 
+  if (txn->pending_frames_used) {
+    nr_txn_materialize_pending_frames(txn);
+  }
+
   if (txn->force_current_segment) {
     return txn->force_current_segment;
   }
@@ -22,6 +22,7 @@
 #include "nr_attributes.h"
 #include "nr_errors.h"
 #include "nr_file_naming.h"
+#include "nr_guid.h"
 #include "nr_log_events.h"
 #include "nr_log_level.h"
 #include "nr_segment.h"
@@ -31,6 +32,7 @@
 #include "nr_distributed_trace.h"
 #include "nr_php_packages.h"
 #include "util_apdex.h"
+#include "util_arena.h"
 #include "util_buffer.h"
 #include "util_hashmap.h"
 #include "util_json.h"
@@ -118,6 +120,12 @@ typedef struct _nrtxnopt_t {
   size_t max_segments; /* The maximum number of segments that are kept in the
                           segment tree at a time. When set to 0 or 1, no maximum
                           is applied. */
+  bool release_completed_segments; /* If enabled, the subtree of a segment is
+                                      freed as soon as every segment within it
+                                      has ended, and its span events are
+                                      created straight away. Only its duration
+                                      is kept, on its parent. This is not done
+                                      when max_segments applies. */
   bool discount_main_context_blocking; /* If enabled, the main context is
                                           assumed to be blocked when
                                           asynchronous contexts are executing,
@@ -230,6 +238,15 @@ typedef struct _nr_composer_info_t {
   nr_composer_api_status_t api_status;
 } nr_composer_info_t;
 
+/*
+ * A call on the default context that has started but has not been given a
+ * segment yet. See nr_txn_pending_frame_push().
+ */
+typedef struct _nr_txn_pending_frame_t {
+  const void* key;     /* Identifies the call, such as its execute data */
+  nrtime_t start_time; /* Relative to the transaction start */
+} nr_txn_pending_frame_t;
+
 /*
  * Possible transaction types, which go into the type bitfield in the nrtxn_t
  * struct.
@@ -266,6 +283,8 @@ typedef struct _nrtxn_t {
   nrtxnstatus_t status; /* Status for the transaction */
   nrtxncat_t cat;       /* Incoming CAT fields */
   nr_random_t* rnd;     /* Random number generator, owned by the application. */
+  nr_guid_generator_t span_ids; /* Generator for span ids, seeded from rnd on
+                                   first use */
 
   nr_stack_t default_parent_stack; /* A stack to track the current parent in a
                                       tree of segments, for segments that are
@@ -276,12 +295,27 @@ typedef struct _nrtxn_t {
   nr_segment_t* force_current_segment; /* Enforce a current segment for the
                                           default context, overriding the
                                           default parent stack. */
+  nr_txn_pending_frame_t*
+      pending_frames;          /* Calls above the current segment of the
+                                  default context that have no segment yet,
+                                  outermost first */
+  size_t pending_frames_used;  /* The number of pending frames */
+  size_t pending_frames_capacity; /* The allocated size of pending_frames */
   size_t segment_count; /* A count of segments for this transaction, maintained
                            throughout the life of this transaction */
   nr_minmax_heap_t*
       segment_heap; /* The heap used to track segments when a limit has been
                        applied via the max_segments transaction option. */
   nr_slab_t* segment_slab;    /* The slab allocator used to allocate segments */
+  nr_segment_children_pool_t
+      segment_children_pool; /* The pool used to allocate the children arrays
+                                of segments with many children */
+  nr_vector_t* released_span_events; /* Span events created for released
+                                        segments, added to the final span
+                                        events when the transaction ends */
+  nrtime_t released_total_time; /* The total time of released segments */
+  nr_arena_t* arena; /* Region for data that lives until the transaction is
+                        destroyed, such as pooled strings */
   nr_segment_t* segment_root; /* The root pointer to the tree of segments */
   nrtime_t abs_start_time; /* The absolute start timestamp for this transaction;
                             * all segment start and end times are relative to
@@ -325,7 +359,8 @@ typedef struct _nrtxn_t {
   nrtxntype_t type; /* The transaction type(s), as a bitfield */
 
   nrobj_t* app_connect_reply; /* Contents of application collector connect
-                                 command reply */
+                                 command reply. This is shared with the
+                                 application and must not be modified */
   nr_app_limits_t app_limits; /* Application data limits */
   char* primary_app_name; /* The primary app name in use (ie the first rollup
                              entry) */
@@ -1044,7 +1079,7 @@ char* nr_txn_create_w3c_traceparent_header(nrtxn_t* txn, nr_segment_t* segment);
  *
  * Returns : A W3C tracestate header. Returns NULL on error.
  */
-char* nr_txn_create_w3c_tracestate_header(const nrtxn_t* txn,
+char* nr_txn_create_w3c_tracestate_header(nrtxn_t* txn,
                                           nr_segment_t* segment);
 
 /*
@@ -1058,6 +1093,16 @@ char* nr_txn_create_w3c_tracestate_header(const nrtxn_t* txn,
  */
 extern bool nr_txn_should_create_span_events(const nrtxn_t* txn);
 
+/*
+ * Purpose : Get the maximum number of span events created for a transaction.
+ *
+ * Params  : 1. The transaction.
+ *
+ * Returns : The span_events_max_samples_stored option, or the default limit if
+ *           that option is not set or out of range.
+ */
+extern size_t nr_txn_get_span_events_limit(const nrtxn_t* txn);
+
 /*
  * Purpose : Get a pointer to the currently-executing segment for a given
  *           async context.
@@ -1097,6 +1142,84 @@ inline static void nr_txn_force_current_segment(nrtxn_t* txn,
   }
 }
 
+/*
+ * Purpose : Make room for at least one more pending frame.
+ */
+extern void nr_txn_pending_frame_grow(nrtxn_t* txn);
+
+/*
+ * Purpose : Record the start of a call on the default context without
+ *           starting a segment for it.
+ *
+ *           Most calls are short and end up discarded, so starting and
+ *           discarding a segment for each of them is wasted work. A pending
+ *           frame only records the start time, and is turned into a segment
+ *           by nr_txn_materialize_pending_frames() once a segment is actually
+ *           needed: nr_txn_get_current_segment() does so for the default
+ *           context, so that children, attributes and errors end up on the
+ *           right segment, and so does nr_txn_finalize_parent_stacks().
+ *
+ * Params  : 1. The transaction.
+ *           2. A key identifying the call, which must be passed to
+ *              nr_txn_pending_frame_pop() when the call ends.
+ */
+inline static void nr_txn_pending_frame_push(nrtxn_t* txn, const void* key) {
+  nr_txn_pending_frame_t* frame;
+
+  if (nrunlikely(NULL == txn)) {
+    return;
+  }
+
+  if (nrunlikely(txn->pending_frames_used == txn->pending_frames_capacity)) {
+    nr_txn_pending_frame_grow(txn);
+  }
+
+  frame = &txn->pending_frames[txn->pending_frames_used++];
+  frame->key = key;
+  frame->start_time = nr_txn_now_rel(txn);
+}
+
+/*
+ * Purpose : Remove the innermost pending frame when its call ends.
+ *
+ * Params  : 1. The transaction.
+ *           2. The key the frame was pushed with.
+ *           3. A pointer to receive the start time of the frame.
+ *
+ * Returns : true if the innermost pending frame was pushed with the given key
+ *           and has been removed. false if there are no pending frames, or if
+ *           the innermost one belongs to another call; in the latter case the
+ *           call either already has a segment or frames were left dangling,
+ *           and the current segment should be consulted instead.
+ */
+inline static bool nr_txn_pending_frame_pop(nrtxn_t* txn,
+                                            const void* key,
+                                            nrtime_t* start_time) {
+  const nr_txn_pending_frame_t* frame;
+
+  if (nrunlikely(NULL == txn) || 0 == txn->pending_frames_used) {
+    return false;
+  }
+
+  frame = &txn->pending_frames[txn->pending_frames_used - 1];
+  if (nrunlikely(frame->key != key)) {
+    return false;
+  }
+
+  *start_time = frame->start_time;
+  txn->pending_frames_used -= 1;
+  return true;
+}
+
+/*
+ * Purpose : Start a segment for every pending frame, outermost first, each
+ *           one parented to the previous one and with the start time of its
+ *           frame. The innermost becomes the current segment.
+ *
+ * Params  : 1. The transaction.
+ */
+extern void nr_txn_materialize_pending_frames(nrtxn_t* txn);
+
 /*
  * Purpose : Set the current segment for the transaction.
  *
@@ -1160,7 +1283,8 @@ extern char* nr_txn_get_current_span_id(nrtxn_t* txn);
  * Purpose : End all currently active segments.
  *
  *           All segments in the parent stacks maintained by the transaction
- *           will be ended and removed from the parent stacks.
+ *           will be ended and removed from the parent stacks. Pending frames
+ *           are turned into segments and ended as well.
  *
  * Params  : 1. The transaction.
  *
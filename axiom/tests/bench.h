@@ -0,0 +1,35 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Helpers shared by the axiom microbenchmarks. Benchmarks are standalone
+ * programs named bench_*.c: they are built and run by the bench target rather
+ * than as part of the unit test suite, and report their results on stdout.
+ */
+#ifndef BENCH_HDR
+#define BENCH_HDR
+
+#include <stdio.h>
+
+#include "util_time.h"
+
+/*
+ * Purpose : Report the cost of a benchmarked operation.
+ *
+ * Params  : 1. The name of the benchmark.
+ *           2. The number of operations performed.
+ *           3. The elapsed time taken by all of the operations.
+ */
+static inline void bench_report(const char* name, int ops, nrtime_t elapsed) {
+  double ns_per_op = 0.0;
+
+  if (ops > 0) {
+    ns_per_op = ((double)elapsed / NR_TIME_DIVISOR_US_D) * 1000.0 / (double)ops;
+  }
+
+  printf("%-48s %10d ops %12.1f ns/op\n", name, ops, ns_per_op);
+}
+
+#endif /* BENCH_HDR */
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Microbenchmark for exclusive time calculation over wide segments (one
+ * parent with many children) and deep segments (many parents with a single
+ * child each), with children added in start order and in reverse order.
+ */
+
+#include "nr_axiom.h"
+
+#include <stdio.h>
+
+#include "nr_exclusive_time.h"
+#include "util_time.h"
+
+#include "bench.h"
+
+static void bench_exclusive_time_wide(int children, int rounds, bool sorted) {
+  char label[64];
+  nrtime_t start;
+  nrtime_t elapsed = 0;
+  int round;
+  int i;
+
+  for (round = 0; round < rounds; round++) {
+    nr_exclusive_time_t* et;
+
+    start = nr_get_time();
+    et = nr_exclusive_time_create(children, 0, (nrtime_t)children * 100);
+    for (i = 0; i < children; i++) {
+      int child = sorted ? i : children - 1 - i;
+
+      nr_exclusive_time_add_child(et, (nrtime_t)child * 100,
+                                  (nrtime_t)child * 100 + 60);
+    }
+    nr_exclusive_time_calculate(et);
+    nr_exclusive_time_destroy(&et);
+    elapsed += nr_get_time() - start;
+  }
+
+  snprintf(label, sizeof(label), "wide %s (%d children)",
+           sorted ? "sorted" : "unsorted", children);
+  bench_report(label, rounds, elapsed);
+}
+
+static void bench_exclusive_time_deep(int depth, int rounds) {
+  char label[64];
+  nrtime_t start;
+  nrtime_t elapsed = 0;
+  int round;
+  int i;
+
+  for (round = 0; round < rounds; round++) {
+    start = nr_get_time();
+    for (i = 0; i < depth; i++) {
+      nr_exclusive_time_t* et
+          = nr_exclusive_time_create(1, (nrtime_t)i, (nrtime_t)(2 * depth - i));
+
+      nr_exclusive_time_add_child(et, (nrtime_t)i + 1,
+                                  (nrtime_t)(2 * depth - i - 1));
+      nr_exclusive_time_calculate(et);
+      nr_exclusive_time_destroy(&et);
+    }
+    elapsed += nr_get_time() - start;
+  }
+
+  snprintf(label, sizeof(label), "deep (%d segments)", depth);
+  bench_report(label, rounds, elapsed);
+}
+
+int main(void) {
+  bench_exclusive_time_wide(10, 100000, true);
+  bench_exclusive_time_wide(10, 100000, false);
+  bench_exclusive_time_wide(1000, 2000, true);
+  bench_exclusive_time_wide(1000, 2000, false);
+  bench_exclusive_time_wide(100000, 10, true);
+  bench_exclusive_time_wide(100000, 10, false);
+  bench_exclusive_time_deep(10000, 200);
+
+  return 0;
+}
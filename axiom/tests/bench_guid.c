@@ -0,0 +1,63 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Microbenchmark for GUID creation: one GUID drawn digit by digit from the
+ * random number generator, as for transaction ids, against a stream of span
+ * ids from a GUID generator.
+ */
+
+#include "nr_axiom.h"
+
+#include "nr_guid.h"
+#include "util_memory.h"
+#include "util_random.h"
+#include "util_time.h"
+
+#include "bench.h"
+
+#define BENCH_GUID_ITERATIONS 1000000
+
+static void bench_guid_create(void) {
+  nr_random_t* rnd = nr_random_create_from_seed(345345);
+  nrtime_t start;
+  int i;
+
+  start = nr_get_time();
+  for (i = 0; i < BENCH_GUID_ITERATIONS; i++) {
+    char* guid = nr_guid_create(rnd);
+
+    nr_free(guid);
+  }
+  bench_report("nr_guid_create", BENCH_GUID_ITERATIONS,
+               nr_get_time() - start);
+
+  nr_random_destroy(&rnd);
+}
+
+static void bench_guid_generator_create(void) {
+  nr_random_t* rnd = nr_random_create_from_seed(345345);
+  nr_guid_generator_t gen = {0};
+  nrtime_t start;
+  int i;
+
+  start = nr_get_time();
+  for (i = 0; i < BENCH_GUID_ITERATIONS; i++) {
+    char* guid = nr_guid_generator_create(&gen, rnd);
+
+    nr_free(guid);
+  }
+  bench_report("nr_guid_generator_create", BENCH_GUID_ITERATIONS,
+               nr_get_time() - start);
+
+  nr_random_destroy(&rnd);
+}
+
+int main(void) {
+  bench_guid_create();
+  bench_guid_generator_create();
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Microbenchmark for JSON string escaping, using payloads that resemble the
+ * SQL, log messages, URLs and backtraces sent by the agent.
+ */
+
+#include "nr_axiom.h"
+
+#include <stdio.h>
+
+#include "util_buffer.h"
+#include "util_memory.h"
+#include "util_strings.h"
+#include "util_time.h"
+
+#include "bench.h"
+
+#define BENCH_JSON_ITERATIONS 200000
+
+static void bench_json_escape(const char* name, const char* payload) {
+  nrbuf_t* buf = nr_buffer_create(4096, 4096);
+  char label[64];
+  nrtime_t start;
+  nrtime_t elapsed;
+  int i;
+
+  start = nr_get_time();
+  for (i = 0; i < BENCH_JSON_ITERATIONS; i++) {
+    nr_buffer_reset(buf);
+    nr_buffer_add_escape_json(buf, payload);
+  }
+  elapsed = nr_get_time() - start;
+
+  snprintf(label, sizeof(label), "escape %s (%d bytes)", name,
+           nr_strlen(payload));
+  bench_report(label, BENCH_JSON_ITERATIONS, elapsed);
+
+  nr_buffer_destroy(&buf);
+}
+
+int main(void) {
+  char* long_log = nr_zalloc(8193);
+  int i;
+
+  for (i = 0; i < 8192; i++) {
+    long_log[i] = "lorem ipsum dolor sit amet, consectetur "[i % 40];
+  }
+
+  bench_json_escape("short", "WP_Hook::apply_filters");
+  bench_json_escape(
+      "sql",
+      "SELECT option_name, option_value FROM wp_options WHERE autoload = ? "
+      "AND option_name NOT IN (SELECT meta_key FROM wp_postmeta WHERE "
+      "post_id = ?) ORDER BY option_id LIMIT ?");
+  bench_json_escape(
+      "log",
+      "User 1234 logged in successfully from the admin dashboard; session "
+      "started and preferences loaded in 12 ms");
+  bench_json_escape("url",
+                    "https://api.example.com/v2/customers/12345/orders?"
+                    "status=open&page=2&per_page=50");
+  bench_json_escape(
+      "backtrace",
+      "in WP_Hook::apply_filters called at "
+      "/var/www/html/wp-includes/class-wp-hook.php (308)\n"
+      "in WP_Hook::do_action called at "
+      "/var/www/html/wp-includes/plugin.php (517)");
+  bench_json_escape("utf-8", "Caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9"
+                             " \xe2\x82\xac 12 \xf0\x9f\x98\x80");
+  bench_json_escape("long log", long_log);
+
+  nr_free(long_log);
+
+  return 0;
+}
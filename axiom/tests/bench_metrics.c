@@ -0,0 +1,84 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Microbenchmark for metric table insertion and lookup. The cost per
+ * operation should remain flat as the number of metrics in the table grows.
+ */
+
+#include "nr_axiom.h"
+
+#include <stdio.h>
+
+#include "util_memory.h"
+#include "util_metrics.h"
+#include "util_strings.h"
+#include "util_time.h"
+
+#include "bench.h"
+
+#define BENCH_METRICS_ROUNDS 50
+
+static char** bench_metrics_names(int count) {
+  char** names = (char**)nr_calloc(count, sizeof(char*));
+  int i;
+
+  /*
+   * Mimic the scoped and unscoped names that a CMS transaction produces.
+   */
+  for (i = 0; i < count; i++) {
+    names[i] = nr_formatf("Function/WP_Hook::apply_filters/hook_%d", i);
+  }
+
+  return names;
+}
+
+static void bench_metrics_run(int count) {
+  char** names = bench_metrics_names(count);
+  char label[64];
+  nrtime_t insert_time = 0;
+  nrtime_t find_time = 0;
+  nrtime_t start;
+  int round;
+  int i;
+
+  for (round = 0; round < BENCH_METRICS_ROUNDS; round++) {
+    nrmtable_t* table = nrm_table_create(count);
+
+    start = nr_get_time();
+    for (i = 0; i < count; i++) {
+      nrm_add(table, names[i], 1);
+    }
+    insert_time += nr_get_time() - start;
+
+    start = nr_get_time();
+    for (i = 0; i < count; i++) {
+      nrm_add(table, names[i], 1);
+    }
+    find_time += nr_get_time() - start;
+
+    nrm_table_destroy(&table);
+  }
+
+  snprintf(label, sizeof(label), "insert (%d metrics)", count);
+  bench_report(label, count * BENCH_METRICS_ROUNDS, insert_time);
+  snprintf(label, sizeof(label), "find and update (%d metrics)", count);
+  bench_report(label, count * BENCH_METRICS_ROUNDS, find_time);
+
+  for (i = 0; i < count; i++) {
+    nr_free(names[i]);
+  }
+  nr_free(names);
+}
+
+int main(void) {
+  bench_metrics_run(100);
+  bench_metrics_run(500);
+  bench_metrics_run(2000);
+  bench_metrics_run(5000);
+  bench_metrics_run(20000);
+
+  return 0;
+}
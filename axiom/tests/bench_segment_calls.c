@@ -0,0 +1,82 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Microbenchmark for the per-call cost of short, uninstrumented calls: a
+ * segment started and discarded for each call, against a pending frame that
+ * is pushed and popped without ever becoming a segment.
+ */
+
+#include "nr_axiom.h"
+
+#include "nr_segment.h"
+#include "nr_txn.h"
+#include "util_time.h"
+
+#include "bench.h"
+
+#define BENCH_SEGMENT_CALLS_ITERATIONS 200000
+#define BENCH_SEGMENT_CALLS_DEPTH 8
+
+static nrtxn_t* bench_segment_calls_txn(void) {
+  nrapp_t app = {.state = NR_APP_OK};
+  nrtxnopt_t opts = {0};
+
+  return nr_txn_begin(&app, &opts, NULL, NULL);
+}
+
+static void bench_segment_calls_start_discard(void) {
+  nrtxn_t* txn = bench_segment_calls_txn();
+  nr_segment_t* segments[BENCH_SEGMENT_CALLS_DEPTH];
+  nrtime_t start;
+  int i;
+  int depth;
+
+  start = nr_get_time();
+  for (i = 0; i < BENCH_SEGMENT_CALLS_ITERATIONS; i++) {
+    for (depth = 0; depth < BENCH_SEGMENT_CALLS_DEPTH; depth++) {
+      segments[depth] = nr_segment_start(txn, NULL, NULL);
+    }
+    for (depth = BENCH_SEGMENT_CALLS_DEPTH; depth > 0; depth--) {
+      nr_segment_discard(&segments[depth - 1]);
+    }
+  }
+  bench_report("segment start and discard",
+               BENCH_SEGMENT_CALLS_ITERATIONS * BENCH_SEGMENT_CALLS_DEPTH,
+               nr_get_time() - start);
+
+  nr_txn_destroy(&txn);
+}
+
+static void bench_segment_calls_pending_frames(void) {
+  nrtxn_t* txn = bench_segment_calls_txn();
+  int keys[BENCH_SEGMENT_CALLS_DEPTH];
+  nrtime_t start;
+  nrtime_t start_time;
+  int i;
+  int depth;
+
+  start = nr_get_time();
+  for (i = 0; i < BENCH_SEGMENT_CALLS_ITERATIONS; i++) {
+    for (depth = 0; depth < BENCH_SEGMENT_CALLS_DEPTH; depth++) {
+      nr_txn_pending_frame_push(txn, &keys[depth]);
+    }
+    for (depth = BENCH_SEGMENT_CALLS_DEPTH; depth > 0; depth--) {
+      nr_txn_pending_frame_pop(txn, &keys[depth - 1], &start_time);
+    }
+  }
+  bench_report("pending frame push and pop",
+               BENCH_SEGMENT_CALLS_ITERATIONS * BENCH_SEGMENT_CALLS_DEPTH,
+               nr_get_time() - start);
+
+  nr_txn_destroy(&txn);
+}
+
+int main(void) {
+  bench_segment_calls_start_discard();
+  bench_segment_calls_pending_frames();
+
+  return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Microbenchmark for segment tree finalisation: selecting the segments for
+ * the trace and span events, calculating exclusive time, and generating the
+ * trace JSON and span events for large synthetic transactions. The plain
+ * traversal of the tree that finalisation is built on is measured too, as is
+ * building trees of different fan outs, which exercises the children arrays.
+ */
+
+#include "nr_axiom.h"
+
+#include <stdio.h>
+
+#include "nr_limits.h"
+#include "nr_segment_private.h"
+#include "nr_segment_traces.h"
+#include "nr_segment_tree.h"
+#include "nr_txn.h"
+#include "util_memory.h"
+#include "util_random.h"
+#include "util_strings.h"
+#include "util_time.h"
+
+#include "bench.h"
+
+/*
+ * Build a transaction with a tree of the given number of segments. Most
+ * segments are children of a recent segment, which gives a mix of deep
+ * call chains and wide loops, as a CMS transaction would.
+ */
+static nrtxn_t* bench_segment_tree_txn(int count) {
+  nrtxn_t* txn = (nrtxn_t*)nr_zalloc(sizeof(nrtxn_t));
+  nr_segment_t** segments
+      = (nr_segment_t**)nr_calloc(count, sizeof(nr_segment_t*));
+  nr_random_t* rnd = nr_random_create_from_seed(count);
+  int i;
+
+  txn->abs_start_time = 1000;
+  txn->distributed_trace = nr_distributed_trace_create();
+  nr_distributed_trace_set_sampled(txn->distributed_trace, true);
+  txn->options.distributed_tracing_enabled = true;
+  txn->options.span_events_enabled = true;
+  txn->options.tt_threshold = 0;
+  txn->app_limits.span_events = NR_DEFAULT_SPAN_EVENTS_MAX_SAMPLES_STORED;
+  txn->rnd = nr_random_create_from_seed(count);
+  txn->segment_slab = nr_slab_create(sizeof(nr_segment_t), 0);
+  txn->trace_strings = nr_string_pool_create();
+  txn->scoped_metrics = nrm_table_create(0);
+  txn->unscoped_metrics = nrm_table_create(0);
+
+  for (i = 0; i < count; i++) {
+    char name[64];
+    nr_segment_t* segment = nr_slab_next(txn->segment_slab);
+
+    snprintf(name, sizeof(name), "Function/WP_Hook::apply_filters/hook_%d",
+             (int)nr_random_range(rnd, 200));
+    segment->name = nr_string_add(txn->trace_strings, name);
+    segment->txn = txn;
+    segment->type = NR_SEGMENT_CUSTOM;
+    nr_segment_children_init(&segment->children);
+
+    if (0 == i) {
+      segment->start_time = 0;
+      segment->stop_time = (nrtime_t)count * 100;
+      nr_segment_set_priority_flag(segment, NR_SEGMENT_PRIORITY_ROOT);
+    } else {
+      int parent = i - 1 - (int)nr_random_range(rnd, i < 8 ? i : 8);
+
+      segment->start_time = (nrtime_t)i * 50;
+      segment->stop_time
+          = segment->start_time + 1 + nr_random_range(rnd, 1000);
+      nr_segment_add_child(segments[parent], segment);
+    }
+
+    segments[i] = segment;
+  }
+
+  txn->segment_root = segments[0];
+  txn->segment_count = count;
+
+  nr_random_destroy(&rnd);
+  nr_free(segments);
+
+  return txn;
+}
+
+static void bench_segment_tree_txn_destroy(nrtxn_t** txn_ptr) {
+  nrtxn_t* txn = *txn_ptr;
+
+  nr_segment_destroy_tree(txn->segment_root);
+  nr_segment_children_pool_destroy_fields(&txn->segment_children_pool);
+  nr_slab_destroy(&txn->segment_slab);
+  nr_string_pool_destroy(&txn->trace_strings);
+  nrm_table_destroy(&txn->scoped_metrics);
+  nrm_table_destroy(&txn->unscoped_metrics);
+  nr_distributed_trace_destroy(&txn->distributed_trace);
+  nr_random_destroy(&txn->rnd);
+  nr_realfree((void**)txn_ptr);
+}
+
+static nr_segment_iter_return_t bench_segment_tree_visit(nr_segment_t* segment,
+                                                         void* userdata) {
+  nrtime_t* total = (nrtime_t*)userdata;
+
+  if (segment->priority >= 0 && segment->stop_time > segment->start_time) {
+    *total += segment->stop_time - segment->start_time;
+  }
+
+  return NR_SEGMENT_NO_POST_ITERATION_CALLBACK;
+}
+
+static void bench_segment_tree_traverse(int count, int rounds) {
+  nrtxn_t* txn = bench_segment_tree_txn(count);
+  char label[64];
+  nrtime_t start;
+  nrtime_t elapsed = 0;
+  nrtime_t total = 0;
+  int round;
+
+  for (round = 0; round < rounds; round++) {
+    start = nr_get_time();
+    nr_segment_iterate(txn->segment_root, bench_segment_tree_visit, &total);
+    elapsed += nr_get_time() - start;
+  }
+
+  snprintf(label, sizeof(label), "traverse (%d segments)", count);
+  bench_report(label, rounds, elapsed);
+
+  bench_segment_tree_txn_destroy(&txn);
+}
+
+/*
+ * Link the given number of segments into a tree where each segment has the
+ * given number of children, then release the children arrays again.
+ */
+static void bench_segment_tree_build(int count, int fanout, int rounds) {
+  nrtxn_t* txn = (nrtxn_t*)nr_zalloc(sizeof(nrtxn_t));
+  nr_segment_t** segments
+      = (nr_segment_t**)nr_calloc(count, sizeof(nr_segment_t*));
+  char label[64];
+  nrtime_t start;
+  nrtime_t elapsed = 0;
+  int round;
+  int i;
+
+  txn->segment_slab = nr_slab_create(sizeof(nr_segment_t), 0);
+  for (i = 0; i < count; i++) {
+    segments[i] = nr_slab_next(txn->segment_slab);
+    segments[i]->txn = txn;
+    nr_segment_children_init(&segments[i]->children);
+  }
+
+  for (round = 0; round < rounds; round++) {
+    start = nr_get_time();
+    for (i = 1; i < count; i++) {
+      nr_segment_add_child(segments[(i - 1) / fanout], segments[i]);
+    }
+    for (i = 0; i < count; i++) {
+      nr_segment_children_deinit(&segments[i]->children);
+      segments[i]->parent = NULL;
+    }
+    elapsed += nr_get_time() - start;
+  }
+
+  snprintf(label, sizeof(label), "build (%d segments, fan out %d)", count,
+           fanout);
+  bench_report(label, rounds, elapsed);
+
+  nr_segment_children_pool_destroy_fields(&txn->segment_children_pool);
+  nr_slab_destroy(&txn->segment_slab);
+  nr_free(segments);
+  nr_free(txn);
+}
+
+static void bench_segment_tree_finalise(int count, int rounds) {
+  nrtxn_t* txn = bench_segment_tree_txn(count);
+  char label[64];
+  nrtime_t start;
+  nrtime_t elapsed = 0;
+  int round;
+
+  for (round = 0; round < rounds; round++) {
+    nrtxnfinal_t result;
+
+    start = nr_get_time();
+    result = nr_segment_tree_finalise(txn, NR_MAX_SEGMENTS,
+                                      NR_DEFAULT_SPAN_EVENTS_MAX_SAMPLES_STORED,
+                                      NULL, NULL);
+    elapsed += nr_get_time() - start;
+
+    nr_txn_final_destroy_fields(&result);
+  }
+
+  snprintf(label, sizeof(label), "finalise (%d segments)", count);
+  bench_report(label, rounds, elapsed);
+
+  bench_segment_tree_txn_destroy(&txn);
+}
+
+int main(void) {
+  bench_segment_tree_traverse(1000, 2000);
+  bench_segment_tree_traverse(10000, 200);
+  bench_segment_tree_traverse(100000, 20);
+
+  bench_segment_tree_build(10000, 4, 200);
+  bench_segment_tree_build(10000, 16, 200);
+  bench_segment_tree_build(10000, 64, 200);
+  bench_segment_tree_build(10000, 1000, 200);
+
+  bench_segment_tree_finalise(1000, 200);
+  bench_segment_tree_finalise(10000, 50);
+  bench_segment_tree_finalise(100000, 10);
+
+  return 0;
+}
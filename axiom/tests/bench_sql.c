@@ -0,0 +1,91 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Microbenchmark for SQL obfuscation, using statements shaped like those
+ * generated by ORMs: short lookups and multi-row INSERT statements.
+ */
+
+#include "nr_axiom.h"
+
+#include <stdio.h>
+
+#include "util_buffer.h"
+#include "util_memory.h"
+#include "util_sql.h"
+#include "util_strings.h"
+#include "util_time.h"
+
+#include "bench.h"
+
+static void bench_sql_obfuscate(const char* name,
+                                const char* sql,
+                                int iterations) {
+  char label[64];
+  nrtime_t start;
+  nrtime_t elapsed;
+  int i;
+
+  start = nr_get_time();
+  for (i = 0; i < iterations; i++) {
+    char* obf = nr_sql_obfuscate(sql);
+
+    nr_free(obf);
+  }
+  elapsed = nr_get_time() - start;
+
+  snprintf(label, sizeof(label), "obfuscate %s (%d bytes)", name,
+           nr_strlen(sql));
+  bench_report(label, iterations, elapsed);
+}
+
+static char* bench_sql_insert(int rows) {
+  nrbuf_t* buf = nr_buffer_create(0, 0);
+  char* sql;
+  int i;
+
+  nr_buffer_add(buf, NR_PSTR("INSERT INTO `wp_postmeta` (`post_id`, "
+                             "`meta_key`, `meta_value`) VALUES "));
+  for (i = 0; i < rows; i++) {
+    char* row = nr_formatf(
+        "%s(%d, '_wp_attachment_metadata', 'a:5:{s:5:\"width\";i:%d;"
+        "s:6:\"height\";i:%d;s:4:\"file\";s:26:\"2023/10/image-%d.jpg\";}')",
+        i ? ", " : "", 1000 + i, 640 + i, 480 + i, i);
+
+    nr_buffer_add(buf, row, nr_strlen(row));
+    nr_free(row);
+  }
+  nr_buffer_add(buf, NR_PSTR("\0"));
+
+  sql = nr_strdup((const char*)nr_buffer_cptr(buf));
+  nr_buffer_destroy(&buf);
+
+  return sql;
+}
+
+int main(void) {
+  char* insert_small = bench_sql_insert(10);
+  char* insert_large = bench_sql_insert(200);
+
+  bench_sql_obfuscate(
+      "select",
+      "SELECT wp_posts.ID FROM wp_posts WHERE 1=1 AND wp_posts.post_type = "
+      "'post' AND ((wp_posts.post_status = 'publish')) ORDER BY "
+      "wp_posts.post_date DESC LIMIT 0, 10",
+      200000);
+  bench_sql_obfuscate(
+      "select with comment",
+      "/* app:checkout controller:cart */ SELECT `carts`.* FROM `carts` "
+      "WHERE `carts`.`user_id` = 42 AND `carts`.`state` = \"open\" -- hint\n"
+      "LIMIT 1",
+      200000);
+  bench_sql_obfuscate("insert (10 rows)", insert_small, 20000);
+  bench_sql_obfuscate("insert (200 rows)", insert_large, 2000);
+
+  nr_free(insert_small);
+  nr_free(insert_large);
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nr_axiom.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "util_arena.h"
+#include "util_arena_private.h"
+#include "util_metrics.h"
+#include "util_string_pool.h"
+
+#include "tlib_main.h"
+
+static void test_create_destroy(void) {
+  nr_arena_t* arena = NULL;
+
+  /*
+   * Test : Bad parameters.
+   */
+  nr_arena_destroy(NULL);
+  nr_arena_destroy(&arena);
+  tlib_pass_if_null("NULL arena alloc", nr_arena_alloc(NULL, 16));
+  tlib_pass_if_null("NULL arena strdup", nr_arena_strdup(NULL, "foo"));
+  tlib_pass_if_size_t_equal("NULL arena used", 0, nr_arena_used(NULL));
+  tlib_pass_if_size_t_equal("NULL arena chunks", 0,
+                            nr_arena_chunk_count(NULL));
+
+  /*
+   * Test : Normal operation.
+   */
+  arena = nr_arena_create(0);
+  tlib_pass_if_not_null("arena created", arena);
+  tlib_pass_if_size_t_equal("default chunk size", NR_ARENA_DEFAULT_CHUNK_SIZE,
+                            arena->chunk_size);
+  tlib_pass_if_null("chunks are lazily allocated", arena->head);
+  tlib_pass_if_null("zero sized alloc", nr_arena_alloc(arena, 0));
+
+  nr_arena_destroy(&arena);
+  tlib_pass_if_null("the arena pointer must be NULLed when destroyed", arena);
+}
+
+static void test_alloc(void) {
+  int i;
+  char* ptr;
+  nr_arena_t* arena = nr_arena_create(1024);
+
+  /*
+   * Test : Allocations are aligned and zeroed.
+   */
+  for (i = 1; i < 100; i++) {
+    ptr = (char*)nr_arena_alloc(arena, (size_t)i);
+    tlib_pass_if_not_null("alloc succeeds", ptr);
+    tlib_pass_if_true("alloc is aligned", 0 == ((uintptr_t)ptr & 15), "ptr=%p",
+                      ptr);
+    tlib_pass_if_char_equal("alloc is zeroed", '\0', ptr[i - 1]);
+    nr_memset(ptr, 'x', (size_t)i);
+  }
+
+  tlib_pass_if_true("allocations use multiple chunks",
+                    nr_arena_chunk_count(arena) > 1, "chunks=%zu",
+                    nr_arena_chunk_count(arena));
+
+  nr_arena_destroy(&arena);
+}
+
+static void test_alloc_oversized(void) {
+  char* small;
+  char* large;
+  char* after;
+  nr_arena_t* arena = nr_arena_create(1024);
+
+  small = (char*)nr_arena_alloc(arena, 16);
+  tlib_pass_if_size_t_equal("one chunk", 1, nr_arena_chunk_count(arena));
+
+  /*
+   * Test : An oversized allocation gets its own chunk, but doesn't replace
+   *        the current chunk.
+   */
+  large = (char*)nr_arena_alloc(arena, 4096);
+  tlib_pass_if_not_null("oversized alloc succeeds", large);
+  tlib_pass_if_size_t_equal("two chunks", 2, nr_arena_chunk_count(arena));
+  nr_memset(large, 'x', 4096);
+
+  after = (char*)nr_arena_alloc(arena, 16);
+  tlib_pass_if_ptr_equal("head chunk is still used", small + 16, after);
+  tlib_pass_if_size_t_equal("still two chunks", 2,
+                            nr_arena_chunk_count(arena));
+  tlib_pass_if_size_t_equal("bytes used", 4096 + 32, nr_arena_used(arena));
+
+  nr_arena_destroy(&arena);
+}
+
+static void test_strdup(void) {
+  nr_arena_t* arena = nr_arena_create(0);
+
+  tlib_pass_if_null("NULL string", nr_arena_strdup(arena, NULL));
+  tlib_pass_if_null("NULL string", nr_arena_strndup(arena, NULL, 3));
+  tlib_pass_if_str_equal("empty string", "", nr_arena_strdup(arena, ""));
+  tlib_pass_if_str_equal("string", "foo bar", nr_arena_strdup(arena, "foo bar"));
+  tlib_pass_if_str_equal("truncated string", "foo",
+                         nr_arena_strndup(arena, "foo bar", 3));
+  tlib_pass_if_str_equal("short string", "foo",
+                         nr_arena_strndup(arena, "foo", 100));
+
+  nr_arena_destroy(&arena);
+}
+
+static void test_string_pool(void) {
+  int i;
+  int idx;
+  nr_arena_t* arena = nr_arena_create(0);
+  nrpool_t* pool = nr_string_pool_create_with_arena(arena);
+
+  for (i = 0; i < 1000; i++) {
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "string %d", i);
+    idx = nr_string_add(pool, buf);
+    tlib_pass_if_int_equal("pooled string index", i + 1, idx);
+  }
+
+  for (i = 0; i < 1000; i++) {
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "string %d", i);
+    tlib_pass_if_int_equal("pooled string found", i + 1,
+                           nr_string_find(pool, buf));
+    tlib_pass_if_str_equal("pooled string value", buf,
+                           nr_string_get(pool, i + 1));
+  }
+
+  tlib_pass_if_true("strings are stored in the arena",
+                    nr_arena_used(arena) >= 1000 * 8, "used=%zu",
+                    nr_arena_used(arena));
+
+  /*
+   * The pool can be destroyed before the arena.
+   */
+  nr_string_pool_destroy(&pool);
+  nr_arena_destroy(&arena);
+}
+
+static void test_metric_table(void) {
+  nr_arena_t* arena = nr_arena_create(0);
+  nrmtable_t* table = nrm_table_create_with_arena(0, arena);
+
+  nrm_add(table, "Foo/bar", 1);
+  nrm_add(table, "Foo/baz", 2);
+  nrm_add(table, "Foo/bar", 3);
+
+  tlib_pass_if_int_equal("metric table size", 2, nrm_table_size(table));
+  tlib_pass_if_str_equal("metric name", "Foo/bar",
+                         nrm_get_name(table, nrm_find(table, "Foo/bar")));
+  tlib_pass_if_time_equal("metric total", 4,
+                          nrm_total(nrm_find(table, "Foo/bar")));
+  tlib_pass_if_true("metric names are stored in the arena",
+                    nr_arena_used(arena) > 0, "used=%zu",
+                    nr_arena_used(arena));
+
+  nrm_table_destroy(&table);
+  nr_arena_destroy(&arena);
+}
+
+tlib_parallel_info_t parallel_info = {.suggested_nthreads = 2, .state_size = 0};
+
+void test_main(void* p NRUNUSED) {
+  test_create_destroy();
+  test_alloc();
+  test_alloc_oversized();
+  test_strdup();
+  test_string_pool();
+  test_metric_table();
+}
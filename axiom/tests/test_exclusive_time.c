@@ -8,6 +8,7 @@
 #include "nr_exclusive_time.h"
 #include "nr_exclusive_time_private.h"
 #include "util_memory.h"
+#include "util_random.h"
 #include "util_time.h"
 
 #include "tlib_main.h"
@@ -463,6 +464,68 @@ static void test_calculate(void) {
   nr_exclusive_time_destroy(&et);
 }
 
+static void test_calculate_sorted(void) {
+  nr_random_t* rnd = nr_random_create_from_seed(12345);
+  nrtime_t starts[16];
+  nrtime_t stops[16];
+  int round;
+  int i;
+
+  /*
+   * Test : Children that are added in start order are merged without sorting
+   *        the transitions, and give the same exclusive time as children added
+   *        in any other order.
+   */
+  for (round = 0; round < 200; round++) {
+    nr_exclusive_time_t* sorted = nr_exclusive_time_create(16, 100, 900);
+    nr_exclusive_time_t* unsorted = nr_exclusive_time_create(16, 100, 900);
+    nrtime_t start = 0;
+
+    for (i = 0; i < 16; i++) {
+      start += nr_random_range(rnd, 80);
+      starts[i] = start;
+      stops[i] = start + nr_random_range(rnd, 200);
+      nr_exclusive_time_add_child(sorted, starts[i], stops[i]);
+    }
+
+    for (i = 15; i >= 0; i--) {
+      nr_exclusive_time_add_child(unsorted, starts[i], stops[i]);
+    }
+
+    tlib_pass_if_true("children in start order", sorted->children_sorted,
+                      "round=%d", round);
+    tlib_pass_if_time_equal("sorted and unsorted children",
+                            nr_exclusive_time_calculate(unsorted),
+                            nr_exclusive_time_calculate(sorted));
+
+    nr_exclusive_time_destroy(&sorted);
+    nr_exclusive_time_destroy(&unsorted);
+  }
+
+  /*
+   * Test : Children that are added out of start order are sorted.
+   *
+   * time ->   10        20        30        40        50
+   *           Parent---------------------------------->
+   *                               Child----->
+   *                     Child------------------->
+   */
+  {
+    nr_exclusive_time_t* et = nr_exclusive_time_create(10, 10, 50);
+
+    nr_exclusive_time_add_child(et, 30, 40);
+    tlib_pass_if_true("single child", et->children_sorted, "expected true");
+    nr_exclusive_time_add_child(et, 20, 45);
+    tlib_pass_if_false("out of order", et->children_sorted, "expected false");
+    tlib_pass_if_time_equal("out of order", 15,
+                            nr_exclusive_time_calculate(et));
+
+    nr_exclusive_time_destroy(&et);
+  }
+
+  nr_random_destroy(&rnd);
+}
+
 static void test_compare(void) {
   nr_exclusive_time_transition_t a = {.time = 0, .type = CHILD_START};
   nr_exclusive_time_transition_t b = {.time = 0, .type = CHILD_START};
@@ -530,5 +593,6 @@ void test_main(void* p NRUNUSED) {
   test_ensure();
   test_add_child();
   test_calculate();
+  test_calculate_sorted();
   test_compare();
 }
@@ -6,7 +6,9 @@
 #include "nr_axiom.h"
 
 #include "nr_guid.h"
+#include "util_hashmap.h"
 #include "util_memory.h"
+#include "util_strings.h"
 
 #include "tlib_main.h"
 
@@ -31,8 +33,79 @@ static void test_create(void) {
   nr_random_destroy(&rnd);
 }
 
+static void test_generator_create(void) {
+  char* guid;
+  char* first;
+  nr_guid_generator_t gen = {0};
+  nr_guid_generator_t other = {0};
+  nr_random_t* rnd = nr_random_create();
+
+  guid = nr_guid_generator_create(NULL, rnd);
+  tlib_pass_if_null("NULL generator", guid);
+
+  guid = nr_guid_generator_create(&gen, NULL);
+  tlib_pass_if_str_equal("NULL random", guid, "0000000000000000");
+  tlib_pass_if_false("NULL random does not seed", gen.seeded,
+                     "seeded=%d", (int)gen.seeded);
+  nr_free(guid);
+
+  /*
+   * Generators seeded from the same random state create the same ids.
+   */
+  nr_random_seed(rnd, 345345);
+  first = nr_guid_generator_create(&gen, rnd);
+  tlib_pass_if_size_t_equal("guid length", NR_GUID_SIZE, nr_strlen(first));
+  tlib_pass_if_int_equal("guid is hex", NR_GUID_SIZE,
+                         nr_strspn(first, "0123456789abcdef"));
+
+  nr_random_seed(rnd, 345345);
+  guid = nr_guid_generator_create(&other, rnd);
+  tlib_pass_if_str_equal("seeded guid creation", first, guid);
+  nr_free(guid);
+
+  /*
+   * Once seeded, the random number generator is not used again.
+   */
+  guid = nr_guid_generator_create(&gen, NULL);
+  tlib_fail_if_null("repeat guid creation", guid);
+  tlib_pass_if_true("repeat guid creation", 0 != nr_strcmp(first, guid),
+                    "first=%s guid=%s", first, guid);
+  nr_free(guid);
+
+  nr_free(first);
+  nr_random_destroy(&rnd);
+}
+
+static void test_generator_unique(void) {
+  int i;
+  char* guid;
+  nr_guid_generator_t gen = {0};
+  nr_hashmap_t* seen = nr_hashmap_create(NULL);
+  nr_random_t* rnd = nr_random_create();
+
+  nr_random_seed(rnd, 345345);
+
+  for (i = 0; i < 10000; i++) {
+    guid = nr_guid_generator_create(&gen, rnd);
+    if (nr_hashmap_has(seen, guid, NR_GUID_SIZE)) {
+      tlib_pass_if_true("guids are unique", false, "guid=%s i=%d", guid, i);
+      nr_free(guid);
+      break;
+    }
+    nr_hashmap_set(seen, guid, NR_GUID_SIZE, (void*)1);
+    nr_free(guid);
+  }
+  tlib_pass_if_size_t_equal("guids are unique", 10000,
+                            nr_hashmap_count(seen));
+
+  nr_hashmap_destroy(&seen);
+  nr_random_destroy(&rnd);
+}
+
 tlib_parallel_info_t parallel_info = {.suggested_nthreads = 2, .state_size = 0};
 
 void test_main(void* p NRUNUSED) {
   test_create();
+  test_generator_create();
+  test_generator_unique();
 }
@@ -76,6 +76,10 @@ bool nr_txn_should_create_span_events(const nrtxn_t* txn NRUNUSED) {
   return true;
 }
 
+size_t nr_txn_get_span_events_limit(const nrtxn_t* txn NRUNUSED) {
+  return 0;
+}
+
 nrtime_t nr_txn_unfinished_duration(const nrtxn_t* txn) {
   return ((const mock_txn*)txn)->unfinished_duration;
 }
@@ -92,7 +96,7 @@ char* nr_txn_create_w3c_traceparent_header(nrtxn_t* txn NRUNUSED,
   return nr_strdup("00-74be672b84ddc4e4b28be285632bbc0a-d6e4e06002e24189-01");
 }
 
-char* nr_txn_create_w3c_tracestate_header(const nrtxn_t* txn NRUNUSED,
+char* nr_txn_create_w3c_tracestate_header(nrtxn_t* txn NRUNUSED,
                                           nr_segment_t* segment NRUNUSED) {
   return nr_strdup(
       "190@nr=0-0-212311-51424-d6e4e06002e24189-27856f70d3d314b7-1-0.421-"
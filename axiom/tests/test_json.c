@@ -335,8 +335,63 @@ static void test_json_worker(void) {
   nr_free(dest);
 }
 
+/*
+ * Long strings are scanned several bytes at a time: make sure that characters
+ * needing escapes are found at every position within and across blocks.
+ */
+static void test_json_escape_positions(void) {
+  static const struct {
+    char raw;
+    const char* escaped;
+  } specials[] = {
+      {'"', "\\\""},     {'\\', "\\\\"},   {'/', "\\/"},
+      {'\n', "\\n"},      {'\x01', "\\u0001"}, {'\x1f', "\\u001f"},
+      {'\x7f', "\\u007f"}, {'\xff', "\\u00ff"},
+  };
+  char raw[64];
+  char expected[128];
+  char* dest = 0;
+  size_t i;
+  int pos;
+  int count;
+
+  for (i = 0; i < sizeof(specials) / sizeof(specials[0]); i++) {
+    for (pos = 0; pos < 40; pos++) {
+      int len = pos + 1 + (pos % 17);
+
+      nr_memset(raw, 'a', len);
+      raw[len] = '\0';
+      raw[pos] = specials[i].raw;
+
+      snprintf(expected, sizeof(expected), "\"%.*s%s%.*s\"", pos, raw,
+               specials[i].escaped, len - pos - 1, raw + pos + 1);
+
+      count = test_nr_json_escape(&dest, raw);
+      tlib_pass_if_true("escape position", 0 == nr_strcmp(expected, dest),
+                        "expected=%s dest=%s", expected, dest);
+      tlib_pass_if_int_equal("escape position length", nr_strlen(expected),
+                             count);
+      nr_free(dest);
+    }
+  }
+
+  /*
+   * Multi-byte UTF-8 sequences straddling a block boundary.
+   */
+  count = test_nr_json_escape(
+      &dest, "aaaaaaaaaaaaaaa\xc3\xa9"
+             "aaaaaaaaaaaaa\xf0\x9f\x98\x80"
+             "bb");
+  tlib_pass_if_str_equal(
+      "utf-8 across blocks",
+      "\"aaaaaaaaaaaaaaa\\u00e9aaaaaaaaaaaaa\\ud83d\\ude00bb\"", dest);
+  tlib_pass_if_int_equal("utf-8 across blocks", nr_strlen(dest), count);
+  nr_free(dest);
+}
+
 tlib_parallel_info_t parallel_info = {.suggested_nthreads = 4, .state_size = 0};
 
 void test_main(void* p NRUNUSED) {
   test_json_worker();
+  test_json_escape_positions();
 }
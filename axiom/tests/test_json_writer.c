@@ -0,0 +1,179 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nr_axiom.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util_json_writer.h"
+#include "util_memory.h"
+#include "util_strings.h"
+
+#include "tlib_main.h"
+
+#define test_buffer_json(...) \
+  test_buffer_json_fn(__VA_ARGS__, __FILE__, __LINE__)
+
+static void test_buffer_json_fn(const char* testname,
+                                nrbuf_t* buf,
+                                const char* expected,
+                                const char* file,
+                                int line) {
+  char* actual;
+
+  nr_buffer_add(buf, NR_PSTR("\0"));
+  actual = nr_strdup((const char*)nr_buffer_cptr(buf));
+  test_pass_if_true(testname, 0 == nr_strcmp(expected, actual),
+                    "expected=%s actual=%s", expected, actual);
+  nr_free(actual);
+  nr_buffer_reset(buf);
+}
+
+static void test_null_buffer(void) {
+  /*
+   * Don't crash.
+   */
+  nr_json_write_begin_object(NULL);
+  nr_json_write_key(NULL, "key");
+  nr_json_write_string(NULL, "value");
+  nr_json_write_int(NULL, 1);
+  nr_json_write_uint(NULL, 1);
+  nr_json_write_double(NULL, 1.0);
+  nr_json_write_bool(NULL, true);
+  nr_json_write_null(NULL);
+  nr_json_write_raw(NULL, "[]");
+  nr_json_write_object(NULL, NULL);
+  nr_json_write_object_members(NULL, NULL);
+  nr_json_write_end_object(NULL);
+}
+
+static void test_scalars(void) {
+  nrbuf_t* buf = nr_buffer_create(0, 0);
+
+  nr_json_write_begin_array(buf);
+  nr_json_write_int(buf, 0);
+  nr_json_write_int(buf, -42);
+  nr_json_write_int(buf, INT64_MAX);
+  nr_json_write_int(buf, INT64_MIN);
+  nr_json_write_uint(buf, UINT64_MAX);
+  nr_json_write_double(buf, 1.5);
+  nr_json_write_bool(buf, true);
+  nr_json_write_bool(buf, false);
+  nr_json_write_null(buf);
+  nr_json_write_end_array(buf);
+  test_buffer_json("scalars", buf,
+                   "[0,-42,9223372036854775807,-9223372036854775808,"
+                   "18446744073709551615,1.50000,true,false,null]");
+
+  nr_json_write_begin_array(buf);
+  nr_json_write_string(buf, "a\"b/c\n");
+  nr_json_write_string(buf, "");
+  nr_json_write_string(buf, NULL);
+  nr_json_write_raw(buf, "{\"x\":[1]}");
+  nr_json_write_raw(buf, NULL);
+  nr_json_write_raw(buf, "");
+  nr_json_write_end_array(buf);
+  test_buffer_json("strings", buf,
+                   "[\"a\\\"b\\/c\\n\",\"\",\"\",{\"x\":[1]},null,null]");
+
+  /*
+   * An empty raw value must not swallow the separator of the next member.
+   */
+  nr_json_write_begin_object(buf);
+  nr_json_write_key(buf, "a");
+  nr_json_write_raw(buf, "");
+  nr_json_write_key(buf, "b");
+  nr_json_write_int(buf, 1);
+  nr_json_write_end_object(buf);
+  test_buffer_json("empty raw value", buf, "{\"a\":null,\"b\":1}");
+
+  nr_buffer_destroy(&buf);
+}
+
+static void test_nesting(void) {
+  nrbuf_t* buf = nr_buffer_create(0, 0);
+
+  nr_json_write_begin_object(buf);
+  nr_json_write_end_object(buf);
+  test_buffer_json("empty object", buf, "{}");
+
+  nr_json_write_begin_array(buf);
+  nr_json_write_end_array(buf);
+  test_buffer_json("empty array", buf, "[]");
+
+  nr_json_write_begin_object(buf);
+  nr_json_write_key(buf, "a");
+  nr_json_write_begin_array(buf);
+  nr_json_write_begin_array(buf);
+  nr_json_write_end_array(buf);
+  nr_json_write_begin_object(buf);
+  nr_json_write_end_object(buf);
+  nr_json_write_int(buf, 1);
+  nr_json_write_end_array(buf);
+  nr_json_write_key(buf, "b\"");
+  nr_json_write_begin_object(buf);
+  nr_json_write_key(buf, "c");
+  nr_json_write_string(buf, "d");
+  nr_json_write_key(buf, NULL);
+  nr_json_write_null(buf);
+  nr_json_write_end_object(buf);
+  nr_json_write_end_object(buf);
+  test_buffer_json("nested", buf,
+                   "{\"a\":[[],{},1],\"b\\\"\":{\"c\":\"d\",\"\":null}}");
+
+  /*
+   * The writer continues JSON started by other means.
+   */
+  nr_buffer_add(buf, NR_PSTR("[1"));
+  nr_json_write_int(buf, 2);
+  nr_buffer_add(buf, NR_PSTR(","));
+  nr_json_write_int(buf, 3);
+  nr_json_write_end_array(buf);
+  test_buffer_json("continued", buf, "[1,2,3]");
+
+  nr_buffer_destroy(&buf);
+}
+
+static void test_objects(void) {
+  nrbuf_t* buf = nr_buffer_create(0, 0);
+  nrobj_t* hash = nro_create_from_json("{\"a\":1,\"b\":[true,\"x\"]}");
+  nrobj_t* empty = nro_new_hash();
+  nrobj_t* array = nro_create_from_json("[1,2]");
+
+  nr_json_write_begin_array(buf);
+  nr_json_write_object(buf, hash);
+  nr_json_write_object(buf, NULL);
+  nr_json_write_object(buf, empty);
+  nr_json_write_end_array(buf);
+  test_buffer_json("objects", buf, "[{\"a\":1,\"b\":[true,\"x\"]},null,{}]");
+
+  nr_json_write_begin_object(buf);
+  nr_json_write_object_members(buf, empty);
+  nr_json_write_object_members(buf, hash);
+  nr_json_write_object_members(buf, NULL);
+  nr_json_write_object_members(buf, array);
+  nr_json_write_key(buf, "c");
+  nr_json_write_int(buf, 3);
+  nr_json_write_object_members(buf, hash);
+  nr_json_write_end_object(buf);
+  test_buffer_json("object members", buf,
+                   "{\"a\":1,\"b\":[true,\"x\"],\"c\":3,"
+                   "\"a\":1,\"b\":[true,\"x\"]}");
+
+  nro_delete(hash);
+  nro_delete(empty);
+  nro_delete(array);
+  nr_buffer_destroy(&buf);
+}
+
+tlib_parallel_info_t parallel_info = {.suggested_nthreads = 4, .state_size = 0};
+
+void test_main(void* p NRUNUSED) {
+  test_null_buffer();
+  test_scalars();
+  test_nesting();
+  test_objects();
+}
@@ -206,6 +206,26 @@ static void test_log_event_to_json_buffer(void) {
                          "}"
                          "}",
                          nr_buffer_cptr(buf));
+  nr_buffer_reset(buf);
+  nr_log_event_destroy(&log);
+
+  /*
+   * Test : A log event appended to a buffer that already holds JSON is not
+   *        preceded by a comma.
+   */
+  log = nr_log_event_create();
+  nr_buffer_add(buf, NR_PSTR("{\"other\":1}"));
+  tlib_pass_if_bool_equal("appended log event", true,
+                          nr_log_event_to_json_buffer(log, buf));
+  nr_buffer_add(buf, NR_PSTR("\0"));
+  tlib_pass_if_str_equal("appended log event",
+                         "{\"other\":1}"
+                         "{"
+                         "\"message\":\"null\","
+                         "\"level\":\"null\","
+                         "\"timestamp\":0"
+                         "}",
+                         nr_buffer_cptr(buf));
   nr_log_event_destroy(&log);
 
   nr_buffer_destroy(&buf);
@@ -163,6 +163,71 @@ static void test_find_create(void) {
   nrm_table_destroy(&table);
 }
 
+static void test_find_create_growth(void) {
+  int i;
+  int limit = 5000;
+  nr_status_t rv;
+  nrmetric_t* metric;
+  nrmtable_t* table = nrm_table_create(10);
+
+  /*
+   * Force metrics well past both the initial metric allocation and the
+   * initial index size so that both have to grow.
+   */
+  for (i = 0; i < limit; i++) {
+    char name_buf[256];
+
+    snprintf(name_buf, sizeof(name_buf), "Custom/growth/%d", i);
+    nrm_force_add(table, name_buf, i);
+  }
+
+  tlib_pass_if_int_equal("all metrics created", limit, nrm_table_size(table));
+  rv = nrm_table_validate(table);
+  tlib_pass_if_status_success("table is valid after growth", rv);
+
+  for (i = 0; i < limit; i++) {
+    char name_buf[256];
+
+    snprintf(name_buf, sizeof(name_buf), "Custom/growth/%d", i);
+    metric = nrm_find(table, name_buf);
+    tlib_pass_if_not_null("metric found after growth", metric);
+    tlib_pass_if_str_equal("metric found after growth", name_buf,
+                           nrm_get_name(table, metric));
+    tlib_pass_if_time_equal("metric data kept after growth", (nrtime_t)i,
+                            nrm_total(metric));
+  }
+
+  tlib_pass_if_null("missing metric not found after growth",
+                    nrm_find(table, "Custom/growth/missing"));
+
+  nrm_table_destroy(&table);
+
+  /*
+   * Collisions on hashes that wrap around the end of the index.
+   */
+  table = nrm_table_create(0);
+  for (i = 0; i < 100; i++) {
+    char name_buf[256];
+
+    snprintf(name_buf, sizeof(name_buf), "wrap%d", i);
+    nrm_create(table, name_buf, 0xffffffff - (uint32_t)(i % 3));
+  }
+  rv = nrm_table_validate(table);
+  tlib_pass_if_status_success("table is valid after wrapping collisions", rv);
+  for (i = 0; i < 100; i++) {
+    char name_buf[256];
+
+    snprintf(name_buf, sizeof(name_buf), "wrap%d", i);
+    metric = nrm_find_internal(table, name_buf, 0xffffffff - (uint32_t)(i % 3));
+    tlib_pass_if_str_equal("wrapping collision found", name_buf,
+                           nrm_get_name(table, metric));
+  }
+  metric = nrm_find_internal(table, "wrap100", 0xffffffff - 1);
+  tlib_pass_if_null("wrapping collision miss", metric);
+
+  nrm_table_destroy(&table);
+}
+
 #define test_metric_attribute(T, V1, V2) \
   test_metric_attribute_fn((T), #V1, (V1), #V2, (V2), __FILE__, __LINE__)
 
@@ -678,6 +743,7 @@ void test_main(void* p NRUNUSED) {
   test_accessor_bad_parameters();
   test_find_internal_bad_parameters();
   test_find_create();
+  test_find_create_growth();
   test_add_ex();
   test_force_add_ex();
   test_add();
@@ -358,6 +358,120 @@ static void test_nro_iteratehash(void) {
   nro_delete(ob);
 }
 
+static void test_nro_large_hash(void) {
+  int i;
+  char key[64];
+  char* json;
+  nrobj_t* hash = nro_new_hash();
+  nrobj_t* copy;
+  nrobj_t* parsed;
+  nr_status_t err;
+  const char* first_key = NULL;
+  int expected;
+
+  /*
+   * Large enough for the key index to be created and grown several times.
+   */
+  for (i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    nro_set_hash_int(hash, key, i);
+  }
+  tlib_pass_if_int_equal("large hash size", 1000, nro_getsize(hash));
+
+  for (i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    tlib_pass_if_int_equal("large hash lookup", i,
+                           nro_get_hash_int(hash, key, &err));
+    tlib_pass_if_status_success("large hash lookup", err);
+  }
+  tlib_pass_if_null("large hash missing key",
+                    nro_get_hash_value(hash, "key1000", &err));
+  tlib_pass_if_status_success("large hash missing key", err);
+
+  /*
+   * Replacing values must not add keys or change their order.
+   */
+  for (i = 0; i < 1000; i += 2) {
+    snprintf(key, sizeof(key), "key%d", i);
+    nro_set_hash_int(hash, key, -i);
+  }
+  tlib_pass_if_int_equal("large hash size after replace", 1000,
+                         nro_getsize(hash));
+  tlib_pass_if_int_equal("large hash replaced value", -998,
+                         nro_get_hash_int(hash, "key998", &err));
+  tlib_pass_if_int_equal("large hash kept value", 999,
+                         nro_get_hash_int(hash, "key999", &err));
+  nro_get_hash_value_by_index(hash, 1, &err, &first_key);
+  tlib_pass_if_str_equal("large hash insertion order", "key0", first_key);
+
+  copy = nro_copy(hash);
+  for (i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    expected = (i & 1) ? i : -i;
+    tlib_pass_if_int_equal("large hash copy lookup", expected,
+                           nro_get_hash_int(copy, key, &err));
+  }
+  nro_set_hash_int(copy, "added", 42);
+  tlib_pass_if_int_equal("large hash copy add", 42,
+                         nro_get_hash_int(copy, "added", &err));
+  tlib_pass_if_null("large hash copy is independent",
+                    nro_get_hash_value(hash, "added", &err));
+
+  json = nro_to_json(hash);
+  tlib_pass_if_true("large hash json order",
+                    0 == nr_strncmp(json, NR_PSTR("{\"key0\":0,\"key1\":1,")),
+                    "json=%.40s", json);
+  parsed = nro_create_from_json(json);
+  for (i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    expected = (i & 1) ? i : -i;
+    tlib_pass_if_int_equal("large hash parsed lookup", expected,
+                           nro_get_hash_int(parsed, key, &err));
+  }
+
+  nr_free(json);
+  nro_delete(parsed);
+  nro_delete(copy);
+  nro_delete(hash);
+}
+
+static void test_nro_ref(void) {
+  nrobj_t* obj;
+  nrobj_t* ref1;
+  nrobj_t* ref2;
+  nr_status_t err;
+
+  tlib_pass_if_null("NULL object", nro_ref(NULL));
+
+  obj = nro_create_from_json("{\"a\":1,\"b\":[1,2,3]}");
+  ref1 = nro_ref(obj);
+  ref2 = nro_ref(obj);
+  tlib_pass_if_ptr_equal("ref returns the object", obj, ref1);
+  tlib_pass_if_ptr_equal("ref returns the object", obj, ref2);
+
+  nro_delete(obj);
+  tlib_pass_if_null("delete clears the pointer", obj);
+  tlib_pass_if_int_equal("referenced object survives delete", 1,
+                         nro_get_hash_int(ref1, "a", &err));
+
+  nro_delete(ref1);
+  tlib_pass_if_null("delete clears the pointer", ref1);
+  tlib_pass_if_int_equal("referenced object survives delete", 3,
+                         nro_getsize(nro_get_hash_array(ref2, "b", NULL)));
+
+  /* Deleting the last reference frees the object. */
+  nro_delete(ref2);
+  tlib_pass_if_null("delete clears the pointer", ref2);
+
+  /* A copy of a shared object is not shared. */
+  obj = nro_new_hash();
+  ref1 = nro_ref(obj);
+  ref2 = nro_copy(obj);
+  nro_delete(obj);
+  nro_delete(ref2);
+  nro_delete(ref1);
+}
+
 static void test_nro_hash_corner_cases(void) {
   nrobj_t* hash;
   nrobj_t* obj;
@@ -2709,6 +2823,8 @@ void test_main(void* vp NRUNUSED) {
   test_nro_getival();
   test_nro_iteratehash();
   test_nro_hash_corner_cases();
+  test_nro_large_hash();
+  test_nro_ref();
   test_nro_array_corner_cases();
   test_nro_hairy_object_json();
   test_nro_hairy_utf8_object_json();
@@ -8,12 +8,14 @@
 #include <stddef.h>
 #include <stdio.h>
 
+#include "nr_header.h"
 #include "nr_segment_private.h"
 #include "nr_segment.h"
 #include "nr_span_event.h"
 #include "nr_span_event_private.h"
 #include "test_segment_helpers.h"
 #include "util_memory.h"
+#include "util_set.h"
 #include "util_slab_private.h"
 
 #include "tlib_main.h"
@@ -1276,6 +1278,71 @@ static void test_segment_iterate_with_post_callback(void) {
   nr_segment_children_deinit(&grown_child_2.children);
 }
 
+#define NR_TEST_DEEP_TREE_DEPTH 200000
+typedef struct _nr_test_depth_t {
+  int pre_count;
+  int post_count;
+  bool in_order;
+} nr_test_depth_t;
+
+static void test_depth_post_callback(nr_segment_t* segment,
+                                     nr_test_depth_t* depth) {
+  /* The deepest segment is finished first. */
+  if (segment->name != NR_TEST_DEEP_TREE_DEPTH - 1 - depth->post_count) {
+    depth->in_order = false;
+  }
+  depth->post_count += 1;
+}
+
+static nr_segment_iter_return_t test_depth_callback(nr_segment_t* segment,
+                                                    nr_test_depth_t* depth) {
+  if (segment->name != depth->pre_count) {
+    depth->in_order = false;
+  }
+  depth->pre_count += 1;
+
+  return ((nr_segment_iter_return_t){
+      .post_callback = (nr_segment_post_iter_t)test_depth_post_callback,
+      .userdata = depth});
+}
+
+static void test_segment_iterate_deep(void) {
+  int i;
+  nr_test_depth_t depth = {.pre_count = 0, .post_count = 0, .in_order = true};
+  nr_segment_t* segments
+      = nr_calloc(NR_TEST_DEEP_TREE_DEPTH, sizeof(nr_segment_t));
+
+  /*
+   * Build a chain of segments, each the only child of the previous one,
+   * that is far deeper than a recursive traversal could handle. The chain is
+   * built from the bottom up, so that the parents have no ancestors to check
+   * for cycles.
+   */
+  for (i = NR_TEST_DEEP_TREE_DEPTH - 1; i >= 0; i--) {
+    segments[i].type = NR_SEGMENT_CUSTOM;
+    segments[i].name = i;
+    nr_segment_children_init(&segments[i].children);
+    if (i < NR_TEST_DEEP_TREE_DEPTH - 1) {
+      nr_segment_add_child(&segments[i], &segments[i + 1]);
+    }
+  }
+
+  nr_segment_iterate(&segments[0], (nr_segment_iter_t)test_depth_callback,
+                     &depth);
+
+  tlib_pass_if_int_equal("Every segment of a deep tree must be traversed",
+                         NR_TEST_DEEP_TREE_DEPTH, depth.pre_count);
+  tlib_pass_if_int_equal("Every segment of a deep tree must be post-traversed",
+                         NR_TEST_DEEP_TREE_DEPTH, depth.post_count);
+  tlib_pass_if_true("A deep tree must be traversed in order", depth.in_order,
+                    "in_order=%d", (int)depth.in_order);
+
+  for (i = 0; i < NR_TEST_DEEP_TREE_DEPTH; i++) {
+    nr_segment_children_deinit(&segments[i].children);
+  }
+  nr_free(segments);
+}
+
 static void test_segment_destroy(void) {
   nr_segment_t* bachelor_1 = nr_zalloc(sizeof(nr_segment_t));
   nr_segment_t* bachelor_2 = nr_zalloc(sizeof(nr_segment_t));
@@ -1730,7 +1797,399 @@ static void test_segment_discard_keep_metrics_while_running(void) {
   nr_txn_destroy(&txn);
 }
 
-static void test_segment_discard_keep_metrics_no_exclusive(void) {
+static const nr_span_event_t* test_find_span_event(nr_vector_t* events,
+                                                   const char* name) {
+  size_t i;
+
+  for (i = 0; i < nr_vector_size(events); i++) {
+    const nr_span_event_t* event = nr_vector_get(events, i);
+
+    if (0 == nr_strcmp(name, nr_span_event_get_name(event))) {
+      return event;
+    }
+  }
+
+  return NULL;
+}
+
+static void test_segment_release_completed(void) {
+  nrapp_t app = {
+      .state = NR_APP_OK,
+      .limits = {
+          .span_events = NR_DEFAULT_SPAN_EVENTS_MAX_SAMPLES_STORED,
+      },
+  };
+  nrtxnopt_t opts;
+  nrtxn_t* txn;
+  nr_segment_t* A;
+  nr_segment_t* B;
+  nr_segment_t* C;
+  nr_segment_t* D;
+  nr_segment_t* E;
+  nr_segment_t* F;
+  nr_segment_t* segment;
+  nr_vector_t* events;
+  char* b_id;
+  char* d_id;
+
+  nr_memset(&opts, 0, sizeof(opts));
+  opts.distributed_tracing_enabled = 1;
+  opts.span_events_enabled = 1;
+  opts.release_completed_segments = true;
+  txn = nr_txn_begin(&app, &opts, NULL, NULL);
+  nr_distributed_trace_set_sampled(txn->distributed_trace, true);
+
+  /*
+   * Test : Bad parameters.
+   */
+  tlib_pass_if_false("NULL segment", nr_segment_release_completed(NULL),
+                     "expected false");
+  tlib_pass_if_false("root segment",
+                     nr_segment_release_completed(txn->segment_root),
+                     "expected false");
+
+  /* Build a tree of segments with metrics
+   *
+   *                A
+   *               / \
+   *              B   F <- async
+   *             / \
+   *            C   D
+   *                 \
+   *                  E
+   */
+  A = txn->segment_root;
+  B = nr_segment_start(txn, A, NULL);
+  C = nr_segment_start(txn, B, NULL);
+  D = nr_segment_start(txn, B, NULL);
+  E = nr_segment_start(txn, D, NULL);
+  F = nr_segment_start(txn, A, "async");
+
+  nr_segment_set_name(B, "B");
+  nr_segment_set_name(C, "C");
+  nr_segment_set_name(D, "D");
+  nr_segment_set_name(E, "E");
+  nr_segment_set_name(F, "F");
+  nr_segment_add_metric(B, "b", true);
+  nr_segment_add_metric(C, "c", true);
+  nr_segment_add_metric(D, "d", true);
+  nr_segment_add_metric(E, "e", true);
+
+  nr_segment_set_timing(A, 0, 12000);
+  nr_segment_set_timing(B, 1000, 10000);
+  nr_segment_set_timing(C, 2000, 4000);
+  nr_segment_set_timing(D, 7000, 3000);
+  nr_segment_set_timing(E, 8000, 2000);
+  nr_segment_set_timing(F, 500, 200);
+
+  /*
+   * Test : A segment that has not ended is not released.
+   */
+  tlib_pass_if_false("segment has not ended", nr_segment_release_completed(E),
+                     "expected false");
+
+  /*
+   * Test : Ending a leaf releases it. It is removed from the tree, and its
+   *        duration is folded into the released time of its parent.
+   */
+  segment = E;
+  nr_segment_end(&segment);
+  tlib_pass_if_size_t_equal("leaf removed", 0,
+                            nr_segment_children_size(&D->children));
+  tlib_pass_if_time_equal("leaf folded", 2000, D->released_time);
+  tlib_pass_if_true("leaf span event",
+                    D->state & NR_SEGMENT_CHILD_SPAN_RELEASED, "state=%d",
+                    (int)D->state);
+  tlib_pass_if_size_t_equal("leaf not counted", 0, txn->segment_count);
+  tlib_pass_if_size_t_equal("leaf span event", 1,
+                            nr_vector_size(txn->released_span_events));
+  test_txn_metric_is("leaf metric", txn->scoped_metrics, 0, "e", 1, 2000,
+                     2000, 2000, 2000, 4000000);
+  d_id = nr_strdup(D->id);
+
+  /*
+   * Test : Ending a segment releases its subtree.
+   */
+  segment = C;
+  nr_segment_end(&segment);
+  segment = D;
+  nr_segment_end(&segment);
+  b_id = nr_strdup(B->id);
+  tlib_pass_if_size_t_equal("subtree released", 0,
+                            nr_segment_children_size(&B->children));
+  tlib_pass_if_time_equal("subtree folded", 4000 + 3000, B->released_time);
+  test_txn_metric_is("exclusive time", txn->scoped_metrics, 0, "d", 1, 3000,
+                     1000, 3000, 3000, 9000000);
+
+  segment = B;
+  nr_segment_end(&segment);
+  tlib_pass_if_size_t_equal("subtree released", 1,
+                            nr_segment_children_size(&A->children));
+  tlib_pass_if_time_equal("subtree folded", 10000, A->released_time);
+  tlib_pass_if_size_t_equal("segments released", 0, txn->segment_count);
+  tlib_pass_if_size_t_equal("span events", 4,
+                            nr_vector_size(txn->released_span_events));
+  tlib_pass_if_time_equal("total time", 10000, txn->released_total_time);
+  test_txn_metric_is("exclusive time", txn->scoped_metrics, 0, "b", 1, 10000,
+                     3000, 10000, 10000, 100000000);
+  test_txn_metric_is("exclusive time", txn->scoped_metrics, 0, "c", 1, 4000,
+                     4000, 4000, 4000, 16000000);
+
+  /*
+   * Test : Asynchronous segments are not released.
+   */
+  segment = F;
+  nr_segment_end(&segment);
+  tlib_pass_if_ptr_equal("async segment", F,
+                         nr_segment_children_get(&A->children, 0));
+  tlib_pass_if_size_t_equal("async segment", 1, txn->segment_count);
+
+  /*
+   * Test : The span events of released segments are added to the final span
+   *        events, and released segments still count towards the exclusive
+   *        time of their parent.
+   */
+  txn->status.path_is_frozen = 1;
+  nr_txn_end(txn);
+
+  events = txn->final_data.span_events;
+  tlib_pass_if_size_t_equal("final span events", 6, nr_vector_size(events));
+  tlib_pass_if_str_equal("released parent", d_id,
+                         nr_span_event_get_parent_id(
+                             test_find_span_event(events, "E")));
+  tlib_pass_if_str_equal("released parent", b_id,
+                         nr_span_event_get_parent_id(
+                             test_find_span_event(events, "D")));
+  tlib_pass_if_str_equal("root parent", A->id,
+                         nr_span_event_get_parent_id(
+                             test_find_span_event(events, "B")));
+  tlib_pass_if_time_equal("total time", 2000 + 10000 + 200,
+                          txn->final_data.total_time);
+  tlib_pass_if_size_t_equal("released span events moved", 0,
+                            nr_vector_size(txn->released_span_events));
+
+  nr_free(b_id);
+  nr_free(d_id);
+  nr_txn_destroy(&txn);
+}
+
+static void test_segment_release_completed_span_limit(void) {
+  nrapp_t app = {
+      .state = NR_APP_OK,
+      .limits = {
+          .span_events = NR_DEFAULT_SPAN_EVENTS_MAX_SAMPLES_STORED,
+      },
+  };
+  nrtxnopt_t opts;
+  nrtxn_t* txn;
+  nr_segment_t* parent;
+  nr_segment_t* children[3];
+  nr_segment_t* segment;
+  int i;
+
+  nr_memset(&opts, 0, sizeof(opts));
+  opts.distributed_tracing_enabled = 1;
+  opts.span_events_enabled = 1;
+  opts.span_events_max_samples_stored = 3;
+  opts.release_completed_segments = true;
+  txn = nr_txn_begin(&app, &opts, NULL, NULL);
+  nr_distributed_trace_set_sampled(txn->distributed_trace, true);
+
+  nr_segment_set_timing(txn->segment_root, 0, 10000);
+  parent = nr_segment_start(txn, txn->segment_root, NULL);
+  nr_segment_set_timing(parent, 1000, 8000);
+  for (i = 0; i < 3; i++) {
+    children[i] = nr_segment_start(txn, parent, NULL);
+    nr_segment_set_timing(children[i], 2000 + i * 2000, 1000);
+    segment = children[i];
+    nr_segment_end(&segment);
+  }
+
+  /*
+   * Test : Once the limit, less one for the root segment, is reached, no more
+   *        span events are created.
+   */
+  tlib_pass_if_size_t_equal("limit reached", 2,
+                            nr_vector_size(txn->released_span_events));
+  tlib_pass_if_size_t_equal("limit reached", 0,
+                            nr_segment_children_size(&parent->children));
+  tlib_pass_if_true("limit reached",
+                    parent->state & NR_SEGMENT_CHILD_SPAN_RELEASED, "state=%d",
+                    (int)parent->state);
+
+  /*
+   * Test : A parent of segments with span events gets a span event.
+   */
+  segment = parent;
+  nr_segment_end(&segment);
+  tlib_pass_if_size_t_equal("parent span event", 3,
+                            nr_vector_size(txn->released_span_events));
+
+  txn->status.path_is_frozen = 1;
+  nr_txn_end(txn);
+  tlib_pass_if_size_t_equal("root span event", 4,
+                            nr_vector_size(txn->final_data.span_events));
+
+  nr_txn_destroy(&txn);
+}
+
+static void test_segment_release_completed_fold(void) {
+  nrapp_t app = {.state = NR_APP_OK};
+  nrtxnopt_t opts;
+  nrtxn_t* txn;
+  nr_segment_t* parent;
+  nr_segment_t* segment;
+  int i;
+
+  nr_memset(&opts, 0, sizeof(opts));
+  opts.release_completed_segments = true;
+  txn = nr_txn_begin(&app, &opts, NULL, NULL);
+
+  nr_segment_set_timing(txn->segment_root, 0, 100000);
+  parent = nr_segment_start(txn, txn->segment_root, NULL);
+  nr_segment_set_timing(parent, 0, 50000);
+
+  /*
+   * Test : Released children don't stay in the tree.
+   */
+  for (i = 0; i < 1000; i++) {
+    segment = nr_segment_start(txn, parent, NULL);
+    nr_segment_set_timing(segment, i * 40, 20);
+    nr_segment_end(&segment);
+  }
+  tlib_pass_if_size_t_equal("children freed", 0,
+                            nr_segment_children_size(&parent->children));
+  tlib_pass_if_time_equal("children folded", 1000 * 20,
+                          parent->released_time);
+  tlib_pass_if_size_t_equal("children not counted", 0, txn->segment_count);
+
+  /*
+   * Test : Discarding a segment passes the time of its released children up
+   *        to its parent.
+   */
+  tlib_pass_if_true("discard", nr_segment_discard(&parent), "expected true");
+  tlib_pass_if_time_equal("children passed up", 1000 * 20,
+                          txn->segment_root->released_time);
+
+  txn->status.path_is_frozen = 1;
+  nr_txn_end(txn);
+  tlib_pass_if_time_equal("total time", 100000,
+                          txn->final_data.total_time);
+
+  nr_txn_destroy(&txn);
+}
+
+static void test_segment_release_completed_max_segments(void) {
+  nrapp_t app = {.state = NR_APP_OK};
+  nrtxnopt_t opts;
+  nrtxn_t* txn;
+  nr_segment_t* child;
+  nr_segment_t* segment;
+
+  nr_memset(&opts, 0, sizeof(opts));
+  opts.max_segments = 10;
+  opts.release_completed_segments = true;
+  txn = nr_txn_begin(&app, &opts, NULL, NULL);
+
+  /*
+   * Test : Nothing is released while a segment limit applies.
+   */
+  child = nr_segment_start(txn, txn->segment_root, NULL);
+  segment = child;
+  nr_segment_end(&segment);
+  tlib_pass_if_ptr_equal(
+      "segment heap", child,
+      nr_segment_children_get(&txn->segment_root->children, 0));
+  tlib_pass_if_size_t_equal("segment heap", 1, txn->segment_count);
+
+  nr_txn_destroy(&txn);
+}
+
+static void test_segment_release_completed_inbound_payload(void) {
+  nrapp_t app = {
+      .state = NR_APP_OK,
+      .limits = {
+          .span_events = NR_DEFAULT_SPAN_EVENTS_MAX_SAMPLES_STORED,
+      },
+  };
+  nrtxnopt_t opts;
+  nrtxn_t* txn;
+  nr_segment_t* child;
+  nr_segment_t* segment;
+  nr_vector_t* events;
+  const nr_span_event_t* root_event;
+  const nr_span_event_t* child_event;
+  nr_hashmap_t* header_map = nr_hashmap_create(NULL);
+  char* json_payload
+      = "{\"v\":[0,1],\"d\":{\"ty\":\"App\",\"ac\":\"9123\","
+        "\"ap\":\"51424\",\"id\":\"27856f70d3d314b7\","
+        "\"tr\":\"3221bf09aa0bcf0d\",\"pr\":1.2345,\"sa\":true,"
+        "\"ti\":1482959525577}}";
+
+  nr_memset(&opts, 0, sizeof(opts));
+  opts.distributed_tracing_enabled = 1;
+  opts.span_events_enabled = 1;
+  opts.release_completed_segments = true;
+  app.connect_reply
+      = nro_create_from_json("{\"trusted_account_key\":\"9123\"}");
+  txn = nr_txn_begin(&app, &opts, NULL, NULL);
+  nr_distributed_trace_set_sampled(txn->distributed_trace, false);
+
+  nr_segment_set_timing(txn->segment_root, 0, 10000);
+  child = nr_segment_start(txn, txn->segment_root, NULL);
+  nr_segment_set_name(child, "child");
+  nr_segment_set_timing(child, 1000, 2000);
+  segment = child;
+  nr_segment_end(&segment);
+
+  /*
+   * Test : A span event is created for a released segment even when the
+   *        transaction is not sampled yet.
+   */
+  tlib_pass_if_size_t_equal("unsampled span event", 1,
+                            nr_vector_size(txn->released_span_events));
+
+  /*
+   * Test : Accepting an inbound payload after the segment was released
+   *        updates the trace fields of its span event.
+   */
+  nr_hashmap_update(header_map, NR_PSTR(NEWRELIC), json_payload);
+  tlib_pass_if_true("accept payload",
+                    nr_txn_accept_distributed_trace_payload(txn, header_map,
+                                                            "HTTP"),
+                    "expected true");
+
+  txn->status.path_is_frozen = 1;
+  nr_txn_end(txn);
+
+  events = txn->final_data.span_events;
+  tlib_pass_if_size_t_equal("final span events", 2, nr_vector_size(events));
+  root_event = nr_vector_get(events, 0);
+  child_event = test_find_span_event(events, "child");
+  tlib_fail_if_null("released span event", child_event);
+  tlib_pass_if_str_equal("released span event parent",
+                         nr_span_event_get_guid(root_event),
+                         nr_span_event_get_parent_id(child_event));
+  tlib_pass_if_true("released span event sampled",
+                    nr_span_event_is_sampled(child_event), "expected true");
+  tlib_pass_if_str_equal("released span event trace id", "3221bf09aa0bcf0d",
+                         nr_span_event_get_trace_id(child_event));
+  tlib_pass_if_str_equal("released span event trace id",
+                         nr_span_event_get_trace_id(root_event),
+                         nr_span_event_get_trace_id(child_event));
+  tlib_pass_if_str_equal("released span event transaction id",
+                         nr_span_event_get_transaction_id(root_event),
+                         nr_span_event_get_transaction_id(child_event));
+  tlib_pass_if_double_equal("released span event priority",
+                            nr_span_event_get_priority(root_event),
+                            nr_span_event_get_priority(child_event));
+
+  nr_hashmap_destroy(&header_map);
+  nr_txn_destroy(&txn);
+  nro_delete(app.connect_reply);
+}
+
+static void test_segment_discard_keep_metrics_segment_limit(void) {
   nrapp_t app = {.state = NR_APP_OK};
   nrtxnopt_t opts = {0};
   nrtxn_t* txn;
@@ -1741,8 +2200,9 @@ static void test_segment_discard_keep_metrics_no_exclusive(void) {
   nr_segment_t* E;
 
   /*
-   * No exclusive time calculation for metrics that are created from
-   * discarded segments.
+   * While a segment limit applies, metrics are recorded when segments end,
+   * with the exclusive time calculated from the durations of their ended
+   * children.
    */
   opts.max_segments = 1000;
 
@@ -1786,9 +2246,10 @@ static void test_segment_discard_keep_metrics_no_exclusive(void) {
    *    metric c -> C
    *     (4,000)
    *
-   *  metric d (1000, excl. 0)
+   *  metric d (1000, excl. 1000)
    */
   test_segment_end_and_keep(&D);
+  tlib_pass_if_null("metrics recorded when the segment ends", D->metrics);
   nr_segment_discard(&D);
 
   /*
@@ -1801,7 +2262,7 @@ static void test_segment_discard_keep_metrics_no_exclusive(void) {
    *  metric c -> C   E <- metric e (2,000)
    *   (4,000)
    *
-   *  metric d (1000, excl. 0)
+   *  metric d (1000, excl. 1000)
    */
   E = nr_segment_start(txn, B, NULL);
   E->id = nr_strdup("E");
@@ -1815,9 +2276,9 @@ static void test_segment_discard_keep_metrics_no_exclusive(void) {
    *                |
    *                B <- metric b (?)
    *
-   *  metric d (1000, excl. 0)
-   *  metric c (4000, excl. 0)
-   *  metric e (2000, excl. 0)
+   *  metric d (1000, excl. 1000)
+   *  metric c (4000, excl. 4000)
+   *  metric e (2000, excl. 2000)
    */
   test_segment_end_and_keep(&C);
   test_segment_end_and_keep(&E);
@@ -1835,14 +2296,140 @@ static void test_segment_discard_keep_metrics_no_exclusive(void) {
   nr_txn_end(txn);
 
   /* Check for metrics */
-  test_txn_metric_is("b", txn->scoped_metrics, 0, "b", 1, 10000, 10000, 10000,
+  test_txn_metric_is("b", txn->scoped_metrics, 0, "b", 1, 10000, 3000, 10000,
                      10000, 100000000);
-  test_txn_metric_is("c", txn->scoped_metrics, 0, "c", 1, 4000, 0, 4000, 4000,
-                     16000000);
-  test_txn_metric_is("d", txn->scoped_metrics, 0, "d", 1, 1000, 0, 1000, 1000,
-                     1000000);
-  test_txn_metric_is("e", txn->scoped_metrics, 0, "e", 1, 2000, 0, 2000, 2000,
-                     4000000);
+  test_txn_metric_is("c", txn->scoped_metrics, 0, "c", 1, 4000, 4000, 4000,
+                     4000, 16000000);
+  test_txn_metric_is("d", txn->scoped_metrics, 0, "d", 1, 1000, 1000, 1000,
+                     1000, 1000000);
+  test_txn_metric_is("e", txn->scoped_metrics, 0, "e", 1, 2000, 2000, 2000,
+                     2000, 4000000);
+
+  nr_txn_destroy(&txn);
+}
+
+static void test_segment_end_metrics_segment_limit(void) {
+  nrapp_t app = {.state = NR_APP_OK};
+  nrtxnopt_t opts = {0};
+  nrtxn_t* txn;
+  nr_segment_t* parent;
+  nr_segment_t* segment;
+  int i;
+
+  opts.max_segments = 2;
+  txn = nr_txn_begin(&app, &opts, NULL, NULL);
+
+  /*
+   * Test : Segments discarded by the segment heap still count towards the
+   *        exclusive time of their parent.
+   *
+   *                A
+   *                |
+   *             parent <- metric parent (10,000, excl. 6,000)
+   *             / /\ \
+   *  four children, each metric child (1,000)
+   */
+  nr_segment_set_timing(txn->segment_root, 0, 12000);
+  parent = nr_segment_start(txn, txn->segment_root, NULL);
+  nr_segment_add_metric(parent, "parent", true);
+  nr_segment_set_timing(parent, 1000, 10000);
+
+  for (i = 0; i < 4; i++) {
+    segment = nr_segment_start(txn, parent, NULL);
+    nr_segment_add_metric(segment, "child", true);
+    nr_segment_set_timing(segment, 2000 + i * 2000, 1000);
+    nr_segment_end(&segment);
+  }
+
+  tlib_pass_if_time_equal("child time", 4000, parent->child_time);
+  tlib_pass_if_size_t_equal("children discarded", 2, txn->segment_count);
+
+  segment = parent;
+  nr_segment_end(&segment);
+  tlib_pass_if_time_equal("child time", 10000,
+                          txn->segment_root->child_time);
+
+  txn->status.path_is_frozen = 1;
+  nr_txn_end(txn);
+
+  test_txn_metric_is("parent", txn->scoped_metrics, 0, "parent", 1, 10000,
+                     6000, 10000, 10000, 100000000);
+  test_txn_metric_is("child", txn->scoped_metrics, 0, "child", 4, 4000, 4000,
+                     1000, 1000, 4000000);
+
+  nr_txn_destroy(&txn);
+}
+
+static void test_segment_discard_unended_segment_limit(void) {
+  nrapp_t app = {.state = NR_APP_OK};
+  nrtxnopt_t opts = {0};
+  nrtxn_t* txn;
+  nr_segment_t* parent;
+  nr_segment_t* wrapper;
+  nr_segment_t* child;
+
+  opts.max_segments = 1000;
+  txn = nr_txn_begin(&app, &opts, NULL, NULL);
+
+  /*
+   * Test : A segment discarded before it ends passes the time of its ended
+   *        children up to its parent, so that it isn't counted twice.
+   *
+   *             parent <- metric parent (10,000, excl. 7,000)
+   *               |
+   *            wrapper (discarded)
+   *               |
+   *             child <- metric child (3,000)
+   */
+  nr_segment_set_timing(txn->segment_root, 0, 12000);
+  parent = nr_segment_start(txn, txn->segment_root, NULL);
+  nr_segment_add_metric(parent, "parent", true);
+  nr_segment_set_timing(parent, 1000, 10000);
+
+  wrapper = nr_segment_start(txn, parent, NULL);
+  nr_segment_set_timing(wrapper, 2000, 4000);
+
+  child = nr_segment_start(txn, wrapper, NULL);
+  nr_segment_add_metric(child, "child", true);
+  nr_segment_set_timing(child, 2500, 3000);
+  nr_segment_end(&child);
+
+  tlib_pass_if_time_equal("wrapper child time", 3000, wrapper->child_time);
+  tlib_pass_if_true("discard succeeds", nr_segment_discard(&wrapper),
+                    "wrapper=%p", wrapper);
+  tlib_pass_if_time_equal("parent child time", 3000, parent->child_time);
+
+  nr_segment_end(&parent);
+
+  txn->status.path_is_frozen = 1;
+  nr_txn_end(txn);
+
+  test_txn_metric_is("parent", txn->scoped_metrics, 0, "parent", 1, 10000,
+                     7000, 10000, 10000, 100000000);
+  test_txn_metric_is("child", txn->scoped_metrics, 0, "child", 1, 3000, 3000,
+                     3000, 3000, 9000000);
+
+  nr_txn_destroy(&txn);
+
+  /*
+   * Test : A segment discarded after it ends has already counted its whole
+   *        duration towards its parent, children included.
+   */
+  txn = nr_txn_begin(&app, &opts, NULL, NULL);
+  nr_segment_set_timing(txn->segment_root, 0, 12000);
+  parent = nr_segment_start(txn, txn->segment_root, NULL);
+  nr_segment_set_timing(parent, 1000, 10000);
+
+  wrapper = nr_segment_start(txn, parent, NULL);
+  nr_segment_set_timing(wrapper, 2000, 4000);
+
+  child = nr_segment_start(txn, wrapper, NULL);
+  nr_segment_set_timing(child, 2500, 3000);
+  nr_segment_end(&child);
+
+  test_segment_end_and_keep(&wrapper);
+  nr_segment_discard(&wrapper);
+  tlib_pass_if_time_equal("parent child time", 4000, parent->child_time);
 
   nr_txn_destroy(&txn);
 }
@@ -1977,10 +2564,10 @@ static void test_segment_set(void) {
   nr_free(mini);
 }
 
-static void test_segment_heap_to_set(void) {
-  nr_set_t* set;
+static void test_segment_heap_to_vector(void) {
   nr_segment_tree_to_heap_metadata_t heaps
       = {.trace_heap = NULL, .span_heap = NULL};
+  nr_vector_t* vector;
 
   nr_segment_t* root = nr_zalloc(sizeof(nr_segment_t));
   nr_segment_t* mini = nr_zalloc(sizeof(nr_segment_t));
@@ -2005,40 +2592,33 @@ static void test_segment_heap_to_set(void) {
   nr_segment_add_child(root, midi);
   nr_segment_add_child(root, maxi);
 
-  /* Build a heap */
+  /* Build a heap that only holds the three longest segments */
   heaps.trace_heap
-      = nr_segment_heap_create(4, nr_segment_wrapped_duration_comparator);
+      = nr_segment_heap_create(3, nr_segment_wrapped_duration_comparator);
   nr_segment_tree_to_heap(root, &heaps);
 
-  /* Prepare a set for population */
-  set = nr_set_create();
+  vector = nr_vector_create(3, NULL, NULL);
 
   /* Test : Bad parameters */
-  nr_segment_heap_to_set(heaps.trace_heap, NULL);
-  nr_segment_heap_to_set(NULL, set);
-  tlib_pass_if_true("Converting a NULL heap to a set must yield an empty set",
-                    nr_set_size(set) == 0, "Expected true");
-  nr_set_destroy(&set);
+  nr_segment_heap_to_vector(NULL, vector);
+  tlib_pass_if_size_t_equal("Converting a NULL heap must not add segments", 0,
+                            nr_vector_size(vector));
+  nr_segment_heap_to_vector(heaps.trace_heap, NULL);
 
   /* Test : Normal operation. */
-  set = nr_set_create();
-  nr_segment_heap_to_set(heaps.trace_heap, set);
-
-  tlib_pass_if_not_null(
-      "Converting a well-formed heap to a set must yield a non-empty set", set);
+  nr_segment_heap_to_vector(heaps.trace_heap, vector);
 
-  /* Affirm membership */
-  tlib_pass_if_true("The longest segment is a member of the set",
-                    nr_set_contains(set, root), "Expected true");
-  tlib_pass_if_true("The second-longest segment is a member of the set",
-                    nr_set_contains(set, maxi), "Expected true");
-  tlib_pass_if_true("The third-longest segment is a member of the set",
-                    nr_set_contains(set, midi), "Expected true");
-  tlib_pass_if_true("The shortest segment is a member of the set",
-                    nr_set_contains(set, mini), "Expected true");
-  nr_set_destroy(&set);
+  tlib_pass_if_size_t_equal("The three longest segments are in the vector", 3,
+                            nr_vector_size(vector));
+  tlib_pass_if_ptr_equal("The segments are in tree order", root,
+                         nr_vector_get(vector, 0));
+  tlib_pass_if_ptr_equal("The segments are in tree order", midi,
+                         nr_vector_get(vector, 1));
+  tlib_pass_if_ptr_equal("The segments are in tree order", maxi,
+                         nr_vector_get(vector, 2));
 
   /* Clean up */
+  nr_vector_destroy(&vector);
   nr_minmax_heap_destroy(&heaps.trace_heap);
   nr_segment_destroy_tree(root);
   nr_free(root);
@@ -3195,16 +3775,24 @@ void test_main(void* p NRUNUSED) {
   test_segment_iterate_cycle_two();
   test_segment_iterate_with_amputation();
   test_segment_iterate_with_post_callback();
+  test_segment_iterate_deep();
   test_segment_destroy();
   test_segment_destroy_tree();
   test_segment_discard();
   test_segment_discard_not_keep_metrics_while_running();
   test_segment_discard_keep_metrics();
   test_segment_discard_keep_metrics_while_running();
-  test_segment_discard_keep_metrics_no_exclusive();
+  test_segment_release_completed();
+  test_segment_release_completed_span_limit();
+  test_segment_release_completed_fold();
+  test_segment_release_completed_max_segments();
+  test_segment_release_completed_inbound_payload();
+  test_segment_discard_keep_metrics_segment_limit();
+  test_segment_end_metrics_segment_limit();
+  test_segment_discard_unended_segment_limit();
   test_segment_tree_to_heap();
   test_segment_set();
-  test_segment_heap_to_set();
+  test_segment_heap_to_vector();
   test_segment_set_parent_cycle();
   test_segment_no_recording();
   test_segment_span_comparator();
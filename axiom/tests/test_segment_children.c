@@ -36,7 +36,7 @@ static void test_segment_children_deinit(void) {
 
   nr_segment_children_init(&children);
   nr_segment_children_add(&children, &segment);
-  nr_segment_children_migrate_to_vector(&children);
+  nr_segment_children_migrate_to_spilled(&children, NULL);
   nr_segment_children_deinit(&children);
   tlib_pass_if_bool_equal("is_packed must be true after deinit occurs", true,
                           children.is_packed);
@@ -235,9 +235,10 @@ static void test_segment_children_reparent_invalid(void) {
   nr_segment_t segment = {.parent = NULL};
 
   tlib_pass_if_bool_equal("NULL children cannot be reparented", false,
-                          nr_segment_children_reparent(NULL, &segment));
+                          nr_segment_children_reparent(NULL, &segment, NULL));
   tlib_pass_if_bool_equal("children cannot be reparented onto a NULL segment",
-                          false, nr_segment_children_reparent(&children, NULL));
+                          false,
+                          nr_segment_children_reparent(&children, NULL, NULL));
 }
 
 static void test_segment_children_reparent(nr_segment_children_t* children,
@@ -255,7 +256,7 @@ static void test_segment_children_reparent(nr_segment_children_t* children,
   }
 
   tlib_pass_if_bool_equal("reparenting children should succeed", true,
-                          nr_segment_children_reparent(children, &parent));
+                          nr_segment_children_reparent(children, &parent, NULL));
   tlib_pass_if_size_t_equal(
       "the original children struct should have no children left in it", 0,
       nr_segment_children_size(children));
@@ -303,7 +304,7 @@ static void test_segment_children_vector_shrink(void) {
     nr_segment_children_add(&children, &segments[i]);
   }
 
-  nr_segment_children_reparent(&children, &parent);
+  nr_segment_children_reparent(&children, &parent, NULL);
 
   tlib_pass_if_bool_equal("parent children not packed", false,
                           parent.children.is_packed);
@@ -318,6 +319,103 @@ static void test_segment_children_vector_shrink(void) {
   nr_segment_children_deinit(&children);
 }
 
+static void test_segment_children_pooled(void) {
+  nr_segment_children_pool_t pool = {0};
+  nr_segment_children_t children;
+  nr_segment_t parent = {0};
+  nr_segment_t** first_elements;
+  /* Enough children to outgrow every size class of the pool. */
+  const size_t count = NR_SEGMENT_CHILDREN_PACKED_LIMIT
+                       << (NR_SEGMENT_CHILDREN_POOL_CLASSES + 1);
+  nr_segment_t* segments
+      = (nr_segment_t*)nr_calloc(count, sizeof(nr_segment_t));
+  size_t i;
+
+  nr_segment_children_init(&children);
+
+  /*
+   * Test : Children spill into the first size class of the pool.
+   */
+  for (i = 0; i <= NR_SEGMENT_CHILDREN_PACKED_LIMIT; i++) {
+    nr_segment_children_add_pooled(&children, &segments[i], &pool);
+  }
+  tlib_pass_if_bool_equal("children are spilled", false, children.is_packed);
+  tlib_pass_if_ptr_equal("spilled children use the pool", &pool,
+                         children.spilled.pool);
+  tlib_pass_if_size_t_equal("spilled children use the first size class",
+                            NR_SEGMENT_CHILDREN_PACKED_LIMIT * 2,
+                            children.spilled.capacity);
+  tlib_pass_if_size_t_equal("first size class is allocated from", 1,
+                            nr_slab_count(pool.slabs[0]));
+  first_elements = children.spilled.elements;
+
+  /*
+   * Test : Children keep their order and indices as they grow through every
+   *        size class and on to the heap.
+   */
+  for (; i < count; i++) {
+    nr_segment_children_add_pooled(&children, &segments[i], &pool);
+  }
+  tlib_pass_if_size_t_equal("all children are added", count,
+                            nr_segment_children_size(&children));
+  tlib_pass_if_size_t_equal("children outgrew the pool", count,
+                            children.spilled.capacity);
+  for (i = 0; i < count; i++) {
+    if (&segments[i] != nr_segment_children_get(&children, i)
+        || (ssize_t)i != nr_segment_get_child_ix(&segments[i])) {
+      tlib_pass_if_true("children keep their order", false, "i=%zu", i);
+      break;
+    }
+  }
+  for (i = 1; i < NR_SEGMENT_CHILDREN_POOL_CLASSES; i++) {
+    tlib_pass_if_size_t_equal("every size class is allocated from", 1,
+                              nr_slab_count(pool.slabs[i]));
+  }
+
+  /*
+   * Test : Removal swaps the last child into place.
+   */
+  tlib_pass_if_bool_equal("removing a child should succeed", true,
+                          nr_segment_children_remove(&children, &segments[0]));
+  tlib_pass_if_ptr_equal("the last child is swapped into place",
+                         &segments[count - 1],
+                         nr_segment_children_get(&children, 0));
+  tlib_pass_if_ssize_t_equal("the swapped child has its index updated", 0,
+                             nr_segment_get_child_ix(&segments[count - 1]));
+
+  /*
+   * Test : Arrays released to the pool are reused.
+   */
+  nr_segment_children_deinit(&children);
+  nr_segment_children_init(&children);
+  for (i = 0; i <= NR_SEGMENT_CHILDREN_PACKED_LIMIT; i++) {
+    nr_segment_children_add_pooled(&children, &segments[i], &pool);
+  }
+  tlib_pass_if_ptr_equal("a released array is reused", first_elements,
+                         children.spilled.elements);
+
+  /*
+   * Test : Reparenting onto a packed parent spills the parent into the pool.
+   */
+  nr_segment_children_init(&parent.children);
+  nr_segment_children_add_pooled(&parent.children, &segments[count - 1],
+                                 &pool);
+  tlib_pass_if_bool_equal("reparenting children should succeed", true,
+                          nr_segment_children_reparent(&children, &parent,
+                                                       &pool));
+  tlib_pass_if_ptr_equal("the parent spilled into the pool", &pool,
+                         parent.children.spilled.pool);
+  tlib_pass_if_size_t_equal("the parent has all the children",
+                            NR_SEGMENT_CHILDREN_PACKED_LIMIT + 2,
+                            nr_segment_children_size(&parent.children));
+
+  nr_segment_children_deinit(&parent.children);
+  nr_segment_children_deinit(&children);
+  nr_segment_children_pool_destroy_fields(&pool);
+  nr_segment_children_pool_destroy_fields(NULL);
+  nr_free(segments);
+}
+
 tlib_parallel_info_t parallel_info = {.suggested_nthreads = 2, .state_size = 0};
 
 void test_main(void* p NRUNUSED) {
@@ -345,4 +443,6 @@ void test_main(void* p NRUNUSED) {
   test_segment_children_reparent_vector();
 
   test_segment_children_vector_shrink();
+
+  test_segment_children_pooled();
 }
@@ -15,12 +15,11 @@
 #include "nr_span_event_private.h"
 #include "util_memory.h"
 #include "util_minmax_heap.h"
-#include "util_set.h"
 
 #include "tlib_main.h"
 
-#define test_buffer_contents(...) \
-  test_buffer_contents_fn(__VA_ARGS__, __FILE__, __LINE__)
+#define test_trace_contents(...) \
+  test_trace_contents_fn(__VA_ARGS__, __FILE__, __LINE__)
 
 #define SPAN_EVENT_COMPARE(evt, expect_name, expect_category, expect_parent, \
                            expect_start, expect_duration)                    \
@@ -104,10 +103,6 @@
       "server.address", expected_server_address,                             \
       nr_span_event_get_message(span_event, NR_SPAN_MESSAGE_SERVER_ADDRESS));
 
-static void nr_vector_span_event_dtor(void* element, void* userdata NRUNUSED) {
-  nr_span_event_destroy((nr_span_event_t**)&element);
-}
-
 static void mock_txn(nrtxn_t* txn, nr_segment_t* root) {
   txn->segment_root = root;
   txn->trace_strings = nr_string_pool_create();
@@ -125,78 +120,116 @@ static void cleanup_mock_txn(nrtxn_t* txn) {
   nr_string_pool_destroy(&txn->trace_strings);
 }
 
-static void test_buffer_contents_fn(const char* testname,
-                                    nrbuf_t* buf,
-                                    const char* expected,
-                                    const char* file,
-                                    int line) {
-  const char* cs;
-  nrobj_t* obj;
+typedef struct {
+  nr_segment_t** selected; /* NULL terminated, or NULL to select every
+                              segment */
+  nr_vector_t* segments;   /* The selected segments in tree order */
+  uint32_t next_pos;
+} test_selection_t;
 
-  nr_buffer_add(buf, "", 1);
-  cs = (const char*)nr_buffer_cptr(buf);
+static void test_select_post_callback(nr_segment_t* segment,
+                                      test_selection_t* selection) {
+  segment->tree_end = selection->next_pos - 1;
+}
+
+static nr_segment_iter_return_t test_select_callback(nr_segment_t* segment,
+                                                     void* userdata) {
+  test_selection_t* selection = (test_selection_t*)userdata;
+  bool selected = (NULL == selection->selected);
+  size_t i;
 
-  test_pass_if_true(testname, 0 == nr_strcmp(cs, expected), "cs=%s expected=%s",
-                    NRSAFESTR(cs), NRSAFESTR(expected));
+  segment->tree_pos = selection->next_pos++;
 
-  if (nr_strcmp(cs, expected)) {
-    printf("got:      %s\n", NRSAFESTR(cs));
-    printf("expected: %s\n", NRSAFESTR(expected));
+  for (i = 0; !selected && selection->selected[i]; i++) {
+    selected = (segment == selection->selected[i]);
   }
 
-  obj = nro_create_from_json(cs);
-  test_pass_if_true(testname, 0 != obj, "obj=%p", obj);
-  nro_delete(obj);
+  if (selected) {
+    nr_vector_push_back(selection->segments, segment);
+  }
 
-  nr_buffer_reset(buf);
+  return ((nr_segment_iter_return_t){
+      .post_callback = (nr_segment_post_iter_t)test_select_post_callback,
+      .userdata = selection});
 }
 
-static void test_json_print_bad_parameters(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nrpool_t* segment_names;
+/*
+ * Purpose : Number the segments of a tree, as nr_segment_tree_to_heap()
+ *           does, and return the selected ones in tree order.
+ */
+static nr_vector_t* test_select_segments(nr_segment_t* root,
+                                         nr_segment_t** selected) {
+  test_selection_t selection = {
+      .selected = selected,
+      .segments = nr_vector_create(8, NULL, NULL),
+  };
 
-  nrtxn_t txn = {.abs_start_time = 1000};
-  nr_segment_t root = {.type = NR_SEGMENT_CUSTOM,
-                       .txn = &txn,
-                       .start_time = 0,
-                       .stop_time = 9000};
-  buf = nr_buffer_create(4096, 4096);
-  segment_names = nr_string_pool_create();
+  nr_segment_iterate(root, test_select_callback, &selection);
 
-  /*
-   * Test : Bad parameters
-   */
-  rv = nr_segment_traces_json_print_segments(NULL, NULL, NULL, NULL, NULL, NULL,
-                                             NULL);
-  tlib_pass_if_bool_equal(
-      "Return value must be false when input params are NULL", false, rv);
-
-  rv = nr_segment_traces_json_print_segments(NULL, NULL, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("Return value must be false when input buff is NULL",
-                          false, rv);
-
-  rv = nr_segment_traces_json_print_segments(buf, NULL, NULL, NULL, NULL, &root,
-                                             segment_names);
-  tlib_pass_if_bool_equal("Return value must be false when input txn is NULL",
-                          false, rv);
-
-  rv = nr_segment_traces_json_print_segments(buf, NULL, NULL, NULL, &txn, &root,
-                                             NULL);
-  tlib_pass_if_bool_equal("Return value must be -1 when input pool is NULL",
-                          false, rv);
+  return selection.segments;
+}
 
-  /* Clean up */
-  nr_string_pool_destroy(&segment_names);
-  nr_buffer_destroy(&buf);
+/*
+ * Purpose : Create the trace and span events of a mock transaction from the
+ *           given selections of segments, without any transaction
+ *           attributes.
+ */
+static void test_create_data(nrtxn_t* txn,
+                             nr_segment_t** trace_selected,
+                             nr_segment_t** span_selected,
+                             nrtxnfinal_t* result) {
+  nr_segment_t* root = txn->segment_root;
+  nr_vector_t* trace_segments = test_select_segments(root, trace_selected);
+  nr_vector_t* span_segments = test_select_segments(root, span_selected);
+
+  nr_segment_traces_create_data_from_selection(
+      txn, nr_time_duration(root->start_time, root->stop_time),
+      trace_segments, span_segments, NULL, NULL, NULL, result);
+
+  nr_vector_destroy(&trace_segments);
+  nr_vector_destroy(&span_segments);
+}
+
+/*
+ * Purpose : Compare the trace nodes below the ROOT node of a trace created by
+ *           test_create_data() with the expected JSON.
+ */
+static void test_trace_contents_fn(const char* testname,
+                                   const char* trace_json,
+                                   const char* expected,
+                                   const char* file,
+                                   int line) {
+  static const char root_node[] = "\"ROOT\",{},[";
+  static const char trace_end[] = "]],{}],";
+  const char* nodes = nr_strstr(trace_json, root_node);
+  const char* end = NULL;
+  const char* next;
+  char* actual = NULL;
+  nrobj_t* obj;
+
+  if (nodes) {
+    nodes += sizeof(root_node) - 1;
+    for (next = nodes; (next = nr_strstr(next, trace_end)); next++) {
+      end = next;
+    }
+  }
+  if (end) {
+    actual = nr_strndup(nodes, end - nodes);
+  }
+
+  test_pass_if_true(testname, 0 == nr_strcmp(actual, expected),
+                    "actual=%s expected=%s", NRSAFESTR(actual),
+                    NRSAFESTR(expected));
+
+  obj = nro_create_from_json(trace_json);
+  test_pass_if_true(testname, 0 != obj, "obj=%p", obj);
+  nro_delete(obj);
+
+  nr_free(actual);
 }
 
-static void test_json_print_segments_root_only(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_root_only(void) {
+  nrtxnfinal_t result = {0};
   nr_span_event_t* evt_root;
 
   nrtxn_t txn = {.abs_start_time = 1000};
@@ -205,12 +238,9 @@ static void test_json_print_segments_root_only(void) {
                        .start_time = 0,
                        .stop_time = 9000};
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
+  txn.segment_count = 1;
 
   /* Create a single mock segment */
   root.name = nr_string_add(txn.trace_strings, "WebTransaction/*");
@@ -218,34 +248,29 @@ static void test_json_print_segments_root_only(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "Printing JSON for a single root segment must succeed", true, rv);
-  test_buffer_contents("success", buf, "[0,9,\"`0\",{},[]]");
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("success", result.trace_json,
+                      "[0,9,\"`0\",{},[]]");
 
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 1);
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 1);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
 
   /* Clean up */
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
   nr_segment_destroy_fields(&root);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_bad_segments(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_unknown_name(void) {
+  nrtxnfinal_t result = {0};
 
   nr_span_event_t* evt_root;
   nr_span_event_t* evt_child;
@@ -258,14 +283,11 @@ static void test_json_print_segments_bad_segments(void) {
   nr_segment_t child = {.type = NR_SEGMENT_CUSTOM,
                         .txn = &txn,
                         .start_time = 1000,
-                        .stop_time = 1000};
-
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
+                        .stop_time = 3000};
 
   /* Mock up the transaction */
   mock_txn(&txn, &root);
+  txn.segment_count = 2;
 
   /* Create a collection of mock segments */
 
@@ -280,45 +302,19 @@ static void test_json_print_segments_bad_segments(void) {
   nr_segment_add_child(&root, &child);
 
   root.name = nr_string_add(txn.trace_strings, "WebTransaction/*");
-  child.name = nr_string_add(txn.trace_strings, "Mongo/alpha");
-
-  /*
-   * Test : Segment stop before segment start
-   */
-  child.start_time = 4000;
-  child.stop_time = 2000;
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "Printing JSON for a segment that has out of order start and stop must "
-      "fail",
-      false, rv);
-
-  tlib_pass_if_uint_equal("not all span events created",
-                          nr_vector_size(span_events), 1);
-
-  nr_buffer_reset(buf);
-  nr_vector_destroy(&span_events);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
 
   /*
    * Test : Segment with unknown name
    */
-  child.start_time = 1000;
-  child.stop_time = 3000;
-  child.name = 0;
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "Printing JSON for a segment with an unknown name must succeed", true,
-      rv);
-  test_buffer_contents("unknown name", buf,
-                       "[0,9,\"`0\",{},[[1,3,\"`1\",{},[]]]]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 2);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_child = (nr_span_event_t*)nr_vector_get(span_events, 1);
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("unknown name", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,3,\"`1\",{},[]]]]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 2);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_child = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -333,17 +329,13 @@ static void test_json_print_segments_bad_segments(void) {
   nr_segment_destroy_fields(&child);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segment_with_data(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segment_with_data(void) {
+  nrtxnfinal_t result = {0};
   nrobj_t* value;
 
   nr_span_event_t* evt_root;
@@ -353,10 +345,6 @@ static void test_json_print_segment_with_data(void) {
   nr_segment_t root = {.txn = &txn, .start_time = 0, .stop_time = 9000};
   nr_segment_t child = {.txn = &txn, .start_time = 1000, .stop_time = 3000};
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 2;
@@ -384,18 +372,16 @@ static void test_json_print_segment_with_data(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("Printing JSON for a segment with data must succeed",
-                          true, rv);
-  test_buffer_contents("node with data", buf,
-                       "[0,9,\"`0\",{},"
-                       "[[1,3,\"`1\",{\"uri\":\"domain.com\"},[]]]]");
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("node with data", result.trace_json,
+                      "[0,9,\"`0\",{},"
+                      "[[1,3,\"`1\",{\"uri\":\"domain.com\"},[]]]]");
 
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 2);
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 2);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_child = (nr_span_event_t*)nr_vector_get(span_events, 1);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_child = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -410,17 +396,13 @@ static void test_json_print_segment_with_data(void) {
   nr_segment_destroy_fields(&child);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_two_nodes(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_two_nodes(void) {
+  nrtxnfinal_t result = {0};
 
   nr_span_event_t* evt_root;
   nr_span_event_t* evt_child;
@@ -429,10 +411,6 @@ static void test_json_print_segments_two_nodes(void) {
   nr_segment_t root = {.txn = &txn, .start_time = 0, .stop_time = 9000};
   nr_segment_t child = {.txn = &txn, .start_time = 1000, .stop_time = 3000};
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 2;
@@ -455,16 +433,15 @@ static void test_json_print_segments_two_nodes(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("Printing JSON for a root+child pair must succeed",
-                          true, rv);
-  test_buffer_contents("success", buf, "[0,9,\"`0\",{},[[1,3,\"`1\",{},[]]]]");
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("success", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,3,\"`1\",{},[]]]]");
 
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 2);
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 2);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_child = (nr_span_event_t*)nr_vector_get(span_events, 1);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_child = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -479,17 +456,13 @@ static void test_json_print_segments_two_nodes(void) {
   nr_segment_destroy_fields(&child);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_hanoi(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_hanoi(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
 
@@ -505,10 +478,6 @@ static void test_json_print_segments_hanoi(void) {
   nr_segment_t C = {.txn = &txn, .start_time = 3000, .stop_time = 4000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   txn.segment_count = 4;
   mock_txn(&txn, &root);
@@ -537,20 +506,18 @@ static void test_json_print_segments_hanoi(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "Printing JSON for a cascade of four segments must succeed", true, rv);
-  test_buffer_contents("towers of hanoi", buf,
-                       "[0,9,\"`0\",{},[[1,6,\"`1\",{},[[2,5,\"`2\",{},[[3,4,"
-                       "\"`3\",{},[]]]]]]]]");
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("towers of hanoi", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,6,\"`1\",{},[[2,5,\"`2\",{},[[3,4,"
+                      "\"`3\",{},[]]]]]]]]");
 
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 4);
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 4);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_b = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_c = (nr_span_event_t*)nr_vector_get(span_events, 3);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_c = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -570,17 +537,13 @@ static void test_json_print_segments_hanoi(void) {
   nr_segment_destroy_fields(&C);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_three_siblings(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_three_siblings(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
 
@@ -596,10 +559,6 @@ static void test_json_print_segments_three_siblings(void) {
   nr_segment_t C = {.txn = &txn, .start_time = 5000, .stop_time = 6000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 4;
@@ -625,20 +584,18 @@ static void test_json_print_segments_three_siblings(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "Printing JSON for a rooted set of triplets must succeed", true, rv);
-  test_buffer_contents("sequential nodes", buf,
-                       "[0,9,\"`0\",{},[[1,2,\"`1\",{},[]],[3,4,\"`2\",{},[]],["
-                       "5,6,\"`3\",{},[]]]]");
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("sequential nodes", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,2,\"`1\",{},[]],[3,4,\"`2\",{},[]],["
+                      "5,6,\"`3\",{},[]]]]");
 
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 4);
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 4);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_b = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_c = (nr_span_event_t*)nr_vector_get(span_events, 3);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_c = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -655,17 +612,13 @@ static void test_json_print_segments_three_siblings(void) {
   nr_segment_destroy_fields(&C);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_invalid_typed_attributes(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_invalid_typed_attributes(void) {
+  nrtxnfinal_t result = {0};
 
   nr_span_event_t* evt_root;
   nr_span_event_t* evt_a;
@@ -681,10 +634,6 @@ static void test_json_print_segments_invalid_typed_attributes(void) {
   nr_segment_t C = {.txn = &txn, .start_time = 9000, .stop_time = 10000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.abs_start_time = 1000;
@@ -709,21 +658,20 @@ static void test_json_print_segments_invalid_typed_attributes(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("success", true, rv);
-  test_buffer_contents("segment attributes", buf,
-                       "[0,11,\"`0\",{},"
-                       "[[1,6,\"`1\",{},[]],"
-                       "[6,8,\"`2\",{},[]],"
-                       "[9,10,\"`3\",{},[]]]]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 4);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_b = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_c = (nr_span_event_t*)nr_vector_get(span_events, 3);
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("segment attributes", result.trace_json,
+                      "[0,11,\"`0\",{},"
+                      "[[1,6,\"`1\",{},[]],"
+                      "[6,8,\"`2\",{},[]],"
+                      "[9,10,\"`3\",{},[]]]]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 4);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_c = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      11000);
@@ -743,17 +691,13 @@ static void test_json_print_segments_invalid_typed_attributes(void) {
   nr_segment_destroy_fields(&C);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_datastore_params(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_datastore_params(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {0};
 
@@ -765,10 +709,6 @@ static void test_json_print_segments_datastore_params(void) {
   nr_segment_t A = {.txn = &txn, .start_time = 1000, .stop_time = 6000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.abs_start_time = 1000;
@@ -801,24 +741,23 @@ static void test_json_print_segments_datastore_params(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("success", true, rv);
-  test_buffer_contents("datastore params", buf,
-                       "[0,9,\"`0\",{},[[1,6,\"`1\",{"
-                       "\"host\":\"localhost\","
-                       "\"database_name\":\"db\","
-                       "\"port_path_or_id\":\"3308\","
-                       "\"backtrace\":[\"a\",\"b\"],"
-                       "\"explain_plan\":[\"c\",\"d\"],"
-                       "\"sql_obfuscated\":\"SELECT\","
-                       "\"input_query\":[\"e\",\"f\"]"
-                       "},[]]]]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 2);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("datastore params", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,6,\"`1\",{"
+                      "\"host\":\"localhost\","
+                      "\"database_name\":\"db\","
+                      "\"port_path_or_id\":\"3308\","
+                      "\"backtrace\":[\"a\",\"b\"],"
+                      "\"explain_plan\":[\"c\",\"d\"],"
+                      "\"sql_obfuscated\":\"SELECT\","
+                      "\"input_query\":[\"e\",\"f\"]"
+                      "},[]]]]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 2);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -833,17 +772,13 @@ static void test_json_print_segments_datastore_params(void) {
   nr_segment_destroy_fields(&A);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_external_async_user_attrs(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_external_async_user_attrs(void) {
+  nrtxnfinal_t result = {0};
   nrobj_t* value;
 
   nrtxn_t txn = {0};
@@ -856,10 +791,6 @@ static void test_json_print_segments_external_async_user_attrs(void) {
   nr_segment_t A = {.txn = &txn, .start_time = 1000, .stop_time = 6000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.abs_start_time = 1000;
@@ -895,24 +826,23 @@ static void test_json_print_segments_external_async_user_attrs(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("success", true, rv);
-  test_buffer_contents("datastore params", buf,
-                       "[0,9,\"`0\",{},[[1,6,\"`1\",{"
-                       "\"uri\":\"example.com\","
-                       "\"library\":\"curl\","
-                       "\"procedure\":\"GET\","
-                       "\"transaction_guid\":\"guid\","
-                       "\"status\":200,"
-                       "\"async_context\":\"`2\","
-                       "\"foo\":\"bar\""
-                       "},[]]]]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 2);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("datastore params", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,6,\"`1\",{"
+                      "\"uri\":\"example.com\","
+                      "\"library\":\"curl\","
+                      "\"procedure\":\"GET\","
+                      "\"transaction_guid\":\"guid\","
+                      "\"status\":200,"
+                      "\"async_context\":\"`2\","
+                      "\"foo\":\"bar\""
+                      "},[]]]]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 2);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -926,17 +856,13 @@ static void test_json_print_segments_external_async_user_attrs(void) {
   nr_segment_destroy_fields(&A);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_message_attributes(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_message_attributes(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {0};
 
@@ -948,10 +874,6 @@ static void test_json_print_segments_message_attributes(void) {
     nr_segment_t A = {.txn = &txn, .start_time = 1000, .stop_time = 6000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.abs_start_time = 1000;
@@ -980,20 +902,19 @@ static void test_json_print_segments_message_attributes(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("success", true, rv);
-  test_buffer_contents("message attributes", buf,
-                       "[0,9,\"`0\",{},[[1,6,\"`1\",{"
-                       "\"destination_name\":\"queue_name\","
-                       "\"messaging_system\":\"aws_sqs\","
-                       "\"server_address\":\"localhost\""
-                       "},[]]]]");
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("message attributes", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,6,\"`1\",{"
+                      "\"destination_name\":\"queue_name\","
+                      "\"messaging_system\":\"aws_sqs\","
+                      "\"server_address\":\"localhost\""
+                      "},[]]]]");
 
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 2);
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 2);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -1007,17 +928,13 @@ static void test_json_print_segments_message_attributes(void) {
   nr_segment_destroy_fields(&A);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_datastore_external_message(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_datastore_external_message(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
 
@@ -1035,10 +952,6 @@ static void test_json_print_segments_datastore_external_message(void) {
   nr_segment_t D = {.txn = &txn, .start_time = 5000, .stop_time = 6000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 4;
@@ -1090,33 +1003,32 @@ static void test_json_print_segments_datastore_external_message(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("success", true, rv);
-  test_buffer_contents("two kids", buf,
-                       "[0,9,\"`0\",{},[[1,6,\"`1\",{},["
-                       "[2,3,\"`2\",{"
-                       "\"host\":\"localhost\","
-                       "\"database_name\":\"db\","
-                       "\"port_path_or_id\":\"3308\","
-                       "\"sql_obfuscated\":\"SELECT\"},[]],"
-                       "[4,5,\"`3\",{"
-                       "\"uri\":\"example.com\","
-                       "\"library\":\"curl\","
-                       "\"procedure\":\"GET\","
-                       "\"transaction_guid\":\"guid\","
-                       "\"status\":200},[]],"
-                       "[5,6,\"`4\","
-                       "{\"destination_name\":\"queue_name\","
-                       "\"messaging_system\":\"aws_sqs\"},[]]]]]]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 5);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_b = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_c = (nr_span_event_t*)nr_vector_get(span_events, 3);
-  evt_d = (nr_span_event_t*)nr_vector_get(span_events, 4);
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("two kids", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,6,\"`1\",{},["
+                      "[2,3,\"`2\",{"
+                      "\"host\":\"localhost\","
+                      "\"database_name\":\"db\","
+                      "\"port_path_or_id\":\"3308\","
+                      "\"sql_obfuscated\":\"SELECT\"},[]],"
+                      "[4,5,\"`3\",{"
+                      "\"uri\":\"example.com\","
+                      "\"library\":\"curl\","
+                      "\"procedure\":\"GET\","
+                      "\"transaction_guid\":\"guid\","
+                      "\"status\":200},[]],"
+                      "[5,6,\"`4\","
+                      "{\"destination_name\":\"queue_name\","
+                      "\"messaging_system\":\"aws_sqs\"},[]]]]]]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 5);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_c = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
+  evt_d = (nr_span_event_t*)nr_vector_get(result.span_events, 4);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -1141,17 +1053,13 @@ static void test_json_print_segments_datastore_external_message(void) {
   nr_segment_destroy_fields(&D);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_two_generations(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_two_generations(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
 
@@ -1167,10 +1075,6 @@ static void test_json_print_segments_two_generations(void) {
   nr_segment_t C = {.txn = &txn, .start_time = 4000, .stop_time = 5000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 4;
@@ -1197,19 +1101,18 @@ static void test_json_print_segments_two_generations(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("success", true, rv);
-  test_buffer_contents("two kids", buf,
-                       "[0,9,\"`0\",{},[[1,6,\"`1\",{},[[2,3,\"`2\",{},[]],[4,"
-                       "5,\"`3\",{},[]]]]]]");
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("two kids", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,6,\"`1\",{},[[2,3,\"`2\",{},[]],[4,"
+                      "5,\"`3\",{},[]]]]]]");
 
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 4);
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 4);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_b = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_c = (nr_span_event_t*)nr_vector_get(span_events, 3);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_c = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -1228,17 +1131,13 @@ static void test_json_print_segments_two_generations(void) {
   nr_segment_destroy_fields(&C);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_async_basic(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_async_basic(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
 
@@ -1267,10 +1166,6 @@ static void test_json_print_segments_async_basic(void) {
   nr_segment_t loop_segment = {.txn = &txn, .start_time = 1000, .stop_time = 3000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 3;
@@ -1291,28 +1186,27 @@ static void test_json_print_segments_async_basic(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "Printing JSON for a basic async scenario must succeed", true, rv);
-  test_buffer_contents("basic", buf,
-                       "["
-                       "0,9,\"`0\",{},"
-                       "["
-                       "["
-                       "0,9,\"`1\",{},"
-                       "["
-                       "[1,3,\"`2\",{\"async_context\":\"`3\"},[]]"
-                       "]"
-                       "]"
-                       "]"
-                       "]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 3);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_main = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_loop = (nr_span_event_t*)nr_vector_get(span_events, 2);
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents(
+      "basic", result.trace_json,
+      "["
+      "0,9,\"`0\",{},"
+      "["
+      "["
+      "0,9,\"`1\",{},"
+      "["
+      "[1,3,\"`2\",{\"async_context\":\"`3\"},[]]"
+      "]"
+      "]"
+      "]"
+      "]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 3);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_main = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_loop = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -1329,17 +1223,13 @@ static void test_json_print_segments_async_basic(void) {
   nr_segment_destroy_fields(&loop_segment);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_async_multi_child(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_async_multi_child(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
 
@@ -1368,10 +1258,6 @@ static void test_json_print_segments_async_multi_child(void) {
   nr_segment_t a_b = {.txn = &txn, .start_time = 6000, .stop_time = 7000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 5;
@@ -1400,11 +1286,9 @@ static void test_json_print_segments_async_multi_child(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("success", true, rv);
-  test_buffer_contents(
-      "Printing JSON for a three-child async scenario must succeed", buf,
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents(
+      "three-child async", result.trace_json,
       "["
       "0,9,\"`0\",{},"
       "["
@@ -1419,13 +1303,14 @@ static void test_json_print_segments_async_multi_child(void) {
       "]"
       "]");
 
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 5);
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 5);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_main = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_a_a = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_b = (nr_span_event_t*)nr_vector_get(span_events, 3);
-  evt_a_b = (nr_span_event_t*)nr_vector_get(span_events, 4);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_main = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_a_a = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
+  evt_a_b = (nr_span_event_t*)nr_vector_get(result.span_events, 4);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -1446,17 +1331,13 @@ static void test_json_print_segments_async_multi_child(void) {
   nr_segment_destroy_fields(&a_b);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_async_multi_context(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_async_multi_context(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
 
@@ -1490,10 +1371,6 @@ static void test_json_print_segments_async_multi_context(void) {
   nr_segment_t d = {.txn = &txn, .start_time = 8000, .stop_time = 9000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 7;
@@ -1530,35 +1407,35 @@ static void test_json_print_segments_async_multi_context(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("success", true, rv);
-  test_buffer_contents("multiple contexts", buf,
-                       "["
-                       "0,9,\"`0\",{},"
-                       "["
-                       "["
-                       "0,9,\"`1\",{},"
-                       "["
-                       "[1,3,\"`2\",{\"async_context\":\"`3\"},[]],"
-                       "[3,5,\"`4\",{\"async_context\":\"`3\"},[]],"
-                       "[6,7,\"`2\",{\"async_context\":\"`3\"},[]],"
-                       "[2,4,\"`5\",{\"async_context\":\"`6\"},[]],"
-                       "[8,9,\"`7\",{\"async_context\":\"`8\"},[]]"
-                       "]"
-                       "]"
-                       "]"
-                       "]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 7);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_main = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_a_a = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_b = (nr_span_event_t*)nr_vector_get(span_events, 3);
-  evt_a_b = (nr_span_event_t*)nr_vector_get(span_events, 4);
-  evt_c = (nr_span_event_t*)nr_vector_get(span_events, 5);
-  evt_d = (nr_span_event_t*)nr_vector_get(span_events, 6);
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents(
+      "multiple contexts", result.trace_json,
+      "["
+      "0,9,\"`0\",{},"
+      "["
+      "["
+      "0,9,\"`1\",{},"
+      "["
+      "[1,3,\"`2\",{\"async_context\":\"`3\"},[]],"
+      "[3,5,\"`4\",{\"async_context\":\"`3\"},[]],"
+      "[6,7,\"`2\",{\"async_context\":\"`3\"},[]],"
+      "[2,4,\"`5\",{\"async_context\":\"`6\"},[]],"
+      "[8,9,\"`7\",{\"async_context\":\"`8\"},[]]"
+      "]"
+      "]"
+      "]"
+      "]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 7);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_main = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_a_a = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
+  evt_a_b = (nr_span_event_t*)nr_vector_get(result.span_events, 4);
+  evt_c = (nr_span_event_t*)nr_vector_get(result.span_events, 5);
+  evt_d = (nr_span_event_t*)nr_vector_get(result.span_events, 6);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -1583,17 +1460,13 @@ static void test_json_print_segments_async_multi_context(void) {
   nr_segment_destroy_fields(&d);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_async_context_nesting(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_async_context_nesting(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
 
@@ -1640,10 +1513,6 @@ static void test_json_print_segments_async_context_nesting(void) {
   nr_segment_t e = {.txn = &txn, .start_time = 4000, .stop_time = 6000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 9;
@@ -1688,48 +1557,48 @@ static void test_json_print_segments_async_context_nesting(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal("success", true, rv);
-  test_buffer_contents("context nesting", buf,
-                       "["
-                       "0,9,\"`0\",{},"
-                       "["
-                       "["
-                       "0,9,\"`1\",{},"
-                       "["
-                       "[1,3,\"`2\",{},"
-                       "["
-                       "[2,9,\"`3\",{\"async_context\":\"`4\"},"
-                       "["
-                       "[4,6,\"`5\",{\"async_context\":\"`4\"},[]]"
-                       "]"
-                       "]"
-                       "]"
-                       "],"
-                       "[3,6,\"`6\",{},"
-                       "["
-                       "[4,6,\"`7\",{\"async_context\":\"`8\"},[]],"
-                       "[5,6,\"`9\",{},[]]"
-                       "]"
-                       "],"
-                       "[6,7,\"`10\",{\"async_context\":\"`11\"},[]]"
-                       "]"
-                       "]"
-                       "]"
-                       "]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 9);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_main = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_d = (nr_span_event_t*)nr_vector_get(span_events, 3);
-  evt_e = (nr_span_event_t*)nr_vector_get(span_events, 4);
-  evt_b = (nr_span_event_t*)nr_vector_get(span_events, 5);
-  evt_f = (nr_span_event_t*)nr_vector_get(span_events, 6);
-  evt_c = (nr_span_event_t*)nr_vector_get(span_events, 7);
-  evt_g = (nr_span_event_t*)nr_vector_get(span_events, 8);
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents(
+      "context nesting", result.trace_json,
+      "["
+      "0,9,\"`0\",{},"
+      "["
+      "["
+      "0,9,\"`1\",{},"
+      "["
+      "[1,3,\"`2\",{},"
+      "["
+      "[2,9,\"`3\",{\"async_context\":\"`4\"},"
+      "["
+      "[4,6,\"`5\",{\"async_context\":\"`4\"},[]]"
+      "]"
+      "]"
+      "]"
+      "],"
+      "[3,6,\"`6\",{},"
+      "["
+      "[4,6,\"`7\",{\"async_context\":\"`8\"},[]],"
+      "[5,6,\"`9\",{},[]]"
+      "]"
+      "],"
+      "[6,7,\"`10\",{\"async_context\":\"`11\"},[]]"
+      "]"
+      "]"
+      "]"
+      "]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 9);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_main = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_d = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
+  evt_e = (nr_span_event_t*)nr_vector_get(result.span_events, 4);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 5);
+  evt_f = (nr_span_event_t*)nr_vector_get(result.span_events, 6);
+  evt_c = (nr_span_event_t*)nr_vector_get(result.span_events, 7);
+  evt_g = (nr_span_event_t*)nr_vector_get(result.span_events, 8);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -1761,16 +1630,13 @@ static void test_json_print_segments_async_context_nesting(void) {
   nr_segment_destroy_fields(&g);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_async_with_data(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nrpool_t* segment_names;
+static void test_trace_segments_async_with_data(void) {
+  nrtxnfinal_t result = {0};
   nrobj_t* value;
 
   nrtxn_t txn = {.abs_start_time = 1000};
@@ -1791,9 +1657,6 @@ static void test_json_print_segments_async_with_data(void) {
   nr_segment_t loop = {.txn = &txn, .start_time = 1000, .stop_time = 3000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 3;
@@ -1824,11 +1687,9 @@ static void test_json_print_segments_async_with_data(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, NULL, NULL, NULL, &txn, &root,
-                                             segment_names);
-  tlib_pass_if_bool_equal("success", true, rv);
-  test_buffer_contents(
-      "basic", buf,
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents(
+      "basic", result.trace_json,
       "["
       "0,9,\"`0\",{},"
       "["
@@ -1850,19 +1711,15 @@ static void test_json_print_segments_async_with_data(void) {
   nr_segment_destroy_fields(&loop);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_with_sampling(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_with_sampling(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
-  nr_set_t* set;
 
   nr_span_event_t* evt_root;
   nr_span_event_t* evt_b;
@@ -1874,12 +1731,7 @@ static void test_json_print_segments_with_sampling(void) {
   nr_segment_t C = {.txn = &txn, .start_time = 3000, .stop_time = 4000};
   // clang-format on
 
-  set = nr_set_create();
-  nr_set_insert(set, (void*)&root);
-  nr_set_insert(set, (void*)&B);
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(8, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
+  nr_segment_t* selected[] = {&root, &B, NULL};
 
   /* Mock up the transaction */
   mock_txn(&txn, &root);
@@ -1909,24 +1761,21 @@ static void test_json_print_segments_with_sampling(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, set, set, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "Printing JSON for a sampled tree of segments must succeed", true, rv);
-  test_buffer_contents("Free samples", buf,
-                       "[0,9,\"`0\",{},[[2,5,\"`1\",{},[]]]]");
+  test_create_data(&txn, selected, selected, &result);
+  test_trace_contents("Free samples", result.trace_json,
+                      "[0,9,\"`0\",{},[[2,5,\"`1\",{},[]]]]");
 
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 2);
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 2);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_b = (nr_span_event_t*)nr_vector_get(span_events, 1);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
   SPAN_EVENT_COMPARE(evt_b, "B", NR_SPAN_GENERIC, evt_root, 3000, 3000);
 
   /* Clean up */
-  nr_set_destroy(&set);
   nr_segment_children_deinit(&root.children);
   nr_segment_destroy_fields(&root);
 
@@ -1938,20 +1787,15 @@ static void test_json_print_segments_with_sampling(void) {
   nr_segment_destroy_fields(&C);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_with_sampling_cousin_parent(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_with_sampling_cousin_parent(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
-  nr_set_t* set;
 
   nr_span_event_t* evt_root;
   nr_span_event_t* evt_c;
@@ -1975,17 +1819,7 @@ static void test_json_print_segments_with_sampling_cousin_parent(void) {
   nr_segment_t K = {.txn = &txn, .start_time = 2000, .stop_time = 11000};
   // clang-format on
 
-  set = nr_set_create();
-  nr_set_insert(set, (void*)&root);
-  nr_set_insert(set, (void*)&C);
-  nr_set_insert(set, (void*)&D);
-  nr_set_insert(set, (void*)&F);
-  nr_set_insert(set, (void*)&G);
-  nr_set_insert(set, (void*)&I);
-
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(8, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
+  nr_segment_t* selected[] = {&root, &C, &D, &F, &G, &I, NULL};
 
   /* Mock up the transaction */
   mock_txn(&txn, &root);
@@ -2058,25 +1892,21 @@ static void test_json_print_segments_with_sampling_cousin_parent(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, set, set, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "Printing JSON for a sampled cousin parent tree of segments must "
-      "succeed",
-      true, rv);
-  test_buffer_contents("Cousin Parent", buf,
-                       "[0,14,\"`0\",{},[[1,5,\"`1\",{},[[1,3,\"`2\",{},[]]]],["
-                       "1,6,\"`3\",{},[[4,6,\"`4\",{},[[5,5,\"`5\",{},[]]]]]]]"
-                       "]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 6);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_c = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_i = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_d = (nr_span_event_t*)nr_vector_get(span_events, 3);
-  evt_f = (nr_span_event_t*)nr_vector_get(span_events, 4);
-  evt_g = (nr_span_event_t*)nr_vector_get(span_events, 5);
+  test_create_data(&txn, selected, selected, &result);
+  test_trace_contents("Cousin Parent", result.trace_json,
+                      "[0,14,\"`0\",{},[[1,5,\"`1\",{},[[1,3,\"`2\",{},[]]]],["
+                      "1,6,\"`3\",{},[[4,6,\"`4\",{},[[5,5,\"`5\",{},[]]]]]]]"
+                      "]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 6);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_c = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_i = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_d = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
+  evt_f = (nr_span_event_t*)nr_vector_get(result.span_events, 4);
+  evt_g = (nr_span_event_t*)nr_vector_get(result.span_events, 5);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      14000);
@@ -2087,7 +1917,6 @@ static void test_json_print_segments_with_sampling_cousin_parent(void) {
   SPAN_EVENT_COMPARE(evt_g, "G", NR_SPAN_GENERIC, evt_f, 6000, 500);
 
   /* Clean up */
-  nr_set_destroy(&set);
   nr_segment_children_deinit(&root.children);
   nr_segment_destroy_fields(&root);
 
@@ -2116,21 +1945,15 @@ static void test_json_print_segments_with_sampling_cousin_parent(void) {
   nr_segment_destroy_fields(&K);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_with_sampling_inner_loop(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_with_sampling_inner_loop(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
-  nr_set_t* trace_set;
-  nr_set_t* span_set;
 
   nr_span_event_t* evt_root;
   nr_span_event_t* evt_a;
@@ -2149,22 +1972,8 @@ static void test_json_print_segments_with_sampling_inner_loop(void) {
   nr_segment_t G = {.txn = &txn, .start_time = 5000, .stop_time = 5500};
   // clang-format on
 
-  trace_set = nr_set_create();
-  nr_set_insert(trace_set, (void*)&root);
-  nr_set_insert(trace_set, (void*)&C);
-  nr_set_insert(trace_set, (void*)&E);
-  nr_set_insert(trace_set, (void*)&G);
-
-  span_set = nr_set_create();
-  nr_set_insert(span_set, (void*)&root);
-  nr_set_insert(span_set, (void*)&A);
-  nr_set_insert(span_set, (void*)&D);
-  nr_set_insert(span_set, (void*)&F);
-  nr_set_insert(span_set, (void*)&G);
-
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(8, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
+  nr_segment_t* trace_selected[] = {&root, &C, &E, &G, NULL};
+  nr_segment_t* span_selected[] = {&root, &A, &D, &F, &G, NULL};
 
   /* Mock up the transaction */
   mock_txn(&txn, &root);
@@ -2224,21 +2033,19 @@ static void test_json_print_segments_with_sampling_inner_loop(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(
-      buf, span_events, trace_set, span_set, &txn, &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "Printing JSON for a sampled tree of segments must succeed", true, rv);
-  test_buffer_contents("Inner Loop", buf,
-                       "[0,9,\"`0\",{},[[3,4,\"`1\",{},[]],[1,4,\"`2\",{},[]],["
-                       "5,5,\"`3\",{},[]]]]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 5);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_d = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_f = (nr_span_event_t*)nr_vector_get(span_events, 3);
-  evt_g = (nr_span_event_t*)nr_vector_get(span_events, 4);
+  test_create_data(&txn, trace_selected, span_selected, &result);
+  test_trace_contents("Inner Loop", result.trace_json,
+                      "[0,9,\"`0\",{},[[3,4,\"`1\",{},[]],[1,4,\"`2\",{},[]],["
+                      "5,5,\"`3\",{},[]]]]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 5);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_d = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_f = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
+  evt_g = (nr_span_event_t*)nr_vector_get(result.span_events, 4);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -2248,8 +2055,6 @@ static void test_json_print_segments_with_sampling_inner_loop(void) {
   SPAN_EVENT_COMPARE(evt_g, "G", NR_SPAN_GENERIC, evt_f, 6000, 500);
 
   /* Clean up */
-  nr_set_destroy(&trace_set);
-  nr_set_destroy(&span_set);
   nr_segment_children_deinit(&root.children);
   nr_segment_destroy_fields(&root);
 
@@ -2270,20 +2075,15 @@ static void test_json_print_segments_with_sampling_inner_loop(void) {
   nr_segment_destroy_fields(&G);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_with_sampling_genghis_khan(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_with_sampling_genghis_khan(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
-  nr_set_t* set;
 
   nr_span_event_t* evt_root;
   nr_span_event_t* evt_a;
@@ -2307,19 +2107,7 @@ static void test_json_print_segments_with_sampling_genghis_khan(void) {
   nr_segment_t I = {.txn = &txn, .start_time = 0,    .stop_time = 6000};
   // clang-format on
 
-  set = nr_set_create();
-  nr_set_insert(set, (void*)&root);
-  nr_set_insert(set, (void*)&A);
-  nr_set_insert(set, (void*)&C);
-  nr_set_insert(set, (void*)&E);
-  nr_set_insert(set, (void*)&F);
-  nr_set_insert(set, (void*)&G);
-  nr_set_insert(set, (void*)&H);
-  nr_set_insert(set, (void*)&I);
-
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(8, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
+  nr_segment_t* selected[] = {&root, &A, &C, &E, &F, &G, &H, &I, NULL};
 
   /* Mock up the transaction */
   mock_txn(&txn, &root);
@@ -2373,27 +2161,23 @@ static void test_json_print_segments_with_sampling_genghis_khan(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, set, set, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "Printing JSON for a genghis khan sampled tree of segments must "
-      "succeed",
-      true, rv);
-  test_buffer_contents("genghis khan", buf,
-                       "[0,9,\"`0\",{},[[1,6,\"`1\",{},[]],[3,4,\"`2\",{},[]],["
-                       "1,4,\"`3\",{},[]],[4,6,\"`4\",{},[]],[0,8,\"`5\",{},[]]"
-                       ",[2,3,\"`6\",{},[]],[0,6,\"`7\",{},[]]]]");
-
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 8);
-
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_c = (nr_span_event_t*)nr_vector_get(span_events, 2);
-  evt_e = (nr_span_event_t*)nr_vector_get(span_events, 3);
-  evt_f = (nr_span_event_t*)nr_vector_get(span_events, 4);
-  evt_g = (nr_span_event_t*)nr_vector_get(span_events, 5);
-  evt_h = (nr_span_event_t*)nr_vector_get(span_events, 6);
-  evt_i = (nr_span_event_t*)nr_vector_get(span_events, 7);
+  test_create_data(&txn, selected, selected, &result);
+  test_trace_contents("genghis khan", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,6,\"`1\",{},[]],[3,4,\"`2\",{},[]],["
+                      "1,4,\"`3\",{},[]],[4,6,\"`4\",{},[]],[0,8,\"`5\",{},[]]"
+                      ",[2,3,\"`6\",{},[]],[0,6,\"`7\",{},[]]]]");
+
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 8);
+
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_c = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
+  evt_e = (nr_span_event_t*)nr_vector_get(result.span_events, 3);
+  evt_f = (nr_span_event_t*)nr_vector_get(result.span_events, 4);
+  evt_g = (nr_span_event_t*)nr_vector_get(result.span_events, 5);
+  evt_h = (nr_span_event_t*)nr_vector_get(result.span_events, 6);
+  evt_i = (nr_span_event_t*)nr_vector_get(result.span_events, 7);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -2406,7 +2190,6 @@ static void test_json_print_segments_with_sampling_genghis_khan(void) {
   SPAN_EVENT_COMPARE(evt_i, "I", NR_SPAN_GENERIC, evt_root, 1000, 6000);
 
   /* Clean up */
-  nr_set_destroy(&set);
   nr_segment_children_deinit(&root.children);
   nr_segment_destroy_fields(&root);
 
@@ -2431,17 +2214,13 @@ static void test_json_print_segments_with_sampling_genghis_khan(void) {
   nr_segment_destroy_fields(&I);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
-static void test_json_print_segments_extremely_short(void) {
-  bool rv;
-  nrbuf_t* buf;
-  nr_vector_t* span_events;
-  nrpool_t* segment_names;
+static void test_trace_segments_extremely_short(void) {
+  nrtxnfinal_t result = {0};
 
   nrtxn_t txn = {.abs_start_time = 1000};
 
@@ -2456,10 +2235,6 @@ static void test_json_print_segments_extremely_short(void) {
   nr_segment_t C = {.txn = &txn, .start_time = 3000, .stop_time = 4000};
   // clang-format on
 
-  buf = nr_buffer_create(4096, 4096);
-  span_events = nr_vector_create(9, nr_vector_span_event_dtor, NULL);
-  segment_names = nr_string_pool_create();
-
   /* Mock up the transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 4;
@@ -2488,20 +2263,17 @@ static void test_json_print_segments_extremely_short(void) {
   /*
    * Test : Normal operation
    */
-  rv = nr_segment_traces_json_print_segments(buf, span_events, NULL, NULL, &txn,
-                                             &root, segment_names);
-  tlib_pass_if_bool_equal(
-      "A segment with zero duration must not appear in the transaction trace",
-      true, rv);
-  test_buffer_contents("segment B omitted", buf,
-                       "[0,9,\"`0\",{},[[1,6,\"`1\",{},[[3,4,\"`2\",{},"
-                       "[]]]]]]");
+  test_create_data(&txn, NULL, NULL, &result);
+  test_trace_contents("segment B omitted", result.trace_json,
+                      "[0,9,\"`0\",{},[[1,6,\"`1\",{},[[3,4,\"`2\",{},"
+                      "[]]]]]]");
 
-  tlib_pass_if_uint_equal("span event size", nr_vector_size(span_events), 3);
+  tlib_pass_if_uint_equal("span event size",
+                          nr_vector_size(result.span_events), 3);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(span_events, 0);
-  evt_a = (nr_span_event_t*)nr_vector_get(span_events, 1);
-  evt_c = (nr_span_event_t*)nr_vector_get(span_events, 2);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
+  evt_c = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
 
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
@@ -2520,16 +2292,16 @@ static void test_json_print_segments_extremely_short(void) {
   nr_segment_destroy_fields(&C);
 
   cleanup_mock_txn(&txn);
-  nr_string_pool_destroy(&segment_names);
 
-  nr_buffer_destroy(&buf);
-  nr_vector_destroy(&span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
 }
 
 static void test_trace_create_data_bad_parameters(void) {
   nrtxn_t txn = {.abs_start_time = 1000};
-  uintptr_t i;
-  nr_segment_tree_sampling_metadata_t metadata = {.trace_set = NULL};
+  int i;
+  nr_segment_t* children;
+  nr_vector_t* segments;
   nrtxnfinal_t result = {.trace_json = NULL};
 
   // clang-format off
@@ -2540,55 +2312,90 @@ static void test_trace_create_data_bad_parameters(void) {
   nrobj_t* user_attributes = nro_create_from_json("[\"user_attributes\"]");
   nrobj_t* intrinsics = nro_create_from_json("[\"intrinsics\"]");
 
-  metadata.out = &result;
-  metadata.trace_set = nr_set_create();
+  txn.segment_root = &root;
+  segments = test_select_segments(&root, NULL);
 
   /*
    * Test : Bad parameters
    */
-  nr_segment_traces_create_data(NULL, 2 * NR_TIME_DIVISOR, &metadata,
-                                agent_attributes, user_attributes, intrinsics,
-                                true, false);
+  nr_segment_traces_create_data_from_selection(NULL, 0, NULL, NULL, NULL, NULL,
+                                               NULL, NULL);
+
+  nr_segment_traces_create_data_from_selection(NULL, 0, NULL, NULL, NULL, NULL,
+                                               NULL, &result);
+  tlib_pass_if_null("NULL input params must not succeed in creating a trace",
+                    result.trace_json);
+  tlib_pass_if_null(
+      "NULL input params must not succeed in creating span events",
+      result.span_events);
+
+  nr_segment_traces_create_data_from_selection(
+      NULL, 2 * NR_TIME_DIVISOR, segments, NULL, agent_attributes,
+      user_attributes, intrinsics, &result);
   tlib_pass_if_null(
       "A NULL transaction pointer must not succeed in creating a trace",
-      metadata.out->trace_json);
+      result.trace_json);
 
-  nr_segment_traces_create_data(&txn, 2 * NR_TIME_DIVISOR, &metadata,
-                                agent_attributes, user_attributes, intrinsics,
-                                true, false);
+  nr_segment_traces_create_data_from_selection(
+      &txn, 2 * NR_TIME_DIVISOR, segments, NULL, agent_attributes,
+      user_attributes, intrinsics, &result);
   tlib_pass_if_null(
       "A zero-sized transaction must not succeed in creating a trace",
-      metadata.out->trace_json);
+      result.trace_json);
 
   txn.segment_count = 1;
-  txn.segment_root = &root;
 
-  nr_segment_traces_create_data(&txn, 0, &metadata, agent_attributes,
-                                user_attributes, intrinsics, true, false);
+  nr_segment_traces_create_data_from_selection(&txn, 0, segments, NULL,
+                                               agent_attributes,
+                                               user_attributes, intrinsics,
+                                               &result);
   tlib_pass_if_null(
       "A zero-duration transaction must not succeed in creating a trace",
-      metadata.out->trace_json);
+      result.trace_json);
 
-  /* Insert initial values. */
-  for (i = 0; i < NR_MAX_SEGMENTS + 1; i++) {
-    nr_set_insert(metadata.trace_set, (const void*)i);
+  nr_segment_traces_create_data_from_selection(
+      &txn, 2 * NR_TIME_DIVISOR, NULL, NULL, agent_attributes,
+      user_attributes, intrinsics, &result);
+  tlib_pass_if_null(
+      "A transaction without selected segments must not succeed in creating "
+      "a trace",
+      result.trace_json);
+  tlib_pass_if_null(
+      "A transaction without selected segments must not succeed in creating "
+      "span events",
+      result.span_events);
+
+  nr_vector_destroy(&segments);
+
+  /* Select more than NR_MAX_SEGMENTS segments for the trace. */
+  children = (nr_segment_t*)nr_calloc(NR_MAX_SEGMENTS, sizeof(nr_segment_t));
+  segments = nr_vector_create(NR_MAX_SEGMENTS + 1, NULL, NULL);
+  nr_segment_children_init(&root.children);
+  nr_vector_push_back(segments, &root);
+  for (i = 0; i < NR_MAX_SEGMENTS; i++) {
+    children[i].txn = &txn;
+    children[i].start_time = 1000;
+    children[i].stop_time = 2000;
+    nr_segment_add_child(&root, &children[i]);
+    nr_vector_push_back(segments, &children[i]);
   }
+  txn.segment_count = NR_MAX_SEGMENTS + 1;
 
-  nr_segment_traces_create_data(&txn, 2 * NR_TIME_DIVISOR, &metadata,
-                                agent_attributes, user_attributes, intrinsics,
-                                true, false);
+  nr_segment_traces_create_data_from_selection(
+      &txn, 2 * NR_TIME_DIVISOR, segments, NULL, agent_attributes,
+      user_attributes, intrinsics, &result);
   tlib_pass_if_null(
       "A transaction with more than NR_MAX_SEGMENTS segments must not "
-      "succeed "
-      "in creating "
-      "a trace",
-      metadata.out->trace_json);
+      "succeed in creating a trace",
+      result.trace_json);
 
-  nr_segment_traces_create_data(&txn, 2 * NR_TIME_DIVISOR, NULL,
-                                agent_attributes, user_attributes, intrinsics,
-                                true, false);
+  nr_segment_traces_create_data_from_selection(
+      &txn, 2 * NR_TIME_DIVISOR, segments, NULL, agent_attributes,
+      user_attributes, intrinsics, NULL);
 
-  nr_set_destroy(&metadata.trace_set);
+  nr_vector_destroy(&segments);
+  nr_segment_children_deinit(&root.children);
+  nr_free(children);
   nro_delete(agent_attributes);
   nro_delete(user_attributes);
   nro_delete(intrinsics);
@@ -2596,8 +2403,8 @@ static void test_trace_create_data_bad_parameters(void) {
 
 static void test_trace_create_trace_spans(void) {
   nrtxn_t txn = {.abs_start_time = 1000};
-  nr_segment_tree_sampling_metadata_t metadata = {0};
   nrtxnfinal_t result = {0};
+  nr_vector_t* segments;
 
   nrobj_t* agent_attributes = nro_create_from_json("[\"agent_attributes\"]");
   nrobj_t* user_attributes = nro_create_from_json("[\"user_attributes\"]");
@@ -2608,8 +2415,6 @@ static void test_trace_create_trace_spans(void) {
   nr_segment_t A = {.txn = &txn, .start_time = 1000, .stop_time = 2000};
   // clang-format on
 
-  metadata.out = &result;
-
   /* Mock up a transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 2;
@@ -2623,62 +2428,64 @@ static void test_trace_create_trace_spans(void) {
   root.name = nr_string_add(txn.trace_strings, "WebTransaction/*");
   A.name = nr_string_add(txn.trace_strings, "A");
 
+  segments = test_select_segments(&root, NULL);
+
   /*
    * Test : Create none of span events and traces
    */
-  nr_segment_traces_create_data(&txn, 2 * NR_TIME_DIVISOR, &metadata,
-                                agent_attributes, user_attributes, intrinsics,
-                                false, false);
+  nr_segment_traces_create_data_from_selection(
+      &txn, 2 * NR_TIME_DIVISOR, NULL, NULL, agent_attributes,
+      user_attributes, intrinsics, &result);
 
-  tlib_pass_if_null("Trace must not be created", metadata.out->trace_json);
-  tlib_pass_if_null("Span events must not be created",
-                    metadata.out->span_events);
+  tlib_pass_if_null("Trace must not be created", result.trace_json);
+  tlib_pass_if_null("Span events must not be created", result.span_events);
 
-  nr_realfree((void**)&metadata.out->trace_json);
-  nr_vector_destroy(&metadata.out->span_events);
+  nr_realfree((void**)&result.trace_json);
+  nr_vector_destroy(&result.span_events);
 
   /*
    * Test : Create both span events and traces
    */
-  nr_segment_traces_create_data(&txn, 2 * NR_TIME_DIVISOR, &metadata,
-                                agent_attributes, user_attributes, intrinsics,
-                                true, true);
+  nr_segment_traces_create_data_from_selection(
+      &txn, 2 * NR_TIME_DIVISOR, segments, segments, agent_attributes,
+      user_attributes, intrinsics, &result);
 
   tlib_pass_if_not_null("Both traces and span events must be created",
-                        metadata.out->trace_json);
+                        result.trace_json);
   tlib_pass_if_not_null("Both traces and span events must be created",
-                        metadata.out->span_events);
+                        result.span_events);
 
-  nr_realfree((void**)&metadata.out->trace_json);
-  nr_vector_destroy(&metadata.out->span_events);
+  nr_realfree((void**)&result.trace_json);
+  nr_vector_destroy(&result.span_events);
 
   /*
    * Test : Create only traces
    */
-  nr_segment_traces_create_data(&txn, 2 * NR_TIME_DIVISOR, &metadata,
-                                agent_attributes, user_attributes, intrinsics,
-                                true, false);
+  nr_segment_traces_create_data_from_selection(
+      &txn, 2 * NR_TIME_DIVISOR, segments, NULL, agent_attributes,
+      user_attributes, intrinsics, &result);
 
-  tlib_pass_if_not_null("Create only traces", metadata.out->trace_json);
-  tlib_pass_if_null("Create only traces", metadata.out->span_events);
+  tlib_pass_if_not_null("Create only traces", result.trace_json);
+  tlib_pass_if_null("Create only traces", result.span_events);
 
-  nr_realfree((void**)&metadata.out->trace_json);
-  nr_vector_destroy(&metadata.out->span_events);
+  nr_realfree((void**)&result.trace_json);
+  nr_vector_destroy(&result.span_events);
 
   /*
    * Test : Create only span events
    */
-  nr_segment_traces_create_data(&txn, 2 * NR_TIME_DIVISOR, &metadata,
-                                agent_attributes, user_attributes, intrinsics,
-                                false, true);
+  nr_segment_traces_create_data_from_selection(
+      &txn, 2 * NR_TIME_DIVISOR, NULL, segments, agent_attributes,
+      user_attributes, intrinsics, &result);
 
-  tlib_pass_if_null("Create only span events", metadata.out->trace_json);
-  tlib_pass_if_not_null("Create only span events", metadata.out->span_events);
+  tlib_pass_if_null("Create only span events", result.trace_json);
+  tlib_pass_if_not_null("Create only span events", result.span_events);
 
-  nr_realfree((void**)&metadata.out->trace_json);
-  nr_vector_destroy(&metadata.out->span_events);
+  nr_realfree((void**)&result.trace_json);
+  nr_vector_destroy(&result.span_events);
 
   /* Clean up */
+  nr_vector_destroy(&segments);
   nr_free(txn.name);
   cleanup_mock_txn(&txn);
 
@@ -2693,8 +2500,8 @@ static void test_trace_create_trace_spans(void) {
 
 static void test_trace_create_data(void) {
   nrtxn_t txn = {.abs_start_time = 1000};
-  nr_segment_tree_sampling_metadata_t metadata = {.trace_set = NULL};
   nrtxnfinal_t result = {.trace_json = NULL};
+  nr_vector_t* segments;
 
   nrobj_t* agent_attributes = nro_create_from_json("[\"agent_attributes\"]");
   nrobj_t* user_attributes = nro_create_from_json("[\"user_attributes\"]");
@@ -2711,8 +2518,6 @@ static void test_trace_create_data(void) {
   nr_segment_t B = {.txn = &txn, .start_time = 3000, .stop_time = 4000};
   // clang-format on
 
-  metadata.out = &result;
-
   /* Mock up a transaction */
   mock_txn(&txn, &root);
   txn.segment_count = 3;
@@ -2733,16 +2538,18 @@ static void test_trace_create_data(void) {
   A.name = nr_string_add(txn.trace_strings, "A");
   B.name = nr_string_add(txn.trace_strings, "B");
 
+  segments = test_select_segments(&root, NULL);
+
   /*
    * Test : Normal operation
    */
-  nr_segment_traces_create_data(&txn, 2 * NR_TIME_DIVISOR, &metadata,
-                                agent_attributes, user_attributes, intrinsics,
-                                true, true);
+  nr_segment_traces_create_data_from_selection(
+      &txn, 2 * NR_TIME_DIVISOR, segments, segments, agent_attributes,
+      user_attributes, intrinsics, &result);
 
   tlib_pass_if_str_equal(
       "A multi-node transaction must succeed in creating a trace",
-      metadata.out->trace_json,
+      result.trace_json,
       "[[0,{},{},[0,2000,\"ROOT\",{},[[0,9,\"`0\",{},[[1,2,"
       "\"`1\",{},[]],[3,4,\"`2\",{},[]]]]]],"
       "{\"agentAttributes\":[\"agent_attributes\"],"
@@ -2750,25 +2557,26 @@ static void test_trace_create_data(void) {
       "\"intrinsics\":[\"intrinsics\"]}],"
       "[\"WebTransaction\\/*\",\"A\",\"B\"]]");
 
-  obj = nro_create_from_json(metadata.out->trace_json);
+  obj = nro_create_from_json(result.trace_json);
   tlib_pass_if_not_null(
       "A multi-node transaction must succeed in creating valid json", obj);
 
   tlib_pass_if_uint_equal("span event size",
-                          nr_vector_size(metadata.out->span_events), 3);
+                          nr_vector_size(result.span_events), 3);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(metadata.out->span_events, 0);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
-  evt_a = (nr_span_event_t*)nr_vector_get(metadata.out->span_events, 1);
+  evt_a = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
   SPAN_EVENT_COMPARE(evt_a, "A", NR_SPAN_GENERIC, evt_root, 2000, 1000);
-  evt_b = (nr_span_event_t*)nr_vector_get(metadata.out->span_events, 2);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 2);
   SPAN_EVENT_COMPARE(evt_b, "B", NR_SPAN_GENERIC, evt_root, 4000, 1000);
 
   /* Clean up */
   nro_delete(obj);
-  nr_free(metadata.out->trace_json);
-  nr_vector_destroy(&metadata.out->span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
+  nr_vector_destroy(&segments);
   nr_free(txn.name);
 
   nr_segment_children_deinit(&root.children);
@@ -2785,8 +2593,9 @@ static void test_trace_create_data(void) {
 
 static void test_trace_create_data_with_sampling(void) {
   nrtxn_t txn = {.abs_start_time = 1000};
-  nr_segment_tree_sampling_metadata_t metadata = {.trace_set = NULL};
   nrtxnfinal_t result = {.trace_json = NULL};
+  nr_vector_t* trace_segments;
+  nr_vector_t* span_segments;
 
   nrobj_t* agent_attributes = nro_create_from_json("[\"agent_attributes\"]");
   nrobj_t* user_attributes = nro_create_from_json("[\"user_attributes\"]");
@@ -2801,13 +2610,8 @@ static void test_trace_create_data_with_sampling(void) {
   nr_segment_t B = {.txn = &txn, .start_time = 3000, .stop_time = 4000};
   // clang-format on
 
-  metadata.out = &result;
-  metadata.trace_set = nr_set_create();
-  nr_set_insert(metadata.trace_set, (void*)&root);
-  nr_set_insert(metadata.trace_set, (void*)&A);
-  metadata.span_set = nr_set_create();
-  nr_set_insert(metadata.span_set, (void*)&root);
-  nr_set_insert(metadata.span_set, (void*)&B);
+  nr_segment_t* trace_selected[] = {&root, &A, NULL};
+  nr_segment_t* span_selected[] = {&root, &B, NULL};
 
   /* Mock up a transaction */
   mock_txn(&txn, &root);
@@ -2833,16 +2637,19 @@ static void test_trace_create_data_with_sampling(void) {
   A.name = nr_string_add(txn.trace_strings, "A");
   B.name = nr_string_add(txn.trace_strings, "B");
 
+  trace_segments = test_select_segments(&root, trace_selected);
+  span_segments = test_select_segments(&root, span_selected);
+
   /*
    * Test : Normal operation
    */
-  nr_segment_traces_create_data(&txn, 2 * NR_TIME_DIVISOR, &metadata,
-                                agent_attributes, user_attributes, intrinsics,
-                                true, true);
+  nr_segment_traces_create_data_from_selection(
+      &txn, 2 * NR_TIME_DIVISOR, trace_segments, span_segments,
+      agent_attributes, user_attributes, intrinsics, &result);
 
   tlib_pass_if_str_equal(
       "A transaction with sampling must succeed in creating a trace",
-      metadata.out->trace_json,
+      result.trace_json,
       "[[0,{},{},[0,2000,\"ROOT\",{},[[0,9,\"`0\",{},[[1,2,"
       "\"`1\",{},[]]]]]],"
       "{\"agentAttributes\":[\"agent_attributes\"],"
@@ -2850,23 +2657,25 @@ static void test_trace_create_data_with_sampling(void) {
       "\"intrinsics\":[\"intrinsics\"]}],"
       "[\"WebTransaction\\/*\",\"A\"]]");
 
-  obj = nro_create_from_json(metadata.out->trace_json);
+  obj = nro_create_from_json(result.trace_json);
   tlib_pass_if_not_null(
       "A transaction with sampling must succeed in creating valid json", obj);
 
   tlib_pass_if_uint_equal("span event size",
-                          nr_vector_size(metadata.out->span_events), 2);
+                          nr_vector_size(result.span_events), 2);
 
-  evt_root = (nr_span_event_t*)nr_vector_get(metadata.out->span_events, 0);
+  evt_root = (nr_span_event_t*)nr_vector_get(result.span_events, 0);
   SPAN_EVENT_COMPARE(evt_root, "WebTransaction/*", NR_SPAN_GENERIC, NULL, 1000,
                      9000);
-  evt_b = (nr_span_event_t*)nr_vector_get(metadata.out->span_events, 1);
+  evt_b = (nr_span_event_t*)nr_vector_get(result.span_events, 1);
   SPAN_EVENT_COMPARE(evt_b, "B", NR_SPAN_GENERIC, evt_root, 4000, 1000);
 
   /* Clean up */
   nro_delete(obj);
-  nr_free(metadata.out->trace_json);
-  nr_vector_destroy(&metadata.out->span_events);
+  nr_free(result.trace_json);
+  nr_vector_destroy(&result.span_events);
+  nr_vector_destroy(&trace_segments);
+  nr_vector_destroy(&span_segments);
   nr_free(txn.name);
 
   nr_segment_children_deinit(&root.children);
@@ -2879,40 +2688,37 @@ static void test_trace_create_data_with_sampling(void) {
   nro_delete(agent_attributes);
   nro_delete(user_attributes);
   nro_delete(intrinsics);
-  nr_set_destroy(&metadata.span_set);
-  nr_set_destroy(&metadata.trace_set);
 }
 
 tlib_parallel_info_t parallel_info = {.suggested_nthreads = 2, .state_size = 0};
 
 void test_main(void* p NRUNUSED) {
-  test_json_print_bad_parameters();
-  test_json_print_segments_root_only();
-  test_json_print_segments_bad_segments();
-
-  test_json_print_segment_with_data();
-  test_json_print_segments_two_nodes();
-  test_json_print_segments_hanoi();
-  test_json_print_segments_three_siblings();
-  test_json_print_segments_two_generations();
-  test_json_print_segments_datastore_external_message();
-  test_json_print_segments_datastore_params();
-  test_json_print_segments_external_async_user_attrs();
-  test_json_print_segments_message_attributes();
-
-  test_json_print_segments_async_basic();
-  test_json_print_segments_async_multi_child();
-  test_json_print_segments_async_multi_context();
-  test_json_print_segments_async_context_nesting();
-  test_json_print_segments_async_with_data();
-
-  test_json_print_segments_with_sampling();
-  test_json_print_segments_with_sampling_cousin_parent();
-  test_json_print_segments_with_sampling_inner_loop();
-  test_json_print_segments_with_sampling_genghis_khan();
-  test_json_print_segments_invalid_typed_attributes();
-
-  test_json_print_segments_extremely_short();
+  test_trace_segments_root_only();
+  test_trace_segments_unknown_name();
+
+  test_trace_segment_with_data();
+  test_trace_segments_two_nodes();
+  test_trace_segments_hanoi();
+  test_trace_segments_three_siblings();
+  test_trace_segments_two_generations();
+  test_trace_segments_datastore_external_message();
+  test_trace_segments_datastore_params();
+  test_trace_segments_external_async_user_attrs();
+  test_trace_segments_message_attributes();
+
+  test_trace_segments_async_basic();
+  test_trace_segments_async_multi_child();
+  test_trace_segments_async_multi_context();
+  test_trace_segments_async_context_nesting();
+  test_trace_segments_async_with_data();
+
+  test_trace_segments_with_sampling();
+  test_trace_segments_with_sampling_cousin_parent();
+  test_trace_segments_with_sampling_inner_loop();
+  test_trace_segments_with_sampling_genghis_khan();
+  test_trace_segments_invalid_typed_attributes();
+
+  test_trace_segments_extremely_short();
 
   test_trace_create_data_bad_parameters();
   test_trace_create_data();
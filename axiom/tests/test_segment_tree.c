@@ -971,133 +971,136 @@ static void test_finalise_with_extended_sampling(void) {
   nr_slab_destroy(&txn.segment_slab);
 }
 
-static void test_nearest_sampled_ancestor(void) {
-  nr_set_t* set;
-  nr_segment_t* ancestor = NULL;
-  nrtxn_t txn = {0};
-
-  nr_segment_t root = {.name = 0, .txn = &txn};
-  nr_segment_t A = {.name = 1, .txn = &txn};
-  nr_segment_t B = {.name = 2, .txn = &txn};
-  nr_segment_t child = {.name = 3, .txn = &txn};
-  txn.segment_root = &root;
+static void test_finalise_zero_duration_and_invalid(void) {
+  nrtxn_t txn = {.abs_start_time = 1000};
+  nrtxnfinal_t result;
+  nr_segment_t* root;
+  nr_segment_t* zero;
+  nr_segment_t* child;
 
-  /*
-   *         ----------Root-----------
-   *                  /
-   *            -----A-----
-   *                /
-   *           ----B----
-   *              /
-   *          -child-
-   */
+  txn.segment_slab = nr_slab_create(sizeof(nr_segment_t), 0);
+  txn.trace_strings = nr_string_pool_create();
+  txn.scoped_metrics = nrm_table_create(NR_METRIC_DEFAULT_LIMIT);
+  txn.unscoped_metrics = nrm_table_create(NR_METRIC_DEFAULT_LIMIT);
 
-  set = nr_set_create();
-  nr_set_insert(set, (void*)&child);
+  root = nr_slab_next(txn.segment_slab);
+  root->txn = &txn;
+  root->start_time = 0;
+  root->stop_time = 9000;
+  root->name = nr_string_add(txn.trace_strings, "WebTransaction/*");
+  nr_segment_children_init(&root->children);
 
-  nr_segment_children_init(&root.children);
-  nr_segment_children_init(&A.children);
-  nr_segment_children_init(&B.children);
+  zero = nr_slab_next(txn.segment_slab);
+  zero->txn = &txn;
+  zero->start_time = 1000;
+  zero->stop_time = 1000;
+  zero->name = nr_string_add(txn.trace_strings, "zero");
+  nr_segment_children_init(&zero->children);
+  nr_segment_add_child(root, zero);
+
+  child = nr_slab_next(txn.segment_slab);
+  child->txn = &txn;
+  child->start_time = 2000;
+  child->stop_time = 3000;
+  child->name = nr_string_add(txn.trace_strings, "child");
+  nr_segment_add_child(zero, child);
 
-  nr_segment_add_child(&root, &A);
-  nr_segment_add_child(&A, &B);
-  nr_segment_add_child(&B, &child);
+  txn.segment_root = root;
+  txn.segment_count = 3;
 
   /*
-   * Test : Bad parameters
+   * Test : Zero duration segments are not part of the trace, and their
+   *        children are nested under the nearest ancestor that is.
    */
-  ancestor = nr_segment_tree_get_nearest_sampled_ancestor(NULL, &child);
-  tlib_pass_if_null("Passing in a NULL set returns NULL", ancestor);
-
-  ancestor = nr_segment_tree_get_nearest_sampled_ancestor(set, NULL);
-  tlib_pass_if_null("Passing in a NULL segment returns NULL", ancestor);
+  result = nr_segment_tree_finalise(&txn, 3, 0, NULL, NULL);
+  tlib_pass_if_str_equal(
+      "Children of zero duration segments must be nested under their nearest "
+      "traced ancestor",
+      result.trace_json,
+      "[[0,{},{},[0,9,\"ROOT\",{},[[0,9,\"`0\",{},[[2,3,\"`1\",{},[]]]]]],{}],"
+      "[\"WebTransaction\\/*\",\"child\"]]");
+  nr_txn_final_destroy_fields(&result);
 
   /*
-   * Test : There is no sampled ancestor
+   * Test : A segment that stops before it starts invalidates the trace.
    */
-  ancestor = nr_segment_tree_get_nearest_sampled_ancestor(set, &child);
-  tlib_pass_if_null(
-      "Passing in a set without any sampled ancestors returns NULL", ancestor);
-  /*
-   * Test : There is a sampled ancestor
-   */
-  nr_segment_add_child(&root, &A);
-  nr_set_insert(set, (void*)&root);
-  ancestor = nr_segment_tree_get_nearest_sampled_ancestor(set, &child);
-  tlib_pass_if_ptr_equal("The returned ancestor should be the root", &root,
-                         ancestor);
-
-  nr_set_destroy(&set);
-  nr_segment_children_deinit(&root.children);
-  nr_segment_destroy_fields(&root);
-
-  nr_segment_children_deinit(&A.children);
-  nr_segment_children_deinit(&B.children);
-
-  nr_segment_destroy_fields(&A);
-  nr_segment_destroy_fields(&B);
-  nr_segment_destroy_fields(&child);
+  child->start_time = 4000;
+  result = nr_segment_tree_finalise(&txn, 3, 0, NULL, NULL);
+  tlib_pass_if_null("An invalid segment must discard the trace",
+                    result.trace_json);
+  nr_txn_final_destroy_fields(&result);
+
+  nrm_table_destroy(&txn.scoped_metrics);
+  nrm_table_destroy(&txn.unscoped_metrics);
+  nr_string_pool_destroy(&txn.trace_strings);
+
+  nr_segment_destroy_tree(txn.segment_root);
+  nr_slab_destroy(&txn.segment_slab);
 }
 
-static void test_nearest_sampled_ancestor_cycle(void) {
-  nr_set_t* set;
-  nr_segment_t* ancestor = NULL;
+static void test_finalise_bad_segments(void) {
   nrtxn_t txn = {0};
+  nrtxnfinal_t result;
+  nr_segment_t* root;
+  nr_segment_t* child;
 
-  nr_segment_t root = {.name = 0, .txn = &txn};
-  nr_segment_t A = {.name = 1, .txn = &txn};
-  nr_segment_t B = {.name = 2, .txn = &txn};
-  nr_segment_t child = {.name = 3, .txn = &txn};
+  /* Mock up a sampled transaction that creates traces and span events */
+  txn.abs_start_time = 1000;
+  txn.distributed_trace = nr_distributed_trace_create();
+  nr_distributed_trace_set_sampled(txn.distributed_trace, true);
+  txn.options.distributed_tracing_enabled = true;
+  txn.options.span_events_enabled = true;
 
-  txn.segment_root = &root;
+  txn.segment_slab = nr_slab_create(sizeof(nr_segment_t), 0);
+  txn.trace_strings = nr_string_pool_create();
+  txn.scoped_metrics = nrm_table_create(NR_METRIC_DEFAULT_LIMIT);
+  txn.unscoped_metrics = nrm_table_create(NR_METRIC_DEFAULT_LIMIT);
 
-  set = nr_set_create();
-  nr_set_insert(set, (void*)&child);
+  /*    ------root-------
+   *       --child--
+   */
+  root = nr_slab_next(txn.segment_slab);
+  root->txn = &txn;
+  root->start_time = 0;
+  root->stop_time = 9000;
+  root->name = nr_string_add(txn.trace_strings, "WebTransaction/*");
+  nr_segment_children_init(&root->children);
 
-  nr_segment_children_init(&root.children);
-  nr_segment_children_init(&A.children);
-  nr_segment_children_init(&B.children);
+  child = nr_slab_next(txn.segment_slab);
+  child->txn = &txn;
+  child->start_time = 1000;
+  child->stop_time = 3000;
+  child->name = nr_string_add(txn.trace_strings, "Mongo/alpha");
+  nr_segment_add_child(root, child);
 
-  nr_segment_add_child(&root, &A);
-  nr_segment_add_child(&A, &B);
-  nr_segment_add_child(&B, &child);
+  txn.segment_root = root;
+  txn.segment_count = 2;
 
   /*
-   * Test : There is a cycle in the tree that does not include the target
-   *        segment. The target segment is the only one sampled.
+   * Test : A valid tree creates both a trace and span events.
    */
+  result = nr_segment_tree_finalise(&txn, 2, 2, NULL, NULL);
+  tlib_pass_if_not_null("A valid tree must create a trace", result.trace_json);
+  tlib_pass_if_size_t_equal("A valid tree must create span events", 2,
+                            nr_vector_size(result.span_events));
+  nr_txn_final_destroy_fields(&result);
 
   /*
-   *         ----------Root-----------
-   *                  /      |
-   *            -----A-----  |
-   *                /        |
-   *           ----B----     |
-   *              /    |     |
-   *          -child-  |     |
-   *                   +-->--+
+   * Test : Segment stop before segment start
    */
-  nr_segment_add_child(&B, &root);
-  ancestor = nr_segment_tree_get_nearest_sampled_ancestor(set, &child);
+  child->start_time = 4000;
+  child->stop_time = 2000;
+  result = nr_segment_tree_finalise(&txn, 2, 2, NULL, NULL);
   tlib_pass_if_null(
-      "Passing in a tree with a cycle and no sampled ancestors returns NULL",
-      ancestor);
-
-  // Test : There is a cycle but the segment has a sampled parent.
-  nr_set_insert(set, (void*)&A);
-  ancestor = nr_segment_tree_get_nearest_sampled_ancestor(set, &child);
-  tlib_pass_if_ptr_equal("The returned ancestor should be A", &A, ancestor);
-
-  nr_set_destroy(&set);
-  nr_segment_children_deinit(&root.children);
-  nr_segment_destroy_fields(&root);
-
-  nr_segment_children_deinit(&A.children);
-  nr_segment_children_deinit(&B.children);
+      "A segment that has out of order start and stop must not create a trace",
+      result.trace_json);
+  tlib_pass_if_null(
+      "A segment that has out of order start and stop must not create span "
+      "events",
+      result.span_events);
+  nr_txn_final_destroy_fields(&result);
 
-  nr_segment_destroy_fields(&A);
-  nr_segment_destroy_fields(&B);
-  nr_segment_destroy_fields(&child);
+  nr_txn_destroy_fields(&txn);
 }
 
 tlib_parallel_info_t parallel_info = {.suggested_nthreads = 4, .state_size = 0};
@@ -1111,7 +1114,7 @@ void test_main(void* p NRUNUSED) {
   test_finalise_total_time_discounted_sync();
   test_finalise_with_sampling();
   test_finalise_with_extended_sampling();
+  test_finalise_zero_duration_and_invalid();
+  test_finalise_bad_segments();
   test_finalise_span_priority();
-  test_nearest_sampled_ancestor();
-  test_nearest_sampled_ancestor_cycle();
 }
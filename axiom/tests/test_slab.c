@@ -230,11 +230,88 @@ static void test_count(void) {
   nr_slab_destroy(&slab);
 }
 
-tlib_parallel_info_t parallel_info = {.suggested_nthreads = 2, .state_size = 0};
+static void test_page_cache(void) {
+  int i;
+  char* obj;
+  size_t page_size;
+  nr_slab_t* slab;
+
+  /*
+   * Test : The cache is disabled by default.
+   */
+  slab = nr_slab_create(64, 0);
+  page_size = slab->page_size;
+  nr_slab_next(slab);
+  nr_slab_destroy(&slab);
+  tlib_pass_if_size_t_equal("disabled cache keeps nothing", 0,
+                            nr_slab_page_cache_size());
+
+  /*
+   * Test : Pages are cached on destroy, and reused and re-zeroed on create.
+   */
+  nr_slab_page_cache_set_limit(4 * page_size);
+
+  slab = nr_slab_create(64, 0);
+  for (i = 0; i < 3; i++) {
+    obj = (char*)nr_slab_next(slab);
+    nr_memset(obj, 'x', 64);
+  }
+  nr_slab_destroy(&slab);
+  tlib_pass_if_size_t_equal("page is cached", page_size,
+                            nr_slab_page_cache_size());
+
+  slab = nr_slab_create(64, 0);
+  tlib_pass_if_size_t_equal("cached page is reused", 0,
+                            nr_slab_page_cache_size());
+  for (i = 0; i < 3; i++) {
+    obj = (char*)nr_slab_next(slab);
+    tlib_pass_if_char_equal("reused memory is zeroed", '\0', obj[0]);
+    tlib_pass_if_char_equal("reused memory is zeroed", '\0', obj[63]);
+  }
+  tlib_pass_if_size_t_equal("reused page is reset", 3 * slab->object_size,
+                            slab->head->used);
+
+  /*
+   * Test : Pages of a different size are not reused.
+   */
+  nr_slab_destroy(&slab);
+  slab = nr_slab_create(64, 2 * page_size);
+  tlib_pass_if_size_t_equal("different page size is not reused", page_size,
+                            nr_slab_page_cache_size());
+
+  /*
+   * Test : The high-water mark is enforced by evicting older pages.
+   */
+  nr_slab_destroy(&slab);
+  tlib_pass_if_size_t_equal("both pages are cached", 3 * page_size,
+                            nr_slab_page_cache_size());
+  nr_slab_page_cache_set_limit(2 * page_size);
+  tlib_pass_if_size_t_equal("oldest page is evicted", 2 * page_size,
+                            nr_slab_page_cache_size());
+
+  slab = nr_slab_create(64, 2 * page_size);
+  tlib_pass_if_size_t_equal("newest page is reused", 0,
+                            nr_slab_page_cache_size());
+  nr_slab_destroy(&slab);
+
+  /*
+   * Test : Pages larger than the limit are never cached.
+   */
+  slab = nr_slab_create(64, 4 * page_size);
+  nr_slab_page_cache_flush();
+  nr_slab_destroy(&slab);
+  tlib_pass_if_size_t_equal("oversized page is not cached", 0,
+                            nr_slab_page_cache_size());
+
+  nr_slab_page_cache_set_limit(0);
+}
+
+tlib_parallel_info_t parallel_info = {.suggested_nthreads = 1, .state_size = 0};
 
 void test_main(void* p NRUNUSED) {
   test_create_destroy();
   test_next();
   test_release();
   test_count();
+  test_page_cache();
 }
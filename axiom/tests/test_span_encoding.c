@@ -13,14 +13,50 @@
 
 #include "tlib_main.h"
 
-static void add_values(nrobj_t* hash) {
-  nro_set_hash_boolean(hash, "bool", true);
-  nro_set_hash_double(hash, "double", 1.0);
-  nro_set_hash_long(hash, "long", 12345);
-  nro_set_hash_string(hash, "string", "foo");
+typedef void (*set_attribute_func_t)(nr_span_event_t* event,
+                                     const char* name,
+                                     const nrobj_t* value);
+
+static void add_values(nr_span_event_t* span, set_attribute_func_t set) {
+  nrobj_t* value;
+
+  value = nro_new_boolean(true);
+  set(span, "bool", value);
+  nro_delete(value);
+
+  value = nro_new_double(1.0);
+  set(span, "double", value);
+  nro_delete(value);
+
+  value = nro_new_long(12345);
+  set(span, "long", value);
+  nro_delete(value);
+
+  value = nro_new_string("foo");
+  set(span, "string", value);
+  nro_delete(value);
 }
 
-#define check_values(ARRAY, NUM)                                               \
+/*
+ * Intrinsics can only be set through their typed setters, so one intrinsic
+ * of each attribute value type is set instead.
+ */
+static void add_intrinsics(nr_span_event_t* span) {
+  nr_span_event_set_sampled(span, true);
+  nr_span_event_set_duration(span, NR_TIME_DIVISOR);
+  nr_span_event_set_timestamp(span, 12345 * NR_TIME_DIVISOR_MS);
+  nr_span_event_set_guid(span, "foo");
+}
+
+#define check_values(ARRAY, NUM)                                              \
+  check_keyed_values(ARRAY, NUM, "bool", "double", "long", "string")
+
+#define check_intrinsics(ARRAY, NUM)                                \
+  check_keyed_values(ARRAY, NUM, "sampled", "duration", "timestamp", \
+                     "guid")
+
+#define check_keyed_values(ARRAY, NUM, BOOL_KEY, DOUBLE_KEY, LONG_KEY,         \
+                           STRING_KEY)                                         \
   do {                                                                         \
     size_t _check_i;                                                           \
     const size_t _check_num = (NUM);                                           \
@@ -36,7 +72,7 @@ static void add_values(nrobj_t* hash) {
       const Com__Newrelic__Trace__V1__AttributeValue* _check_value             \
           = ARRAY[_check_i]->value;                                            \
                                                                                \
-      if (nr_streq(_check_key, "bool")) {                                      \
+      if (nr_streq(_check_key, (BOOL_KEY))) {                                      \
         tlib_pass_if_int_equal(                                                \
             "bool value has the right type",                                   \
             (int)COM__NEWRELIC__TRACE__V1__ATTRIBUTE_VALUE__VALUE_BOOL_VALUE,  \
@@ -46,7 +82,7 @@ static void add_values(nrobj_t* hash) {
         _check_seen.bools++;                                                   \
       }                                                                        \
                                                                                \
-      if (nr_streq(_check_key, "double")) {                                    \
+      if (nr_streq(_check_key, (DOUBLE_KEY))) {                                    \
         tlib_pass_if_int_equal(                                                \
             "double value has the right type",                                 \
             (int)                                                              \
@@ -57,7 +93,7 @@ static void add_values(nrobj_t* hash) {
         _check_seen.doubles++;                                                 \
       }                                                                        \
                                                                                \
-      if (nr_streq(_check_key, "long")) {                                      \
+      if (nr_streq(_check_key, (LONG_KEY))) {                                      \
         tlib_pass_if_int_equal(                                                \
             "long value has the right type",                                   \
             (int)COM__NEWRELIC__TRACE__V1__ATTRIBUTE_VALUE__VALUE_INT_VALUE,   \
@@ -67,7 +103,7 @@ static void add_values(nrobj_t* hash) {
         _check_seen.longs++;                                                   \
       }                                                                        \
                                                                                \
-      if (nr_streq(_check_key, "string")) {                                    \
+      if (nr_streq(_check_key, (STRING_KEY))) {                                    \
         tlib_pass_if_int_equal(                                                \
             "string value has the right type",                                 \
             (int)                                                              \
@@ -119,9 +155,9 @@ static void test_single(void) {
   nr_span_encoding_result_deinit(&result);
 
   // Now we'll put one of every attribute value type into each of the objects.
-  add_values(span->agent_attributes);
-  add_values(span->intrinsics);
-  add_values(span->user_attributes);
+  add_values(span, nr_span_event_set_attribute_agent);
+  add_intrinsics(span);
+  add_values(span, nr_span_event_set_attribute_user);
 
   tlib_pass_if_bool_equal("full span", true,
                           nr_span_encoding_single_v1(span, &result));
@@ -134,7 +170,7 @@ static void test_single(void) {
   tlib_pass_if_str_equal("span has the correct trace ID", "abcdefgh",
                          encoded->trace_id);
   check_values(encoded->agent_attributes, encoded->n_agent_attributes);
-  check_values(encoded->intrinsics, encoded->n_intrinsics);
+  check_intrinsics(encoded->intrinsics, encoded->n_intrinsics);
   check_values(encoded->user_attributes, encoded->n_user_attributes);
   com__newrelic__trace__v1__span__free_unpacked(encoded, NULL);
   nr_span_encoding_result_deinit(&result);
@@ -172,9 +208,9 @@ static void test_batch(void) {
    */
   nr_span_event_set_trace_id(spans[0], "abcdefgh");
   nr_span_event_set_trace_id(spans[1], "01234567");
-  add_values(spans[1]->agent_attributes);
-  add_values(spans[1]->intrinsics);
-  add_values(spans[1]->user_attributes);
+  add_values(spans[1], nr_span_event_set_attribute_agent);
+  add_intrinsics(spans[1]);
+  add_values(spans[1], nr_span_event_set_attribute_user);
 
   tlib_pass_if_bool_equal(
       "normal batch", true,
@@ -195,7 +231,8 @@ static void test_batch(void) {
                          encoded->spans[1]->trace_id);
   check_values(encoded->spans[1]->agent_attributes,
                encoded->spans[1]->n_agent_attributes);
-  check_values(encoded->spans[1]->intrinsics, encoded->spans[1]->n_intrinsics);
+  check_intrinsics(encoded->spans[1]->intrinsics,
+                   encoded->spans[1]->n_intrinsics);
   check_values(encoded->spans[1]->user_attributes,
                encoded->spans[1]->n_user_attributes);
 
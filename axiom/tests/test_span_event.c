@@ -26,6 +26,7 @@ static void test_span_event_create_destroy(void) {
 static void test_span_event_to_json(void) {
   char* json;
   nr_span_event_t* span;
+  nrobj_t* value;
 
   /*
    * Test : Bad parameters.
@@ -48,10 +49,9 @@ static void test_span_event_to_json(void) {
    */
   span = nr_span_event_create();
   nr_span_event_set_external(span, NR_SPAN_EXTERNAL_URL, "http://example.org/");
-  // Since we don't yet have an API to add user attributes to a span event,
-  // we'll just mutate the object directly. This should use the API once we have
-  // one.
-  nro_set_hash_string(span->user_attributes, "foo", "bar");
+  value = nro_new_string("bar");
+  nr_span_event_set_attribute_user(span, "foo", value);
+  nro_delete(value);
   json = nr_span_event_to_json(span);
   tlib_pass_if_str_equal(
       "full span event",
@@ -65,6 +65,7 @@ static void test_span_event_to_json(void) {
 static void test_span_event_to_json_buffer(void) {
   nrbuf_t* buf = nr_buffer_create(0, 0);
   nr_span_event_t* span;
+  nrobj_t* value;
 
   /*
    * Test : Bad parameters.
@@ -97,10 +98,9 @@ static void test_span_event_to_json_buffer(void) {
    */
   span = nr_span_event_create();
   nr_span_event_set_external(span, NR_SPAN_EXTERNAL_URL, "http://example.org/");
-  // Since we don't yet have an API to add user attributes to a span event,
-  // we'll just mutate the object directly. This should use the API once we have
-  // one.
-  nro_set_hash_string(span->user_attributes, "foo", "bar");
+  value = nro_new_string("bar");
+  nr_span_event_set_attribute_user(span, "foo", value);
+  nro_delete(value);
   tlib_pass_if_bool_equal("full span event", true,
                           nr_span_event_to_json_buffer(span, buf));
   nr_buffer_add(buf, NR_PSTR("\0"));
@@ -114,6 +114,63 @@ static void test_span_event_to_json_buffer(void) {
   nr_buffer_destroy(&buf);
 }
 
+static void test_span_event_to_json_typed_fields(void) {
+  char* json;
+  nr_span_event_t* span = nr_span_event_create();
+  nrobj_t* value;
+
+  /*
+   * Test : Intrinsics and agent attributes are written from the typed fields,
+   *        and a typed agent attribute takes precedence over an agent
+   *        attribute with the same key.
+   */
+  nr_span_event_set_guid(span, "guid");
+  nr_span_event_set_trace_id(span, "trace");
+  nr_span_event_set_transaction_id(span, "txn");
+  nr_span_event_set_name(span, "name");
+  nr_span_event_set_timestamp(span, 123 * NR_TIME_DIVISOR_MS);
+  nr_span_event_set_duration(span, NR_TIME_DIVISOR / 2);
+  nr_span_event_set_priority(span, 0.5);
+  nr_span_event_set_sampled(span, false);
+  nr_span_event_set_entry_point(span, true);
+  nr_span_event_set_parent_id(span, "parent");
+  nr_span_event_set_category(span, NR_SPAN_HTTP);
+  nr_span_event_set_external(span, NR_SPAN_EXTERNAL_COMPONENT, "curl");
+  nr_span_event_set_external(span, NR_SPAN_EXTERNAL_URL, "url");
+  nr_span_event_set_external_status(span, 200);
+
+  value = nro_new_string("ignored");
+  nr_span_event_set_attribute_agent(span, "http.url", value);
+  nro_delete(value);
+  value = nro_new_string("GET");
+  nr_span_event_set_attribute_agent(span, "request.method", value);
+  nro_delete(value);
+
+  json = nr_span_event_to_json(span);
+  tlib_pass_if_str_equal(
+      "typed span event",
+      "[{\"category\":\"http\",\"type\":\"Span\",\"guid\":\"guid\","
+      "\"traceId\":\"trace\",\"transactionId\":\"txn\",\"name\":"
+      "\"name\",\"timestamp\":123,\"duration\":0.50000,\"priority\":"
+      "0.50000,\"sampled\":false,\"nr.entryPoint\":true,\"parentId\":"
+      "\"parent\",\"span.kind\":\"client\",\"component\":\"curl\"},{},"
+      "{\"http.url\":\"url\",\"http.statusCode\":200,\"request.method\":"
+      "\"GET\"}]",
+      json);
+  nr_free(json);
+
+  /*
+   * Test : Unsetting the span kind removes it.
+   */
+  nr_span_event_set_category(span, NR_SPAN_GENERIC);
+  tlib_pass_if_null("generic span kind", nr_span_event_get_spankind(span));
+  json = nr_span_event_to_json(span);
+  tlib_pass_if_null("generic span kind", nr_strstr(json, "span.kind"));
+  nr_free(json);
+
+  nr_span_event_destroy(&span);
+}
+
 static void test_span_event_guid(void) {
   nr_span_event_t* event = nr_span_event_create();
 
@@ -787,6 +844,7 @@ void test_main(void* p NRUNUSED) {
   test_span_event_create_destroy();
   test_span_event_to_json();
   test_span_event_to_json_buffer();
+  test_span_event_to_json_typed_fields();
   test_span_event_guid();
   test_span_event_parent();
   test_span_event_transaction_id();
@@ -185,6 +185,25 @@ static void test_sql_obfuscate(void) {
       "SELECT * FROM test WHERE foo IN (1,\'missing closing single quote)",
       "SELECT * FROM test WHERE foo IN (?,?");
 
+  sql_obfuscate_testcase("trailing escape in single quotes",
+                         "SELECT * FROM test WHERE foo = 'bar\\",
+                         "SELECT * FROM test WHERE foo = ?");
+
+  sql_obfuscate_testcase("trailing escape in double quotes",
+                         "SELECT * FROM test WHERE foo = \"bar\\",
+                         "SELECT * FROM test WHERE foo = ?");
+
+  sql_obfuscate_testcase(
+      "long statement",
+      "INSERT INTO `wp_postmeta` (`post_id`, `meta_key`, `meta_value`) VALUES "
+      "(1021, '_wp_attachment_metadata', 'a:1:{s:5:\"width\";i:661;}'), "
+      "(1022, \"_wp_attached_file\", \"2023/10/image-\\\"22\\\".jpg\") "
+      "/* batch 7 of 12 */ ON DUPLICATE KEY UPDATE meta_value = "
+      "VALUES(meta_value) -- retry 3",
+      "INSERT INTO `wp_postmeta` (`post_id`, `meta_key`, `meta_value`) VALUES "
+      "(?, ?, ?), (?, ?, ?)  ON DUPLICATE KEY UPDATE meta_value = "
+      "VALUES(meta_value) ");
+
   sql_obfuscate_testcase(
       "digit strings", "SELECT 12345 FROM test WHERE foo IN (1,\"foo\",'baz')",
       "SELECT ? FROM test WHERE foo IN (?,?,?)");
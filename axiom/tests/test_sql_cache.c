@@ -0,0 +1,224 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nr_axiom.h"
+
+#include "util_memory.h"
+#include "util_sql.h"
+#include "util_sql_cache.h"
+#include "util_strings.h"
+
+#include "tlib_main.h"
+
+#define SELECT_SQL "SELECT * FROM users WHERE id = 42 AND name IN ('a','b')"
+#define INSERT_SQL "INSERT INTO orders (id, total) VALUES (7, \"19.99\")"
+#define UPDATE_SQL "UPDATE carts SET state = 'closed' WHERE id = 3"
+
+static void test_disabled(void) {
+  nr_sql_cache_status_t status = NR_SQL_CACHE_HIT;
+  const char* operation = NULL;
+  char* table = NULL;
+  char* obfuscated;
+
+  nr_sql_cache_set_limit(0);
+
+  obfuscated = nr_sql_cache_obfuscate(SELECT_SQL, &status);
+  tlib_pass_if_str_equal("disabled obfuscate",
+                         "SELECT * FROM users WHERE id = ? AND name IN (?,?)",
+                         obfuscated);
+  tlib_pass_if_int_equal("disabled obfuscate", NR_SQL_CACHE_BYPASSED,
+                         (int)status);
+  nr_free(obfuscated);
+
+  status = NR_SQL_CACHE_HIT;
+  nr_sql_cache_get_operation_and_table(SELECT_SQL, &operation, &table, 0,
+                                       &status);
+  tlib_pass_if_str_equal("disabled operation", "select", operation);
+  tlib_pass_if_str_equal("disabled table", "users", table);
+  tlib_pass_if_int_equal("disabled operation", NR_SQL_CACHE_BYPASSED,
+                         (int)status);
+  nr_free(table);
+
+  tlib_pass_if_size_t_equal("disabled cache is empty", 0, nr_sql_cache_size());
+}
+
+static void test_results_match(void) {
+  const char* statements[] = {SELECT_SQL, INSERT_SQL, UPDATE_SQL,
+                              "COMMIT", "not sql at all"};
+  size_t i;
+  int pass;
+
+  nr_sql_cache_set_limit(10);
+
+  /*
+   * The first pass populates the cache and the second is served from it:
+   * both must match the uncached functions.
+   */
+  for (pass = 0; pass < 2; pass++) {
+    nr_sql_cache_status_t expected
+        = (0 == pass) ? NR_SQL_CACHE_MISS : NR_SQL_CACHE_HIT;
+
+    for (i = 0; i < sizeof(statements) / sizeof(statements[0]); i++) {
+      nr_sql_cache_status_t status = NR_SQL_CACHE_BYPASSED;
+      const char* operation = NULL;
+      const char* cached_operation = NULL;
+      char* table = NULL;
+      char* cached_table = NULL;
+      char* obfuscated = nr_sql_obfuscate(statements[i]);
+      char* cached_obfuscated
+          = nr_sql_cache_obfuscate(statements[i], &status);
+
+      tlib_pass_if_str_equal("obfuscate", obfuscated, cached_obfuscated);
+      tlib_pass_if_int_equal("obfuscate status", (int)expected, (int)status);
+
+      status = NR_SQL_CACHE_BYPASSED;
+      tlib_pass_if_uint32_t_equal(
+          "normalized id", nr_sql_normalized_id(obfuscated),
+          nr_sql_cache_normalized_id(statements[i], &status));
+      tlib_pass_if_int_equal("normalized id status", (int)expected,
+                             (int)status);
+
+      status = NR_SQL_CACHE_BYPASSED;
+      nr_sql_get_operation_and_table(statements[i], &operation, &table, 0);
+      nr_sql_cache_get_operation_and_table(statements[i], &cached_operation,
+                                           &cached_table, 0, &status);
+      tlib_pass_if_str_equal("operation", operation, cached_operation);
+      tlib_pass_if_str_equal("table", table, cached_table);
+      tlib_pass_if_int_equal("operation status", (int)expected, (int)status);
+
+      nr_free(obfuscated);
+      nr_free(cached_obfuscated);
+      nr_free(table);
+      nr_free(cached_table);
+    }
+  }
+
+  tlib_pass_if_size_t_equal("cache size", 5, nr_sql_cache_size());
+
+  nr_sql_cache_flush();
+  tlib_pass_if_size_t_equal("flushed cache", 0, nr_sql_cache_size());
+}
+
+static void test_lazy_results(void) {
+  nr_sql_cache_status_t status = NR_SQL_CACHE_BYPASSED;
+  char* obfuscated;
+
+  nr_sql_cache_set_limit(10);
+
+  /*
+   * Caching the normalized id also caches the obfuscated SQL, but caching
+   * the obfuscated SQL does not compute the normalized id.
+   */
+  nr_sql_cache_normalized_id(SELECT_SQL, NULL);
+  obfuscated = nr_sql_cache_obfuscate(SELECT_SQL, &status);
+  tlib_pass_if_int_equal("obfuscated after id", NR_SQL_CACHE_HIT, (int)status);
+  nr_free(obfuscated);
+
+  obfuscated = nr_sql_cache_obfuscate(INSERT_SQL, NULL);
+  nr_free(obfuscated);
+  nr_sql_cache_normalized_id(INSERT_SQL, &status);
+  tlib_pass_if_int_equal("id after obfuscated", NR_SQL_CACHE_MISS,
+                         (int)status);
+  nr_sql_cache_normalized_id(INSERT_SQL, &status);
+  tlib_pass_if_int_equal("id after obfuscated", NR_SQL_CACHE_HIT, (int)status);
+
+  tlib_pass_if_size_t_equal("one entry per statement", 2, nr_sql_cache_size());
+
+  nr_sql_cache_flush();
+}
+
+static void test_eviction(void) {
+  nr_sql_cache_status_t status;
+
+  nr_sql_cache_set_limit(2);
+
+  nr_sql_cache_normalized_id(SELECT_SQL, NULL);
+  nr_sql_cache_normalized_id(INSERT_SQL, NULL);
+
+  /* Using the SELECT makes the INSERT the least recently used statement. */
+  nr_sql_cache_normalized_id(SELECT_SQL, &status);
+  tlib_pass_if_int_equal("select cached", NR_SQL_CACHE_HIT, (int)status);
+
+  nr_sql_cache_normalized_id(UPDATE_SQL, &status);
+  tlib_pass_if_int_equal("update added", NR_SQL_CACHE_MISS, (int)status);
+  tlib_pass_if_size_t_equal("limit respected", 2, nr_sql_cache_size());
+
+  nr_sql_cache_normalized_id(SELECT_SQL, &status);
+  tlib_pass_if_int_equal("select kept", NR_SQL_CACHE_HIT, (int)status);
+  nr_sql_cache_normalized_id(UPDATE_SQL, &status);
+  tlib_pass_if_int_equal("update kept", NR_SQL_CACHE_HIT, (int)status);
+  nr_sql_cache_normalized_id(INSERT_SQL, &status);
+  tlib_pass_if_int_equal("insert evicted", NR_SQL_CACHE_MISS, (int)status);
+
+  /* Lowering the limit evicts immediately. */
+  nr_sql_cache_set_limit(1);
+  tlib_pass_if_size_t_equal("lowered limit", 1, nr_sql_cache_size());
+  nr_sql_cache_normalized_id(INSERT_SQL, &status);
+  tlib_pass_if_int_equal("most recent kept", NR_SQL_CACHE_HIT, (int)status);
+
+  nr_sql_cache_set_limit(0);
+  tlib_pass_if_size_t_equal("disabled", 0, nr_sql_cache_size());
+}
+
+static void test_bypass(void) {
+  nr_sql_cache_status_t status = NR_SQL_CACHE_HIT;
+  const char* operation = NULL;
+  char* table = NULL;
+  char* long_sql;
+  char* obfuscated;
+
+  nr_sql_cache_set_limit(10);
+
+  /*
+   * Parsing is not cached when it is being logged.
+   */
+  nr_sql_cache_get_operation_and_table(SELECT_SQL, &operation, &table, 1,
+                                       &status);
+  tlib_pass_if_int_equal("show sql parsing", NR_SQL_CACHE_BYPASSED,
+                         (int)status);
+  tlib_pass_if_str_equal("show sql parsing", "users", table);
+  nr_free(table);
+
+  /*
+   * Very long statements are not cached.
+   */
+  long_sql = (char*)nr_malloc(NR_SQL_CACHE_MAX_SQL_LEN + 2);
+  nr_memset(long_sql, 'x', NR_SQL_CACHE_MAX_SQL_LEN + 1);
+  long_sql[NR_SQL_CACHE_MAX_SQL_LEN + 1] = '\0';
+  status = NR_SQL_CACHE_HIT;
+  obfuscated = nr_sql_cache_obfuscate(long_sql, &status);
+  tlib_pass_if_int_equal("long sql", NR_SQL_CACHE_BYPASSED, (int)status);
+  tlib_pass_if_str_equal("long sql", long_sql, obfuscated);
+  nr_free(obfuscated);
+  nr_free(long_sql);
+
+  /*
+   * Bad parameters.
+   */
+  status = NR_SQL_CACHE_HIT;
+  tlib_pass_if_null("NULL sql", nr_sql_cache_obfuscate(NULL, &status));
+  tlib_pass_if_int_equal("NULL sql", NR_SQL_CACHE_BYPASSED, (int)status);
+  tlib_pass_if_uint32_t_equal("NULL sql", 0,
+                              nr_sql_cache_normalized_id(NULL, NULL));
+  nr_sql_cache_get_operation_and_table(SELECT_SQL, NULL, &table, 0, &status);
+  tlib_pass_if_null("NULL operation pointer", table);
+
+  tlib_pass_if_size_t_equal("nothing cached", 0, nr_sql_cache_size());
+
+  nr_sql_cache_set_limit(0);
+}
+
+/*
+ * The cache is process wide, so these tests cannot run in parallel.
+ */
+tlib_parallel_info_t parallel_info = {.suggested_nthreads = 1, .state_size = 0};
+
+void test_main(void* p NRUNUSED) {
+  test_disabled();
+  test_results_match();
+  test_lazy_results();
+  test_eviction();
+  test_bypass();
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nr_axiom.h"
+
+#include <stdio.h>
+
+#include "util_hash.h"
+#include "util_memory.h"
+#include "util_metrics.h"
+#include "util_string_intern.h"
+#include "util_string_pool.h"
+#include "util_strings.h"
+#include "util_threads.h"
+
+#include "tlib_main.h"
+
+static void test_disabled(void) {
+  nrpool_t* pool;
+  int idx;
+
+  nr_string_intern_set_limit(0);
+
+  tlib_pass_if_null("disabled", nr_string_intern("Datastore/all"));
+  tlib_pass_if_null("disabled", nr_string_intern_find("Datastore/all"));
+  tlib_pass_if_size_t_equal("disabled", 0, nr_string_intern_size());
+
+  /*
+   * Pools copy their strings as they always have.
+   */
+  pool = nr_string_pool_create();
+  idx = nr_string_add(pool, "Datastore/all");
+  tlib_pass_if_str_equal("disabled pool", "Datastore/all",
+                         nr_string_get(pool, idx));
+  nr_string_pool_destroy(&pool);
+}
+
+static void test_intern(void) {
+  char buf[32];
+  const char* a;
+  const char* b;
+  const char* empty;
+  int length = 0;
+  uint32_t hash;
+
+  nr_string_intern_set_limit(10);
+
+  tlib_pass_if_null("NULL string", nr_string_intern(NULL));
+  tlib_pass_if_null("NULL string", nr_string_intern_find(NULL));
+  tlib_pass_if_null("negative length",
+                    nr_string_intern_with_hash_length("a", 0, -1));
+
+  tlib_pass_if_null("not yet interned", nr_string_intern_find("MySQL"));
+
+  /*
+   * A string is only interned once it has been seen before.
+   */
+  nr_strcpy(buf, "MySQL");
+  tlib_pass_if_null("first seen", nr_string_intern(buf));
+  tlib_pass_if_null("first seen", nr_string_intern_find("MySQL"));
+  a = nr_string_intern(buf);
+  tlib_pass_if_str_equal("interned", "MySQL", a);
+  tlib_pass_if_true("interned copy", a != buf, "a=%p buf=%p", a, buf);
+
+  /*
+   * Interning an equal string returns the same pointer.
+   */
+  b = nr_string_intern("MySQL");
+  tlib_pass_if_ptr_equal("same pointer", a, b);
+  tlib_pass_if_ptr_equal("find", a, nr_string_intern_find("MySQL"));
+  hash = nr_mkhash("MySQL", &length);
+  tlib_pass_if_ptr_equal("with hash and length", a,
+                         nr_string_intern_with_hash_length("MySQL", hash,
+                                                           length));
+
+  /*
+   * The interned copy is independent of the caller's buffer.
+   */
+  nr_strcpy(buf, "Redis");
+  tlib_pass_if_str_equal("independent copy", "MySQL", a);
+  tlib_pass_if_true("different string", a != nr_string_intern(buf),
+                    "a=%p", a);
+
+  nr_string_intern("");
+  empty = nr_string_intern("");
+  tlib_pass_if_str_equal("empty string", "", empty);
+  tlib_pass_if_ptr_equal("empty string", empty, nr_string_intern(""));
+
+  tlib_pass_if_size_t_equal("size", 2, nr_string_intern_size());
+
+  /*
+   * The limit of an enabled table cannot be changed.
+   */
+  nr_string_intern_set_limit(1);
+  tlib_pass_if_ptr_equal("still enabled", a, nr_string_intern_find("MySQL"));
+  tlib_pass_if_size_t_equal("still enabled", 2, nr_string_intern_size());
+
+  nr_string_intern_set_limit(0);
+  tlib_pass_if_size_t_equal("disabled", 0, nr_string_intern_size());
+}
+
+static void test_limits(void) {
+  char name[32];
+  char long_string[NR_STRING_INTERN_MAX_LEN + 2];
+  int i;
+
+  nr_string_intern_set_limit(4);
+
+  for (i = 0; i < 4; i++) {
+    snprintf(name, sizeof(name), "Custom/%d", i);
+    nr_string_intern(name);
+    tlib_pass_if_not_null("below limit", nr_string_intern(name));
+  }
+  nr_string_intern("Custom/4");
+  tlib_pass_if_null("table full", nr_string_intern("Custom/4"));
+  tlib_pass_if_not_null("existing strings are found",
+                        nr_string_intern("Custom/0"));
+  tlib_pass_if_size_t_equal("table full", 4, nr_string_intern_size());
+
+  nr_string_intern_set_limit(0);
+  nr_string_intern_set_limit(4);
+
+  nr_memset(long_string, 'x', sizeof(long_string));
+  long_string[NR_STRING_INTERN_MAX_LEN] = '\0';
+  nr_string_intern(long_string);
+  tlib_pass_if_not_null("maximum length", nr_string_intern(long_string));
+  long_string[NR_STRING_INTERN_MAX_LEN] = 'x';
+  long_string[NR_STRING_INTERN_MAX_LEN + 1] = '\0';
+  tlib_pass_if_null("too long", nr_string_intern(long_string));
+  tlib_pass_if_null("too long", nr_string_intern_find(long_string));
+
+  nr_string_intern_set_limit(0);
+}
+
+static void test_pools(void) {
+  nrpool_t* first = nr_string_pool_create();
+  nrpool_t* pool = nr_string_pool_create();
+  nrpool_t* other = nr_string_pool_create();
+  nrmtable_t* metrics;
+  char long_string[NR_STRING_INTERN_MAX_LEN + 2];
+  int idx;
+  int other_idx;
+
+  nr_string_intern_set_limit(10);
+
+  /*
+   * The first pool to add a string copies it, as it has not been seen
+   * before.
+   */
+  idx = nr_string_add(first, "WebTransaction/Uri/index.php");
+  tlib_pass_if_str_equal("first pool copies", "WebTransaction/Uri/index.php",
+                         nr_string_get(first, idx));
+  tlib_pass_if_null("first pool copies",
+                    nr_string_intern_find("WebTransaction/Uri/index.php"));
+  nr_string_pool_destroy(&first);
+
+  /*
+   * Later pools reference the interned string rather than copying it, so
+   * equal strings in different pools share a pointer.
+   */
+  idx = nr_string_add(pool, "WebTransaction/Uri/index.php");
+  other_idx = nr_string_add(other, "WebTransaction/Uri/index.php");
+  tlib_pass_if_ptr_equal("pooled strings are interned",
+                         nr_string_intern_find("WebTransaction/Uri/index.php"),
+                         nr_string_get(pool, idx));
+  tlib_pass_if_ptr_equal("pools share interned strings",
+                         nr_string_get(pool, idx),
+                         nr_string_get(other, other_idx));
+  tlib_pass_if_int_equal("find by interned pointer", other_idx,
+                         nr_string_find(other, nr_string_get(pool, idx)));
+
+  /*
+   * Strings that cannot be interned are still copied.
+   */
+  nr_memset(long_string, 'y', sizeof(long_string));
+  long_string[NR_STRING_INTERN_MAX_LEN + 1] = '\0';
+  idx = nr_string_add(pool, long_string);
+  tlib_pass_if_str_equal("long strings are copied", long_string,
+                         nr_string_get(pool, idx));
+  tlib_pass_if_null("long strings are copied",
+                    nr_string_intern_find(long_string));
+
+  /*
+   * Destroying a pool leaves the interned strings intact.
+   */
+  nr_string_pool_destroy(&pool);
+  tlib_pass_if_str_equal("interned string survives pool",
+                         "WebTransaction/Uri/index.php",
+                         nr_string_get(other, other_idx));
+  nr_string_pool_destroy(&other);
+
+  nr_string_intern("Supportability/PHP/Intern");
+  metrics = nrm_table_create(10);
+  nrm_force_add(metrics, "Supportability/PHP/Intern", 0);
+  tlib_pass_if_not_null("metric names are interned",
+                        nr_string_intern_find("Supportability/PHP/Intern"));
+  tlib_pass_if_not_null(
+      "metric found by interned name",
+      nrm_find(metrics, nr_string_intern_find("Supportability/PHP/Intern")));
+  nrm_table_destroy(&metrics);
+
+  nr_string_intern_set_limit(0);
+}
+
+static void test_admission(void) {
+  char name[32];
+  size_t unique_interned;
+  int i;
+
+  nr_string_intern_set_limit(1000);
+
+  /*
+   * Strings that are only seen once do not fill the table, so that a string
+   * that is used over and over again is still interned after many of them.
+   */
+  for (i = 0; i < 200000; i++) {
+    snprintf(name, sizeof(name), "WebTransaction/Uri/%d", i);
+    nr_string_intern(name);
+  }
+  unique_interned = nr_string_intern_size();
+  tlib_pass_if_true("unique strings are mostly not interned",
+                    unique_interned < 500, "unique_interned=%zu",
+                    unique_interned);
+
+  tlib_pass_if_null("hot string first seen",
+                    nr_string_intern("Datastore/operation/MySQL/select"));
+  tlib_pass_if_str_equal("hot string interned",
+                         "Datastore/operation/MySQL/select",
+                         nr_string_intern("Datastore/operation/MySQL/select"));
+  tlib_pass_if_size_t_equal("hot string interned", unique_interned + 1,
+                            nr_string_intern_size());
+
+  nr_string_intern_set_limit(0);
+}
+
+#define INTERN_THREADS 4
+#define INTERN_STRINGS 200
+
+static void* intern_thread(void* arg) {
+  char name[32];
+  int* failures = (int*)arg;
+  int i;
+
+  for (i = 0; i < INTERN_STRINGS; i++) {
+    const char* interned;
+
+    snprintf(name, sizeof(name), "Custom/%d", i);
+    nr_string_intern(name);
+    interned = nr_string_intern(name);
+    if ((NULL == interned) || (0 != nr_strcmp(name, interned))) {
+      *failures += 1;
+    }
+  }
+
+  return NULL;
+}
+
+static void test_threads(void) {
+  nrthread_t threads[INTERN_THREADS];
+  int failures[INTERN_THREADS] = {0};
+  int i;
+
+  nr_string_intern_set_limit(INTERN_STRINGS);
+
+  for (i = 0; i < INTERN_THREADS; i++) {
+    nrt_create(&threads[i], NULL, intern_thread, &failures[i]);
+  }
+  for (i = 0; i < INTERN_THREADS; i++) {
+    nrt_join(threads[i], NULL);
+    tlib_pass_if_int_equal("concurrent interning", 0, failures[i]);
+  }
+
+  tlib_pass_if_size_t_equal("each string interned once", INTERN_STRINGS,
+                            nr_string_intern_size());
+
+  nr_string_intern_set_limit(0);
+}
+
+/*
+ * The intern table is process wide, so these tests cannot run in parallel.
+ */
+tlib_parallel_info_t parallel_info = {.suggested_nthreads = 1, .state_size = 0};
+
+void test_main(void* p NRUNUSED) {
+  test_disabled();
+  test_intern();
+  test_limits();
+  test_pools();
+  test_admission();
+  test_threads();
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nr_axiom.h"
+
+#include <stdio.h>
+
+#include "util_memory.h"
+#include "util_strings.h"
+#include "util_suffix_matcher.h"
+
+#include "tlib_main.h"
+
+#define MATCH(M, S, V, N) nr_suffix_matcher_match((M), NR_PSTR(S), (V), (N))
+
+static void test_bad_params(void) {
+  nr_suffix_matcher_t* matcher = nr_suffix_matcher_create();
+  int values[4];
+
+  /* Destroying NULL must not crash. */
+  nr_suffix_matcher_destroy(NULL);
+
+  tlib_pass_if_bool_equal("NULL matcher", false,
+                          nr_suffix_matcher_add(NULL, NR_PSTR("a.php"), 1));
+  tlib_pass_if_bool_equal("NULL suffix", false,
+                          nr_suffix_matcher_add(matcher, NULL, 5, 1));
+  tlib_pass_if_bool_equal("empty suffix", false,
+                          nr_suffix_matcher_add(matcher, "", 0, 1));
+
+  nr_suffix_matcher_add(matcher, NR_PSTR("a.php"), 1);
+  tlib_pass_if_size_t_equal("NULL matcher", 0, MATCH(NULL, "a.php", values, 4));
+  tlib_pass_if_size_t_equal(
+      "NULL string", 0, nr_suffix_matcher_match(matcher, NULL, 5, values, 4));
+  tlib_pass_if_size_t_equal("NULL values", 0, MATCH(matcher, "a.php", NULL, 4));
+  tlib_pass_if_size_t_equal("no room for values", 0,
+                            MATCH(matcher, "a.php", values, 0));
+
+  nr_suffix_matcher_destroy(&matcher);
+  tlib_pass_if_null("destroyed matcher", matcher);
+}
+
+static void test_match(void) {
+  nr_suffix_matcher_t* matcher = nr_suffix_matcher_create();
+  int values[4] = {0};
+
+  tlib_pass_if_size_t_equal("empty matcher", 0,
+                            MATCH(matcher, "/var/www/index.php", values, 4));
+
+  nr_suffix_matcher_add(matcher, NR_PSTR("predis/src/client.php"), 7);
+  nr_suffix_matcher_add(matcher, NR_PSTR("predis/client.php"), 8);
+  nr_suffix_matcher_add(matcher, NR_PSTR("mongodb/src/client.php"), 5);
+  nr_suffix_matcher_add(matcher, NR_PSTR("wp-config.php"), 1);
+
+  tlib_pass_if_size_t_equal("no match", 0,
+                            MATCH(matcher, "/var/www/index.php", values, 4));
+  tlib_pass_if_size_t_equal("empty string", 0, MATCH(matcher, "", values, 4));
+  tlib_pass_if_size_t_equal("string is a partial suffix", 0,
+                            MATCH(matcher, "client.php", values, 4));
+  tlib_pass_if_size_t_equal("suffix in the middle", 0,
+                            MATCH(matcher, "/wp-config.php.bak", values, 4));
+
+  tlib_pass_if_size_t_equal("exact match", 1,
+                            MATCH(matcher, "wp-config.php", values, 4));
+  tlib_pass_if_int_equal("exact match", 1, values[0]);
+
+  tlib_pass_if_size_t_equal(
+      "suffix match", 1,
+      MATCH(matcher, "/app/vendor/predis/predis/src/client.php", values, 4));
+  tlib_pass_if_int_equal("suffix match", 7, values[0]);
+
+  tlib_pass_if_size_t_equal(
+      "sibling suffix match", 1,
+      MATCH(matcher, "/app/vendor/mongodb/mongodb/src/client.php", values, 4));
+  tlib_pass_if_int_equal("sibling suffix match", 5, values[0]);
+
+  tlib_pass_if_size_t_equal(
+      "case-insensitive match", 1,
+      MATCH(matcher, "/APP/Vendor/Predis/Client.PHP", values, 4));
+  tlib_pass_if_int_equal("case-insensitive match", 8, values[0]);
+
+  nr_suffix_matcher_destroy(&matcher);
+}
+
+static void test_match_multiple(void) {
+  nr_suffix_matcher_t* matcher = nr_suffix_matcher_create();
+  int values[4] = {0};
+
+  /* Values are reported in ascending order, whatever order they were added. */
+  nr_suffix_matcher_add(matcher, NR_PSTR("laminas-http/src/client.php"), 9);
+  nr_suffix_matcher_add(matcher, NR_PSTR("CLIENT.PHP"), 4);
+  nr_suffix_matcher_add(matcher, NR_PSTR("src/client.php"), 2);
+  nr_suffix_matcher_add(matcher, NR_PSTR("src/client.php"), 6);
+
+  tlib_pass_if_size_t_equal(
+      "nested and duplicate suffixes", 4,
+      MATCH(matcher, "vendor/laminas/laminas-http/src/Client.php", values, 4));
+  tlib_pass_if_int_equal("nested and duplicate suffixes", 2, values[0]);
+  tlib_pass_if_int_equal("nested and duplicate suffixes", 4, values[1]);
+  tlib_pass_if_int_equal("nested and duplicate suffixes", 6, values[2]);
+  tlib_pass_if_int_equal("nested and duplicate suffixes", 9, values[3]);
+
+  tlib_pass_if_size_t_equal(
+      "matches beyond the array are ignored", 2,
+      MATCH(matcher, "vendor/laminas/laminas-http/src/Client.php", values, 2));
+
+  tlib_pass_if_size_t_equal("shorter suffixes only", 3,
+                            MATCH(matcher, "/src/client.php", values, 4));
+  tlib_pass_if_int_equal("shorter suffixes only", 2, values[0]);
+  tlib_pass_if_int_equal("shorter suffixes only", 4, values[1]);
+  tlib_pass_if_int_equal("shorter suffixes only", 6, values[2]);
+
+  nr_suffix_matcher_destroy(&matcher);
+}
+
+static void test_match_many(void) {
+  nr_suffix_matcher_t* matcher = nr_suffix_matcher_create();
+  char suffix[32];
+  int values[2];
+  size_t len;
+  int i;
+
+  /* Grow the node and value arrays past their initial sizes. */
+  for (i = 0; i < 500; i++) {
+    snprintf(suffix, sizeof(suffix), "lib%d/file.php", i);
+    nr_suffix_matcher_add(matcher, suffix, nr_strlen(suffix), i);
+  }
+
+  for (i = 0; i < 500; i++) {
+    snprintf(suffix, sizeof(suffix), "/x/lib%d/file.php", i);
+    len = nr_strlen(suffix);
+    tlib_pass_if_size_t_equal(
+        "many suffixes", 1,
+        nr_suffix_matcher_match(matcher, suffix, len, values, 2));
+    tlib_pass_if_int_equal("many suffixes", i, values[0]);
+  }
+
+  nr_suffix_matcher_destroy(&matcher);
+}
+
+tlib_parallel_info_t parallel_info = {.suggested_nthreads = 2, .state_size = 0};
+
+void test_main(void* p NRUNUSED) {
+  test_bad_params();
+  test_match();
+  test_match_multiple();
+  test_match_many();
+}
@@ -7710,6 +7710,120 @@ static void test_force_current_segment(void) {
   nr_txn_destroy(&txn);
 }
 
+static void test_pending_frames(void) {
+  nrapp_t app = {.state = NR_APP_OK};
+  nrtxnopt_t opts = {0};
+  nrtxn_t* txn;
+  nr_segment_t* segment_1;
+  nr_segment_t* segment_2;
+  nr_segment_t* segment_async;
+  nrtime_t start_time = 0;
+  int keys[NR_STACK_DEFAULT_CAPACITY + 1] = {0};
+  size_t i;
+
+  /*
+   * Test : Bad parameters
+   */
+  nr_txn_pending_frame_push(NULL, &keys[0]);
+  tlib_pass_if_false("Popping from a NULL txn must fail",
+                     nr_txn_pending_frame_pop(NULL, &keys[0], &start_time),
+                     "start_time=" NR_TIME_FMT, start_time);
+  nr_txn_materialize_pending_frames(NULL);
+
+  txn = nr_txn_begin(&app, &opts, NULL, NULL);
+
+  /*
+   * Test : Pushing and popping frames starts no segments.
+   */
+  tlib_pass_if_false("Popping without pending frames must fail",
+                     nr_txn_pending_frame_pop(txn, &keys[0], &start_time),
+                     "start_time=" NR_TIME_FMT, start_time);
+
+  nr_txn_pending_frame_push(txn, &keys[0]);
+  nr_txn_pending_frame_push(txn, &keys[1]);
+  tlib_pass_if_false(
+      "Popping with a key that is not the innermost frame must fail",
+      nr_txn_pending_frame_pop(txn, &keys[0], &start_time),
+      "start_time=" NR_TIME_FMT, start_time);
+  tlib_pass_if_size_t_equal("A failed pop must not remove frames", 2,
+                            txn->pending_frames_used);
+  tlib_pass_if_true("Popping the innermost frame must succeed",
+                    nr_txn_pending_frame_pop(txn, &keys[1], &start_time),
+                    "start_time=" NR_TIME_FMT, start_time);
+  tlib_pass_if_true("Popping the outermost frame must succeed",
+                    nr_txn_pending_frame_pop(txn, &keys[0], &start_time),
+                    "start_time=" NR_TIME_FMT, start_time);
+  tlib_pass_if_size_t_equal("No segments must be started", 0,
+                            txn->segment_count);
+
+  /*
+   * Test : Frames grow past the initial capacity.
+   */
+  for (i = 0; i < NR_STACK_DEFAULT_CAPACITY + 1; i++) {
+    nr_txn_pending_frame_push(txn, &keys[i]);
+  }
+  for (i = NR_STACK_DEFAULT_CAPACITY + 1; i > 0; i--) {
+    tlib_pass_if_true("Frames must be popped innermost first",
+                      nr_txn_pending_frame_pop(txn, &keys[i - 1], &start_time),
+                      "i=%zu", i);
+  }
+
+  /*
+   * Test : Asking for the current segment of the default context
+   *        materializes pending frames, keeping their start times.
+   */
+  segment_async = nr_segment_start(txn, NULL, "async");
+  nr_txn_pending_frame_push(txn, &keys[0]);
+  start_time = txn->pending_frames[0].start_time;
+  nr_txn_pending_frame_push(txn, &keys[1]);
+
+  tlib_pass_if_ptr_equal(
+      "The async context must not materialize pending frames", segment_async,
+      nr_txn_get_current_segment(txn, "async"));
+  tlib_pass_if_size_t_equal("Frames must still be pending", 2,
+                            txn->pending_frames_used);
+
+  segment_2 = nr_txn_get_current_segment(txn, NULL);
+  tlib_pass_if_size_t_equal("Frames must no longer be pending", 0,
+                            txn->pending_frames_used);
+  tlib_fail_if_null("The innermost frame must be the current segment",
+                    segment_2);
+  segment_1 = segment_2->parent;
+  tlib_fail_if_null("The outermost frame must be a segment", segment_1);
+  tlib_pass_if_ptr_equal("The outermost frame must be a child of the root",
+                         txn->segment_root, segment_1->parent);
+  tlib_pass_if_time_equal("The segment must keep the frame's start time",
+                          start_time, segment_1->start_time);
+  tlib_pass_if_false("Materialized frames must not be popped",
+                     nr_txn_pending_frame_pop(txn, &keys[1], &start_time),
+                     "start_time=" NR_TIME_FMT, start_time);
+
+  /*
+   * Test : Starting a segment materializes pending frames and parents the
+   *        new segment with the innermost one.
+   */
+  nr_txn_pending_frame_push(txn, &keys[2]);
+  segment_1 = nr_segment_start(txn, NULL, NULL);
+  tlib_pass_if_ptr_equal("The new segment's parent must be the pending frame",
+                         segment_2, segment_1->parent->parent);
+  nr_segment_end(&segment_1);
+
+  /*
+   * Test : Finalizing the parent stacks ends pending frames.
+   */
+  nr_txn_pending_frame_push(txn, &keys[3]);
+  nr_txn_finalize_parent_stacks(txn);
+  tlib_pass_if_size_t_equal("Frames must no longer be pending", 0,
+                            txn->pending_frames_used);
+  tlib_pass_if_true("segment in default parent stack ended",
+                    segment_2->stop_time != 0, "stop_time=" NR_TIME_FMT,
+                    segment_2->stop_time);
+  tlib_pass_if_null("The default parent stack must be empty",
+                    nr_txn_get_current_segment(txn, NULL));
+
+  nr_txn_destroy(&txn);
+}
+
 static void test_txn_is_sampled(void) {
   nrtxn_t txn;
   bool scenarios[][3] = {/* { DT enabled, sampled, result } */
@@ -9111,6 +9225,7 @@ void test_main(void* p NRUNUSED) {
   test_should_create_span_events();
   test_parent_stacks();
   test_force_current_segment();
+  test_pending_frames();
   test_txn_is_sampled();
   test_get_current_trace_id();
   test_get_current_span_id();
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nr_axiom.h"
+
+#include "util_arena.h"
+#include "util_arena_private.h"
+#include "util_memory.h"
+#include "util_strings.h"
+
+/*
+ * As with the slab allocator, we align on 16 byte boundaries, which is
+ * sufficient for every architecture we support.
+ */
+#define NR_ARENA_ALIGN(x) (((x) + 15) & ~((size_t)15))
+
+static nr_arena_chunk_t* nr_arena_chunk_create(size_t capacity) {
+  nr_arena_chunk_t* chunk;
+
+  /*
+   * Chunks are zeroed when created, and allocations are never recycled, so
+   * the memory handed out by the arena is always zeroed.
+   */
+  chunk = (nr_arena_chunk_t*)nr_zalloc(sizeof(nr_arena_chunk_t) + capacity);
+  chunk->capacity = capacity;
+  chunk->used = 0;
+  chunk->prev = NULL;
+
+  return chunk;
+}
+
+nr_arena_t* nr_arena_create(size_t chunk_size) {
+  nr_arena_t* arena;
+
+  if (0 == chunk_size) {
+    chunk_size = NR_ARENA_DEFAULT_CHUNK_SIZE;
+  }
+
+  arena = (nr_arena_t*)nr_zalloc(sizeof(nr_arena_t));
+  arena->chunk_size = NR_ARENA_ALIGN(chunk_size);
+
+  /*
+   * The first chunk is allocated lazily, so that an arena which is never
+   * used costs a single allocation.
+   */
+  arena->head = NULL;
+
+  return arena;
+}
+
+void nr_arena_destroy(nr_arena_t** arena_ptr) {
+  nr_arena_chunk_t* chunk;
+
+  if (nrunlikely(NULL == arena_ptr || NULL == *arena_ptr)) {
+    return;
+  }
+
+  chunk = (*arena_ptr)->head;
+  while (chunk) {
+    nr_arena_chunk_t* prev = chunk->prev;
+
+    nr_free(chunk);
+    chunk = prev;
+  }
+
+  nr_realfree((void**)arena_ptr);
+}
+
+void* nr_arena_alloc(nr_arena_t* arena, size_t size) {
+  nr_arena_chunk_t* chunk;
+  void* ptr;
+
+  if (nrunlikely(NULL == arena || 0 == size)) {
+    return NULL;
+  }
+
+  size = NR_ARENA_ALIGN(size);
+
+  if (size > arena->chunk_size) {
+    /*
+     * Oversized allocations get a dedicated chunk. This is linked in behind
+     * the head so that the remaining space in the head chunk is still used
+     * for subsequent small allocations.
+     */
+    chunk = nr_arena_chunk_create(size);
+    chunk->used = size;
+
+    if (arena->head) {
+      chunk->prev = arena->head->prev;
+      arena->head->prev = chunk;
+    } else {
+      arena->head = chunk;
+    }
+
+    arena->chunk_count += 1;
+    arena->used += size;
+    return chunk->data;
+  }
+
+  chunk = arena->head;
+  if ((NULL == chunk) || ((chunk->capacity - chunk->used) < size)) {
+    chunk = nr_arena_chunk_create(arena->chunk_size);
+    chunk->prev = arena->head;
+    arena->head = chunk;
+    arena->chunk_count += 1;
+  }
+
+  ptr = &chunk->data[chunk->used];
+  chunk->used += size;
+  arena->used += size;
+
+  return ptr;
+}
+
+char* nr_arena_strndup(nr_arena_t* arena, const char* str, size_t len) {
+  char* dup;
+
+  if (nrunlikely(NULL == str)) {
+    return NULL;
+  }
+
+  len = (size_t)nr_strnlen(str, (int)len);
+  dup = (char*)nr_arena_alloc(arena, len + 1);
+  if (nrunlikely(NULL == dup)) {
+    return NULL;
+  }
+
+  /*
+   * The terminating NUL is already present, since arena memory is zeroed.
+   */
+  nr_memcpy(dup, str, len);
+
+  return dup;
+}
+
+char* nr_arena_strdup(nr_arena_t* arena, const char* str) {
+  if (nrunlikely(NULL == str)) {
+    return NULL;
+  }
+
+  return nr_arena_strndup(arena, str, (size_t)nr_strlen(str));
+}
+
+size_t nr_arena_used(const nr_arena_t* arena) {
+  if (NULL == arena) {
+    return 0;
+  }
+
+  return arena->used;
+}
+
+size_t nr_arena_chunk_count(const nr_arena_t* arena) {
+  if (NULL == arena) {
+    return 0;
+  }
+
+  return arena->chunk_count;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Functions related to region (or "arena") allocation for data that shares a
+ * single lifetime, such as everything owned by a transaction.
+ */
+#ifndef UTIL_ARENA_HDR
+#define UTIL_ARENA_HDR
+
+#include <stddef.h>
+
+typedef struct _nr_arena_t nr_arena_t;
+
+/*
+ * The default size of each chunk requested from the system allocator.
+ */
+#define NR_ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+/*
+ * Purpose : Create an arena allocator.
+ *
+ * Params  : 1. The size of each chunk allocated from the system allocator, or
+ *              0 to use NR_ARENA_DEFAULT_CHUNK_SIZE.
+ *
+ * Returns : A newly allocated arena, which must be destroyed with
+ *           nr_arena_destroy().
+ *
+ * Notes   : Allocations larger than the chunk size are given their own chunk,
+ *           so the chunk size is a tuning parameter rather than a limit.
+ *
+ * Warning : Memory returned by an arena cannot be freed or reallocated
+ *           individually: it is all released at once when the arena is
+ *           destroyed. Only use an arena for data that lives at least as long
+ *           as the arena's owner, and which is never removed, or the memory
+ *           used by removed data will be retained until the owner goes away.
+ *           Arenas are not thread safe.
+ */
+extern nr_arena_t* nr_arena_create(size_t chunk_size);
+
+/*
+ * Purpose : Destroy an arena, freeing all memory allocated from it.
+ *
+ * Params  : 1. A pointer to the arena to destroy.
+ */
+extern void nr_arena_destroy(nr_arena_t** arena_ptr);
+
+/*
+ * Purpose : Allocate memory from an arena.
+ *
+ * Params  : 1. The arena.
+ *           2. The number of bytes to allocate.
+ *
+ * Returns : A pointer to zeroed memory aligned on a 16 byte boundary, or NULL
+ *           if the arena is NULL or the size is 0.
+ */
+extern void* nr_arena_alloc(nr_arena_t* arena, size_t size);
+
+/*
+ * Purpose : Duplicate a string into an arena.
+ *
+ * Params  : 1. The arena.
+ *           2. The string to duplicate.
+ *
+ * Returns : The duplicated string, or NULL on error.
+ */
+extern char* nr_arena_strdup(nr_arena_t* arena, const char* str);
+
+/*
+ * Purpose : Duplicate at most the given number of bytes of a string into an
+ *           arena. The result is always NUL terminated.
+ *
+ * Params  : 1. The arena.
+ *           2. The string to duplicate.
+ *           3. The maximum number of bytes to copy.
+ *
+ * Returns : The duplicated string, or NULL on error.
+ */
+extern char* nr_arena_strndup(nr_arena_t* arena, const char* str, size_t len);
+
+/*
+ * Purpose : Return the number of bytes handed out by an arena.
+ *
+ * Params  : 1. The arena.
+ *
+ * Returns : The number of bytes allocated, including alignment padding.
+ */
+extern size_t nr_arena_used(const nr_arena_t* arena);
+
+/*
+ * Purpose : Return the number of chunks allocated by an arena, which is the
+ *           number of calls that will be made to free() when it is destroyed.
+ *
+ * Params  : 1. The arena.
+ *
+ * Returns : The number of chunks.
+ */
+extern size_t nr_arena_chunk_count(const nr_arena_t* arena);
+
+#endif /* UTIL_ARENA_HDR */
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef UTIL_ARENA_PRIVATE_HDR
+#define UTIL_ARENA_PRIVATE_HDR
+
+#include <stddef.h>
+
+/*
+ * A chunk within the arena.
+ *
+ * Chunks are allocated as variably sized structures, with the allocations
+ * packed into the data element.
+ */
+typedef struct _nr_arena_chunk_t {
+  struct _nr_arena_chunk_t* prev;
+  size_t capacity;
+  size_t used;
+
+  /*
+   * Keep the data element aligned on a 16 byte boundary, so that aligning
+   * offsets within the chunk aligns the returned pointers.
+   */
+  size_t padding;
+
+  char data[0];
+} nr_arena_chunk_t;
+
+/*
+ * The arena itself. Like the slab allocator, only the head chunk is ever
+ * allocated from; older chunks are retained in a singly linked list until the
+ * arena is destroyed.
+ */
+struct _nr_arena_t {
+  nr_arena_chunk_t* head;
+  size_t chunk_size;
+  size_t used;        /* The total number of bytes handed out. */
+  size_t chunk_count; /* The number of chunks allocated. */
+};
+
+#endif /* UTIL_ARENA_PRIVATE_HDR */
@@ -6,12 +6,123 @@
 #include "nr_axiom.h"
 
 #include <stdint.h>
-#include <stdio.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "util_json.h"
+#include "util_memory.h"
+#include "util_strings.h"
+
+/*
+ * Most of the strings that are escaped (SQL, log messages, names) consist
+ * almost entirely of printable ASCII characters that are copied unchanged.
+ * Such runs are found several bytes at a time and copied in bulk; only the
+ * bytes that need escaping, and UTF-8 sequences, go through the byte-by-byte
+ * switch in nr_json_escape().
+ *
+ * A byte is clean if it is printable ASCII (0x20 to 0x7e) and is not one of
+ * '"', '\\' and '/'.
+ */
+static inline int nr_json_is_clean(unsigned char c) {
+  return (c >= 0x20) && (c < 0x7f) && ('"' != c) && ('\\' != c)
+         && ('/' != c);
+}
+
+#if defined(__SSE2__)
+/*
+ * SSE2 is part of the x86-64 baseline, so no runtime detection is needed.
+ */
+static size_t nr_json_clean_run(const char* s, size_t len) {
+  const __m128i space = _mm_set1_epi8(0x20);
+  const __m128i del = _mm_set1_epi8(0x7f);
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i slash = _mm_set1_epi8('/');
+  size_t i = 0;
+
+  while (i + 16 <= len) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+    /*
+     * The comparison is signed, so bytes of 0x80 and above are also less
+     * than a space.
+     */
+    __m128i dirty = _mm_or_si128(
+        _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del)),
+        _mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                     _mm_or_si128(_mm_cmpeq_epi8(v, backslash),
+                                  _mm_cmpeq_epi8(v, slash))));
+    int mask = _mm_movemask_epi8(dirty);
+
+    if (mask) {
+      return i + (size_t)__builtin_ctz((unsigned int)mask);
+    }
+    i += 16;
+  }
+
+  while (i < len && nr_json_is_clean((unsigned char)s[i])) {
+    i++;
+  }
+
+  return i;
+}
+#else
+/*
+ * Portable fallback, examining eight bytes at a time using the usual bit
+ * tricks for finding zero bytes within a word.
+ */
+#define NR_JSON_ONES ((uint64_t)0x0101010101010101ULL)
+#define NR_JSON_HIGHS ((uint64_t)0x8080808080808080ULL)
+#define NR_JSON_HAS_ZERO(x) (((x)-NR_JSON_ONES) & ~(x)&NR_JSON_HIGHS)
+
+static size_t nr_json_clean_run(const char* s, size_t len) {
+  size_t i = 0;
+
+  while (i + 8 <= len) {
+    uint64_t v;
+
+    nr_memcpy(&v, s + i, sizeof(v));
+    if ((v & NR_JSON_HIGHS)
+        || (((v - NR_JSON_ONES * 0x20) & ~v & NR_JSON_HIGHS))
+        || NR_JSON_HAS_ZERO(v ^ (NR_JSON_ONES * 0x7f))
+        || NR_JSON_HAS_ZERO(v ^ (NR_JSON_ONES * '"'))
+        || NR_JSON_HAS_ZERO(v ^ (NR_JSON_ONES * '\\'))
+        || NR_JSON_HAS_ZERO(v ^ (NR_JSON_ONES * '/'))) {
+      break;
+    }
+    i += 8;
+  }
+
+  while (i < len && nr_json_is_clean((unsigned char)s[i])) {
+    i++;
+  }
+
+  return i;
+}
+#endif
+
+/*
+ * Purpose : Write a \uXXXX escape for a UTF-16 code unit.
+ *
+ * Returns : A pointer just past the escape.
+ */
+static char* nr_json_add_unicode_escape(char* ep, uint32_t code_unit) {
+  static const char hex[] = "0123456789abcdef";
+
+  ep[0] = '\\';
+  ep[1] = 'u';
+  ep[2] = hex[(code_unit >> 12) & 0xf];
+  ep[3] = hex[(code_unit >> 8) & 0xf];
+  ep[4] = hex[(code_unit >> 4) & 0xf];
+  ep[5] = hex[code_unit & 0xf];
+
+  return ep + 6;
+}
 
 int nr_json_escape(char* dest, const char* json) {
   char* ep;
+  const char* end;
 
   if (0 == json) {
     json = "";
@@ -22,10 +133,21 @@ int nr_json_escape(char* dest, const char* json) {
     return 0;
   }
 
+  end = json + nr_strlen(json);
+
   *ep = '"';
   ep++;
 
   while (*json) {
+    size_t clean = nr_json_clean_run(json, (size_t)(end - json));
+
+    if (clean) {
+      nr_memcpy(ep, json, clean);
+      ep += clean;
+      json += clean;
+      continue;
+    }
+
     switch (*json) {
       case '"':
         *ep = '\\';
@@ -152,8 +274,7 @@ int nr_json_escape(char* dest, const char* json) {
             goto fault;
           } else {
             if (bits_in_code_point <= 16) {
-              sprintf(ep, "\\u%04x", code_point & 0xffff);
-              ep += (1 + 1 + 4); /* 1 byte for backslash, 1 for u, 4 for data */
+              ep = nr_json_add_unicode_escape(ep, code_point & 0xffff);
             } else if (bits_in_code_point == 21) {
               /*
                * Build a surrogate pair
@@ -169,9 +290,8 @@ int nr_json_escape(char* dest, const char* json) {
               code_point -= 0x10000; /* leaves us a 20-bit number */
               surrogate_0 = 0xd800 + ((code_point >> 10) & ((1 << 10) - 1));
               surrogate_1 = 0xdc00 + ((code_point >> 0) & ((1 << 10) - 1));
-              sprintf(ep, "\\u%04x\\u%04x", surrogate_0 & 0xffff,
-                      surrogate_1 & 0xffff);
-              ep += (1 + 1 + 4 + 1 + 1 + 4);
+              ep = nr_json_add_unicode_escape(ep, surrogate_0 & 0xffff);
+              ep = nr_json_add_unicode_escape(ep, surrogate_1 & 0xffff);
             } else {
               goto fault;
             }
@@ -181,27 +301,13 @@ int nr_json_escape(char* dest, const char* json) {
         }
 
         if ((u_json[0] <= 0x1f) || (u_json[0] >= 0x7f)) {
-          char tmp[4];
-
         fault:;
           /*
            * Behavior of the encoder when presented with illegal UTF-8 is
            * undefined. Here we handle unknown or mis-encoded characters as a 16
            * bit UTF-8 encoding, with the leading byte set to 0.
            */
-          snprintf(tmp, sizeof(tmp), "%02x", (int)(u_json[0]));
-          *ep = '\\';
-          ep++;
-          *ep = 'u';
-          ep++;
-          *ep = '0';
-          ep++;
-          *ep = '0';
-          ep++;
-          *ep = tmp[0];
-          ep++;
-          *ep = tmp[1];
-          ep++;
+          ep = nr_json_add_unicode_escape(ep, u_json[0]);
         } else {
           *ep = *json;
           ep++;
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nr_axiom.h"
+
+#include "util_json_writer.h"
+#include "util_number_converter.h"
+#include "util_strings.h"
+
+/*
+ * Purpose : Add a comma to the buffer if the next key or value follows a
+ *           previous member or element.
+ */
+static void nr_json_write_separator(nrbuf_t* buf) {
+  switch (nr_buffer_peek_end(buf)) {
+    case '\0':
+    case '[':
+    case '{':
+    case ':':
+    case ',':
+      break;
+
+    default:
+      nr_buffer_add(buf, NR_PSTR(","));
+      break;
+  }
+}
+
+void nr_json_write_begin_object(nrbuf_t* buf) {
+  nr_json_write_separator(buf);
+  nr_buffer_add(buf, NR_PSTR("{"));
+}
+
+void nr_json_write_end_object(nrbuf_t* buf) {
+  nr_buffer_add(buf, NR_PSTR("}"));
+}
+
+void nr_json_write_begin_array(nrbuf_t* buf) {
+  nr_json_write_separator(buf);
+  nr_buffer_add(buf, NR_PSTR("["));
+}
+
+void nr_json_write_end_array(nrbuf_t* buf) {
+  nr_buffer_add(buf, NR_PSTR("]"));
+}
+
+void nr_json_write_key(nrbuf_t* buf, const char* key) {
+  nr_json_write_separator(buf);
+  nr_buffer_add_escape_json(buf, key ? key : "");
+  nr_buffer_add(buf, NR_PSTR(":"));
+}
+
+void nr_json_write_string(nrbuf_t* buf, const char* value) {
+  nr_json_write_separator(buf);
+  nr_buffer_add_escape_json(buf, value ? value : "");
+}
+
+/*
+ * Purpose : Write the digits of an unsigned integer, without a separator.
+ */
+static void nr_json_write_digits(nrbuf_t* buf, uint64_t value, bool negative) {
+  char tmp[24];
+  char* p = tmp + sizeof(tmp);
+
+  do {
+    p--;
+    *p = '0' + (char)(value % 10);
+    value /= 10;
+  } while (value);
+
+  if (negative) {
+    p--;
+    *p = '-';
+  }
+
+  nr_buffer_add(buf, p, (int)(tmp + sizeof(tmp) - p));
+}
+
+void nr_json_write_int(nrbuf_t* buf, int64_t value) {
+  nr_json_write_separator(buf);
+  if (value < 0) {
+    /* Negate in unsigned arithmetic so that INT64_MIN is handled. */
+    nr_json_write_digits(buf, -(uint64_t)value, true);
+  } else {
+    nr_json_write_digits(buf, (uint64_t)value, false);
+  }
+}
+
+void nr_json_write_uint(nrbuf_t* buf, uint64_t value) {
+  nr_json_write_separator(buf);
+  nr_json_write_digits(buf, value, false);
+}
+
+void nr_json_write_double(nrbuf_t* buf, double value) {
+  char tmp[1024];
+  int len;
+
+  nr_json_write_separator(buf);
+  len = nr_double_to_str(tmp, sizeof(tmp), value);
+  nr_buffer_add(buf, tmp, len);
+}
+
+void nr_json_write_bool(nrbuf_t* buf, bool value) {
+  nr_json_write_separator(buf);
+  if (value) {
+    nr_buffer_add(buf, NR_PSTR("true"));
+  } else {
+    nr_buffer_add(buf, NR_PSTR("false"));
+  }
+}
+
+void nr_json_write_null(nrbuf_t* buf) {
+  nr_json_write_separator(buf);
+  nr_buffer_add(buf, NR_PSTR("null"));
+}
+
+void nr_json_write_raw(nrbuf_t* buf, const char* json) {
+  if (nr_strempty(json)) {
+    nr_json_write_null(buf);
+    return;
+  }
+
+  nr_json_write_separator(buf);
+  nr_buffer_add(buf, json, nr_strlen(json));
+}
+
+void nr_json_write_object(nrbuf_t* buf, const nrobj_t* obj) {
+  nr_json_write_separator(buf);
+  nro_to_json_buffer(obj, buf);
+}
+
+static nr_status_t nr_json_write_member(const char* key,
+                                        const nrobj_t* val,
+                                        void* ptr) {
+  nrbuf_t* buf = (nrbuf_t*)ptr;
+
+  nr_json_write_key(buf, key);
+  nro_to_json_buffer(val, buf);
+
+  return NR_SUCCESS;
+}
+
+void nr_json_write_object_members(nrbuf_t* buf, const nrobj_t* hash) {
+  if (NULL == buf) {
+    return;
+  }
+
+  nro_iteratehash(hash, nr_json_write_member, buf);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * This file contains functions to stream JSON directly into a buffer.
+ *
+ * Rather than building a tree of generic objects and then converting it to
+ * JSON, the functions below write keys, values and the punctuation
+ * separating them straight into an nrbuf_t:
+ *
+ *   nr_json_write_begin_object(buf);
+ *   nr_json_write_key(buf, "name");
+ *   nr_json_write_string(buf, "value");
+ *   nr_json_write_key(buf, "count");
+ *   nr_json_write_int(buf, 3);
+ *   nr_json_write_end_object(buf);
+ *
+ * produces {"name":"value","count":3}.
+ *
+ * The writer keeps no state of its own: whether a comma is needed before a
+ * key or value is determined from the last byte in the buffer. A comma is
+ * added unless the buffer is empty or ends with '[', '{', ':' or ','. This
+ * means that there is no limit on the nesting depth, but also that the
+ * writer must own the buffer from the point where it is empty, or where the
+ * container being written was opened: anything else in the buffer decides
+ * whether the first key or value is preceded by a comma. To append a value to
+ * a buffer that may already hold other data, open its container with
+ * nr_buffer_add() rather than with the writer.
+ */
+#ifndef UTIL_JSON_WRITER_HDR
+#define UTIL_JSON_WRITER_HDR
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util_buffer.h"
+#include "util_object.h"
+
+/*
+ * Purpose : Open or close an object or an array.
+ *
+ * Params  : 1. The buffer to write into.
+ */
+extern void nr_json_write_begin_object(nrbuf_t* buf);
+extern void nr_json_write_end_object(nrbuf_t* buf);
+extern void nr_json_write_begin_array(nrbuf_t* buf);
+extern void nr_json_write_end_array(nrbuf_t* buf);
+
+/*
+ * Purpose : Write the key of an object member. The key is escaped and
+ *           followed by a colon; the next write provides the value.
+ *
+ * Params  : 1. The buffer to write into.
+ *           2. The key. NULL is written as an empty key.
+ */
+extern void nr_json_write_key(nrbuf_t* buf, const char* key);
+
+/*
+ * Purpose : Write a scalar value.
+ *
+ * Params  : 1. The buffer to write into.
+ *           2. The value. A NULL string is written as an empty string.
+ */
+extern void nr_json_write_string(nrbuf_t* buf, const char* value);
+extern void nr_json_write_int(nrbuf_t* buf, int64_t value);
+extern void nr_json_write_uint(nrbuf_t* buf, uint64_t value);
+extern void nr_json_write_double(nrbuf_t* buf, double value);
+extern void nr_json_write_bool(nrbuf_t* buf, bool value);
+extern void nr_json_write_null(nrbuf_t* buf);
+
+/*
+ * Purpose : Write a value that is already encoded as JSON.
+ *
+ * Params  : 1. The buffer to write into.
+ *           2. The JSON to write verbatim, which must be a complete value.
+ *              NULL or an empty string is written as null, as writing nothing
+ *              would leave the buffer ending with the preceding separator.
+ */
+extern void nr_json_write_raw(nrbuf_t* buf, const char* json);
+
+/*
+ * Purpose : Write a generic object as a JSON value, without first converting
+ *           it to a string.
+ *
+ * Params  : 1. The buffer to write into.
+ *           2. The object. NULL is written as null.
+ */
+extern void nr_json_write_object(nrbuf_t* buf, const nrobj_t* obj);
+
+/*
+ * Purpose : Write the members of a generic hash into the object that is
+ *           currently being written, as though each had been written with
+ *           nr_json_write_key() and nr_json_write_object().
+ *
+ * Params  : 1. The buffer to write into.
+ *           2. The hash. Nothing is written if this is not a hash.
+ */
+extern void nr_json_write_object_members(nrbuf_t* buf, const nrobj_t* hash);
+
+#endif /* UTIL_JSON_WRITER_HDR */
@@ -44,7 +44,18 @@ NRM_CREATE_ACCESSOR_FUNCTION(nrm_sumsquares, NRM_SUMSQUARES)
 
 #define NRM_DEFAULT_MAX_SIZE 2048
 
+/*
+ * The initial number of slots in the metric index. This must be a power of
+ * two. Most transactions create well under half this many metrics, so the
+ * index is rarely rebuilt outside of the daemon and harvest paths.
+ */
+#define NRM_INDEX_STARTING_SLOTS 256
+
 nrmtable_t* nrm_table_create(int max_size) {
+  return nrm_table_create_with_arena(max_size, NULL);
+}
+
+nrmtable_t* nrm_table_create_with_arena(int max_size, nr_arena_t* arena) {
   nrmtable_t* table;
 
   if (max_size <= 0) {
@@ -56,8 +67,15 @@ nrmtable_t* nrm_table_create(int max_size) {
   table->number = 0;
   table->allocated = max_size;
   table->metrics = (nrmetric_t*)nr_calloc(table->allocated, sizeof(nrmetric_t));
-  table->strpool = nr_string_pool_create();
+  if (arena) {
+    table->strpool = nr_string_pool_create_with_arena(arena);
+  } else {
+    table->strpool = nr_string_pool_create();
+  }
   table->max_size = max_size;
+  table->slots
+      = (nrmslot_t*)nr_calloc(NRM_INDEX_STARTING_SLOTS, sizeof(nrmslot_t));
+  table->slot_mask = NRM_INDEX_STARTING_SLOTS - 1;
 
   return table;
 }
@@ -71,6 +89,7 @@ void nrm_table_destroy(nrmtable_t** table_p) {
 
   table = *table_p;
   nr_free(table->metrics);
+  nr_free(table->slots);
   nr_string_pool_destroy(&table->strpool);
   table->number = 0;
   nr_realfree((void**)table_p);
@@ -94,36 +113,107 @@ static uint32_t nrm_hash(const char* name) {
   return nr_mkhash(name, 0);
 }
 
+/*
+ * The distance of a slot from the home slot of the hash stored in it. Since
+ * the slot count is a power of two, wrapping around the end of the index is
+ * handled by the mask.
+ */
+static inline uint32_t nrm_probe_distance(uint32_t hash,
+                                          uint32_t pos,
+                                          uint32_t mask) {
+  return (pos - hash) & mask;
+}
+
+/*
+ * Purpose : Insert a metric into the index using Robin Hood hashing: an entry
+ *           that is further away from its home slot displaces one that is
+ *           closer to its own, which keeps probe sequences short and allows
+ *           lookups to stop early on a miss.
+ *
+ * Note    : The caller must ensure that the index has at least one free slot.
+ */
+static void nrm_index_insert(nrmtable_t* table, uint32_t hash, int metric) {
+  uint32_t mask = table->slot_mask;
+  uint32_t pos = hash & mask;
+  uint32_t dist = 0;
+  nrmslot_t entry;
+
+  entry.hash = hash;
+  entry.metric = metric + 1;
+
+  for (;;) {
+    nrmslot_t* slot = &table->slots[pos];
+    uint32_t slot_dist;
+
+    if (0 == slot->metric) {
+      *slot = entry;
+      return;
+    }
+
+    slot_dist = nrm_probe_distance(slot->hash, pos, mask);
+    if (slot_dist < dist) {
+      nrmslot_t displaced = *slot;
+
+      *slot = entry;
+      entry = displaced;
+      dist = slot_dist;
+    }
+
+    pos = (pos + 1) & mask;
+    dist++;
+  }
+}
+
+static void nrm_index_grow(nrmtable_t* table) {
+  uint32_t num_slots = (table->slot_mask + 1) * 2;
+  int i;
+
+  nr_free(table->slots);
+  table->slots = (nrmslot_t*)nr_calloc(num_slots, sizeof(nrmslot_t));
+  table->slot_mask = num_slots - 1;
+
+  for (i = 0; i < table->number; i++) {
+    nrm_index_insert(table, table->metrics[i].hash, i);
+  }
+}
+
 nrmetric_t* nrm_find_internal(nrmtable_t* table,
                               const char* name,
                               uint32_t hash) {
-  int i;
+  uint32_t mask;
+  uint32_t pos;
+  uint32_t dist;
 
   if ((0 == table) || (0 == table->number) || (0 == table->metrics)) {
     return 0;
   }
 
-  i = 0;
-  while (-1 != i) {
-    nrmetric_t* metric = &table->metrics[i];
+  mask = table->slot_mask;
+  pos = hash & mask;
+
+  for (dist = 0;; dist++, pos = (pos + 1) & mask) {
+    const nrmslot_t* slot = &table->slots[pos];
+
+    /*
+     * Because of the Robin Hood invariant, reaching either an empty slot or
+     * an entry closer to its home than we are to ours means the name is not
+     * in the table.
+     */
+    if ((0 == slot->metric)
+        || (nrm_probe_distance(slot->hash, pos, mask) < dist)) {
+      return 0;
+    }
 
-    if (hash == metric->hash) {
+    if (hash == slot->hash) {
+      nrmetric_t* metric = &table->metrics[slot->metric - 1];
       const char* metric_name
           = nr_string_get(table->strpool, metric->name_index);
 
-      if (0 == nr_strcmp(name, metric_name)) {
+      if ((name == metric_name) || (0 == nr_strcmp(name, metric_name))) {
         return metric;
       }
     }
-
-    if (metric->hash < hash) {
-      i = metric->left;
-    } else {
-      i = metric->right;
-    }
   }
-
-  return 0;
 }
 
 nrmetric_t* nrm_find(nrmtable_t* table, const char* name) {
@@ -138,7 +228,6 @@ nrmetric_t* nrm_find(nrmtable_t* table, const char* name) {
  *        first use nrm_find.
  */
 nrmetric_t* nrm_create(nrmtable_t* table, const char* name, uint32_t hash) {
-  int i;
   nrmetric_t* new_metric;
   int new_metric_index;
 
@@ -159,34 +248,21 @@ nrmetric_t* nrm_create(nrmtable_t* table, const char* name, uint32_t hash) {
   nr_memset((void*)new_metric, 0, sizeof(*new_metric));
 
   new_metric->hash = hash;
-  new_metric->left = -1;
-  new_metric->right = -1;
   new_metric->flags = 0;
   new_metric->name_index = nr_string_add(table->strpool, name);
   new_metric->mdata[NRM_MIN] = NR_TIME_MAX;
 
-  if (0 == new_metric_index) {
-    return new_metric;
+  /*
+   * Keep the index at most half full. Growing rehashes from the metrics
+   * array, which already includes the new metric.
+   */
+  if ((uint32_t)table->number * 2 > table->slot_mask + 1) {
+    nrm_index_grow(table);
+  } else {
+    nrm_index_insert(table, hash, new_metric_index);
   }
 
-  i = 0;
-  for (;;) {
-    nrmetric_t* test_metric = &table->metrics[i];
-
-    if (test_metric->hash < hash) {
-      i = test_metric->left;
-      if (-1 == i) {
-        test_metric->left = new_metric_index;
-        return new_metric;
-      }
-    } else {
-      i = test_metric->right;
-      if (-1 == i) {
-        test_metric->right = new_metric_index;
-        return new_metric;
-      }
-    }
-  }
+  return new_metric;
 }
 
 const nrmetric_t* nrm_get_metric(const nrmtable_t* table, int i) {
@@ -415,6 +491,8 @@ static void nr_metric_data_as_json_to_buffer(nrbuf_t* buf,
 nr_status_t nrm_table_validate(const nrmtable_t* table) {
   int i;
   int used;
+  int indexed;
+  uint32_t slot;
 
   if (0 == table) {
     return NR_FAILURE;
@@ -447,27 +525,41 @@ nr_status_t nrm_table_validate(const nrmtable_t* table) {
       const char* name_string
           = nr_string_get(table->strpool, metric->name_index);
 
-      if (metric->left < -1) {
-        return NR_FAILURE;
-      }
-      if (metric->right < -1) {
-        return NR_FAILURE;
-      }
-      if (metric->left >= used) {
-        return NR_FAILURE;
-      }
-      if (metric->right >= used) {
+      if (0 == name_string) {
         return NR_FAILURE;
       }
-      if ((-1 != metric->left) && (metric->left <= i)) {
-        return NR_FAILURE;
+    }
+
+    if (0 == table->slots) {
+      return NR_FAILURE;
+    }
+    if (0 != ((table->slot_mask + 1) & table->slot_mask)) {
+      return NR_FAILURE;
+    }
+    if ((uint32_t)used * 2 > table->slot_mask + 1) {
+      return NR_FAILURE;
+    }
+
+    /*
+     * Every metric must be indexed exactly once, under its own hash.
+     */
+    indexed = 0;
+    for (slot = 0; slot <= table->slot_mask; slot++) {
+      const nrmslot_t* entry = &table->slots[slot];
+
+      if (0 == entry->metric) {
+        continue;
       }
-      if ((-1 != metric->right) && (metric->right <= i)) {
+      if ((entry->metric < 0) || (entry->metric > used)) {
         return NR_FAILURE;
       }
-      if (0 == name_string) {
+      if (entry->hash != table->metrics[entry->metric - 1].hash) {
         return NR_FAILURE;
       }
+      indexed++;
+    }
+    if (indexed != used) {
+      return NR_FAILURE;
     }
   }
 
@@ -16,6 +16,7 @@
 #ifndef UTIL_METRICS_HDR
 #define UTIL_METRICS_HDR
 
+#include "util_arena.h"
 #include "util_time.h"
 
 /*
@@ -39,6 +40,16 @@ typedef struct _nrmintmetric_t nrmetric_t;
  */
 extern nrmtable_t* nrm_table_create(int max_size);
 
+/*
+ * Purpose : Create a new metric table whose metric names are stored in an
+ *           arena.
+ *
+ * Params  : 1. The maximum size of the table, as for nrm_table_create().
+ *           2. The arena, which must outlive the table.
+ */
+extern nrmtable_t* nrm_table_create_with_arena(int max_size,
+                                               nr_arena_t* arena);
+
 /*
  * Purpose : Destroys a metric table, freeing all of its associated memory.
  */
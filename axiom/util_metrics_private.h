@@ -20,12 +20,28 @@
  * unit testing. Other clients are forbidden.
  */
 
+/*
+ * Metrics are stored densely in insertion order in the metrics array, which is
+ * what the JSON and iteration functions walk. Lookups go through a separate
+ * open addressing index using Robin Hood linear probing: each slot caches the
+ * metric hash so that a probe sequence only touches the metrics array (and the
+ * string pool) on a full hash match. The index always has a power of two
+ * number of slots and is kept at most half full, so there is no need for a
+ * tombstone scheme: metrics are never removed from a table.
+ */
+typedef struct _nrmslot_t {
+  uint32_t hash; /* Cached hash of the metric in this slot */
+  int metric;    /* Metric index + 1. 0 means the slot is empty */
+} nrmslot_t;
+
 typedef struct _nrminttable_t {
   int number;          /* Number of metrics in the table */
   int allocated;       /* Current number of metrics allocated */
   int max_size;        /* Maximum number of non-forced metrics */
   nrmetric_t* metrics; /* The metrics themselves */
   nrpool_t* strpool;   /* String pool containing the metric names */
+  nrmslot_t* slots;    /* Open addressing index into metrics */
+  uint32_t slot_mask;  /* Number of slots - 1; the count is a power of two */
 } nrminttable_t;
 
 /*
@@ -50,8 +66,6 @@ typedef enum _nr_metric_data_attribute_t {
 
 typedef struct _nrmintmetric_t {
   uint32_t hash;  /* Metric hash identifier for quick compares */
-  int left;       /* Index of binary tree left child. -1 means empty */
-  int right;      /* Index of binary tree right child. -1 means empty */
   uint32_t flags; /* Additional metric information */
   int name_index; /* String pool index of metric name */
   nrtime_t mdata[NRM_MUST_BE_GREATEST]; /* The actual metric data */
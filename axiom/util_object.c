@@ -14,6 +14,7 @@
 #include <stdlib.h>
 
 #include "util_buffer.h"
+#include "util_hash.h"
 #include "util_memory.h"
 #include "util_number_converter.h"
 #include "util_object.h"
@@ -25,6 +26,12 @@
  */
 #define NRO_CHUNK_SIZE 8
 
+/*
+ * Hashes with more keys than this get an index to speed up key lookups.
+ * Smaller hashes, which are the vast majority, are simply scanned linearly.
+ */
+#define NRO_HASH_INDEX_THRESHOLD 16
+
 /*
  * This file implements the generic object. Unlike its use in the php agent
  * where the internals of this type are visible to all, in this implementation
@@ -37,11 +44,30 @@
  * In order to shorten the function names and to increase legibility, we use
  * the prefix nro_ for all functions, which stands for "New Relic Object".
  */
+
+/*
+ * The key index of a large hash: an open addressing table, using linear
+ * probing, that maps key hashes to positions in the keys and data arrays.
+ * Those arrays remain the source of truth and preserve insertion order for
+ * iteration and JSON output. Keys are never removed from a hash, and the
+ * index is kept at most half full, so probe sequences always terminate.
+ */
+typedef struct _nrohashslot_t {
+  uint32_t hash; /* Hash of the key in this slot */
+  int pos;       /* Position of the key + 1. 0 means the slot is empty */
+} nrohashslot_t;
+
+typedef struct _nrohashindex_t {
+  uint32_t mask; /* Number of slots - 1; the count is a power of two */
+  nrohashslot_t slots[];
+} nrohashindex_t;
+
 typedef struct _nrohash_t {
   int size;
   int allocated;
   char** keys;
   struct _nrintobj_t** data;
+  nrohashindex_t* index; /* NULL until size exceeds NRO_HASH_INDEX_THRESHOLD */
 } nrohash_t;
 
 typedef struct _nrarray_t {
@@ -52,6 +78,8 @@ typedef struct _nrarray_t {
 
 typedef struct _nrintobj_t {
   nrotype_t type;
+  int refs; /* Number of references taken with nro_ref(), in addition to the
+               one held by the creator */
   union {
     int ival;       /* int */
     int64_t lval;   /* long */
@@ -256,6 +284,7 @@ static void nro_internal_delete(nrintobj_t* op, int freebase) {
       }
       nr_free(op->u.hval.keys);
       nr_free(op->u.hval.data);
+      nr_free(op->u.hval.index);
       op->u.hval.size = 0;
       op->u.hval.allocated = 0;
       op->u.hval.keys = 0;
@@ -286,10 +315,84 @@ void nro_real_delete(nrobj_t** obj) {
     return;
   }
 
+  /*
+   * An object without extra references cannot gain one concurrently, as
+   * that would require another owner, so the atomic update is only needed
+   * for shared objects. If this was not the last reference, just drop it.
+   */
+  if ((0 != __atomic_load_n(&(*op)->refs, __ATOMIC_ACQUIRE))
+      && (__atomic_fetch_sub(&(*op)->refs, 1, __ATOMIC_ACQ_REL) > 0)) {
+    *obj = 0;
+    return;
+  }
+
   nro_internal_delete(*op, 1);
   *obj = 0;
 }
 
+nrobj_t* nro_ref(nrobj_t* obj) {
+  if (nrunlikely(NULL == obj)) {
+    return NULL;
+  }
+
+  __atomic_fetch_add(&obj->refs, 1, __ATOMIC_RELAXED);
+
+  return obj;
+}
+
+static void nro_hash_index_insert(nrohashindex_t* index,
+                                  uint32_t hash,
+                                  int pos) {
+  uint32_t slot = hash & index->mask;
+
+  while (0 != index->slots[slot].pos) {
+    slot = (slot + 1) & index->mask;
+  }
+
+  index->slots[slot].hash = hash;
+  index->slots[slot].pos = pos + 1;
+}
+
+/*
+ * Purpose : (Re)build the key index of a hash, sized for the number of keys
+ *           currently allocated.
+ */
+static void nro_hash_index_build(nrohash_t* hval) {
+  uint32_t num_slots = 2 * NRO_HASH_INDEX_THRESHOLD;
+  int i;
+
+  while (num_slots < 2 * (uint32_t)hval->allocated) {
+    num_slots *= 2;
+  }
+
+  nr_free(hval->index);
+  hval->index = (nrohashindex_t*)nr_zalloc(sizeof(nrohashindex_t)
+                                           + num_slots * sizeof(nrohashslot_t));
+  hval->index->mask = num_slots - 1;
+
+  for (i = 0; i < hval->size; i++) {
+    nro_hash_index_insert(hval->index, nr_mkhash(hval->keys[i], NULL), i);
+  }
+}
+
+/*
+ * Purpose : Add the key at the given position to the key index, creating or
+ *           growing the index if required.
+ */
+static void nro_hash_index_add(nrohash_t* hval, int pos) {
+  if (hval->size <= NRO_HASH_INDEX_THRESHOLD) {
+    return;
+  }
+
+  if ((NULL == hval->index)
+      || ((uint32_t)hval->size * 2 > hval->index->mask + 1)) {
+    nro_hash_index_build(hval);
+    return;
+  }
+
+  nro_hash_index_insert(hval->index, nr_mkhash(hval->keys[pos], NULL), pos);
+}
+
 /*
  * Search for an existing key in a hash.
  * Returns : its position if found (positional range from 0 .. size)
@@ -314,6 +417,25 @@ static int nro_find_key_in_hash(const nrintobj_t* op, const char* key) {
     return -2;
   }
 
+  if (op->u.hval.index) {
+    const nrohashindex_t* index = op->u.hval.index;
+    uint32_t hash = nr_mkhash(key, NULL);
+    uint32_t slot;
+
+    for (slot = hash & index->mask; 0 != index->slots[slot].pos;
+         slot = (slot + 1) & index->mask) {
+      if (hash == index->slots[slot].hash) {
+        int pos = index->slots[slot].pos - 1;
+
+        if (0 == nr_strcmp(op->u.hval.keys[pos], key)) {
+          return pos;
+        }
+      }
+    }
+
+    return -2;
+  }
+
   for (i = 0; i < op->u.hval.size; i++) {
     if (0 == nr_strcmp(op->u.hval.keys[i], key)) {
       return i;
@@ -448,6 +570,7 @@ static nr_status_t nro_internal_setvalue_hash(nrintobj_t* op,
     }
     op->u.hval.size++;
     op->u.hval.keys[idx] = nr_strdup(key);
+    nro_hash_index_add(&op->u.hval, idx);
   }
   op->u.hval.data[idx] = nobj;
   return NR_SUCCESS;
@@ -851,6 +974,9 @@ nrobj_t* nro_copy(const nrobj_t* obj) {
         np->u.hval.keys[i] = nr_strdup(op->u.hval.keys[i]);
         np->u.hval.data[i] = nro_copy(op->u.hval.data[i]);
       }
+      if (op->u.hval.index) {
+        nro_hash_index_build(&np->u.hval);
+      }
       break;
 
     case NR_OBJECT_ARRAY:
@@ -42,11 +42,29 @@ typedef enum _nrotype_t {
 extern nrobj_t* nro_new(nrotype_t type);
 
 /*
- * Delete a generic object freeing up all of its memory.
+ * Delete a generic object freeing up all of its memory. If references to the
+ * object have been taken with nro_ref(), the memory is only freed once the
+ * last reference is deleted.
  */
 extern void nro_real_delete(nrobj_t** obj);
 #define nro_delete(O) nro_real_delete(&O)
 
+/*
+ * Purpose : Take an additional reference to an object so that it can be
+ *           shared without being copied. Each reference must be released
+ *           with nro_delete().
+ *
+ * Params  : 1. The object to reference. This must be a top level object:
+ *              it must not be contained within another hash or array.
+ *
+ * Returns : The object.
+ *
+ * Notes   : The reference count is maintained atomically, so references may
+ *           be released from different threads. The object itself is not
+ *           protected however: once shared, it must be treated as immutable.
+ */
+extern nrobj_t* nro_ref(nrobj_t* obj);
+
 /*
  * Return the type of a generic object.
  */
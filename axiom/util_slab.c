@@ -5,16 +5,135 @@
 
 #include "util_slab.h"
 
+#include <string.h>
 #include <unistd.h>
 
 #include "util_logging.h"
 #include "util_memory.h"
 #include "util_slab_private.h"
+#include "util_threads.h"
+
+/*
+ * The process wide page cache. Cached pages are kept in a singly linked list
+ * through their prev pointers, most recently cached first. In practice the
+ * list is short: it only ever holds the handful of page sizes produced by
+ * the doubling in nr_slab_next().
+ */
+static nrthread_mutex_t nr_slab_page_cache_mutex = NRTHREAD_MUTEX_INITIALIZER;
+static nr_slab_page_t* nr_slab_page_cache_head = NULL;
+static size_t nr_slab_page_cache_bytes = 0;
+static size_t nr_slab_page_cache_limit = 0;
+
+static inline size_t nr_slab_page_size(const nr_slab_page_t* page) {
+  return page->capacity + sizeof(nr_slab_page_t);
+}
+
+/*
+ * Purpose : Free the least recently cached pages until the cache fits within
+ *           the given number of bytes.
+ *
+ * Note    : The cache mutex must be held by the caller.
+ */
+static void nr_slab_page_cache_trim_locked(size_t max_bytes) {
+  while (nr_slab_page_cache_bytes > max_bytes) {
+    nr_slab_page_t** link = &nr_slab_page_cache_head;
+
+    while ((*link)->prev) {
+      link = &(*link)->prev;
+    }
+
+    nr_slab_page_cache_bytes -= nr_slab_page_size(*link);
+    nr_free(*link);
+  }
+}
+
+static nr_slab_page_t* nr_slab_page_cache_get(size_t page_size) {
+  nr_slab_page_t* page = NULL;
+  nr_slab_page_t** link;
+
+  nrt_mutex_lock(&nr_slab_page_cache_mutex);
+  for (link = &nr_slab_page_cache_head; *link; link = &(*link)->prev) {
+    if (nr_slab_page_size(*link) == page_size) {
+      page = *link;
+      *link = page->prev;
+      nr_slab_page_cache_bytes -= page_size;
+      break;
+    }
+  }
+  nrt_mutex_unlock(&nr_slab_page_cache_mutex);
+
+  if (page) {
+    /*
+     * Everything past the used mark was never handed out, and is therefore
+     * still zeroed.
+     */
+    memset(page->data, 0, page->used);
+  }
+
+  return page;
+}
+
+/*
+ * Purpose : Return a page to the cache.
+ *
+ * Returns : True if the page is now owned by the cache; false if the caller
+ *           must free it.
+ */
+static bool nr_slab_page_cache_put(nr_slab_page_t* page) {
+  size_t page_size = nr_slab_page_size(page);
+  bool cached = false;
+
+  nrt_mutex_lock(&nr_slab_page_cache_mutex);
+  if (page_size <= nr_slab_page_cache_limit) {
+    page->prev = nr_slab_page_cache_head;
+    nr_slab_page_cache_head = page;
+    nr_slab_page_cache_bytes += page_size;
+    nr_slab_page_cache_trim_locked(nr_slab_page_cache_limit);
+    cached = true;
+  }
+  nrt_mutex_unlock(&nr_slab_page_cache_mutex);
+
+  return cached;
+}
+
+void nr_slab_page_cache_set_limit(size_t max_bytes) {
+  nrt_mutex_lock(&nr_slab_page_cache_mutex);
+  nr_slab_page_cache_limit = max_bytes;
+  nr_slab_page_cache_trim_locked(max_bytes);
+  nrt_mutex_unlock(&nr_slab_page_cache_mutex);
+}
+
+void nr_slab_page_cache_flush(void) {
+  nrt_mutex_lock(&nr_slab_page_cache_mutex);
+  nr_slab_page_cache_trim_locked(0);
+  nrt_mutex_unlock(&nr_slab_page_cache_mutex);
+}
+
+size_t nr_slab_page_cache_size(void) {
+  size_t bytes;
+
+  nrt_mutex_lock(&nr_slab_page_cache_mutex);
+  bytes = nr_slab_page_cache_bytes;
+  nrt_mutex_unlock(&nr_slab_page_cache_mutex);
+
+  return bytes;
+}
 
 static nr_slab_page_t* nr_slab_page_create(size_t page_size,
                                            nr_slab_page_t* prev) {
   nr_slab_page_t* page;
 
+  page = nr_slab_page_cache_get(page_size);
+  if (page) {
+    *page = (nr_slab_page_t){
+        .capacity = page_size - sizeof(nr_slab_page_t),
+        .used = 0,
+        .prev = prev,
+    };
+
+    return page;
+  }
+
   /*
    * Traditionally, one would implement this kind of allocator on top of
    * mmap(). In practice, though, the libc on our supported operating systems
@@ -138,13 +257,15 @@ void nr_slab_destroy(nr_slab_t** slab_ptr) {
 
   /*
    * Actually destroying the slab allocator is easy: we just free each page
-   * until we have no more pages.
+   * until we have no more pages, unless the page cache wants to keep it.
    */
   head = slab->head;
   while (head) {
     nr_slab_page_t* prev = head->prev;
 
-    nr_free(head);
+    if (!nr_slab_page_cache_put(head)) {
+      nr_free(head);
+    }
     head = prev;
   }
 
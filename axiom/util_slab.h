@@ -77,4 +77,40 @@ extern bool nr_slab_release(nr_slab_t* slab, void* obj);
  */
 extern size_t nr_slab_count(const nr_slab_t* slab);
 
+/*
+ * USAGE NOTES: PAGE CACHE
+ *
+ * Slab allocators are typically created and destroyed once per transaction,
+ * so a long lived process would otherwise allocate, fault in, and free the
+ * same pages on every request. Instead, nr_slab_destroy() can return pages to
+ * a process wide cache, and nr_slab_create() and nr_slab_next() reuse cached
+ * pages of the same size before allocating new ones. Reused pages are zeroed
+ * as usual, but only the bytes that were actually used are cleared.
+ *
+ * The cache is bounded by a high-water mark in bytes, and is disabled (with a
+ * limit of 0) by default. When the limit would be exceeded, the least recently
+ * cached pages are freed. The cache is protected by a mutex, and so may be
+ * shared between threads.
+ */
+
+/*
+ * Purpose : Set the maximum number of bytes the slab page cache may retain.
+ *
+ * Params  : 1. The high-water mark in bytes, or 0 to disable the cache.
+ *
+ * Notes   : Lowering the limit immediately frees cached pages as needed.
+ */
+extern void nr_slab_page_cache_set_limit(size_t max_bytes);
+
+/*
+ * Purpose : Free every page held in the slab page cache. The limit is left
+ *           unchanged.
+ */
+extern void nr_slab_page_cache_flush(void);
+
+/*
+ * Purpose : Return the number of bytes currently held in the slab page cache.
+ */
+extern size_t nr_slab_page_cache_size(void);
+
 #endif /* UTIL_SLAB_HDR */
@@ -7,6 +7,10 @@
 
 #include <stddef.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "util_hash.h"
 #include "util_logging.h"
 #include "util_memory.h"
@@ -14,9 +18,147 @@
 #include "util_sql_private.h"
 #include "util_strings.h"
 
+/*
+ * Obfuscation spends most of its time skipping over runs of bytes that are
+ * either copied unchanged (outside of literals) or dropped (inside quoted
+ * literals). The scanners below find the end of such runs, examining 16 bytes
+ * at a time where SSE2 is available, so that nr_sql_obfuscate() only has to
+ * run its state machine on the bytes that matter.
+ */
+#if defined(__SSE2__)
+/*
+ * Purpose : Find the next byte that may start a literal or a comment outside
+ *           of a literal: a quote, '-', '/' or a digit.
+ *
+ * Returns : A pointer to that byte, or end if there is none.
+ */
+static const char* nr_sql_find_special(const char* p, const char* end) {
+  const __m128i dquote = _mm_set1_epi8('"');
+  const __m128i squote = _mm_set1_epi8('\'');
+  const __m128i dash = _mm_set1_epi8('-');
+  const __m128i slash = _mm_set1_epi8('/');
+  /*
+   * Digits are found with a single signed comparison by shifting '0' to the
+   * smallest signed byte value.
+   */
+  const __m128i digit_bias = _mm_set1_epi8((char)('0' + 0x80));
+  const __m128i digit_limit = _mm_set1_epi8((char)(0x80 + 10));
+
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, dquote), _mm_cmpeq_epi8(v, squote)),
+        _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, dash), _mm_cmpeq_epi8(v, slash)),
+            _mm_cmplt_epi8(_mm_sub_epi8(v, digit_bias), digit_limit)));
+    int mask = _mm_movemask_epi8(special);
+
+    if (mask) {
+      return p + __builtin_ctz((unsigned int)mask);
+    }
+    p += 16;
+  }
+
+  while (p < end) {
+    switch (*p) {
+      case '"':
+      case '\'':
+      case '-':
+      case '/':
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7':
+      case '8':
+      case '9':
+        return p;
+
+      default:
+        p++;
+        break;
+    }
+  }
+
+  return end;
+}
+
+/*
+ * Purpose : Find the next quote or backslash inside a quoted literal.
+ *
+ * Returns : A pointer to that byte, or end if there is none.
+ */
+static const char* nr_sql_find_quote(const char* p,
+                                     const char* end,
+                                     char quote) {
+  const __m128i quotes = _mm_set1_epi8(quote);
+  const __m128i backslash = _mm_set1_epi8('\\');
+
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(v, quotes), _mm_cmpeq_epi8(v, backslash)));
+
+    if (mask) {
+      return p + __builtin_ctz((unsigned int)mask);
+    }
+    p += 16;
+  }
+
+  while ((p < end) && (quote != *p) && ('\\' != *p)) {
+    p++;
+  }
+
+  return p;
+}
+#else
+static const char* nr_sql_find_special(const char* p, const char* end) {
+  while (p < end) {
+    switch (*p) {
+      case '"':
+      case '\'':
+      case '-':
+      case '/':
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7':
+      case '8':
+      case '9':
+        return p;
+
+      default:
+        p++;
+        break;
+    }
+  }
+
+  return end;
+}
+
+static const char* nr_sql_find_quote(const char* p,
+                                     const char* end,
+                                     char quote) {
+  while ((p < end) && (quote != *p) && ('\\' != *p)) {
+    p++;
+  }
+
+  return p;
+}
+#endif
+
 char* nr_sql_obfuscate(const char* raw) {
   char* obf;
   const char* p;
+  const char* end;
+  const char* next;
   char* q;
   int state = 0;
 
@@ -24,13 +166,25 @@ char* nr_sql_obfuscate(const char* raw) {
     return 0;
   }
 
-  obf = (char*)nr_malloc(nr_strlen(raw) + 1);
+  end = raw + nr_strlen(raw);
+  obf = (char*)nr_malloc((end - raw) + 1);
   p = raw;
   q = obf;
 
-  while (*p) {
+  while (p < end) {
     switch (state) {
       case 0: /* normal */
+        /*
+         * Copy everything up to the next quote, comment or digit.
+         */
+        next = nr_sql_find_special(p, end);
+        nr_memcpy(q, p, next - p);
+        q += next - p;
+        p = next;
+        if (p >= end) {
+          goto done;
+        }
+
         switch (*p) {
           case '"':
             p++;
@@ -68,72 +222,40 @@ char* nr_sql_obfuscate(const char* raw) {
             }
             break;
 
-          case '0':
-          case '1':
-          case '2':
-          case '3':
-          case '4':
-          case '5':
-          case '6':
-          case '7':
-          case '8':
-          case '9':
+          default: /* a digit */
             *q++ = '?';
             p++;
             state = 3;
             break;
-
-          default:
-            *q++ = *p++;
-            break;
         }
         break;
 
       case 1: /* inside "..." */
-        switch (*p) {
-          case '\\':
-            p++;
-            p++;
-            break;
-
-          case '"':
-            if ('"' == p[1]) {
-              p++;
-              p++;
-            } else {
-              p++;
-              state = 0;
-            }
-            break;
-
-          default:
-            p++;
-            break;
-        }
-        break;
-
       case 2: /* inside '...' */
-        switch (*p) {
-          case '\\':
-            p++;
-            p++;
-            break;
-
-          case '\'':
-            if ('\'' == p[1]) {
-              p++;
-              p++;
-            } else {
-              p++;
-              state = 0;
-            }
-            break;
+      {
+        char quote = (1 == state) ? '"' : '\'';
+
+        /*
+         * Skip everything up to the next quote or escape.
+         */
+        p = nr_sql_find_quote(p, end, quote);
+        if (p >= end) {
+          goto done;
+        }
 
-          default:
-            p++;
-            break;
+        if ('\\' == *p) {
+          /*
+           * Skip the escaped character, unless the backslash is the last
+           * character of the statement.
+           */
+          p += (p + 1 < end) ? 2 : 1;
+        } else if (quote == p[1]) {
+          p += 2;
+        } else {
+          p++;
+          state = 0;
         }
-        break;
+      } break;
 
       case 3: /* inside \d+ */
         switch (*p) {
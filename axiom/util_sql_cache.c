@@ -0,0 +1,340 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nr_axiom.h"
+
+#include <stdbool.h>
+
+#include "util_hashmap.h"
+#include "util_memory.h"
+#include "util_sql.h"
+#include "util_sql_cache.h"
+#include "util_strings.h"
+#include "util_threads.h"
+
+/*
+ * A cached statement. The results are computed lazily, as not every caller
+ * needs every result: for example, the operation and table are required for
+ * every SQL segment, but the obfuscated SQL only when SQL is recorded in
+ * obfuscated form.
+ */
+typedef struct _nr_sql_cache_entry_t {
+  struct _nr_sql_cache_entry_t* newer; /* Towards the most recently used */
+  struct _nr_sql_cache_entry_t* older; /* Towards the least recently used */
+  char* sql;                           /* The raw SQL; the key */
+  size_t sql_len;                      /* The length of the raw SQL */
+
+  char* obfuscated; /* The obfuscated SQL, or NULL if not yet computed */
+  bool has_normalized_id;
+  uint32_t normalized_id;
+  bool has_operation_and_table;
+  const char* operation; /* Constant string returned by the parser */
+  char* table;           /* May be NULL even once computed */
+} nr_sql_cache_entry_t;
+
+/*
+ * The process wide cache: a hashmap from the raw SQL to its entry, and a
+ * doubly linked list of the same entries in order of use.
+ */
+static nrthread_mutex_t nr_sql_cache_mutex = NRTHREAD_MUTEX_INITIALIZER;
+static nr_hashmap_t* nr_sql_cache_map = NULL;
+static nr_sql_cache_entry_t* nr_sql_cache_newest = NULL;
+static nr_sql_cache_entry_t* nr_sql_cache_oldest = NULL;
+static size_t nr_sql_cache_count = 0;
+static size_t nr_sql_cache_limit = 0;
+
+static void nr_sql_cache_unlink_locked(nr_sql_cache_entry_t* entry) {
+  if (entry->newer) {
+    entry->newer->older = entry->older;
+  } else {
+    nr_sql_cache_newest = entry->older;
+  }
+
+  if (entry->older) {
+    entry->older->newer = entry->newer;
+  } else {
+    nr_sql_cache_oldest = entry->newer;
+  }
+
+  entry->newer = NULL;
+  entry->older = NULL;
+}
+
+static void nr_sql_cache_push_locked(nr_sql_cache_entry_t* entry) {
+  entry->newer = NULL;
+  entry->older = nr_sql_cache_newest;
+  if (nr_sql_cache_newest) {
+    nr_sql_cache_newest->newer = entry;
+  } else {
+    nr_sql_cache_oldest = entry;
+  }
+  nr_sql_cache_newest = entry;
+}
+
+/*
+ * Purpose : Evict the least recently used statements until the cache holds
+ *           at most the given number of statements.
+ *
+ * Note    : The cache mutex must be held by the caller.
+ */
+static void nr_sql_cache_trim_locked(size_t max_entries) {
+  while (nr_sql_cache_count > max_entries) {
+    nr_sql_cache_entry_t* entry = nr_sql_cache_oldest;
+
+    nr_sql_cache_unlink_locked(entry);
+    nr_hashmap_delete(nr_sql_cache_map, entry->sql, entry->sql_len);
+    nr_sql_cache_count--;
+
+    nr_free(entry->sql);
+    nr_free(entry->obfuscated);
+    nr_free(entry->table);
+    nr_free(entry);
+  }
+}
+
+/*
+ * Purpose : Decide whether a statement may be cached.
+ *
+ * Note    : The cache mutex must be held by the caller.
+ */
+static bool nr_sql_cache_applies_locked(const char* sql, size_t sql_len) {
+  return (0 != nr_sql_cache_limit) && (NULL != sql) && (0 != sql_len)
+         && (sql_len <= NR_SQL_CACHE_MAX_SQL_LEN);
+}
+
+/*
+ * Purpose : Find a statement in the cache, marking it as the most recently
+ *           used.
+ *
+ * Returns : The entry, or NULL if the statement is not cached.
+ *
+ * Note    : The cache mutex must be held by the caller.
+ */
+static nr_sql_cache_entry_t* nr_sql_cache_find_locked(const char* sql,
+                                                      size_t sql_len) {
+  nr_sql_cache_entry_t* entry
+      = (nr_sql_cache_entry_t*)nr_hashmap_get(nr_sql_cache_map, sql, sql_len);
+
+  if (entry && (entry != nr_sql_cache_newest)) {
+    nr_sql_cache_unlink_locked(entry);
+    nr_sql_cache_push_locked(entry);
+  }
+
+  return entry;
+}
+
+/*
+ * Purpose : Find a statement in the cache, adding it if required.
+ *
+ * Returns : The entry, or NULL if the cache has been disabled in the meantime.
+ *
+ * Note    : The cache mutex must be held by the caller.
+ */
+static nr_sql_cache_entry_t* nr_sql_cache_add_locked(const char* sql,
+                                                     size_t sql_len) {
+  nr_sql_cache_entry_t* entry;
+
+  if (!nr_sql_cache_applies_locked(sql, sql_len)) {
+    return NULL;
+  }
+
+  entry = nr_sql_cache_find_locked(sql, sql_len);
+  if (entry) {
+    return entry;
+  }
+
+  nr_sql_cache_trim_locked(nr_sql_cache_limit - 1);
+
+  entry = (nr_sql_cache_entry_t*)nr_zalloc(sizeof(nr_sql_cache_entry_t));
+  entry->sql = nr_strndup(sql, sql_len);
+  entry->sql_len = sql_len;
+
+  nr_hashmap_set(nr_sql_cache_map, entry->sql, sql_len, entry);
+  nr_sql_cache_push_locked(entry);
+  nr_sql_cache_count++;
+
+  return entry;
+}
+
+static void nr_sql_cache_set_status(nr_sql_cache_status_t* status_ptr,
+                                    nr_sql_cache_status_t status) {
+  if (status_ptr) {
+    *status_ptr = status;
+  }
+}
+
+void nr_sql_cache_set_limit(size_t max_entries) {
+  nrt_mutex_lock(&nr_sql_cache_mutex);
+  nr_sql_cache_limit = max_entries;
+  if (nr_sql_cache_map) {
+    nr_sql_cache_trim_locked(max_entries);
+  }
+  if (0 == max_entries) {
+    nr_hashmap_destroy(&nr_sql_cache_map);
+  } else if (NULL == nr_sql_cache_map) {
+    nr_sql_cache_map = nr_hashmap_create_buckets(max_entries, NULL);
+  }
+  nrt_mutex_unlock(&nr_sql_cache_mutex);
+}
+
+void nr_sql_cache_flush(void) {
+  nrt_mutex_lock(&nr_sql_cache_mutex);
+  if (nr_sql_cache_map) {
+    nr_sql_cache_trim_locked(0);
+  }
+  nrt_mutex_unlock(&nr_sql_cache_mutex);
+}
+
+size_t nr_sql_cache_size(void) {
+  size_t count;
+
+  nrt_mutex_lock(&nr_sql_cache_mutex);
+  count = nr_sql_cache_count;
+  nrt_mutex_unlock(&nr_sql_cache_mutex);
+
+  return count;
+}
+
+char* nr_sql_cache_obfuscate(const char* raw,
+                             nr_sql_cache_status_t* status_ptr) {
+  nr_sql_cache_status_t status = NR_SQL_CACHE_BYPASSED;
+  nr_sql_cache_entry_t* entry;
+  size_t raw_len = raw ? nr_strlen(raw) : 0;
+  char* obfuscated = NULL;
+
+  nrt_mutex_lock(&nr_sql_cache_mutex);
+  if (nr_sql_cache_applies_locked(raw, raw_len)) {
+    status = NR_SQL_CACHE_MISS;
+    entry = nr_sql_cache_find_locked(raw, raw_len);
+    if (entry && entry->obfuscated) {
+      status = NR_SQL_CACHE_HIT;
+      obfuscated = nr_strdup(entry->obfuscated);
+    }
+  }
+  nrt_mutex_unlock(&nr_sql_cache_mutex);
+
+  nr_sql_cache_set_status(status_ptr, status);
+  if (NR_SQL_CACHE_HIT == status) {
+    return obfuscated;
+  }
+
+  /*
+   * The statement is processed without holding the lock, so that other
+   * threads are not held up.
+   */
+  obfuscated = nr_sql_obfuscate(raw);
+
+  if ((NR_SQL_CACHE_MISS == status) && obfuscated) {
+    nrt_mutex_lock(&nr_sql_cache_mutex);
+    entry = nr_sql_cache_add_locked(raw, raw_len);
+    if (entry && (NULL == entry->obfuscated)) {
+      entry->obfuscated = nr_strdup(obfuscated);
+    }
+    nrt_mutex_unlock(&nr_sql_cache_mutex);
+  }
+
+  return obfuscated;
+}
+
+uint32_t nr_sql_cache_normalized_id(const char* raw,
+                                    nr_sql_cache_status_t* status_ptr) {
+  nr_sql_cache_status_t status = NR_SQL_CACHE_BYPASSED;
+  nr_sql_cache_entry_t* entry;
+  size_t raw_len = raw ? nr_strlen(raw) : 0;
+  char* obfuscated = NULL;
+  uint32_t normalized_id = 0;
+
+  nrt_mutex_lock(&nr_sql_cache_mutex);
+  if (nr_sql_cache_applies_locked(raw, raw_len)) {
+    status = NR_SQL_CACHE_MISS;
+    entry = nr_sql_cache_find_locked(raw, raw_len);
+    if (entry && entry->has_normalized_id) {
+      status = NR_SQL_CACHE_HIT;
+      normalized_id = entry->normalized_id;
+    } else if (entry && entry->obfuscated) {
+      obfuscated = nr_strdup(entry->obfuscated);
+    }
+  }
+  nrt_mutex_unlock(&nr_sql_cache_mutex);
+
+  nr_sql_cache_set_status(status_ptr, status);
+  if (NR_SQL_CACHE_HIT == status) {
+    return normalized_id;
+  }
+
+  if (NULL == obfuscated) {
+    obfuscated = nr_sql_obfuscate(raw);
+    if (NULL == obfuscated) {
+      return 0;
+    }
+  }
+  normalized_id = nr_sql_normalized_id(obfuscated);
+
+  if (NR_SQL_CACHE_MISS == status) {
+    nrt_mutex_lock(&nr_sql_cache_mutex);
+    entry = nr_sql_cache_add_locked(raw, raw_len);
+    if (entry) {
+      if (NULL == entry->obfuscated) {
+        entry->obfuscated = obfuscated;
+        obfuscated = NULL;
+      }
+      entry->has_normalized_id = true;
+      entry->normalized_id = normalized_id;
+    }
+    nrt_mutex_unlock(&nr_sql_cache_mutex);
+  }
+
+  nr_free(obfuscated);
+
+  return normalized_id;
+}
+
+void nr_sql_cache_get_operation_and_table(const char* sql,
+                                          const char** operation_ptr,
+                                          char** table_ptr,
+                                          int show_sql_parsing,
+                                          nr_sql_cache_status_t* status_ptr) {
+  nr_sql_cache_status_t status = NR_SQL_CACHE_BYPASSED;
+  nr_sql_cache_entry_t* entry;
+  size_t sql_len = sql ? nr_strlen(sql) : 0;
+
+  nr_sql_cache_set_status(status_ptr, status);
+  if ((NULL == operation_ptr) || (NULL == table_ptr) || show_sql_parsing) {
+    nr_sql_get_operation_and_table(sql, operation_ptr, table_ptr,
+                                   show_sql_parsing);
+    return;
+  }
+
+  nrt_mutex_lock(&nr_sql_cache_mutex);
+  if (nr_sql_cache_applies_locked(sql, sql_len)) {
+    status = NR_SQL_CACHE_MISS;
+    entry = nr_sql_cache_find_locked(sql, sql_len);
+    if (entry && entry->has_operation_and_table) {
+      status = NR_SQL_CACHE_HIT;
+      *operation_ptr = entry->operation;
+      *table_ptr = entry->table ? nr_strdup(entry->table) : NULL;
+    }
+  }
+  nrt_mutex_unlock(&nr_sql_cache_mutex);
+
+  nr_sql_cache_set_status(status_ptr, status);
+  if (NR_SQL_CACHE_HIT == status) {
+    return;
+  }
+
+  nr_sql_get_operation_and_table(sql, operation_ptr, table_ptr,
+                                 show_sql_parsing);
+
+  if (NR_SQL_CACHE_MISS == status) {
+    nrt_mutex_lock(&nr_sql_cache_mutex);
+    entry = nr_sql_cache_add_locked(sql, sql_len);
+    if (entry && !entry->has_operation_and_table) {
+      entry->has_operation_and_table = true;
+      entry->operation = *operation_ptr;
+      entry->table = *table_ptr ? nr_strdup(*table_ptr) : NULL;
+    }
+    nrt_mutex_unlock(&nr_sql_cache_mutex);
+  }
+}
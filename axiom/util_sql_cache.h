@@ -0,0 +1,95 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * This file contains a process wide cache of the results of SQL processing.
+ *
+ * Applications issue the same handful of statements over and over, both
+ * within a request and across requests. The functions below wrap the SQL
+ * obfuscation, normalization and parsing functions in util_sql.h, caching
+ * their results keyed on the raw SQL. The least recently used statements are
+ * evicted once the cache is full.
+ *
+ * The cache is disabled by default: nr_sql_cache_set_limit() must be called
+ * to enable it. While disabled, the functions below simply call through to
+ * their uncached equivalents.
+ */
+#ifndef UTIL_SQL_CACHE_HDR
+#define UTIL_SQL_CACHE_HDR
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Statements longer than this are never cached: they are rarely repeated
+ * verbatim, and would quickly push useful entries out of the cache.
+ */
+#define NR_SQL_CACHE_MAX_SQL_LEN 8192
+
+typedef enum _nr_sql_cache_status_t {
+  NR_SQL_CACHE_BYPASSED = 0, /* The cache was disabled or not applicable */
+  NR_SQL_CACHE_HIT = 1,
+  NR_SQL_CACHE_MISS = 2,
+} nr_sql_cache_status_t;
+
+/*
+ * Purpose : Set the maximum number of statements held in the cache.
+ *
+ * Params  : 1. The maximum number of statements. 0 disables the cache.
+ *
+ * Notes   : Lowering the limit immediately evicts statements as needed.
+ */
+extern void nr_sql_cache_set_limit(size_t max_entries);
+
+/*
+ * Purpose : Evict every statement from the cache. The limit is left
+ *           unchanged.
+ */
+extern void nr_sql_cache_flush(void);
+
+/*
+ * Purpose : Return the number of statements currently held in the cache.
+ */
+extern size_t nr_sql_cache_size(void);
+
+/*
+ * Purpose : Cached equivalent of nr_sql_obfuscate().
+ *
+ * Params  : 1. The raw SQL.
+ *           2. An optional pointer to receive whether the cache was used.
+ *
+ * Returns : An allocated, obfuscated copy of the SQL, or NULL on error.
+ */
+extern char* nr_sql_cache_obfuscate(const char* raw,
+                                    nr_sql_cache_status_t* status_ptr);
+
+/*
+ * Purpose : Cached equivalent of obfuscating SQL and then calling
+ *           nr_sql_normalized_id() on the result.
+ *
+ * Params  : 1. The raw SQL.
+ *           2. An optional pointer to receive whether the cache was used.
+ *
+ * Returns : The normalized id, or 0 on error.
+ */
+extern uint32_t nr_sql_cache_normalized_id(const char* raw,
+                                           nr_sql_cache_status_t* status_ptr);
+
+/*
+ * Purpose : Cached equivalent of nr_sql_get_operation_and_table().
+ *
+ * Params  : 1-4. As for nr_sql_get_operation_and_table(). The cache is
+ *                bypassed if show_sql_parsing is set, so that the parser
+ *                logs its work.
+ *           5.   An optional pointer to receive whether the cache was used.
+ */
+extern void nr_sql_cache_get_operation_and_table(
+    const char* sql,
+    const char** operation_ptr,
+    char** table_ptr,
+    int show_sql_parsing,
+    nr_sql_cache_status_t* status_ptr);
+
+#endif /* UTIL_SQL_CACHE_HDR */
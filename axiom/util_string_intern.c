@@ -0,0 +1,278 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nr_axiom.h"
+
+#include <stdbool.h>
+
+#include "util_arena.h"
+#include "util_hash.h"
+#include "util_memory.h"
+#include "util_string_intern.h"
+#include "util_strings.h"
+#include "util_threads.h"
+
+/*
+ * A slot in the open addressing table. The hash and length are written
+ * before the string pointer is published, so a reader that sees a non-NULL
+ * string also sees the matching hash and length. Slots are never cleared.
+ */
+typedef struct _nr_string_intern_slot_t {
+  uint32_t hash;
+  int length;
+  const char* str;
+} nr_string_intern_slot_t;
+
+/*
+ * Strings are only interned once they have been seen before, so that the
+ * table, which never evicts a string, is not filled by strings that are only
+ * used once. The strings that have been seen are kept in a Bloom filter of
+ * this many bits, with two bits per string, which is cleared after every
+ * window of this many strings that were not interned, so that it does not
+ * fill up with them either.
+ */
+#define NR_STRING_INTERN_SEEN_BITS (1 << 19)
+#define NR_STRING_INTERN_SEEN_WINDOW (NR_STRING_INTERN_SEEN_BITS / 32)
+#define NR_STRING_INTERN_SEEN_WORDS (NR_STRING_INTERN_SEEN_BITS / 64)
+
+typedef struct _nr_string_intern_table_t {
+  nr_string_intern_slot_t* slots;
+  size_t mask;        /* The number of slots, minus one */
+  size_t limit;       /* The maximum number of strings */
+  size_t count;       /* The number of strings */
+  nr_arena_t* arena;  /* Storage for the strings */
+  uint64_t* seen;     /* Bloom filter of the strings seen in this window */
+  size_t seen_count;  /* The number of strings seen in this window */
+} nr_string_intern_table_t;
+
+/*
+ * The mutex serialises adding strings and enabling or disabling the table.
+ * Lookups only load the table and slot pointers.
+ */
+static nrthread_mutex_t nr_string_intern_mutex = NRTHREAD_MUTEX_INITIALIZER;
+static nr_string_intern_table_t* nr_string_intern_table = NULL;
+
+static nr_string_intern_table_t* nr_string_intern_table_get(void) {
+  return __atomic_load_n(&nr_string_intern_table, __ATOMIC_ACQUIRE);
+}
+
+static void nr_string_intern_table_destroy(nr_string_intern_table_t** table_ptr) {
+  nr_string_intern_table_t* table = *table_ptr;
+
+  if (NULL == table) {
+    return;
+  }
+
+  nr_arena_destroy(&table->arena);
+  nr_free(table->seen);
+  nr_free(table->slots);
+  nr_realfree((void**)table_ptr);
+}
+
+void nr_string_intern_set_limit(size_t max_strings) {
+  nr_string_intern_table_t* table;
+  size_t num_slots;
+
+  nrt_mutex_lock(&nr_string_intern_mutex);
+  table = nr_string_intern_table;
+
+  if (0 == max_strings) {
+    __atomic_store_n(&nr_string_intern_table, NULL, __ATOMIC_RELEASE);
+    nr_string_intern_table_destroy(&table);
+  } else if (NULL == table) {
+    /*
+     * Keep the table at most half full, so that probe sequences stay short.
+     */
+    num_slots = 16;
+    while (num_slots < (max_strings * 2)) {
+      num_slots *= 2;
+    }
+
+    table = (nr_string_intern_table_t*)nr_zalloc(
+        sizeof(nr_string_intern_table_t));
+    table->slots = (nr_string_intern_slot_t*)nr_calloc(
+        num_slots, sizeof(nr_string_intern_slot_t));
+    table->mask = num_slots - 1;
+    table->limit = max_strings;
+    table->count = 0;
+    table->arena = nr_arena_create(0);
+    table->seen = (uint64_t*)nr_calloc(NR_STRING_INTERN_SEEN_WORDS,
+                                       sizeof(uint64_t));
+    table->seen_count = 0;
+
+    __atomic_store_n(&nr_string_intern_table, table, __ATOMIC_RELEASE);
+  }
+
+  nrt_mutex_unlock(&nr_string_intern_mutex);
+}
+
+size_t nr_string_intern_size(void) {
+  size_t count = 0;
+
+  nrt_mutex_lock(&nr_string_intern_mutex);
+  if (nr_string_intern_table) {
+    count = nr_string_intern_table->count;
+  }
+  nrt_mutex_unlock(&nr_string_intern_mutex);
+
+  return count;
+}
+
+/*
+ * Purpose : Find a string in the table.
+ *
+ * Returns : The slot holding the string, or the empty slot where it would be
+ *           added.
+ */
+static nr_string_intern_slot_t* nr_string_intern_probe(
+    const nr_string_intern_table_t* table,
+    const char* str,
+    uint32_t hash,
+    int length) {
+  size_t i = (size_t)hash & table->mask;
+
+  for (;;) {
+    nr_string_intern_slot_t* slot = &table->slots[i];
+    const char* interned = __atomic_load_n(&slot->str, __ATOMIC_ACQUIRE);
+
+    if (NULL == interned) {
+      return slot;
+    }
+
+    if ((hash == slot->hash) && (length == slot->length)
+        && (0 == nr_memcmp(str, interned, (size_t)length))) {
+      return slot;
+    }
+
+    i = (i + 1) & table->mask;
+  }
+}
+
+/*
+ * Purpose : Record that a string that is not interned has been seen.
+ *
+ * Returns : true if the string has been seen before in this window, and so
+ *           may be interned.
+ *
+ * Notes   : This does not take the mutex. Concurrent callers may clear the
+ *           filter while others set bits in it, which at worst delays
+ *           interning a string until it is seen again.
+ */
+static bool nr_string_intern_seen(nr_string_intern_table_t* table,
+                                  uint32_t hash) {
+  uint64_t mixed = (uint64_t)hash * 0x9e3779b97f4a7c15ULL;
+  size_t bit1 = (size_t)(mixed >> 45);
+  size_t bit2 = (size_t)(mixed >> 13) & (NR_STRING_INTERN_SEEN_BITS - 1);
+  uint64_t mask1 = (uint64_t)1 << (bit1 % 64);
+  uint64_t mask2 = (uint64_t)1 << (bit2 % 64);
+  uint64_t old1;
+  uint64_t old2;
+  size_t i;
+
+  old1 = __atomic_fetch_or(&table->seen[bit1 / 64], mask1, __ATOMIC_RELAXED);
+  old2 = __atomic_fetch_or(&table->seen[bit2 / 64], mask2, __ATOMIC_RELAXED);
+  if ((old1 & mask1) && (old2 & mask2)) {
+    return true;
+  }
+
+  if (0
+      == (__atomic_add_fetch(&table->seen_count, 1, __ATOMIC_RELAXED)
+          % NR_STRING_INTERN_SEEN_WINDOW)) {
+    for (i = 0; i < NR_STRING_INTERN_SEEN_WORDS; i++) {
+      __atomic_store_n(&table->seen[i], 0, __ATOMIC_RELAXED);
+    }
+  }
+
+  return false;
+}
+
+const char* nr_string_intern_with_hash_length(const char* str,
+                                              uint32_t hash,
+                                              int length) {
+  nr_string_intern_table_t* table = nr_string_intern_table_get();
+  nr_string_intern_slot_t* slot;
+  const char* interned;
+  char* copy;
+
+  if ((NULL == table) || (NULL == str) || (length < 0)
+      || (length > NR_STRING_INTERN_MAX_LEN)) {
+    return NULL;
+  }
+
+  /*
+   * The common case: the string has already been interned.
+   */
+  slot = nr_string_intern_probe(table, str, hash, length);
+  interned = __atomic_load_n(&slot->str, __ATOMIC_ACQUIRE);
+  if (interned) {
+    return interned;
+  }
+
+  /*
+   * Only strings that have been seen before are added, and only while there
+   * is room for them, so most misses do not take the mutex.
+   */
+  if ((__atomic_load_n(&table->count, __ATOMIC_RELAXED) >= table->limit)
+      || !nr_string_intern_seen(table, hash)) {
+    return NULL;
+  }
+
+  nrt_mutex_lock(&nr_string_intern_mutex);
+
+  /*
+   * Another thread may have added the string, or disabled the table, since
+   * the table was last checked.
+   */
+  table = nr_string_intern_table;
+  if ((NULL == table) || (table->count >= table->limit)) {
+    nrt_mutex_unlock(&nr_string_intern_mutex);
+    return NULL;
+  }
+
+  slot = nr_string_intern_probe(table, str, hash, length);
+  if (NULL == slot->str) {
+    copy = nr_arena_strndup(table->arena, str, (size_t)length);
+    slot->hash = hash;
+    slot->length = length;
+    __atomic_store_n(&slot->str, copy, __ATOMIC_RELEASE);
+    __atomic_store_n(&table->count, table->count + 1, __ATOMIC_RELAXED);
+  }
+  interned = slot->str;
+
+  nrt_mutex_unlock(&nr_string_intern_mutex);
+
+  return interned;
+}
+
+const char* nr_string_intern(const char* str) {
+  int length = 0;
+  uint32_t hash;
+
+  if (NULL == str) {
+    return NULL;
+  }
+
+  hash = nr_mkhash(str, &length);
+
+  return nr_string_intern_with_hash_length(str, hash, length);
+}
+
+const char* nr_string_intern_find(const char* str) {
+  nr_string_intern_table_t* table = nr_string_intern_table_get();
+  int length = 0;
+  uint32_t hash;
+
+  if ((NULL == table) || (NULL == str)) {
+    return NULL;
+  }
+
+  hash = nr_mkhash(str, &length);
+  if (length > NR_STRING_INTERN_MAX_LEN) {
+    return NULL;
+  }
+
+  return __atomic_load_n(&nr_string_intern_probe(table, str, hash, length)->str,
+                         __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * This file contains a process wide table of interned strings.
+ *
+ * Metric names, segment names and datastore products come from a small,
+ * nearly static vocabulary, but are copied into the string pools of every
+ * transaction. Once a string has been interned, string pools reference the
+ * interned copy instead of making their own, and two pooled strings that
+ * were both interned can be compared by pointer.
+ *
+ * Interned strings are never freed while the table is enabled, so their
+ * addresses are stable. Lookups do not take a lock: only adding a string
+ * does. As the table never evicts a string, a string is only added once it
+ * has been seen before, typically by another transaction, so that strings
+ * that are only used once do not fill it. Until then, and once the table is
+ * full, strings are simply not interned, and callers must fall back to
+ * copying them.
+ *
+ * The table is disabled by default: nr_string_intern_set_limit() must be
+ * called to enable it.
+ */
+#ifndef UTIL_STRING_INTERN_HDR
+#define UTIL_STRING_INTERN_HDR
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Strings longer than this are never interned: long strings are usually
+ * unique, such as URLs with embedded ids, and would waste the table.
+ */
+#define NR_STRING_INTERN_MAX_LEN 255
+
+/*
+ * Purpose : Enable or disable the intern table.
+ *
+ * Params  : 1. The maximum number of strings to intern. 0 disables the
+ *              table and frees every interned string.
+ *
+ * Notes   : The limit of an enabled table cannot be changed, as interned
+ *           strings are never moved; non-zero limits are ignored until the
+ *           table has been disabled again.
+ *
+ *           Disabling the table frees the interned strings, so it must only
+ *           be done when nothing references them, such as at shutdown.
+ */
+extern void nr_string_intern_set_limit(size_t max_strings);
+
+/*
+ * Purpose : Return the number of interned strings.
+ */
+extern size_t nr_string_intern_size(void);
+
+/*
+ * Purpose : Intern a string.
+ *
+ * Params  : 1. The string to intern, which must be NULL-terminated even if
+ *              a length is provided.
+ *           2. The hash of the string, as returned by nr_mkhash().
+ *           3. The length of the string.
+ *
+ * Returns : The interned copy of the string, which must not be modified or
+ *           freed, or NULL if the table is disabled or full, or the string
+ *           is too long to be interned or has not been seen before.
+ */
+extern const char* nr_string_intern(const char* str);
+extern const char* nr_string_intern_with_hash_length(const char* str,
+                                                     uint32_t hash,
+                                                     int length);
+
+/*
+ * Purpose : Look for a string in the intern table without adding it.
+ *
+ * Returns : The interned copy of the string, or NULL if it is not interned.
+ */
+extern const char* nr_string_intern_find(const char* str);
+
+#endif /* UTIL_STRING_INTERN_HDR */
@@ -5,9 +5,11 @@
 
 #include "nr_axiom.h"
 
+#include "util_arena.h"
 #include "util_buffer.h"
 #include "util_hash.h"
 #include "util_memory.h"
+#include "util_string_intern.h"
 #include "util_string_pool.h"
 #include "util_strings.h"
 
@@ -34,12 +36,14 @@ typedef struct _nrstring_t {
 } nrstring_t;
 
 typedef struct _nrstrpool_t {
-  int num_entries;     /* Number of strings in the pool */
-  int size;            /* Current max allocated space in pool */
-  nrstring_t* entries; /* One entry for each string in the pool */
-  char** strings;      /* Pointers to stored strings. Separated from entries to
-                          minimize buffer use */
-  nrstable_t* tables;  /* Linked list of tables containing the strings */
+  int num_entries;      /* Number of strings in the pool */
+  int size;             /* Current max allocated space in pool */
+  nrstring_t* entries;  /* One entry for each string in the pool */
+  const char** strings; /* Pointers to stored strings. Separated from entries
+                           to minimize buffer use. Interned strings point into
+                           the process wide intern table */
+  nrstable_t* tables;   /* Linked list of tables containing the strings */
+  nr_arena_t* arena;    /* If set, strings are stored here instead of tables */
 } nrstrpool_t;
 
 int nr_string_len(const nrstrpool_t* pool, int idx) {
@@ -69,8 +73,18 @@ nrpool_t* nr_string_pool_create(void) {
   pool->num_entries = 0;
   pool->size = NR_STRPOOL_STARTING_SIZE;
   pool->entries = (nrstring_t*)nr_zalloc(sizeof(nrstring_t) * pool->size);
-  pool->strings = (char**)nr_zalloc(sizeof(char*) * pool->size);
+  pool->strings
+      = (const char**)nr_zalloc(sizeof(const char*) * pool->size);
   pool->tables = 0;
+  pool->arena = NULL;
+
+  return pool;
+}
+
+nrpool_t* nr_string_pool_create_with_arena(nr_arena_t* arena) {
+  nrstrpool_t* pool = nr_string_pool_create();
+
+  pool->arena = arena;
 
   return pool;
 }
@@ -113,7 +127,8 @@ static int nr_string_find_internal(const nrstrpool_t* pool,
     nrstring_t* entry = &pool->entries[idx - 1];
 
     if ((hash == entry->hash) && (length == entry->length)
-        && (0 == nr_strcmp(string, pool->strings[idx - 1]))) {
+        && ((string == pool->strings[idx - 1])
+            || (0 == nr_strcmp(string, pool->strings[idx - 1])))) {
       return idx;
     }
 
@@ -159,6 +174,7 @@ static int nr_string_add_internal(nrstrpool_t* pool,
                                   int length) {
   int idx;
   int new_string;
+  const char* interned;
   nrstable_t* table;
 
   if (nrunlikely((0 == pool) || (0 == string) || (length < 0))) {
@@ -169,8 +185,8 @@ static int nr_string_add_internal(nrstrpool_t* pool,
     pool->size += NR_STRPOOL_INCREASE_SIZE;
     pool->entries = (nrstring_t*)nr_realloc(pool->entries,
                                             pool->size * sizeof(nrstring_t));
-    pool->strings
-        = (char**)nr_realloc(pool->strings, pool->size * sizeof(char*));
+    pool->strings = (const char**)nr_realloc(pool->strings,
+                                             pool->size * sizeof(const char*));
   }
 
   if (pool->num_entries) {
@@ -185,7 +201,8 @@ static int nr_string_add_internal(nrstrpool_t* pool,
       nrstring_t* entry = &pool->entries[idx - 1];
 
       if ((hash == entry->hash) && (length == entry->length)
-          && (0 == nr_strcmp(string, pool->strings[idx - 1]))) {
+          && ((string == pool->strings[idx - 1])
+              || (0 == nr_strcmp(string, pool->strings[idx - 1])))) {
         return idx;
       }
 
@@ -211,26 +228,39 @@ static int nr_string_add_internal(nrstrpool_t* pool,
   pool->entries[new_string].left = 0;
   pool->entries[new_string].right = 0;
 
-  table = pool->tables;
-  if ((0 == table)
-      || ((table->num_bytes_allocated - table->num_bytes_used)
-          < (length + 1))) {
-    nrstable_t* t;
-    int required = length + 1;
-    int size
-        = (required > NR_STRPOOL_TABLE_SIZE) ? required : NR_STRPOOL_TABLE_SIZE;
-
-    t = (nrstable_t*)nr_zalloc(sizeof(nrstable_t) + size);
-    t->num_bytes_allocated = size;
-    t->num_bytes_used = 0;
-    t->next = pool->tables;
-    pool->tables = t;
-  }
+  /*
+   * Strings that are in the process wide intern table are referenced rather
+   * than copied.
+   */
+  interned = nr_string_intern_with_hash_length(string, hash, length);
+
+  if (interned) {
+    pool->strings[new_string] = interned;
+  } else if (pool->arena) {
+    pool->strings[new_string]
+        = nr_arena_strndup(pool->arena, string, (size_t)length);
+  } else {
+    table = pool->tables;
+    if ((0 == table)
+        || ((table->num_bytes_allocated - table->num_bytes_used)
+            < (length + 1))) {
+      nrstable_t* t;
+      int required = length + 1;
+      int size = (required > NR_STRPOOL_TABLE_SIZE) ? required
+                                                    : NR_STRPOOL_TABLE_SIZE;
+
+      t = (nrstable_t*)nr_zalloc(sizeof(nrstable_t) + size);
+      t->num_bytes_allocated = size;
+      t->num_bytes_used = 0;
+      t->next = pool->tables;
+      pool->tables = t;
+    }
 
-  table = pool->tables;
-  pool->strings[new_string] = table->bytes + table->num_bytes_used;
-  nr_strcpy(table->bytes + table->num_bytes_used, string);
-  table->num_bytes_used += length + 1;
+    table = pool->tables;
+    pool->strings[new_string] = table->bytes + table->num_bytes_used;
+    nr_strcpy(table->bytes + table->num_bytes_used, string);
+    table->num_bytes_used += length + 1;
+  }
 
   if (idx) {
     if (pool->entries[idx - 1].hash < hash) {
@@ -11,6 +11,8 @@
 
 #include <stdint.h>
 
+#include "util_arena.h"
+
 /*
  * These constants determine the starting size of the string pool, and the
  * increments by which the string pool is enlarged.
@@ -56,6 +58,11 @@
  * pool, you may benefit from the very fast string hashing algorithm, which is
  * exposed as an API call.
  *
+ * Third, strings that are in the process wide intern table (see
+ * util_string_intern.h) are not copied into the pool: the pool references the
+ * interned copy instead. Equal strings in different pools may therefore share
+ * the same address.
+ *
  * Last point to remember is that string pools can save a lot of memory, but
  * they will retain *all* strings added to the pool until such time as the pool
  * is destroyed. Depending on the requirements of the usage, string pools may
@@ -68,6 +75,17 @@ typedef struct _nrstrpool_t nrpool_t;
 
 extern nrpool_t* nr_string_pool_create(void);
 
+/*
+ * Purpose : Create a string pool that stores its strings in an arena rather
+ *           than in its own tables.
+ *
+ * Params  : 1. The arena, which must outlive the pool.
+ *
+ * Returns : A newly allocated pool, which must still be destroyed with
+ *           nr_string_pool_destroy().
+ */
+extern nrpool_t* nr_string_pool_create_with_arena(nr_arena_t* arena);
+
 /*
  * Purpose : Add a string to the pool.
  *
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nr_axiom.h"
+
+#include <stdint.h>
+
+#include "util_memory.h"
+#include "util_strings.h"
+#include "util_suffix_matcher.h"
+
+/*
+ * Nodes and values are kept in flat arrays and refer to each other by index,
+ * with 0 meaning none: node 0 is the root, which is never a child, and index
+ * 0 of the values array is left unused.
+ */
+typedef struct _nr_suffix_matcher_node_t {
+  uint32_t first_child;  /* The first node one byte further from the end */
+  uint32_t next_sibling; /* The next node with the same parent */
+  uint32_t first_value;  /* The values of suffixes that end at this node */
+  unsigned char byte;    /* The lowercased byte leading to this node */
+} nr_suffix_matcher_node_t;
+
+typedef struct _nr_suffix_matcher_value_t {
+  int value;
+  uint32_t next;
+} nr_suffix_matcher_value_t;
+
+struct _nr_suffix_matcher_t {
+  nr_suffix_matcher_node_t* nodes;
+  uint32_t nodes_used;
+  uint32_t nodes_capacity;
+  nr_suffix_matcher_value_t* values;
+  uint32_t values_used;
+  uint32_t values_capacity;
+};
+
+nr_suffix_matcher_t* nr_suffix_matcher_create(void) {
+  nr_suffix_matcher_t* matcher = nr_zalloc(sizeof(nr_suffix_matcher_t));
+
+  matcher->nodes_capacity = 64;
+  matcher->nodes
+      = nr_calloc(matcher->nodes_capacity, sizeof(nr_suffix_matcher_node_t));
+  matcher->nodes_used = 1;
+
+  matcher->values_capacity = 16;
+  matcher->values
+      = nr_calloc(matcher->values_capacity, sizeof(nr_suffix_matcher_value_t));
+  matcher->values_used = 1;
+
+  return matcher;
+}
+
+void nr_suffix_matcher_destroy(nr_suffix_matcher_t** matcher_ptr) {
+  if (NULL == matcher_ptr || NULL == *matcher_ptr) {
+    return;
+  }
+
+  nr_free((*matcher_ptr)->nodes);
+  nr_free((*matcher_ptr)->values);
+  nr_realfree((void**)matcher_ptr);
+}
+
+static uint32_t nr_suffix_matcher_find_child(
+    const nr_suffix_matcher_t* matcher,
+    uint32_t node,
+    unsigned char byte) {
+  uint32_t child = matcher->nodes[node].first_child;
+
+  while (child && matcher->nodes[child].byte != byte) {
+    child = matcher->nodes[child].next_sibling;
+  }
+
+  return child;
+}
+
+static uint32_t nr_suffix_matcher_add_child(nr_suffix_matcher_t* matcher,
+                                            uint32_t node,
+                                            unsigned char byte) {
+  uint32_t child;
+
+  if (matcher->nodes_used == matcher->nodes_capacity) {
+    matcher->nodes_capacity *= 2;
+    matcher->nodes = nr_realloc(
+        matcher->nodes,
+        matcher->nodes_capacity * sizeof(nr_suffix_matcher_node_t));
+  }
+
+  child = matcher->nodes_used++;
+  matcher->nodes[child].first_child = 0;
+  matcher->nodes[child].next_sibling = matcher->nodes[node].first_child;
+  matcher->nodes[child].first_value = 0;
+  matcher->nodes[child].byte = byte;
+  matcher->nodes[node].first_child = child;
+
+  return child;
+}
+
+bool nr_suffix_matcher_add(nr_suffix_matcher_t* matcher,
+                           const char* suffix,
+                           size_t suffix_len,
+                           int value) {
+  uint32_t node = 0;
+  uint32_t entry;
+  size_t i;
+
+  if (NULL == matcher || NULL == suffix || 0 == suffix_len) {
+    return false;
+  }
+
+  for (i = suffix_len; i > 0; i--) {
+    unsigned char byte = (unsigned char)nr_tolower(suffix[i - 1]);
+    uint32_t child = nr_suffix_matcher_find_child(matcher, node, byte);
+
+    if (0 == child) {
+      child = nr_suffix_matcher_add_child(matcher, node, byte);
+    }
+    node = child;
+  }
+
+  if (matcher->values_used == matcher->values_capacity) {
+    matcher->values_capacity *= 2;
+    matcher->values = nr_realloc(
+        matcher->values,
+        matcher->values_capacity * sizeof(nr_suffix_matcher_value_t));
+  }
+
+  entry = matcher->values_used++;
+  matcher->values[entry].value = value;
+  matcher->values[entry].next = matcher->nodes[node].first_value;
+  matcher->nodes[node].first_value = entry;
+
+  return true;
+}
+
+size_t nr_suffix_matcher_match(const nr_suffix_matcher_t* matcher,
+                               const char* str,
+                               size_t str_len,
+                               int* values,
+                               size_t max_values) {
+  uint32_t node = 0;
+  size_t num_values = 0;
+  size_t i;
+
+  if (NULL == matcher || NULL == str || NULL == values || 0 == max_values) {
+    return 0;
+  }
+
+  for (i = str_len; i > 0; i--) {
+    uint32_t entry;
+
+    node = nr_suffix_matcher_find_child(
+        matcher, node, (unsigned char)nr_tolower(str[i - 1]));
+    if (0 == node) {
+      break;
+    }
+
+    for (entry = matcher->nodes[node].first_value; entry;
+         entry = matcher->values[entry].next) {
+      int value = matcher->values[entry].value;
+      size_t j;
+
+      if (num_values == max_values) {
+        return num_values;
+      }
+
+      /* Keep the values sorted; there are only ever a few of them. */
+      for (j = num_values; j > 0 && values[j - 1] > value; j--) {
+        values[j] = values[j - 1];
+      }
+      values[j] = value;
+      num_values++;
+    }
+  }
+
+  return num_values;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * A case-insensitive matcher for a fixed set of string suffixes.
+ *
+ * The suffixes are stored reversed in a trie, so that walking a string
+ * backwards from its end visits every suffix it ends with in a single pass,
+ * however many suffixes have been added. Each suffix carries an integer
+ * value that identifies it to the caller.
+ */
+#ifndef UTIL_SUFFIX_MATCHER_HDR
+#define UTIL_SUFFIX_MATCHER_HDR
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct _nr_suffix_matcher_t nr_suffix_matcher_t;
+
+/*
+ * Purpose : Create an empty suffix matcher.
+ *
+ * Returns : A newly allocated suffix matcher, which must be destroyed with
+ *           nr_suffix_matcher_destroy().
+ */
+extern nr_suffix_matcher_t* nr_suffix_matcher_create(void);
+
+/*
+ * Purpose : Destroy a suffix matcher.
+ *
+ * Params  : 1. A pointer to the suffix matcher.
+ */
+extern void nr_suffix_matcher_destroy(nr_suffix_matcher_t** matcher_ptr);
+
+/*
+ * Purpose : Add a suffix to a matcher.
+ *
+ * Params  : 1. The suffix matcher.
+ *           2. The suffix. It is compared case-insensitively.
+ *           3. The length of the suffix.
+ *           4. The value to report when a string ends with the suffix.
+ *
+ * Returns : true if the suffix was added; false if any parameter was invalid.
+ */
+extern bool nr_suffix_matcher_add(nr_suffix_matcher_t* matcher,
+                                  const char* suffix,
+                                  size_t suffix_len,
+                                  int value);
+
+/*
+ * Purpose : Find the suffixes a string ends with.
+ *
+ * Params  : 1. The suffix matcher.
+ *           2. The string to examine.
+ *           3. The length of the string.
+ *           4. An array to receive the values of the matching suffixes.
+ *           5. The size of the values array.
+ *
+ * Returns : The number of values written, in ascending order. Once the array
+ *           is full, further matches are ignored.
+ */
+extern size_t nr_suffix_matcher_match(const nr_suffix_matcher_t* matcher,
+                                      const char* str,
+                                      size_t str_len,
+                                      int* values,
+                                      size_t max_values);
+
+#endif /* UTIL_SUFFIX_MATCHER_HDR */
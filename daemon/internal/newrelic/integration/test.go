@@ -873,6 +873,8 @@ var (
 		regexp.MustCompile(`Memory/Physical`),
 		regexp.MustCompile(`Supportability/execute/user/call_count`),
 		regexp.MustCompile(`Supportability/execute/allocated_segment_count`),
+		regexp.MustCompile(`^Supportability/execute/file_cache/.*`),
+		regexp.MustCompile(`^Supportability/PHP/SQLCache/.*`),
 		regexp.MustCompile(`Memory/RSS`),
 		regexp.MustCompile(`^Supportability\/Locale`),
 		regexp.MustCompile(`^Supportability\/InstrumentedFunction`),
@@ -0,0 +1,55 @@
+<?php
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Measure the per-call overhead the agent adds to calls of uninstrumented
+ * user functions on PHP 8.0+.
+ *
+ * Run it once with every call observed and once with only instrumented
+ * functions observed, and compare the ns/call figures:
+ *
+ *   php -d newrelic.transaction_tracer.detail=0 \
+ *       -d newrelic.transaction_tracer.observe_instrumented_only=0 \
+ *       tests/bench/observer_fcall.php
+ *
+ *   php -d newrelic.transaction_tracer.detail=0 \
+ *       -d newrelic.transaction_tracer.observe_instrumented_only=1 \
+ *       tests/bench/observer_fcall.php
+ *
+ * Running it without the agent loaded gives the baseline cost of a call.
+ */
+
+function leaf($a)
+{
+  return $a + 1;
+}
+
+function branch($a)
+{
+  return leaf($a) + leaf($a);
+}
+
+function run($iterations)
+{
+  $sum = 0;
+  for ($i = 0; $i < $iterations; $i++) {
+    $sum += branch($i);
+  }
+  return $sum;
+}
+
+$iterations = isset($argv[1]) ? (int)$argv[1] : 1000000;
+$calls_per_iteration = 3;
+
+run(1000); // warm up
+
+$start = hrtime(true);
+$sum = run($iterations);
+$elapsed = hrtime(true) - $start;
+
+printf("%-40s %10d calls %8.1f ns/call (%d)\n",
+       'uninstrumented user function', $iterations * $calls_per_iteration,
+       $elapsed / ($iterations * $calls_per_iteration), $sum);
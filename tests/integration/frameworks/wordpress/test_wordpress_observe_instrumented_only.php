@@ -0,0 +1,65 @@
+<?php
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*DESCRIPTION
+When transaction tracer details are disabled and only instrumented functions
+are observed, whether a user function is observed is decided on its first call
+in a request. Test that a hook callback that was first called before WordPress
+was detected is not instrumented in that request, while a hook callback that
+was first called after WordPress was detected is.
+*/
+
+/*SKIPIF
+<?php
+if (version_compare(PHP_VERSION, "8.0", "<")) {
+  die("skip: Only for PHP 8.0+\n");
+}
+*/
+
+/*INI
+newrelic.transaction_tracer.detail = 0
+newrelic.transaction_tracer.observe_instrumented_only = 1
+newrelic.framework.wordpress.hooks.options = all_callbacks
+*/
+
+/*EXPECT
+early_callback called
+early_callback called
+late_callback called
+*/
+
+/*EXPECT_METRICS_EXIST
+Supportability/framework/WordPress/detected
+Supportability/InstrumentedFunction/do_action
+Framework/WordPress/Hook/late_hook
+*/
+
+/*EXPECT_METRICS_DONT_EXIST
+Framework/WordPress/Hook/early_hook
+*/
+
+function early_callback()
+{
+  echo 'early_callback called' . PHP_EOL;
+}
+
+function late_callback()
+{
+  echo 'late_callback called' . PHP_EOL;
+}
+
+// This first call happens before WordPress is detected, while no wraprec
+// exists for the function, so it is left unobserved for this request.
+early_callback();
+
+// WordPress is detected when its configuration file is loaded.
+require_once __DIR__.'/wp-config.php';
+
+add_action("early_hook", "early_callback");
+add_action("late_hook", "late_callback");
+
+do_action("early_hook");
+do_action("late_hook");
@@ -0,0 +1,133 @@
+<?php
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*DESCRIPTION
+When transaction tracer details are disabled and only instrumented functions
+are observed, test that functions wrapped by configuration, and functions
+wrapped using API before their first call, appear as spans in span events,
+while other functions, however long, do not.
+*/
+
+/*SKIPIF
+<?php
+if (version_compare(PHP_VERSION, "8.0", "<")) {
+  die("skip: Only for PHP 8.0+\n");
+}
+*/
+
+/*INI
+newrelic.transaction_tracer.detail = 0
+newrelic.transaction_tracer.observe_instrumented_only = 1
+newrelic.transaction_tracer.custom = "custom_function_from_config"
+newrelic.special.expensive_node_min = 50us
+*/
+
+/*EXPECT
+function_exceeding_tt_detail_threshold called
+custom_function_from_config called
+custom_function_from_api called
+function_exceeding_tt_detail_threshold called
+No alarms and no surprises.
+*/
+
+/*EXPECT_SPAN_EVENTS
+[
+  "?? agent run id",
+  {
+    "reservoir_size": 10000,
+    "events_seen": 3
+  },
+  [
+    [
+      {
+        "category": "generic",
+        "type": "Span",
+        "guid": "??",
+        "traceId": "??",
+        "transactionId": "??",
+        "name": "OtherTransaction/php__FILE__",
+        "timestamp": "??",
+        "duration": "??",
+        "priority": "??",
+        "sampled": true,
+        "nr.entryPoint": true,
+        "transaction.name": "OtherTransaction/php__FILE__"
+      },
+      {},
+      {}
+    ],
+    [
+      {
+        "category": "generic",
+        "type": "Span",
+        "guid": "??",
+        "traceId": "??",
+        "transactionId": "??",
+        "name": "Custom\/custom_function_from_config",
+        "timestamp": "??",
+        "duration": "??",
+        "priority": "??",
+        "sampled": true,
+        "parentId": "??"
+      },
+      {},
+      {}
+    ],
+    [
+      {
+        "category": "generic",
+        "type": "Span",
+        "guid": "??",
+        "traceId": "??",
+        "transactionId": "??",
+        "name": "Custom\/custom_function_from_api",
+        "timestamp": "??",
+        "duration": "??",
+        "priority": "??",
+        "sampled": true,
+        "parentId": "??"
+      },
+      {},
+      {}
+    ]
+  ]
+]
+*/
+
+function function_exceeding_tt_detail_threshold()
+{
+  error_reporting(error_reporting()); // prevent from optimizing this function away
+  time_nanosleep(0, 100 * 1000); // 100 microseconds should be enough (= 2 x newrelic.special.expensive_node_min)
+  echo 'function_exceeding_tt_detail_threshold called' . PHP_EOL;
+}
+
+function custom_function_from_config()
+{
+  error_reporting(error_reporting()); // prevent from optimizing this function away
+  echo 'custom_function_from_config called' . PHP_EOL;
+}
+
+function custom_function_from_api()
+{
+  error_reporting(error_reporting()); // prevent from optimizing this function away
+  echo 'custom_function_from_api called' . PHP_EOL;
+}
+
+// Add the custom wrapper before the first call, when the function's observer
+// handlers are registered.
+newrelic_add_custom_tracer('custom_function_from_api');
+
+// This call will not be a span in span events
+function_exceeding_tt_detail_threshold();
+
+// These calls will be spans in span events
+custom_function_from_config();
+custom_function_from_api();
+
+// This call will not be a span in span events
+function_exceeding_tt_detail_threshold();
+
+echo 'No alarms and no surprises.'  . PHP_EOL;
@@ -6,11 +6,14 @@
 
 /*DESCRIPTION
 When transaction tracer details are disabled, test that only calls to custom wrapped functions appear as spans in span events after they have been wrapped using API.
+The custom tracer is added after the function's first call, so every call has
+to be observed for it to take effect in the same request.
 */
 
 /*INI
 newrelic.transaction_tracer.detail = 0
 newrelic.special.expensive_node_min = 50us
+newrelic.transaction_tracer.observe_instrumented_only = 0
 */
 
 /*EXPECT